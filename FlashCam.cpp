@@ -45,6 +45,10 @@
 
 #include <stdio.h>
 #include <sysexits.h>
+#include <time.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <unistd.h>
 
 /*
  * Constructor
@@ -53,31 +57,47 @@ FlashCam::FlashCam(){
     clear();
 }
 
+FlashCam::FlashCam( unsigned int cameranum ){    
+    _cameranum = cameranum;
+    clear();
+}
+
 /*
  * Destructor
  */
 FlashCam::~FlashCam(){
-    //allow callback/buffer data to be emptied..
-    sleep(1);
-    //cleanup.
-    destroyComponents();
-    FlashCamPLL::destroy();
+    //stop pipeline of this instance
+    if (_active)
+        stopCapture();
+    //cleanup (waits for callbacks and frames held by user)
+    if (destroyComponents()) {
+        //frames not released are freed with the instance
+        fprintf(stderr, "%s: Freeing buffers of unreleased frames.\n", __func__);
+        _userdata.views_lent.store(0, std::memory_order_release);
+        destroyComponents();
+    }
+    FlashCamPLL::destroy(&_state);
+    FlashCamMetrics::unpublish(&_metrics);
+    FlashCamMemory::destroy(&_memory);
     vcos_semaphore_delete(&_userdata.sem_capture);
+    vcos_semaphore_delete(&_userdata.sem_drain);
 }
 
-void FlashCam::clear() {    
+int FlashCam::clear() {    
     if (_active) {
         fprintf(stderr, "%s: Cannot clear FlashCam while it is capturing.\n", __func__);
-        return;
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
     }
     
     if (_initialised) {
-        //allow callback/buffer data to be emptied..
-        sleep(1);
-        //clear old values
-        destroyComponents();
-        FlashCamPLL::destroy();
+        //clear old values (waits for callbacks and frames held by user)
+        if (destroyComponents()) {
+            fprintf(stderr, "%s: Cannot clear FlashCam while frames are not released.\n", __func__);
+            return FlashCamMMAL::mmal_to_int(MMAL_EAGAIN);
+        }
+        FlashCamPLL::destroy(&_state);
         vcos_semaphore_delete(&_userdata.sem_capture);
+        vcos_semaphore_delete(&_userdata.sem_drain);
     }
     
     _initialised = false;
@@ -86,6 +106,10 @@ void FlashCam::clear() {
     
     FlashCamPLL::init(&_state);
     
+    //clear metrics
+    FlashCamMetrics::unpublish(&_metrics);
+    FlashCamMetrics::init(&_metrics, _cameranum);
+    
     //init with default parameter set;
     getDefaultSettings(&_settings);
     
@@ -94,10 +118,11 @@ void FlashCam::clear() {
     _settings.verbose = 0;
     
     //init with default settings
-    setSettings(&_settings); //implicitly resets/configures camera
+    int status = setSettings(&_settings); //implicitly resets/configures camera
     
     //reset verbose
     _settings.verbose = v;
+    return status;
 }
 
 
@@ -109,6 +134,12 @@ int FlashCam::resetCamera() {
         return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
     }
     
+    // Buffers of frames lent to the user are freed by a reset
+    if (_initialised && drainViews()) {
+        fprintf(stderr, "%s: Cannot reset camera while frames are not released.\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EAGAIN);
+    }
+    
     if (_settings.verbose)
         fprintf(stdout, "%s: (re)setting/initializing components.\n", __func__);
     
@@ -160,14 +191,21 @@ int FlashCam::setupComponents() {
         if (vcos_semaphore_create(&_userdata.sem_capture, "FlashCam_sem_captured", 0) != VCOS_SUCCESS) {
             vcos_log_error("%s: Failed to create semaphore", __func__);
             return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        }
+        if (vcos_semaphore_create(&_userdata.sem_drain, "FlashCam_sem_drained", 0) != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to create semaphore", __func__);
+            vcos_semaphore_delete(&_userdata.sem_capture);
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
         }    
                 
         //setup default camera params 
         getDefaultParams(&_params);
+        _params.cameranum = _cameranum;
     }
 
-    //clear current setup
-    destroyComponents();
+    //clear current setup (not while frames are lent to the user)
+    if (destroyComponents())
+        return FlashCamMMAL::mmal_to_int(MMAL_EAGAIN);
 
     // init/reset private variables
     //_initialised          : set at the end of this function.
@@ -177,18 +215,48 @@ int FlashCam::setupComponents() {
     //_camera_component     : (re)set by destroyComponents()
     //_preview_component    : (re)set by destroyComponents()
     //_preview_connection   : (re)set by destroyComponents()
-    //_camera_pool          : (re)set by destroyComponents()
+    //_buffers              : (re)set by destroyComponents()
+    //_capture_buffers      : (re)set by destroyComponents()
     //_framebuffer          : (re)set by destroyComponents()
     //_opengl_queue         : (re)set by destroyComponents()
 
     //set userdata
     _userdata.params            = &_params;
     _userdata.settings          = &_settings;
-    _userdata.camera_pool       = NULL;
+    _userdata.buffers           = &_buffers;
+    _userdata.capture_buffers   = &_capture_buffers;
     _userdata.framebuffer       = NULL;
     _userdata.framebuffer_size  = 0;
-    _userdata.framebuffer_idx   = 0;
+    _userdata.framebuffer_idx.store(0, std::memory_order_relaxed);
+    _userdata.draining.store(false, std::memory_order_relaxed);
+    _userdata.framebuffer_pitch = 0;
+    _userdata.stride            = 0;
+    _userdata.slice_height      = 0;
     _userdata.callback          = NULL;
+    _userdata.callback_view     = NULL;
+    _userdata.callback_batch    = NULL;
+    _userdata.callback_pair     = NULL;
+    _userdata.callback_stack    = NULL;
+    _userdata.ring              = NULL;
+    _userdata.dispatch          = NULL;
+    _userdata.batch             = NULL;
+    _userdata.pair              = NULL;
+    _userdata.stack             = NULL;
+    _userdata.shared            = NULL;
+    _userdata.recorder          = NULL;
+    _userdata.clock             = &_clock;
+    _userdata.sched             = &_sched;
+    _userdata.replay            = &_replay;
+    _userdata.state             = &_state;
+    _userdata.metrics           = &_metrics;
+    _userdata.burst.frames      = NULL;
+    _userdata.burst.pts         = NULL;
+    _userdata.burst.num         = 0;
+    _userdata.burst.idx.store(0, std::memory_order_relaxed);
+    FlashCamTrace::reset(&_userdata.trace);
+    FlashCamSched::reset(&_sched);
+    FlashCamStream::reset(&_userdata.stream);
+    resetStats();
     
 #ifdef BUILD_FLASHCAM_WITH_OPENGL
     _userdata.callback_egl      = NULL;
@@ -202,8 +270,6 @@ int FlashCam::setupComponents() {
     //setup camera
     // - internally sets:
     //      _camera_component
-    //      _camera_pool
-    //      _userdata.camera_pool
     //      _userdata.framebuffer
     //      _userdata.framebuffer_size
     if ((status = setupComponentCamera()) != MMAL_SUCCESS)  {
@@ -236,6 +302,10 @@ int FlashCam::setupComponents() {
         return FlashCamMMAL::mmal_to_int(status);
     }
     
+    //estimate the GPU clock in the background: timestamps of frames in CLOCK_MONOTONIC
+    if (_settings.clock_interval && FlashCamClock::start(&_clock, _camera_component->control, _settings.clock_interval))
+        vcos_log_error("%s: Failed to start GPU clock estimation", __func__);
+    
     if (_settings.verbose)
         fprintf(stdout, "%s: Finished setup\n", __func__);
     
@@ -294,24 +364,32 @@ MMAL_STATUS_T FlashCam::setupComponentCamera() {
     MMAL_PORT_T   *video_port = _camera_component->output[MMAL_CAMERA_VIDEO_PORT  ];
     MMAL_PORT_T *capture_port = _camera_component->output[MMAL_CAMERA_CAPTURE_PORT];
     
-    // Align height/width
-    _settings.width  = VCOS_ALIGN_UP(_settings.width , 32);
-    _settings.height = VCOS_ALIGN_UP(_settings.height, 16);
+    // I420 requires even sizes. The ports are padded to the alignment of the camera, the image is cropped 
+    //  from that. Delivered frames are of the set size, see buffer_callback.
+    _settings.width  = VCOS_ALIGN_UP(_settings.width , 2);
+    _settings.height = VCOS_ALIGN_UP(_settings.height, 2);
+    unsigned int width_aligned  = VCOS_ALIGN_UP(_settings.width , 32);
+    unsigned int height_aligned = VCOS_ALIGN_UP(_settings.height, 16);
     
     if (_settings.verbose)
-        fprintf(stdout, "%s: Aligned image size: %d x %d (w x h) \n" , __func__, _settings.width , _settings.height);
+        fprintf(stdout, "%s: Aligned image size: %d x %d (w x h) \n" , __func__, width_aligned , height_aligned);
+    
+    // Frames buffered by the camera: more at high framerates (as raspivid) and at least the initial number of buffers.
+    unsigned int num_frames = 3 + vcos_max(0, ((int) _params.framerate - 30) / 10);
+    num_frames = vcos_max(num_frames, _settings.buffer_num);
+    num_frames = vcos_min(num_frames, FLASHCAM_BUFFERS_MAX);
     
     // setup the camera configuration
     MMAL_PARAMETER_CAMERA_CONFIG_T cam_config =
     {
         { MMAL_PARAMETER_CAMERA_CONFIG, sizeof(cam_config) },
-        .max_stills_w                           = _settings.width,
-        .max_stills_h                           = _settings.height,
+        .max_stills_w                           = width_aligned,
+        .max_stills_h                           = height_aligned,
         .stills_yuv422                          = 0,
         .one_shot_stills                        = 1,
-        .max_preview_video_w                    = _settings.width,
-        .max_preview_video_h                    = _settings.height,
-        .num_preview_video_frames               = 3,
+        .max_preview_video_w                    = width_aligned,
+        .max_preview_video_h                    = height_aligned,
+        .num_preview_video_frames               = num_frames,
         .stills_capture_circular_buffer_height  = 0,
         .fast_preview_resume                    = 0,
         .use_stc_timestamp                      = MMAL_PARAM_TIMESTAMP_MODE_RAW_STC
@@ -329,8 +407,8 @@ MMAL_STATUS_T FlashCam::setupComponentCamera() {
     //Preview format
     format->encoding                    = MMAL_ENCODING_OPAQUE;
     format->encoding_variant            = MMAL_ENCODING_I420;        
-    format->es->video.width             = _settings.width;
-    format->es->video.height            = _settings.height;
+    format->es->video.width             = width_aligned;
+    format->es->video.height            = height_aligned;
     format->es->video.crop.x            = 0;
     format->es->video.crop.y            = 0;
     format->es->video.crop.width        = _settings.width;
@@ -354,8 +432,8 @@ MMAL_STATUS_T FlashCam::setupComponentCamera() {
         format->encoding                = MMAL_ENCODING_I420;
     }
     format->encoding_variant            = MMAL_ENCODING_I420;     
-    format->es->video.width             = _settings.width;
-    format->es->video.height            = _settings.height;
+    format->es->video.width             = width_aligned;
+    format->es->video.height            = height_aligned;
     format->es->video.crop.x            = 0;
     format->es->video.crop.y            = 0;
     format->es->video.crop.width        = _settings.width;
@@ -390,8 +468,8 @@ MMAL_STATUS_T FlashCam::setupComponentCamera() {
     format = capture_port->format;
     format->encoding                    = MMAL_ENCODING_I420;
     format->encoding_variant            = MMAL_ENCODING_I420;     
-    format->es->video.width             = _settings.width;
-    format->es->video.height            = _settings.height;
+    format->es->video.width             = width_aligned;
+    format->es->video.height            = height_aligned;
     format->es->video.crop.x            = 0;
     format->es->video.crop.y            = 0;
     format->es->video.crop.width        = _settings.width;
@@ -413,11 +491,24 @@ MMAL_STATUS_T FlashCam::setupComponentCamera() {
         return status;
     }
     
-    // YUV-data framesize 
-    _userdata.framebuffer_size = VCOS_ALIGN_UP(_settings.width * _settings.height * 1.5, 32);    
+    // YUV-data framesize: Y plane and two chroma planes of half the pitch and height,
+    //  or the selected planes of each extracted region.
+    if ((_settings.pitch) && (_settings.pitch < _settings.width)) {
+        fprintf(stderr, "%s: Pitch smaller than width (%d < %d), using packed frames.\n", __func__, _settings.pitch, _settings.width);
+        _settings.pitch = 0;
+    }
+    _userdata.framebuffer_pitch = VCOS_ALIGN_UP(_settings.pitch ? _settings.pitch : _settings.width, 2);
+    _userdata.extract           = _settings.extract;
+    _userdata.framebuffer_size  = FlashCamExtract::init(&_userdata.extract, _settings.width, _settings.height, _userdata.framebuffer_pitch);
+    if (_userdata.framebuffer_size == 0) {
+        vcos_log_error("%s: Invalid extraction of planes / regions", __func__);
+        destroyComponents();        
+        return MMAL_EINVAL;
+    }
+    _userdata.framebuffer_size  = VCOS_ALIGN_UP(_userdata.framebuffer_size, FLASHCAM_MEMORY_ALIGN);
     
-    //create buffer for image
-    _framebuffer = new unsigned char[_userdata.framebuffer_size];
+    //buffer for image: kept in the memory pool across resets, only grows
+    _framebuffer = FlashCamMemory::reserve(&_memory, &_memory.frame, _userdata.framebuffer_size, _settings.memory);
     if (!_framebuffer) {
         vcos_log_error("%s: Failed to allocate image buffer", __func__);
         destroyComponents();        
@@ -454,13 +545,23 @@ MMAL_STATUS_T FlashCam::setupComponentPreview() {
 }
 
 
-void FlashCam::destroyComponents() {
+int FlashCam::destroyComponents() {
     if (_settings.verbose)
         fprintf(stdout, "%s: Clearing components\n", __func__);
     
+    //callbacks finished, frames returned by user: their buffers are freed below
+    // Otherwise nothing is destroyed, so releaseFrame() still finds the port and pool of a lent frame.
+    if (fenceCallbacks() || drainViews()) {
+        fprintf(stderr, "%s: Cannot clear components while frames are not released.\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EAGAIN);
+    }
+    
     //reset init flag    
     _initialised = false;
     
+    //GPU clock is sampled through the camera
+    FlashCamClock::stop(&_clock);
+    
     // Disable connections
     if (_preview_connection) {
         mmal_connection_destroy(_preview_connection);
@@ -477,32 +578,50 @@ void FlashCam::destroyComponents() {
         mmal_component_destroy( _camera_component );
     }
     
-    // Disable pool
-    if (_camera_pool) {
-        mmal_pool_destroy( _camera_pool );
-    }
+    // Disable pools
+    FlashCamBuffers::destroy(&_buffers);
+    FlashCamBuffers::destroy(&_capture_buffers);
+    
+    // Framebuffer stays in the memory pool (released by destructor)
+    
+    // Clear ring
+    FlashCamRing::destroy(&_ring);
+    
+    // Clear dispatch pool
+    FlashCamDispatch::destroy(&_dispatch);
+    
+    // Clear batches
+    FlashCamBatch::destroy(&_batch);
+    
+    // Clear pairs
+    FlashCamPair::destroy(&_pair);
+    
+    // Clear stack
+    FlashCamStack::destroy(&_stack);
     
-    // Clear buffer
-    if (_framebuffer) 
-        delete[] _framebuffer;
+    // Remove shared ring
+    FlashCamShared::destroy(&_shared);
+    
+    // Free recorder queue
+    FlashCamRecorder::destroy(&_recorder);
     
 #ifdef BUILD_FLASHCAM_WITH_OPENGL
     if (_opengl_queue) {
         mmal_queue_destroy( _opengl_queue );
         _opengl_queue = NULL;
     }
-    FlashCamOpenGL::destroy();
+    FlashCamOpenGL::destroy(&_state);
 #endif
 
     // Reset pointers
     _preview_connection = NULL;
     _preview_component  = NULL;
     _camera_component   = NULL;
-    _camera_pool        = NULL;
     _framebuffer        = NULL;
     
     if (_settings.verbose)
         fprintf(stdout, "%s: Components cleared\n", __func__);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
 }
 
 /*
@@ -547,33 +666,80 @@ void FlashCam::control_callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer)
 }
 
 /*
- * void FlashCam::control_callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer)
+ * void FlashCam::buffer_callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer)
  *  Callback function for buffer-events (that is, camera returned an image)
+ *  Callbacks are counted, so stopping can wait for the callbacks in progress (fenceCallbacks).
  */
 void FlashCam::buffer_callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+    FLASHCAM_PORT_USERDATA_T *userdata = (FLASHCAM_PORT_USERDATA_T *)port->userdata;
+    
+    if (userdata)
+        userdata->callbacks_entered.fetch_add(1, std::memory_order_seq_cst);
+    
+    processBuffer(port, buffer);
+    
+    if (userdata) {
+        FlashCamMetrics::pool(userdata->metrics, getBuffers(userdata, port)->circulating, userdata->views_lent);
+        userdata->callbacks_exited.fetch_add(1, std::memory_order_release);
+    }
+}
+
+/*
+ * void FlashCam::processBuffer(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer)
+ *  Stitches / delivers a camera buffer.
+ */
+void FlashCam::processBuffer(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
     int abort           = 0; //flag for detecting if we need to abort due to error
+    int failed          = 0; //flag for detecting if the camera aborted the frame
     int complete        = 0; //flag for detecting if a full frame is recieved
     int discard         = 0; //flag for detecting if we need to discard buffer
-    int max_idx         = 0; //flag for detecting if _framebuffer is out of memory
+    unsigned int max_idx = 0; //flag for detecting if _framebuffer is out of memory
     uint64_t presentationtime = 0;
+    uint64_t arrival    = 0; //latency trace: arrival of buffer
+    uint64_t hold_start = 0; //buffer tuning: arrival of buffer
+    uint64_t host       = 0; //pts in CLOCK_MONOTONIC
+    uint32_t host_error = 0; //error bound of host
+    bool pll_state      = false;
+    FLASHCAM_FRAME_VIEW_T *view = NULL; //zero-copy view on buffer
+    unsigned char *framebuffer  = NULL; //target of stitching
+    unsigned char **burst       = NULL; //framebuffers of burst (captureBurst)
     
     //retrieve userdata
     FLASHCAM_PORT_USERDATA_T *userdata = (FLASHCAM_PORT_USERDATA_T *)port->userdata;
+    FLASHCAM_BUFFERS_T       *buffers  = NULL;
           
     //is userdata properly set?
     if (userdata) {
+        buffers = getBuffers(userdata, port);
+        burst   = userdata->burst.frames.load(std::memory_order_acquire);
         
+        // Armed ports: buffers of the port of the previous mode (still in flight) are returned unused
+        if ((buffers == userdata->capture_buffers) != (userdata->settings->mode == FLASHCAM_MODE_CAPTURE)) {
+            discard = 1;
+            
         // Are there bytes to write?
-        if (buffer->length) {
+        } else if (buffer->length) {
+            
+            arrival = FlashCamTrace::now(&(userdata->trace));
+            FlashCamSched::callback(userdata->sched);
+            FlashCamSched::wake(userdata->sched, FLASHCAM_THREAD_CALLBACK, &(userdata->sched->callback_wake), buffer->pts);
+            FlashCamMetrics::buffer(userdata->metrics);
+            if (userdata->replay->record)
+                FlashCamReplay::write(userdata->replay, buffer);
+            if (buffers->tune)
+                hold_start = FlashCamBuffers::now();
 
-            bool pll_state = false;
 #ifdef BUILD_FLASHCAM_WITH_PLL
-            FlashCamPLL::update(buffer->pts, &pll_state);
+            FlashCamPLL::update(userdata->state, buffer->pts, &pll_state);
 #endif
             
             //OpenGL processing?
             if (userdata->settings->opengl_enabled) {
 #ifdef BUILD_FLASHCAM_WITH_OPENGL      
+                //opaque buffers hold a complete frame
+                FlashCamStream::frame(&(userdata->stream), buffer->pts, userdata->params->framerate);
+                FlashCamMetrics::frame(userdata->metrics);
+                
                 unsigned int length = mmal_queue_length(userdata->opengl_queue);
                 //fprintf(stdout, "%s: QueueSize - %d (%d)  \n", __func__, length, port->buffer_num);
                 
@@ -581,17 +747,21 @@ void FlashCam::buffer_callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer)
                 if ( length + 1 < port->buffer_num) {
                     
                     // set FlashCam data in Buffer.
-                    FLASHCAM_OPENGL_BUF_T* glb = FlashCamOpenGL::getOpenGLBuffer();
+                    FLASHCAM_OPENGL_BUF_T* glb = FlashCamOpenGL::getOpenGLBuffer(userdata->state);
                     
                     if (glb != NULL) {
                         glb->pll_state = pll_state;
                         glb->buffer    = buffer;
+                        glb->stamps    = {};
+                        glb->stamps.pts     = buffer->pts;
+                        glb->stamps.arrival = arrival;
                     } else {
                         vcos_log_error("%s: No OpenGL buffer available in pool." , __func__);
                    }
                     
                     //push buffer to OpenGL queue for processing
                     mmal_queue_put(userdata->opengl_queue, &glb->glb_mmal_buffer);
+                    FlashCamMetrics::opengl(userdata->metrics, length + 1);
                     
                     //fprintf(stdout, "%s: Posting...\n", __func__);
                     vcos_semaphore_post(&(userdata->sem_capture));
@@ -599,45 +769,146 @@ void FlashCam::buffer_callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer)
                     //buffer released by OpenGL worker.
                     return;
                 } 
-                fprintf(stdout, "%s: DISCARD! \n", __func__);
+                //OpenGL worker is too slow: drop frame
+                FlashCamStream::discard(&(userdata->stream), 1);
 #else 
                 vcos_log_error("%s: OpenGL Support not build." , __func__);
 #endif
                 discard = 1;
+                // zero-copy: a complete frame in a single buffer is lent to the user
+            } else if ((view = getFrameView(userdata, buffers, buffer)) != NULL) {
+                
+                //lock buffer --> unlocked by releaseFrame()
+                mmal_buffer_header_mem_lock(buffer);
+                
+                // planes are padded according to the port format
+                unsigned int stride  = userdata->stride;
+                unsigned int size_Y  = stride * userdata->slice_height;
+                
+                view->data[0]   = &buffer->data[0];
+                view->data[1]   = &buffer->data[size_Y];
+                view->data[2]   = &buffer->data[size_Y + (size_Y >> 2)];
+                view->stride[0] = stride;
+                view->stride[1] = stride >> 1;
+                view->stride[2] = stride >> 1;
+                view->width     = userdata->settings->width;
+                view->height    = userdata->settings->height;
+                view->pts       = buffer->pts;
+                view->pll_state = pll_state;
+                FlashCamClock::translate(userdata->clock, buffer->pts, &view->host, &view->host_error);
+                view->port      = port;
+                view->buffer    = buffer;
+                view->arrival   = hold_start;
+                
+                userdata->stats.frames.fetch_add(1, std::memory_order_relaxed);
+                FlashCamStream::frame(&(userdata->stream), buffer->pts, userdata->params->framerate);
+                FlashCamMetrics::frame(userdata->metrics);
+                
+                FLASHCAM_TRACE_STAMPS_T stamps = {};
+                stamps.pts     = buffer->pts;
+                stamps.arrival = arrival;
+                stamps.entry   = FlashCamTrace::now(&(userdata->trace));
+                
+                //record a copy of the frame, the buffer itself is lent to the user
+                if (userdata->recorder) {
+                    unsigned char *record = FlashCamRecorder::acquire(userdata->recorder);
+                    if (record) {
+                        FlashCamExtract::band(&(userdata->extract), record, &buffer->data[0], stride, 0, userdata->slice_height);
+                        FlashCamRecorder::publish(userdata->recorder, userdata->stream.received, buffer->pts, pll_state, view->host, view->host_error);
+                    }
+                }
+                
+                //buffer is released (and replaced) by releaseFrame().
+                userdata->views_lent.fetch_add(1, std::memory_order_relaxed);
+                uint64_t callback_start = FlashCamMetrics::now();
+                userdata->callback_view(view);
+                FlashCamMetrics::callback(userdata->metrics, FlashCamMetrics::now() - callback_start);
+                
+                stamps.exit    = FlashCamTrace::now(&(userdata->trace));
+                FlashCamTrace::record(&(userdata->trace), &stamps);
+                FlashCamBuffers::frame(buffers, userdata->params->framerate);
+                postCapture(userdata, buffers);
+                return;
+                
                 // `normal` processing
             } else {
-                    
+                
                 //lock buffer --> callback is async!
                 mmal_buffer_header_mem_lock(buffer);
                 
-                // We are decoding YUV packages
-                // - 4/6 = Y
-                // - 1/6 = U
-                // - 1/6 = V
-                unsigned int length_Y = (buffer->length << 2) / 6;
-                unsigned int length_U = (buffer->length - length_Y) >> 1;
-                unsigned int length_V = length_U;
+                //first buffer of frame
+                unsigned int row = userdata->framebuffer_idx.load(std::memory_order_relaxed);
+                if (row == 0) {
+                    userdata->stamps = {};
+                    userdata->stamps.arrival = arrival;
+                }
+                
+                // Stitch into a slot of the ring (FLASHCAM_DELIVERY_RING). 
+                // When the ring is full, the frame is dropped without being copied.
+                // The same holds for batches (FLASHCAM_DELIVERY_BATCH) when all of them are taken.
+                // Pairs (FLASHCAM_DELIVERY_PAIR) skip frames that cannot be paired: these are not copied at all.
+                // Stacks (FLASHCAM_DELIVERY_STACK) likewise skip frames outside of any window, and drop frames when all slots are taken.
+                // A dispatch pool (FLASHCAM_DELIVERY_DISPATCH) and the shared ring (FLASHCAM_DELIVERY_SHARED) always provide a frame.
+                framebuffer = userdata->framebuffer;
+                if (burst) {
+                    //frames beyond the burst (late still) are not copied
+                    unsigned int idx = userdata->burst.idx.load(std::memory_order_relaxed);
+                    framebuffer = (idx < userdata->burst.num) ? burst[idx] : NULL;
+                } else if (userdata->ring) {
+                    framebuffer = (row == 0) ? FlashCamRing::acquire(userdata->ring) : FlashCamRing::current(userdata->ring);
+                } else if (userdata->dispatch) {
+                    unsigned char *frame = (row == 0) ? FlashCamDispatch::acquire(userdata->dispatch) : FlashCamDispatch::current(userdata->dispatch);
+                    if (frame)
+                        framebuffer = frame;
+                } else if (userdata->shared) {
+                    unsigned char *slot = (row == 0) ? FlashCamShared::acquire(userdata->shared) : FlashCamShared::current(userdata->shared);
+                    if (slot)
+                        framebuffer = slot;
+                } else if (userdata->batch) {
+                    framebuffer = (row == 0) ? FlashCamBatch::acquire(userdata->batch) : FlashCamBatch::current(userdata->batch);
+                } else if (userdata->pair) {
+                    framebuffer = (row == 0) ? FlashCamPair::acquire(userdata->pair, buffer->pts, pll_state) : FlashCamPair::current(userdata->pair);
+                } else if (userdata->stack) {
+                    framebuffer = (row == 0) ? FlashCamStack::acquire(userdata->stack) : FlashCamStack::current(userdata->stack);
+                }
+                
+                // Record: the band is also copied into a record of the recorder (NULL: queue full, frame not recorded)
+                unsigned char *record = NULL;
+                if (userdata->recorder)
+                    record = (row == 0) ? FlashCamRecorder::acquire(userdata->recorder) : FlashCamRecorder::current(userdata->recorder);
+                
+                // We are decoding YUV packages: each buffer holds a band of `rows` rows of the frame
+                // - Y : rows     x stride
+                // - U : rows / 2 x stride / 2
+                // - V : rows / 2 x stride / 2
+                // The planes in the buffer are padded (stride, slice_height) according to the port format,
+                //  only the extracted planes and regions of the image are copied into `framebuffer`.
+                unsigned int stride   = userdata->stride;
+                unsigned int rows     = buffer->length / (stride + (stride >> 1));
                 
-                unsigned int offset_Y = userdata->framebuffer_idx;
-                unsigned int offset_U = userdata->settings->height * userdata->settings->width * 1.00 + (userdata->framebuffer_idx >> 2);
-                unsigned int offset_V = userdata->settings->height * userdata->settings->width * 1.25 + (userdata->framebuffer_idx >> 2);
-                                                    
-                //max index to be written
-                max_idx = offset_V + length_V;
+                //max row to be written
+                max_idx = row + rows;
                 
                 //does it fit in buffer?
-                if ( max_idx > userdata->framebuffer_size ) {
-                    vcos_log_error("%s: Framebuffer full (%d > %d) - aborting.." , __func__, max_idx , userdata->framebuffer_size );
+                if ( (rows == 0) || (max_idx > userdata->slice_height) ) {
+                    vcos_log_error("%s: Framebuffer full (%u > %u rows) - aborting.." , __func__, max_idx , userdata->slice_height );
                     abort = 1;
                 } else {
-                    //copy Y
-                    memcpy ( &userdata->framebuffer[offset_Y] , &buffer->data[0]                   , length_Y );
-                    //copy U
-                    memcpy ( &userdata->framebuffer[offset_U] , &buffer->data[length_Y]            , length_U );
-                    //copy V
-                    memcpy ( &userdata->framebuffer[offset_V] , &buffer->data[length_Y + length_U] , length_V );
+                    //copy regions within band (NULL: skipped frame). Pairs may subtract the band from/by its partner instead.
+                    if (framebuffer) {
+                        bool lit = false;
+                        uint64_t copy_start = FlashCamMetrics::now();
+                        unsigned int copied = (userdata->pair && FlashCamPair::fused(userdata->pair, &lit)) ?
+                            FlashCamExtract::subtractBand(&(userdata->extract), framebuffer, &buffer->data[0], stride, row, rows, lit) :
+                            FlashCamExtract::band(&(userdata->extract), framebuffer, &buffer->data[0], stride, row, rows);
+                        userdata->stats.bytes_copied.fetch_add(copied, std::memory_order_relaxed);
+                        FlashCamMetrics::copy(userdata->metrics, copied, FlashCamMetrics::now() - copy_start);
+                    }
+                    if (record)
+                        FlashCamExtract::band(&(userdata->extract), record, &buffer->data[0], stride, row, rows);
                     //update index
-                    userdata->framebuffer_idx += length_Y;
+                    userdata->framebuffer_idx.store(row + rows, std::memory_order_relaxed);
+                    userdata->stamps.copied = FlashCamTrace::now(&(userdata->trace));
                 }
 
                 //done with data..
@@ -648,7 +919,7 @@ void FlashCam::buffer_callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer)
         if (discard == 0) {
             // Check end of frame or error
             if (buffer->flags & MMAL_BUFFER_HEADER_FLAG_TRANSMISSION_FAILED)    
-                abort = 1;
+                abort = failed = 1;
             
             if (buffer->flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END)              
                 complete = 1;
@@ -660,34 +931,163 @@ void FlashCam::buffer_callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer)
     }
 
     // release buffer back to the pool
+    if (hold_start)
+        FlashCamBuffers::hold(buffers, FlashCamBuffers::now() - hold_start);
     mmal_buffer_header_release(buffer);
     
     // and send one back to the port (if still open)
-    if (port->is_enabled) {
-        MMAL_STATUS_T status;
-        MMAL_BUFFER_HEADER_T *new_buffer = mmal_queue_get(userdata->camera_pool->queue);
-        
-        // and back to the port from there.
-        if (new_buffer)
-            status = mmal_port_send_buffer(port, new_buffer);
-        
-        if (!new_buffer || status != MMAL_SUCCESS)
-            vcos_log_error("%s: Unable to return the buffer to the camera still port", __func__);
-    }
+    if (buffers && FlashCamBuffers::send(buffers, port))
+        vcos_log_error("%s: Unable to return the buffer to the camera still port", __func__);
     
     if (discard == 0) {
         //post that we are done
         if (abort) {
-            vcos_semaphore_post(&(userdata->sem_capture));
+            if (burst) {
+                unsigned int idx = userdata->burst.idx.load(std::memory_order_relaxed);
+                if (idx < userdata->burst.num) {
+                    userdata->burst.pts[idx] = MMAL_TIME_UNKNOWN;
+                    userdata->burst.idx.store(idx + 1, std::memory_order_release);
+                }
+            } else if (userdata->ring)
+                FlashCamRing::cancel(userdata->ring);
+            else if (userdata->shared)
+                FlashCamShared::cancel(userdata->shared);
+            else if (userdata->batch)
+                FlashCamBatch::cancel(userdata->batch);
+            else if (userdata->pair)
+                FlashCamPair::cancel(userdata->pair);
+            else if (userdata->stack)
+                FlashCamStack::cancel(userdata->stack);
+            if (userdata->dispatch)
+                FlashCamDispatch::cancel(userdata->dispatch);
+            if (userdata->recorder)
+                FlashCamRecorder::cancel(userdata->recorder);
+            
+            //aborted by camera, or not fitting in framebuffer
+            if (failed)
+                FlashCamStream::abort(&(userdata->stream), presentationtime, userdata->params->framerate);
+            else
+                FlashCamStream::discard(&(userdata->stream), 1);
+            
+            //next buffer starts a new frame
+            postCapture(userdata, buffers);
         } else if (complete) {        
-            if (userdata->callback)
-                userdata->callback( userdata->framebuffer , userdata->settings->width , userdata->settings->height);
+            userdata->stamps.pts = presentationtime;
+            FlashCamStream::frame(&(userdata->stream), presentationtime, userdata->params->framerate);
+            FlashCamMetrics::frame(userdata->metrics);
+            FlashCamClock::translate(userdata->clock, presentationtime, &host, &host_error);
+            if (userdata->recorder)
+                FlashCamRecorder::publish(userdata->recorder, userdata->stream.received, presentationtime, pll_state, host, host_error);
+            if (burst) {
+                //frame is kept in framebuffer of burst
+                unsigned int idx = userdata->burst.idx.load(std::memory_order_relaxed);
+                if (idx < userdata->burst.num) {
+                    userdata->stats.frames.fetch_add(1, std::memory_order_relaxed);
+                    userdata->burst.pts[idx] = presentationtime;
+                    userdata->burst.idx.store(idx + 1, std::memory_order_release);
+                } else
+                    FlashCamStream::discard(&(userdata->stream), 1);
+            } else if (userdata->ring) {
+                //consumer thread calls user
+                FlashCamStream::discard(&(userdata->stream), FlashCamRing::publish(userdata->ring, presentationtime, pll_state, &(userdata->stamps)));
+            } else if (userdata->dispatch) {
+                //workers call user, might block (FLASHCAM_DISPATCH_BLOCK)
+                FlashCamStream::discard(&(userdata->stream), FlashCamDispatch::publish(userdata->dispatch, presentationtime, pll_state, &(userdata->stamps)));
+            } else if (userdata->batch) {
+                //consumer thread calls user once the batch is full
+                FlashCamStream::discard(&(userdata->stream), FlashCamBatch::publish(userdata->batch, presentationtime, pll_state, host, host_error, &(userdata->stamps)));
+            } else if (userdata->pair) {
+                //consumer thread calls user once the lit frame is paired
+                FlashCamStream::discard(&(userdata->stream), FlashCamPair::publish(userdata->pair, presentationtime, host, host_error, &(userdata->stamps)));
+            } else if (userdata->stack) {
+                //consumer thread stacks the frame, calls user every `stack_interval` frames
+                FlashCamStream::discard(&(userdata->stream), FlashCamStack::publish(userdata->stack, presentationtime, pll_state, host, host_error, &(userdata->stamps)));
+            } else if (userdata->shared) {
+                //readers take the frame from the slot, user gets a pointer to it
+                unsigned char *slot = FlashCamShared::current(userdata->shared);
+                FlashCamShared::publish(userdata->shared, presentationtime, pll_state, host, host_error);
+                userdata->stats.frames.fetch_add(1, std::memory_order_relaxed);
+                if (userdata->callback && slot) {
+                    userdata->stamps.entry = FlashCamTrace::now(&(userdata->trace));
+                    uint64_t callback_start = FlashCamMetrics::now();
+                    userdata->callback( slot , userdata->extract.rois[0].width , userdata->extract.rois[0].height);
+                    FlashCamMetrics::callback(userdata->metrics, FlashCamMetrics::now() - callback_start);
+                    userdata->stamps.exit  = FlashCamTrace::now(&(userdata->trace));
+                    FlashCamTrace::record(&(userdata->trace), &(userdata->stamps));
+                }
+            } else if (userdata->callback) {
+                userdata->stats.frames.fetch_add(1, std::memory_order_relaxed);
+                userdata->stamps.entry = FlashCamTrace::now(&(userdata->trace));
+                uint64_t callback_start = FlashCamMetrics::now();
+                userdata->callback( userdata->framebuffer , userdata->extract.rois[0].width , userdata->extract.rois[0].height);
+                FlashCamMetrics::callback(userdata->metrics, FlashCamMetrics::now() - callback_start);
+                userdata->stamps.exit  = FlashCamTrace::now(&(userdata->trace));
+                FlashCamTrace::record(&(userdata->trace), &(userdata->stamps));
+            }
+            
+            //tune number of buffers: a callback on this thread holds back all buffers queued meanwhile
+            if (hold_start)
+                FlashCamBuffers::hold(buffers, FlashCamBuffers::now() - hold_start);
+            FlashCamBuffers::frame(buffers, userdata->params->framerate);
             
             //release semaphore
-            userdata->framebuffer_idx = 0;
-            vcos_semaphore_post(&(userdata->sem_capture));
+            postCapture(userdata, buffers);
+        }
+    }
+}
+
+/*
+ * FLASHCAM_BUFFERS_T *FlashCam::getBuffers(FLASHCAM_PORT_USERDATA_T *userdata, MMAL_PORT_T *port)
+ *  Returns the buffers of the port which produced a buffer: both ports can be armed at once.
+ *  Replayed buffers are handled as buffers of the video port.
+ */
+FLASHCAM_BUFFERS_T *FlashCam::getBuffers(FLASHCAM_PORT_USERDATA_T *userdata, MMAL_PORT_T *port) {
+    if (port == userdata->capture_buffers->port)
+        return userdata->capture_buffers;
+    return userdata->buffers;
+}
+
+/*
+ * void FlashCam::postCapture(FLASHCAM_PORT_USERDATA_T *userdata, FLASHCAM_BUFFERS_T *buffers)
+ *  Ends a completed (or aborted) frame: the next buffer starts a new frame, a caller in `drainFrame()` is woken.
+ *  Signals the frame. Armed ports: a video frame which completes after switching to capture-mode
+ *  was drained already or would be taken for the still, so it is not signalled.
+ */
+void FlashCam::postCapture(FLASHCAM_PORT_USERDATA_T *userdata, FLASHCAM_BUFFERS_T *buffers) {
+    //seq_cst: either `drainFrame()` sees the frame ended, or this sees it draining
+    userdata->framebuffer_idx.store(0, std::memory_order_seq_cst);
+    if (userdata->draining.load(std::memory_order_seq_cst))
+        vcos_semaphore_post(&(userdata->sem_drain));
+    
+    if ((buffers == userdata->capture_buffers) == (userdata->settings->mode == FLASHCAM_MODE_CAPTURE))
+        vcos_semaphore_post(&(userdata->sem_capture));
+}
+
+/*
+ * FLASHCAM_FRAME_VIEW_T *FlashCam::getFrameView(FLASHCAM_PORT_USERDATA_T *userdata, FLASHCAM_BUFFERS_T *buffers, MMAL_BUFFER_HEADER_T *buffer)
+ *  Returns the view of `buffer` when it can be lent to the user (FLASHCAM_DELIVERY_ZEROCOPY), else NULL.
+ *  Frames spread over multiple buffers (or failed ones) are stitched/copied as usual.
+ */
+FLASHCAM_FRAME_VIEW_T *FlashCam::getFrameView(FLASHCAM_PORT_USERDATA_T *userdata, FLASHCAM_BUFFERS_T *buffers, MMAL_BUFFER_HEADER_T *buffer) {
+    if ((userdata->settings->delivery != FLASHCAM_DELIVERY_ZEROCOPY) || (!userdata->callback_view) || (!buffers->views) || (userdata->burst.frames.load(std::memory_order_acquire)))
+        return NULL;
+    
+    // Only complete frames
+    if ((userdata->framebuffer_idx.load(std::memory_order_relaxed) != 0) ||
+        !(buffer->flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END) ||
+         (buffer->flags & MMAL_BUFFER_HEADER_FLAG_TRANSMISSION_FAILED))
+        return NULL;
+    
+    // View with same index as buffer in pool of replayed buffers (not larger than pool of video port)
+    if (userdata->replay->active) {
+        MMAL_POOL_T *pool = userdata->replay->pool;
+        for (unsigned int i=0; i<pool->headers_num; i++) {
+            if (pool->header[i] == buffer)
+                return &buffers->views[i];
         }
+        return NULL;
     }
+    return FlashCamBuffers::view(buffers, buffer);
 }
 
 
@@ -733,24 +1133,200 @@ int FlashCam::startCapture() {
 
     if (_settings.mode == FLASHCAM_MODE_VIDEO) {
         _state.port = _camera_component->output[MMAL_CAMERA_VIDEO_PORT];
-    } else if ( _settings.mode = FLASHCAM_MODE_CAPTURE ) { 
+    } else if ( _settings.mode == FLASHCAM_MODE_CAPTURE ) { 
         _state.port = _camera_component->output[MMAL_CAMERA_CAPTURE_PORT];
     } else {
         fprintf(stderr, "%s: Cannot start camera. Unknown mode (%u)\n", __func__, _settings.mode);
         return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
     }
     
+    //recorded buffers: I420 stream of the camera port (opaque OpenGL buffers hold no image data)
+    if ((_settings.record || _settings.replay) && _settings.opengl_enabled) {
+        fprintf(stderr, "%s: Cannot record or replay with OpenGL.\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    if (_settings.replay && ((_settings.mode != FLASHCAM_MODE_VIDEO) || _settings.record)) {
+        fprintf(stderr, "%s: Replay requires video mode and no recording.\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    //recorded frames: copied from the I420 stream
+    if (_settings.recorder && _settings.opengl_enabled) {
+        fprintf(stderr, "%s: Cannot record frames with OpenGL.\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    //metrics: (re)publish for external monitors, counters continue
+    if (_settings.metrics) {
+        if (FlashCamMetrics::publish(&_metrics, _settings.metrics))
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    } else {
+        FlashCamMetrics::unpublish(&_metrics);
+    }
+    
+    //stream layout of the camera port
+    FLASHCAM_REPLAY_HEADER_T header = {};
+    header.width        = _settings.width;
+    header.height       = _settings.height;
+    header.stride       = _userdata.stride;
+    header.slice_height = _userdata.slice_height;
+    header.buffer_size  = _state.port->buffer_size;
+    header.framerate    = _params.framerate;
+    
 #ifdef BUILD_FLASHCAM_WITH_OPENGL
     //start EGL thread for processing
     if (_settings.opengl_enabled) {
-        FlashCamOpenGL::start();
+        FlashCamOpenGL::start(&_state);
     }
 #endif 
+    
+    //map stamps onto the GPU clock
+    _userdata.trace.enabled = _settings.trace;
+    if (_settings.trace)
+        calibrateTrace();
+    
+    //new stream: no timestamp gap with previous stream
+    FlashCamStream::start(&_userdata.stream);
+    
+    //threads take on their scheduling when they (next) run
+    for (unsigned int t=0; t<FLASHCAM_THREADS; t++)
+        _sched.params[t] = _settings.sched[t];
+    _sched.callback_wake = {};
+    
+    //still: frames completed in video mode should not be taken for the still
+    if (_settings.mode == FLASHCAM_MODE_CAPTURE)
+        while (vcos_semaphore_trywait(&_userdata.sem_capture) != VCOS_EAGAIN);
+    
+    //create/keep shared ring: readers in other processes
+    _userdata.shared = NULL;
+    if ((_settings.delivery == FLASHCAM_DELIVERY_SHARED) && (!_settings.opengl_enabled)) {
+        if (FlashCamShared::init(&_shared, _settings.shared, _settings.ring_size, _userdata.framebuffer_size, _userdata.extract.rois[0].width,
+                                 _userdata.extract.rois[0].height, _userdata.extract.rois[0].pitch, _settings.extract.planes)) {
+            fprintf(stderr, "%s: Shared ring cannot be created.\n", __func__);
+            unwindCapture();
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        }
+        _userdata.shared = &_shared;
+    }
+    
+    //start recorder: frames are copied by the camera callback, written by the writer thread
+    _userdata.recorder = NULL;
+    if (_settings.recorder) {
+        if (FlashCamRecorder::start(&_recorder, _settings.recorder, _settings.recorder_memory, _userdata.framebuffer_size, _userdata.extract.rois[0].width,
+                                    _userdata.extract.rois[0].height, _userdata.extract.rois[0].pitch, _settings.extract.planes, _params.framerate)) {
+            fprintf(stderr, "%s: Recorder cannot be started.\n", __func__);
+            unwindCapture();
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        }
+        _userdata.recorder = &_recorder;
+    }
+    
+    //start ring consumer
+    _userdata.ring = NULL;
+    if ((_settings.delivery == FLASHCAM_DELIVERY_RING) && (!_settings.opengl_enabled)) {
+        unsigned char *data = FlashCamMemory::reserve(&_memory, &_memory.ring, ((size_t) _settings.ring_size) * _userdata.framebuffer_size, _settings.memory);
+        if (!data || FlashCamRing::init(&_ring, _settings.ring_size, _userdata.framebuffer_size, data) ||
+            FlashCamRing::start(&_ring, _userdata.callback, _userdata.extract.rois[0].width, _userdata.extract.rois[0].height, &_userdata.stats, &_userdata.trace, &_sched)) {
+            fprintf(stderr, "%s: Ring cannot be started.\n", __func__);
+            unwindCapture();
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        }
+        _userdata.ring = &_ring;
+    }
+    
+    //start dispatch workers
+    _userdata.dispatch = NULL;
+    if ((_settings.delivery == FLASHCAM_DELIVERY_DISPATCH) && (!_settings.opengl_enabled)) {
+        unsigned char *data = FlashCamMemory::reserve(&_memory, &_memory.dispatch, ((size_t) FlashCamDispatch::frames(_settings.dispatch_threads, _settings.dispatch_queue)) * _userdata.framebuffer_size, _settings.memory);
+        if (!data || FlashCamDispatch::init(&_dispatch, _settings.dispatch_threads, _settings.dispatch_queue, _settings.dispatch_policy, _userdata.framebuffer_size, data) ||
+            FlashCamDispatch::start(&_dispatch, _userdata.callback, _userdata.extract.rois[0].width, _userdata.extract.rois[0].height, &_userdata.stats, &_userdata.trace, &_sched)) {
+            fprintf(stderr, "%s: Dispatch pool cannot be started.\n", __func__);
+            unwindCapture();
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        }
+        _userdata.dispatch = &_dispatch;
+    }
+    
+    //start batch consumer
+    _userdata.batch = NULL;
+    if ((_settings.delivery == FLASHCAM_DELIVERY_BATCH) && (!_settings.opengl_enabled)) {
+        unsigned char *data = FlashCamMemory::reserve(&_memory, &_memory.batch, ((size_t) FLASHCAM_BATCH_NUM) * _settings.batch_size * _userdata.framebuffer_size, _settings.memory);
+        if (!data || FlashCamBatch::init(&_batch, _settings.batch_size, _userdata.framebuffer_size, data) ||
+            FlashCamBatch::start(&_batch, _userdata.callback_batch, _userdata.extract.rois[0].width, _userdata.extract.rois[0].height,
+                                 _userdata.extract.rois[0].pitch, &_userdata.stats, &_userdata.trace, &_sched)) {
+            fprintf(stderr, "%s: Batches cannot be started.\n", __func__);
+            unwindCapture();
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        }
+        _userdata.batch = &_batch;
+    }
+    
+    //start pair consumer: lit frames are paired with unlit frames by the PLL state
+    _userdata.pair = NULL;
+    if ((_settings.delivery == FLASHCAM_DELIVERY_PAIR) && (!_settings.opengl_enabled)) {
+        //frames are paired by their distance in frame periods
+        if (_params.framerate <= 0) {
+            fprintf(stderr, "%s: Pairs require a frame rate.\n", __func__);
+            unwindCapture();
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        }
+        unsigned int divider = 1;
+#ifdef BUILD_FLASHCAM_WITH_PLL
+        divider = _settings.pll_divider;
+#endif
+        unsigned char *data = FlashCamMemory::reserve(&_memory, &_memory.pair, ((size_t) FLASHCAM_PAIR_SLOTS) * _userdata.framebuffer_size, _settings.memory);
+        if (!data || FlashCamPair::init(&_pair, _userdata.framebuffer_size, data) ||
+            FlashCamPair::start(&_pair, _userdata.callback_pair, &_userdata.extract, (unsigned int) (1000000 / _params.framerate), divider,
+                                _settings.pair_subtract, &_userdata.stats, &_userdata.trace, &_sched)) {
+            fprintf(stderr, "%s: Pairs cannot be started.\n", __func__);
+            unwindCapture();
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        }
+        _userdata.pair = &_pair;
+    }
+    
+    //start stack consumer: accumulator and slots share one region
+    _userdata.stack = NULL;
+    if ((_settings.delivery == FLASHCAM_DELIVERY_STACK) && (!_settings.opengl_enabled)) {
+        unsigned int   num  = FlashCamStack::slots(_settings.stack_mode, _settings.stack_window, _settings.stack_interval);
+        unsigned char *data = FlashCamMemory::reserve(&_memory, &_memory.stack, ((size_t) 2 + num) * _userdata.framebuffer_size, _settings.memory);
+        if (!data || FlashCamStack::init(&_stack, num, _userdata.framebuffer_size, data) ||
+            FlashCamStack::start(&_stack, _userdata.callback_stack, &_userdata.extract, _settings.stack_mode, _settings.stack_window,
+                                 _settings.stack_interval, _settings.stack_chroma, &_userdata.stats, &_userdata.trace, &_sched)) {
+            fprintf(stderr, "%s: Stack cannot be started.\n", __func__);
+            unwindCapture();
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        }
+        _userdata.stack = &_stack;
+    }
+        
+    //replay: feed recorded buffers through the camera callback, camera & PLL stay idle
+    if (_settings.replay) {
+        if (FlashCamReplay::start(&_replay, _settings.replay, _settings.replay_mode, &header, FlashCam::buffer_callback, &_userdata, _state.port->buffer_num)) {
+            fprintf(stderr, "%s: Replay cannot be started.\n", __func__);
+            unwindCapture();
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        }
+        _active = true;
+        
+        if (_settings.verbose)
+            fprintf(stdout, "%s: Success (replay)\n", __func__);
         
+        return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+    }
+    
+    //record: buffers are appended by the camera callback
+    if (_settings.record) {
+        if (FlashCamReplay::startRecord(&_replay, _settings.record, &header)) {
+            unwindCapture();
+            return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        }
+    }
+    
 #ifdef BUILD_FLASHCAM_WITH_PLL
     if (_settings.mode == FLASHCAM_MODE_VIDEO) {        
-        if (FlashCamPLL::start()) {
+        if (FlashCamPLL::start(&_state)) {
             fprintf(stderr, "%s: PLL cannot be started.\n", __func__);
+            unwindCapture();
             return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
         }
     }
@@ -759,6 +1335,7 @@ int FlashCam::startCapture() {
     //start camera
     if (status = setCapture(_state.port, 1)) {
         vcos_log_error("%s: Failed to start video stream", __func__);
+        unwindCapture();
         return status;
     }    
     _active = true;
@@ -766,6 +1343,13 @@ int FlashCam::startCapture() {
     // When in capturemode: Wait for capture to complete
     if ( _settings.mode == FLASHCAM_MODE_CAPTURE ) { 
         vcos_semaphore_wait(&_userdata.sem_capture);
+        FlashCamRing::stop(&_ring);
+        FlashCamDispatch::stop(&_dispatch);
+        FlashCamBatch::stop(&_batch);
+        FlashCamPair::stop(&_pair);
+        FlashCamStack::stop(&_stack);
+        FlashCamReplay::stopRecord(&_replay);
+        FlashCamRecorder::stop(&_recorder);
         _active = false;
     } 
     
@@ -793,15 +1377,21 @@ int FlashCam::stopCapture() {
     if (_settings.verbose)
         fprintf(stdout, "%s: Stopping stream.\n", __func__);
     
-    if (_settings.mode == FLASHCAM_MODE_VIDEO) {
+    if (_replay.active) {
+        //stop replay: buffers in flight are delivered by the callback
+        FlashCamReplay::stop(&_replay);
+        
+    } else if (_settings.mode == FLASHCAM_MODE_VIDEO) {
         
         //shutdown PLL before camera, as PLL has some internal Camera dependencies.
-        // Shutting down camera will crash PLL.
+        // Shutting down camera will crash PLL: wait for callbacks still updating the PLL.
 #ifdef BUILD_FLASHCAM_WITH_PLL
-        if (FlashCamPLL::stop()) {
+        if (FlashCamPLL::stop(&_state)) {
             fprintf(stderr, "%s: PLL cannot be stopped.\n", __func__);
             return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
         }
+        if (fenceCallbacks())
+            return FlashCamMMAL::mmal_to_int(MMAL_EAGAIN);
 #endif
         
         //stop video
@@ -810,7 +1400,7 @@ int FlashCam::stopCapture() {
             return status;
         }        
         
-    } else if ( _settings.mode = FLASHCAM_MODE_CAPTURE ) { 
+    } else if ( _settings.mode == FLASHCAM_MODE_CAPTURE ) { 
         //stop capture
         if (status = setCapture(_camera_component->output[MMAL_CAMERA_CAPTURE_PORT], 0)) {
             vcos_log_error("%s: Failed to stop camera", __func__);
@@ -823,14 +1413,29 @@ int FlashCam::stopCapture() {
         return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
     }
     
+    //Camera stops at the end of a frame: wait for the frame in progress, and for callbacks delivering it
+    drainFrame();
+    if (fenceCallbacks())
+        return FlashCamMMAL::mmal_to_int(MMAL_EAGAIN);
+    
+    //Stop ring consumer, dispatch workers, batch, pair and stack consumers: deliver pending frames
+    FlashCamRing::stop(&_ring);
+    FlashCamDispatch::stop(&_dispatch);
+    FlashCamBatch::stop(&_batch);
+    FlashCamPair::stop(&_pair);
+    FlashCamStack::stop(&_stack);
+    FlashCamShared::cancel(&_shared);
+    
+    //camera stopped: no buffers left to record, write queued frames
+    FlashCamReplay::stopRecord(&_replay);
+    FlashCamRecorder::stop(&_recorder);
+    
 #ifdef BUILD_FLASHCAM_WITH_OPENGL
     //Stop EGL thread
     // This needs to be done after shutting down the camera, 
     //  ensuring that pending frames/buffers are processed
-    //  and pushed to the appropiate inter-thread queues. 
-    // Sleeping is required to provide all async mmal-related systems to terminate.
-    usleep(1000000);
-    FlashCamOpenGL::stop();
+    //  and pushed to the appropiate inter-thread queues (fenced above).
+    FlashCamOpenGL::stop(&_state);
 #endif 
     
     //camera inactive
@@ -849,6 +1454,26 @@ void FlashCam::setFrameCallback(FLASHCAM_CALLBACK_T callback) {
     _userdata.callback = callback;
 }
 
+void FlashCam::setFrameCallback(FLASHCAM_CALLBACK_VIEW_T callback) {
+    if (_active) return; //no changer/reset while in capturemode
+    _userdata.callback_view = callback;
+}
+
+void FlashCam::setFrameCallback(FLASHCAM_CALLBACK_BATCH_T callback) {
+    if (_active) return; //no changer/reset while in capturemode
+    _userdata.callback_batch = callback;
+}
+
+void FlashCam::setFrameCallback(FLASHCAM_CALLBACK_PAIR_T callback) {
+    if (_active) return; //no changer/reset while in capturemode
+    _userdata.callback_pair = callback;
+}
+
+void FlashCam::setFrameCallback(FLASHCAM_CALLBACK_STACK_T callback) {
+    if (_active) return; //no changer/reset while in capturemode
+    _userdata.callback_stack = callback;
+}
+
 #ifdef BUILD_FLASHCAM_WITH_OPENGL
 void FlashCam::setFrameCallback(FLASHCAM_CALLBACK_OPENGL_T callback) {
     if (_active) return; //no changer/reset while in capturemode
@@ -859,61 +1484,433 @@ void FlashCam::setFrameCallback(FLASHCAM_CALLBACK_OPENGL_T callback) {
 void FlashCam::resetFrameCallback() {
     if (_active) return; //no changer/reset while in capturemode
     _userdata.callback = NULL;
+    _userdata.callback_view = NULL;
+    _userdata.callback_batch = NULL;
+    _userdata.callback_pair = NULL;
+    _userdata.callback_stack = NULL;
 #ifdef BUILD_FLASHCAM_WITH_OPENGL
     _userdata.callback_egl = NULL;
 #endif 
 }
 
-int FlashCam::getGPUtime(uint64_t *us) {  
-    *us = 0;
-    if (_state.port && _state.port->is_enabled) {
-        MMAL_STATUS_T status = mmal_port_parameter_get_uint64(_state.port, MMAL_PARAMETER_SYSTEM_TIME, us);
-        return FlashCamMMAL::mmal_to_int(status);
+/*
+ * int FlashCam::captureBurst(unsigned int num, unsigned char **frames, uint64_t *pts)
+ * 
+ * Capture `num` stills in a row. The capture port stays enabled and the camera stays in burst mode between
+ *  stills, so each still costs only its capture request. MMAL takes one capture request at a time: the next
+ *  still is requested once the previous one arrived (or after FLASHCAM_STILL_TIMEOUT_US).
+ */
+int FlashCam::captureBurst(unsigned int num, unsigned char **frames, uint64_t *pts) {
+    int status;
+    
+    if (!_initialised) {
+        fprintf(stderr, "%s: Camera not initialised.\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
     }
-    return FlashCamMMAL::mmal_to_int(MMAL_ENOTREADY);
+    
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Camera already capturing.\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if ((_settings.mode != FLASHCAM_MODE_CAPTURE) || (_settings.opengl_enabled)) {
+        fprintf(stderr, "%s: Burst requires capture mode without OpenGL.\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if ((num == 0) || (!frames) || (!pts))
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Starting burst of %u stills\n", __func__, num);
+    
+    //update state
+    _state.settings = &_settings;
+    _state.params   = &_params;
+    _state.userdata = &_userdata;
+    _state.port     = _camera_component->output[MMAL_CAMERA_CAPTURE_PORT];
+    
+    //camera remains in still mode between captures
+    if (mmal_port_parameter_set_boolean(_camera_component->control, MMAL_PARAMETER_CAMERA_BURST_CAPTURE, 1) != MMAL_SUCCESS)
+        vcos_log_error("%s: Failed to enable burst mode", __func__);
+    
+    //no frames pending from a previous capture
+    while (vcos_semaphore_trywait(&_userdata.sem_capture) != VCOS_EAGAIN);
+    FlashCamStream::start(&_userdata.stream);
+    
+    //callback sees the burst once `frames` is published
+    _userdata.framebuffer_idx.store(0, std::memory_order_relaxed);
+    _userdata.burst.pts       = pts;
+    _userdata.burst.num       = num;
+    _userdata.burst.idx.store(0, std::memory_order_relaxed);
+    _userdata.burst.frames.store(frames, std::memory_order_release);
+    _active = true;
+    
+    //each completed (or aborted) still posts `sem_capture`
+    status = FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+    unsigned int received;
+    while ((received = _userdata.burst.idx.load(std::memory_order_acquire)) < num) {
+        if (status = setCapture(_state.port, 1)) {
+            vcos_log_error("%s: Failed to capture still %u", __func__, received);
+            break;
+        }
+        uint64_t deadline = FlashCamBuffers::now() + FLASHCAM_STILL_TIMEOUT_US + _params.shutterspeed;
+        bool captured;
+        while (!(captured = (vcos_semaphore_trywait(&_userdata.sem_capture) == VCOS_SUCCESS)) && (FlashCamBuffers::now() < deadline))
+            usleep(100);
+        if (!captured) {
+            vcos_log_error("%s: Still %u not received", __func__, received);
+            status = FlashCamMMAL::mmal_to_int(MMAL_EIO);
+            break;
+        }
+    }
+    
+    //a late still is not written into `frames` once the callbacks have passed the fence
+    _userdata.burst.frames.store(NULL, std::memory_order_release);
+    if (fenceCallbacks())
+        status = FlashCamMMAL::mmal_to_int(MMAL_EIO);
+    _userdata.burst.pts = NULL;
+    _userdata.burst.num = 0;
+    _userdata.burst.idx.store(0, std::memory_order_relaxed);
+    _active = false;
+    mmal_port_parameter_set_boolean(_camera_component->control, MMAL_PARAMETER_CAMERA_BURST_CAPTURE, 0);
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Done\n", __func__);
+    
+    return status;
 }
 
+int FlashCam::getFrameSize(unsigned int *size) {
+    *size = _userdata.framebuffer_size;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
 
-/* SETTING MANAGEMENT */
-
-void FlashCam::getDefaultSettings(FLASHCAM_SETTINGS_T *settings) {
-    settings->width             = 640;
-    settings->height            = 480;
-    settings->verbose           = 1;
-    settings->update            = 0;
-    settings->mode              = FLASHCAM_MODE_CAPTURE;
-    settings->opengl_enabled    = 0;
-#ifdef BUILD_FLASHCAM_WITH_PLL
-    FlashCamPLL::getDefaultSettings(settings);
-#endif    
+int FlashCam::releaseFrame(FLASHCAM_FRAME_VIEW_T *frame) {
+    if (!frame || !frame->buffer) {
+        fprintf(stderr, "%s: Frame not set or already released.\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    MMAL_PORT_T          *port    = frame->port;
+    MMAL_BUFFER_HEADER_T *buffer  = frame->buffer;
+    FLASHCAM_BUFFERS_T   *buffers = getBuffers(&_userdata, port);
+    frame->buffer = NULL;
+    _userdata.views_lent.fetch_sub(1, std::memory_order_release);
+    
+    // time the buffer was held (buffer tuning)
+    if (frame->arrival)
+        FlashCamBuffers::hold(buffers, FlashCamBuffers::now() - frame->arrival);
+    
+    // done with data, release buffer back to the pool
+    mmal_buffer_header_mem_unlock(buffer);
+    mmal_buffer_header_release(buffer);
     
+    // and send one back to the port (if still open)
+    if (FlashCamBuffers::send(buffers, port)) {
+        vcos_log_error("%s: Unable to return the buffer to the camera port", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_ENOSPC);
+    }
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
 }
 
-void FlashCam::printSettings(FLASHCAM_SETTINGS_T *settings) {
-    fprintf(stdout, "Width        : %d\n", settings->width);
-    fprintf(stdout, "Height       : %d\n", settings->height);
-    fprintf(stdout, "Verbose      : %d\n", settings->verbose);
-    fprintf(stdout, "Update       : %d\n", settings->update);
-    fprintf(stdout, "Camera-Mode  : %d\n", settings->mode);    
-    fprintf(stdout, "OpenGL       : %d\n", settings->opengl_enabled);    
-#ifdef BUILD_FLASHCAM_WITH_PLL
-    FlashCamPLL::printSettings(settings);
-#endif    
+int FlashCam::getStats(FLASHCAM_STATS_T *stats) {
+    FLASHCAM_COUNTERS_T *counters = &_userdata.stats;
+    stats->frames                  = counters->frames.load(std::memory_order_relaxed);
+    stats->bytes_copied            = counters->bytes_copied.load(std::memory_order_relaxed);
+    stats->overruns                = counters->overruns.load(std::memory_order_relaxed);
+    stats->skipped                 = counters->skipped.load(std::memory_order_relaxed);
+    stats->unpaired                = counters->unpaired.load(std::memory_order_relaxed);
+    stats->dispatch_depth          = counters->dispatch_depth.load(std::memory_order_relaxed);
+    stats->dispatch_depth_max      = counters->dispatch_depth_max.load(std::memory_order_relaxed);
+    stats->dispatch_dropped_oldest = counters->dispatch_dropped_oldest.load(std::memory_order_relaxed);
+    stats->dispatch_dropped_newest = counters->dispatch_dropped_newest.load(std::memory_order_relaxed);
+    stats->dispatch_blocked        = counters->dispatch_blocked.load(std::memory_order_relaxed);
+    stats->buffers                 = _buffers.circulating;
+    stats->buffers_max             = _buffers.max;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
 }
 
-#ifdef PLLTUNE
-void FlashCam::getInternalState( FLASHCAM_INTERNAL_STATE_T** state ) {
-    *state = &_state;
+int FlashCam::resetStats() {
+    if (_active) {
+        fprintf(stderr, "%s: Cannot reset statistics while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    FLASHCAM_COUNTERS_T *counters = &_userdata.stats;
+    counters->frames.store(0, std::memory_order_relaxed);
+    counters->bytes_copied.store(0, std::memory_order_relaxed);
+    counters->overruns.store(0, std::memory_order_relaxed);
+    counters->skipped.store(0, std::memory_order_relaxed);
+    counters->unpaired.store(0, std::memory_order_relaxed);
+    counters->dispatch_depth.store(0, std::memory_order_relaxed);
+    counters->dispatch_depth_max.store(0, std::memory_order_relaxed);
+    counters->dispatch_dropped_oldest.store(0, std::memory_order_relaxed);
+    counters->dispatch_dropped_newest.store(0, std::memory_order_relaxed);
+    counters->dispatch_blocked.store(0, std::memory_order_relaxed);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
 }
-#endif
-
-int FlashCam::setSettings(FLASHCAM_SETTINGS_T *settings) {
-
-    //update settings
-    memcpy(&_settings, settings, sizeof(FLASHCAM_SETTINGS_T));
 
-    if (_settings.verbose)
-        fprintf(stdout, "%s: (re)setting camera.\n", __func__);
+int FlashCam::getStreamStats(FLASHCAM_STREAM_STATS_T *stats) {
+    FlashCamStream::get(&_userdata.stream, stats);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::resetStreamStats() {
+    if (_active) {
+        fprintf(stderr, "%s: Cannot reset stream statistics while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    FlashCamStream::reset(&_userdata.stream);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getRecorderStats(FLASHCAM_RECORDER_STATS_T *stats) {
+    FlashCamRecorder::stats(&_recorder, stats);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getMemoryStats(FLASHCAM_MEMORY_STATS_T *stats) {
+    FlashCamMemory::stats(&_memory, stats);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSchedJitter(FLASHCAM_THREAD_T thread, FLASHCAM_HISTOGRAM_T *hist) {
+    if (FlashCamSched::get(&_sched, thread, hist))
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::resetSchedJitter() {
+    FlashCamSched::reset(&_sched);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getTrace(FLASHCAM_TRACE_STAGE_T stage, FLASHCAM_HISTOGRAM_T *hist) {
+    if (FlashCamTrace::get(&_userdata.trace, stage, hist))
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::resetTrace() {
+    FlashCamTrace::reset(&_userdata.trace);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+/*
+ * void FlashCam::calibrateTrace()
+ *  Samples the GPU clock between two CLOCK_MONOTONIC readings. The sample with the smallest
+ *  interval gives the most accurate offset between both clocks.
+ */
+void FlashCam::calibrateTrace() {
+    FLASHCAM_CLOCK_SAMPLE_T sample;
+    
+    if ((!_state.port) || (!_state.port->is_enabled) || FlashCamClock::sample(_state.port, &sample)) {
+        vcos_log_error("%s: Unable to read GPU time, trace is not calibrated", __func__);
+        return;
+    }
+    
+    FlashCamTrace::calibrate(&_userdata.trace, sample.gpu, sample.mono - (sample.interval >> 1), sample.mono + (sample.interval >> 1));
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: GPU offset %" PRId64 "us (+/- %" PRIu64 "us)\n", __func__, _userdata.trace.offset, sample.interval >> 1);
+}
+
+/*
+ * int FlashCam::fenceCallbacks()
+ *  Waits until the buffer callbacks which were in progress have returned.
+ *  Callbacks of a port are serialised, so these have returned when as many callbacks exited as were entered.
+ *  Entries are counted seq_cst: a callback entered after the snapshot sees flags cleared before it (`pll_active`).
+ *  Returns -1 when a callback did not return within FLASHCAM_FENCE_TIMEOUT_US.
+ */
+int FlashCam::fenceCallbacks() {
+    uint64_t     deadline = FlashCamBuffers::now() + FLASHCAM_FENCE_TIMEOUT_US;
+    unsigned int entered  = _userdata.callbacks_entered.load(std::memory_order_seq_cst);
+    while ((int) (_userdata.callbacks_exited.load(std::memory_order_acquire) - entered) < 0) {
+        if (FlashCamBuffers::now() >= deadline) {
+            fprintf(stderr, "%s: Buffer callback did not return.\n", __func__);
+            return -1;
+        }
+        sched_yield();
+    }
+    return 0;
+}
+
+/*
+ * void FlashCam::drainFrame()
+ *  Waits (at most two frame periods) until a frame which is partially received has been completed or aborted.
+ *  The callback posts `sem_drain` when it ends a frame while the caller is draining.
+ */
+void FlashCam::drainFrame() {
+    float        fps     = (_params.framerate > 0) ? _params.framerate : 1;
+    VCOS_UNSIGNED timeout = (VCOS_UNSIGNED) (2000.0f / fps) + 1;
+    
+    _userdata.draining.store(true, std::memory_order_seq_cst);
+    while (vcos_semaphore_trywait(&_userdata.sem_drain) != VCOS_EAGAIN);
+    if ((_userdata.framebuffer_idx.load(std::memory_order_seq_cst) != 0) &&
+        (vcos_semaphore_wait_timeout(&_userdata.sem_drain, timeout) != VCOS_SUCCESS))
+        vcos_log_error("%s: Frame in progress not completed", __func__);
+    _userdata.draining.store(false, std::memory_order_relaxed);
+}
+
+/*
+ * void FlashCam::unwindCapture()
+ *  Undoes a failed `startCapture()`: stops what it started, so the instance can be started again.
+ *  Consumers which were not started are left alone by their `stop`.
+ */
+void FlashCam::unwindCapture() {
+#ifdef BUILD_FLASHCAM_WITH_PLL
+    //PLL may have been started: wait for callbacks still updating it
+    if (_state.pll_active.load(std::memory_order_relaxed)) {
+        FlashCamPLL::stop(&_state);
+        fenceCallbacks();
+    }
+#endif
+    FlashCamRing::stop(&_ring);
+    FlashCamDispatch::stop(&_dispatch);
+    FlashCamBatch::stop(&_batch);
+    FlashCamPair::stop(&_pair);
+    FlashCamStack::stop(&_stack);
+    FlashCamReplay::stopRecord(&_replay);
+    FlashCamRecorder::stop(&_recorder);
+#ifdef BUILD_FLASHCAM_WITH_OPENGL
+    if (_settings.opengl_enabled)
+        FlashCamOpenGL::stop(&_state);
+#endif
+}
+
+/*
+ * int FlashCam::drainViews()
+ *  Waits until zero-copy frames are released by the user (at most FLASHCAM_DRAIN_TIMEOUT_US),
+ *  as their buffers are freed with the components. Returns -1 when frames are still lent out:
+ *  their buffers must then be kept.
+ */
+int FlashCam::drainViews() {
+    uint64_t deadline = FlashCamBuffers::now() + FLASHCAM_DRAIN_TIMEOUT_US;
+    while ((_userdata.views_lent.load(std::memory_order_acquire) > 0) && (FlashCamBuffers::now() < deadline))
+        usleep(100);
+    if (_userdata.views_lent.load(std::memory_order_acquire) > 0) {
+        fprintf(stderr, "%s: %u frames not released.\n", __func__, _userdata.views_lent.load());
+        return -1;
+    }
+    return 0;
+}
+
+int FlashCam::getGPUtime(uint64_t *us) {  
+    *us = 0;
+    if (_state.port && _state.port->is_enabled) {
+        MMAL_STATUS_T status = mmal_port_parameter_get_uint64(_state.port, MMAL_PARAMETER_SYSTEM_TIME, us);
+        return FlashCamMMAL::mmal_to_int(status);
+    }
+    return FlashCamMMAL::mmal_to_int(MMAL_ENOTREADY);
+}
+
+int FlashCam::getClockEstimate(FLASHCAM_CLOCK_ESTIMATE_T *estimate) {
+    FlashCamClock::get(&_clock, estimate);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::translateTime(uint64_t gpu_us, uint64_t *host_us, uint32_t *error_us) {
+    if (FlashCamClock::translate(&_clock, gpu_us, host_us, error_us))
+        return FlashCamMMAL::mmal_to_int(MMAL_ENOTREADY);
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+
+/* SETTING MANAGEMENT */
+
+void FlashCam::getDefaultSettings(FLASHCAM_SETTINGS_T *settings) {
+    settings->width             = 640;
+    settings->height            = 480;
+    settings->verbose           = 1;
+    settings->update            = 0;
+    settings->mode              = FLASHCAM_MODE_CAPTURE;
+    settings->opengl_enabled    = 0;
+    settings->delivery          = FLASHCAM_DELIVERY_COPY;
+    settings->ring_size         = 4;
+    settings->batch_size        = 8;
+    settings->pair_subtract     = 0;
+    settings->stack_mode        = FLASHCAM_STACK_SUM;
+    settings->stack_window      = 8;
+    settings->stack_interval    = 8;
+    settings->stack_chroma      = 0;
+    settings->shared            = NULL;
+    settings->dispatch_threads  = 2;
+    settings->dispatch_queue    = 4;
+    settings->dispatch_policy   = FLASHCAM_DISPATCH_DROP_OLDEST;
+    settings->trace             = 0;
+    settings->pitch             = 0;
+    settings->buffer_num        = FLASHCAM_BUFFERS_MIN;
+    settings->buffer_memory     = 64 << 20;
+    settings->extract           = {};
+    settings->extract.planes    = FLASHCAM_PLANE_YUV;
+    settings->armed             = 1;
+    settings->record            = NULL;
+    settings->replay            = NULL;
+    settings->replay_mode       = FLASHCAM_REPLAY_CADENCE;
+    settings->metrics           = NULL;
+    settings->recorder          = NULL;
+    settings->recorder_memory   = 64 << 20;
+    settings->clock_interval    = 1000;
+    settings->memory            = FLASHCAM_MEMORY_LOCK;
+    for (unsigned int t=0; t<FLASHCAM_THREADS; t++)
+        settings->sched[t]      = {};
+#ifdef BUILD_FLASHCAM_WITH_PLL
+    FlashCamPLL::getDefaultSettings(settings);
+#endif    
+    
+}
+
+void FlashCam::printSettings(FLASHCAM_SETTINGS_T *settings) {
+    fprintf(stdout, "Width        : %d\n", settings->width);
+    fprintf(stdout, "Height       : %d\n", settings->height);
+    fprintf(stdout, "Verbose      : %d\n", settings->verbose);
+    fprintf(stdout, "Update       : %d\n", settings->update);
+    fprintf(stdout, "Camera-Mode  : %d\n", settings->mode);    
+    fprintf(stdout, "OpenGL       : %d\n", settings->opengl_enabled);    
+    fprintf(stdout, "Delivery     : %d\n", settings->delivery);    
+    fprintf(stdout, "Ring size    : %d\n", settings->ring_size);    
+    fprintf(stdout, "Batch size   : %d\n", settings->batch_size);    
+    fprintf(stdout, "Pair subtract: %d\n", settings->pair_subtract);    
+    fprintf(stdout, "Stack        : mode %d, window %d, interval %d, chroma %d\n", settings->stack_mode, settings->stack_window, settings->stack_interval, settings->stack_chroma);    
+    fprintf(stdout, "Shared ring  : %s\n", settings->shared ? settings->shared : "-");    
+    fprintf(stdout, "Dispatch thr.: %d\n", settings->dispatch_threads);    
+    fprintf(stdout, "Dispatch q.  : %d\n", settings->dispatch_queue);    
+    fprintf(stdout, "Dispatch pol.: %d\n", settings->dispatch_policy);    
+    fprintf(stdout, "Trace        : %d\n", settings->trace);    
+    fprintf(stdout, "Pitch        : %d\n", settings->pitch);    
+    fprintf(stdout, "Buffers      : %d\n", settings->buffer_num);    
+    fprintf(stdout, "Buffer memory: %d\n", settings->buffer_memory);    
+    fprintf(stdout, "Extract      : planes %d, regions %d\n", settings->extract.planes, settings->extract.num_rois);    
+    fprintf(stdout, "Armed ports  : %d\n", settings->armed);    
+    fprintf(stdout, "Record       : %s\n", settings->record ? settings->record : "-");    
+    fprintf(stdout, "Replay       : %s (%d)\n", settings->replay ? settings->replay : "-", settings->replay_mode);    
+    fprintf(stdout, "Metrics      : %s\n", settings->metrics ? settings->metrics : "-");    
+    fprintf(stdout, "Recorder     : %s (%d)\n", settings->recorder ? settings->recorder : "-", settings->recorder_memory);    
+    fprintf(stdout, "Clock interv.: %d\n", settings->clock_interval);    
+    fprintf(stdout, "Frame memory : %d\n", settings->memory);    
+    fprintf(stdout, "Scheduling   : callback %d/0x%x, opengl %d/0x%x, workers %d/0x%x\n",
+            settings->sched[FLASHCAM_THREAD_CALLBACK].priority, settings->sched[FLASHCAM_THREAD_CALLBACK].cpus,
+            settings->sched[FLASHCAM_THREAD_OPENGL].priority  , settings->sched[FLASHCAM_THREAD_OPENGL].cpus,
+            settings->sched[FLASHCAM_THREAD_WORKER].priority  , settings->sched[FLASHCAM_THREAD_WORKER].cpus);
+#ifdef BUILD_FLASHCAM_WITH_PLL
+    FlashCamPLL::printSettings(settings);
+#endif    
+}
+
+#ifdef PLLTUNE
+void FlashCam::getInternalState( FLASHCAM_INTERNAL_STATE_T** state ) {
+    *state = &_state;
+}
+#endif
+
+int FlashCam::setSettings(FLASHCAM_SETTINGS_T *settings) {
+
+    //update settings
+    memcpy(&_settings, settings, sizeof(FLASHCAM_SETTINGS_T));
+
+    if (_settings.verbose)
+        fprintf(stdout, "%s: (re)setting camera.\n", __func__);
 
     //reset camera
     return resetCamera();
@@ -921,6 +1918,7 @@ int FlashCam::setSettings(FLASHCAM_SETTINGS_T *settings) {
 
 int FlashCam::getSettings(FLASHCAM_SETTINGS_T *settings) {
     memcpy(settings, &_settings, sizeof(FLASHCAM_SETTINGS_T));
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
 }
 
 
@@ -944,6 +1942,57 @@ int FlashCam::getSettingSize( unsigned int *width, unsigned int *height ) {
     return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);    
 }
 
+//Pitch determines the framebuffer size: reset & re-initialise all components
+int FlashCam::setSettingPitch( unsigned int  pitch ) {
+    
+    if ((pitch) && (pitch < _settings.width)) {
+        fprintf(stderr, "%s: Pitch should be 0 (packed) or at least the width (%u < %u)\n", __func__, pitch, _settings.width);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    //update settings
+    _settings.pitch = pitch;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating pitch to: %u\n", __func__, pitch);
+    
+    //reset camera
+    return resetCamera();
+}
+
+int FlashCam::getSettingPitch( unsigned int *pitch ) {
+    *pitch = _userdata.framebuffer_pitch;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);    
+}
+
+//Extraction determines the framebuffer size: reset & re-initialise all components
+int FlashCam::setSettingExtract( const FLASHCAM_EXTRACT_T *extract ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change extraction while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    // Valid for current image size?
+    FLASHCAM_EXTRACT_T check = *extract;
+    if (FlashCamExtract::init(&check, _settings.width, _settings.height, _userdata.framebuffer_pitch) == 0)
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    
+    //update settings
+    _settings.extract = *extract;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating extraction to: planes %u, regions %u\n", __func__, extract->planes, extract->num_rois);
+    
+    //reset camera
+    return resetCamera();
+}
+
+int FlashCam::getSettingExtract( FLASHCAM_EXTRACT_T *extract ) {
+    *extract = _userdata.extract;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);    
+}
+
 int FlashCam::setSettingVerbose( int  verbose ) {
     _settings.verbose = verbose;
     return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);    
@@ -966,7 +2015,7 @@ int FlashCam::getSettingUpdate( int *update ) {
 }
 
 int FlashCam::setSettingCaptureMode( FLASHCAM_MODE_T  mode ) {
-    MMAL_STATUS_T status;
+    int status;
     
     // Is camera active?
     if (_active) {
@@ -980,73 +2029,115 @@ int FlashCam::setSettingCaptureMode( FLASHCAM_MODE_T  mode ) {
         return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
     }
     
+    if ((mode != FLASHCAM_MODE_VIDEO) && (mode != FLASHCAM_MODE_CAPTURE)) {
+        //unknown mode..
+        fprintf(stderr, "%s: Cannot enable camera. Unknown mode (%u)\n", __func__, mode);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
     _settings.mode = mode;
     
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Enabling %s-mode.\n", __func__, (mode == FLASHCAM_MODE_VIDEO) ? "video" : "capture");
+    
     //Setup userdata / camera
-    MMAL_PORT_T *old_port = NULL;     
-    MMAL_PORT_T *new_port = NULL;     
+    MMAL_PORT_T *video_port   = _camera_component->output[MMAL_CAMERA_VIDEO_PORT];
+    MMAL_PORT_T *capture_port = _camera_component->output[MMAL_CAMERA_CAPTURE_PORT];
+    MMAL_PORT_T *new_port     = (mode == FLASHCAM_MODE_VIDEO) ? video_port   : capture_port;
+    MMAL_PORT_T *old_port     = (mode == FLASHCAM_MODE_VIDEO) ? capture_port : video_port;
     
-    if (_settings.mode == FLASHCAM_MODE_VIDEO) {
-        //video mode..
-        if (_settings.verbose)
-            fprintf(stdout, "%s: Enabling video-mode.\n", __func__);
-        
-        new_port = _camera_component->output[MMAL_CAMERA_VIDEO_PORT];
-        old_port = _camera_component->output[MMAL_CAMERA_CAPTURE_PORT];
-        
-        //set buffer sizes
-        if (new_port->buffer_size < new_port->buffer_size_min)
-            new_port->buffer_size = new_port->buffer_size_min;
-        
-        if (new_port->buffer_num < VIDEO_OUTPUT_BUFFERS_NUM)
-            new_port->buffer_num = VIDEO_OUTPUT_BUFFERS_NUM;
-        
-    } else if (_settings.mode == FLASHCAM_MODE_CAPTURE) {
-        //capture mode..
-        if (_settings.verbose)
-            fprintf(stdout, "%s: Enabling capture-mode.\n", __func__);
-        
-        old_port = _camera_component->output[MMAL_CAMERA_VIDEO_PORT];
-        new_port = _camera_component->output[MMAL_CAMERA_CAPTURE_PORT];
+    // Armed: both ports stay enabled with their buffers, switching only selects the port started by startCapture().
+    //  With OpenGL the video port holds opaque buffers, so ports are switched.
+    bool armed = _settings.armed && !_settings.opengl_enabled;
+    
+    // Disable old port and its pool (not while frames of it are lent to the user)
+    if ( !armed && old_port->is_enabled && drainViews() ) {
+        fprintf(stderr, "%s: Cannot change camera mode while frames are not released.\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EAGAIN);
+    }
+    if ( !armed && old_port->is_enabled ) {
+        mmal_port_disable( old_port );
+        FlashCamBuffers::destroy( getBuffers(&_userdata, old_port) );
+    }
+    
+    // Enable port(s)
+    if ( !new_port->is_enabled && (status = setupPort(new_port)) )
+        return status;
+    if ( armed && !old_port->is_enabled && (status = setupPort(old_port)) )
+        return status;
+    
+    //layout of planes in buffers of new port; no frame in progress
+    _userdata.stride          = mmal_encoding_width_to_stride(new_port->format->encoding, new_port->format->es->video.width);
+    _userdata.slice_height    = new_port->format->es->video.height;
+    _userdata.framebuffer_idx.store(0, std::memory_order_relaxed);
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Success.\n", __func__);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+/*
+ * int FlashCam::setupPort( MMAL_PORT_T *port )
+ *  Creates the buffers of the video or capture port and enables the port.
+ */
+int FlashCam::setupPort( MMAL_PORT_T *port ) {
+    MMAL_STATUS_T status;
+    
+    //Buffers
+    FLASHCAM_BUFFERS_T *buffers = NULL;
+    unsigned int num  = 0;          // initial number of buffers
+    unsigned int max  = 0;          // maximum number of buffers
+    bool         tune = false;      // tune number of buffers?
+    
+    //set buffer sizes
+    if (port->buffer_size < port->buffer_size_min)
+        port->buffer_size = port->buffer_size_min;
+    
+    if (port == _camera_component->output[MMAL_CAMERA_VIDEO_PORT]) {
+        buffers = &_buffers;
         
-        //set buffer sizes
-        if (new_port->buffer_size < new_port->buffer_size_min)
-            new_port->buffer_size = new_port->buffer_size_min;
+        // number of buffers fitting in the memory limit
+        max = FLASHCAM_BUFFERS_MAX;
+        if (_settings.buffer_memory)
+            max = vcos_min(max, _settings.buffer_memory / port->buffer_size);
+        max = vcos_max(max, port->buffer_num_min);
         
-        if (new_port->buffer_num < new_port->buffer_num_recommended)
-            new_port->buffer_num = new_port->buffer_num_recommended;
+        if (_settings.buffer_num) {
+            // fixed number of buffers
+            num  = vcos_min(vcos_max(_settings.buffer_num, port->buffer_num_min), max);
+            max  = num;
+        } else {
+            // tuned to the time buffers are held by FlashCam and user (not with OpenGL: buffers are textures)
+            num  = vcos_min(vcos_max((unsigned int) FLASHCAM_BUFFERS_MIN, port->buffer_num_min), max);
+            tune = !_settings.opengl_enabled;
+            if (!tune)
+                max = num;
+        }
         
     } else {
-        //unknown mode..
-        fprintf(stderr, "%s: Cannot enable camera. Unknown mode (%u)\n", __func__, _settings.mode);
-        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+        buffers = &_capture_buffers;
+        
+        num = vcos_max(port->buffer_num_recommended, port->buffer_num_min);
+        max = num;
     }
     
-    // Disable old port
-    if ( old_port && old_port->is_enabled )
-        mmal_port_disable( old_port );
-    
-    // Disable old pool
-    if ( _camera_pool )
-        mmal_pool_destroy( _camera_pool );
-    
     // Pool/Buffer sizes 
     if ( _settings.verbose ) {
-        fprintf(stdout, "%s: - Pool size  : %d\n", __func__, new_port->buffer_num);
-        fprintf(stdout, "%s: - Buffer size: %d\n", __func__, new_port->buffer_size);
-        fprintf(stdout, "%s: - Total size : %d\n", __func__, new_port->buffer_num * new_port->buffer_size);
+        fprintf(stdout, "%s: - Port       : %s\n", __func__, (buffers == &_buffers) ? "video" : "capture");
+        fprintf(stdout, "%s: - Pool size  : %d (max: %d, tuned: %d)\n", __func__, num, max, tune);
+        fprintf(stdout, "%s: - Buffer size: %d\n", __func__, port->buffer_size);
+        fprintf(stdout, "%s: - Total size : %d\n", __func__, num * port->buffer_size);
     }
     
-    // Create pool of buffer headers for the output port to consume
-    _camera_pool = mmal_port_pool_create(new_port, new_port->buffer_num, new_port->buffer_size);
-    if ( !_camera_pool ) {
+    // Create pool of buffer headers (and their views) for the output port to consume
+    if ( FlashCamBuffers::create(buffers, port, num, max, tune) ) {
         vcos_log_error("%s: Failed to create buffer header pool", __func__);
-    } else {
-        _userdata.camera_pool = _camera_pool;
+        return FlashCamMMAL::mmal_to_int(MMAL_ENOMEM);
     }
     
 #ifdef BUILD_FLASHCAM_WITH_OPENGL
-    if (_settings.opengl_enabled) {
+    if (_settings.opengl_enabled && !_opengl_queue) {
         _opengl_queue = mmal_queue_create();
         if (! _opengl_queue ) {
             vcos_log_error("Error allocating OpenGL queue");
@@ -1058,33 +2149,17 @@ int FlashCam::setSettingCaptureMode( FLASHCAM_MODE_T  mode ) {
 #endif
     
     //set userdata
-    new_port->userdata = (struct MMAL_PORT_USERDATA_T *)&_userdata;
+    port->userdata = (struct MMAL_PORT_USERDATA_T *)&_userdata;
     
     // Enable the camera output port with callback
-    if ((status = mmal_port_enable(new_port, FlashCam::buffer_callback)) != MMAL_SUCCESS) {
+    if ((status = mmal_port_enable(port, FlashCam::buffer_callback)) != MMAL_SUCCESS) {
         vcos_log_error("%s: Failed to setup camera output (%u)", __func__, status);
         return FlashCamMMAL::mmal_to_int(status);
     }
     
-    // buffer pointer
-    MMAL_BUFFER_HEADER_T *buffer;
-    // number of buffers
-    int qsize = mmal_queue_length(_camera_pool->queue);
-
     // Send all the buffers to the camera output port
-    for (int i=0; i<qsize; i++) {
-        //get buffer
-        buffer = mmal_queue_get(_camera_pool->queue);
-        
-        if (!buffer)
-            vcos_log_error("%s: Unable to get a required buffer %d from pool queue", __func__, i);
-        
-        if (mmal_port_send_buffer(new_port, buffer)!= MMAL_SUCCESS)
-            vcos_log_error("%s: Unable to send a buffer to camera output port (%d)", __func__, i);
-    }
-    
-    if (_settings.verbose)
-        fprintf(stdout, "%s: Success.\n", __func__);
+    if ( FlashCamBuffers::start(buffers, port) )
+        vcos_log_error("%s: Unable to send all buffers to camera output port", __func__);
     
     return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
 }
@@ -1094,6 +2169,27 @@ int FlashCam::getSettingCaptureMode( FLASHCAM_MODE_T *mode ) {
     return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
 }
 
+int FlashCam::setSettingArmed( unsigned int  armed ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change armed ports while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.armed = (armed > 0) ? 1 : 0;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating armed ports to: %u\n", __func__, _settings.armed);
+    
+    //(dis)arm port of other mode
+    return setSettingCaptureMode(_settings.mode);
+}
+
+int FlashCam::getSettingArmed( unsigned int *armed ) {
+    *armed = _settings.armed;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
 int FlashCam::setSettingSensorMode( unsigned int  sensormode ) {    
     //update settings
     _settings.sensormode = sensormode;
@@ -1110,6 +2206,410 @@ int FlashCam::getSettingSensorMode( unsigned int *sensormode ) {
     return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
 }
 
+int FlashCam::setSettingDelivery( FLASHCAM_DELIVERY_T  delivery ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change delivery while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.delivery = delivery;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating delivery to: %d\n", __func__, delivery);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingDelivery( FLASHCAM_DELIVERY_T *delivery ) {
+    *delivery = _settings.delivery;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingRingSize( unsigned int  size ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change ring size while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if (size < 2) {
+        fprintf(stderr, "%s: Ring requires at least 2 slots (%u)\n", __func__, size);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.ring_size = size;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating ring size to: %u\n", __func__, size);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingRingSize( unsigned int *size ) {
+    *size = _settings.ring_size;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingBatchSize( unsigned int  size ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change batch size while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if (size < 1) {
+        fprintf(stderr, "%s: Batch requires at least 1 frame (%u)\n", __func__, size);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.batch_size = size;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating batch size to: %u\n", __func__, size);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingBatchSize( unsigned int *size ) {
+    *size = _settings.batch_size;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingPairSubtract( unsigned int  enabled ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change pair subtraction while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.pair_subtract = enabled ? 1 : 0;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating pair subtraction to: %u\n", __func__, _settings.pair_subtract);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingPairSubtract( unsigned int *enabled ) {
+    *enabled = _settings.pair_subtract;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingStack( FLASHCAM_STACK_MODE_T  mode, unsigned int  window, unsigned int  interval, unsigned int  chroma ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change stack while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if ((mode != FLASHCAM_STACK_SUM) && (mode != FLASHCAM_STACK_AVERAGE)) {
+        fprintf(stderr, "%s: Unknown stack mode (%d)\n", __func__, mode);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if ((window < 1) || (window > FLASHCAM_STACK_MAX_WINDOW)) {
+        fprintf(stderr, "%s: Stack requires a window of 1 to %d frames (%u)\n", __func__, FLASHCAM_STACK_MAX_WINDOW, window);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if (interval < 1) {
+        fprintf(stderr, "%s: Stack requires an interval of at least 1 frame (%u)\n", __func__, interval);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.stack_mode     = mode;
+    _settings.stack_window   = window;
+    _settings.stack_interval = interval;
+    _settings.stack_chroma   = chroma ? 1 : 0;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating stack to: mode %d, window %u, interval %u, chroma %u\n", __func__, mode, window, interval, _settings.stack_chroma);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingStack( FLASHCAM_STACK_MODE_T *mode, unsigned int *window, unsigned int *interval, unsigned int *chroma ) {
+    *mode     = _settings.stack_mode;
+    *window   = _settings.stack_window;
+    *interval = _settings.stack_interval;
+    *chroma   = _settings.stack_chroma;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingShared( const char  *name ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change shared ring while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.shared = name;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating shared ring to: %s\n", __func__, name ? name : "-");
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingShared( const char **name ) {
+    *name = _settings.shared;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingDispatch( unsigned int  threads, unsigned int  queue, FLASHCAM_DISPATCH_POLICY_T  policy ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change dispatch pool while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if ((threads < 1) || (threads > FLASHCAM_DISPATCH_MAX_THREADS)) {
+        fprintf(stderr, "%s: Dispatch pool requires 1 to %d threads (%u)\n", __func__, FLASHCAM_DISPATCH_MAX_THREADS, threads);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if (queue < 1) {
+        fprintf(stderr, "%s: Dispatch queue requires at least 1 frame (%u)\n", __func__, queue);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if ((policy != FLASHCAM_DISPATCH_DROP_OLDEST) && (policy != FLASHCAM_DISPATCH_DROP_NEWEST) && (policy != FLASHCAM_DISPATCH_BLOCK)) {
+        fprintf(stderr, "%s: Unknown dispatch policy (%d)\n", __func__, policy);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.dispatch_threads = threads;
+    _settings.dispatch_queue   = queue;
+    _settings.dispatch_policy  = policy;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating dispatch pool to: %u threads, %u queued, policy %d\n", __func__, threads, queue, policy);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingDispatch( unsigned int *threads, unsigned int *queue, FLASHCAM_DISPATCH_POLICY_T *policy ) {
+    *threads = _settings.dispatch_threads;
+    *queue   = _settings.dispatch_queue;
+    *policy  = _settings.dispatch_policy;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingTrace( unsigned int  trace ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change tracing while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.trace = (trace > 0) ? 1 : 0;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating tracing to: %u\n", __func__, _settings.trace);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingTrace( unsigned int *trace ) {
+    *trace = _settings.trace;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingRecord( const char  *path ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change recording while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.record = path;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating recording to: %s\n", __func__, path ? path : "-");
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingRecord( const char **path ) {
+    *path = _settings.record;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingRecorder( const char  *path, unsigned int  memory ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change recorder while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.recorder        = path;
+    _settings.recorder_memory = memory;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating recorder to: %s (%u bytes)\n", __func__, path ? path : "-", memory);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingRecorder( const char **path, unsigned int *memory ) {
+    *path   = _settings.recorder;
+    *memory = _settings.recorder_memory;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingClock( unsigned int  interval ) {
+    _settings.clock_interval = interval;
+    
+    //restart sampling at the new interval, the estimate is kept
+    FlashCamClock::stop(&_clock);
+    if (_initialised && interval && FlashCamClock::start(&_clock, _camera_component->control, interval)) {
+        fprintf(stderr, "%s: Failed to start GPU clock estimation\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating clock interval to: %u ms\n", __func__, interval);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingClock( unsigned int *interval ) {
+    *interval = _settings.clock_interval;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+//Flags apply when frame memory is mapped: reset & re-initialise all components
+int FlashCam::setSettingMemory( unsigned int  flags ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change frame memory while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if (flags & ~(FLASHCAM_MEMORY_LOCK | FLASHCAM_MEMORY_HUGEPAGES))
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    
+    _settings.memory = flags;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating frame memory to: %s%s\n", __func__, (flags & FLASHCAM_MEMORY_LOCK) ? "locked " : "pageable ",
+                (flags & FLASHCAM_MEMORY_HUGEPAGES) ? "hugepages" : "pages");
+    
+    //reset camera
+    return resetCamera();
+}
+
+int FlashCam::getSettingMemory( unsigned int *flags ) {
+    *flags = _settings.memory;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingSched( FLASHCAM_THREAD_T thread, int  priority, unsigned int  cpus ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change scheduling while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    FLASHCAM_SCHED_PARAMS_T params = {};
+    params.priority = priority;
+    params.cpus     = cpus;
+    if ((thread < 0) || (thread >= FLASHCAM_THREADS) || FlashCamSched::check(&params))
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    
+    _settings.sched[thread] = params;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating scheduling of thread %d to: priority %d, CPUs 0x%x\n", __func__, thread, priority, cpus);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingSched( FLASHCAM_THREAD_T thread, int *priority, unsigned int *cpus ) {
+    if ((thread < 0) || (thread >= FLASHCAM_THREADS))
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    
+    *priority = _settings.sched[thread].priority;
+    *cpus     = _settings.sched[thread].cpus;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingReplay( const char  *path, FLASHCAM_REPLAY_MODE_T  mode ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change replay while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if ((mode != FLASHCAM_REPLAY_CADENCE) && (mode != FLASHCAM_REPLAY_FAST))
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    
+    _settings.replay      = path;
+    _settings.replay_mode = mode;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating replay to: %s (%u)\n", __func__, path ? path : "-", mode);
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingReplay( const char **path, FLASHCAM_REPLAY_MODE_T *mode ) {
+    *path = _settings.replay;
+    *mode = _settings.replay_mode;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::setSettingMetrics( const char  *name ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change metrics while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    _settings.metrics = name;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating metrics to: %s\n", __func__, name ? name : "-");
+    
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+int FlashCam::getSettingMetrics( const char **name ) {
+    *name = _settings.metrics;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
+//Buffers are allocated with the port: reset & re-initialise all components
+int FlashCam::setSettingBuffers( unsigned int  num, unsigned int  memory ) {
+    // Is camera active?
+    if (_active) {
+        fprintf(stderr, "%s: Cannot change buffers while camera is in use\n", __func__);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    if (num > FLASHCAM_BUFFERS_MAX) {
+        fprintf(stderr, "%s: Number of buffers should be 0 (auto) or at most %u (%u)\n", __func__, FLASHCAM_BUFFERS_MAX, num);
+        return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
+    }
+    
+    //update settings
+    _settings.buffer_num    = num;
+    _settings.buffer_memory = memory;
+    
+    if (_settings.verbose)
+        fprintf(stdout, "%s: Updating buffers to: %u (memory: %u)\n", __func__, num, memory);
+    
+    //reset camera
+    return resetCamera();
+}
+
+int FlashCam::getSettingBuffers( unsigned int *num, unsigned int *memory ) {
+    *num    = _settings.buffer_num;
+    *memory = _settings.buffer_memory;
+    return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
+}
+
 /*** PLL FUNCTIONS ***/
 
 #ifndef BUILD_FLASHCAM_WITH_PLL
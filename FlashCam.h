@@ -43,6 +43,23 @@
 #include "interface/mmal/mmal.h"
 #include "interface/mmal/util/mmal_connection.h"
 
+#include "FlashCam_ring.h"
+#include "FlashCam_dispatch.h"
+#include "FlashCam_batch.h"
+#include "FlashCam_pair.h"
+#include "FlashCam_stack.h"
+#include "FlashCam_trace.h"
+#include "FlashCam_buffers.h"
+#include "FlashCam_stream.h"
+#include "FlashCam_extract.h"
+#include "FlashCam_replay.h"
+#include "FlashCam_metrics.h"
+#include "FlashCam_shared.h"
+#include "FlashCam_recorder.h"
+#include "FlashCam_clock.h"
+#include "FlashCam_memory.h"
+#include "FlashCam_sched.h"
+
 #ifdef BUILD_FLASHCAM_WITH_PLL
 #include "FlashCam_pll.h"
 #endif
@@ -59,14 +76,28 @@ private:
     //private variables
     bool                        _initialised        = false;    // Camera initialised?
     bool                        _active             = false;    // Camera currently active?
+    unsigned int                _cameranum          = 0;        // Sensor driven by this instance
     FLASHCAM_PARAMS_T           _params             = {};
     FLASHCAM_SETTINGS_T         _settings           = {};
     MMAL_COMPONENT_T           *_camera_component   = NULL;
     MMAL_COMPONENT_T           *_preview_component  = NULL;
     MMAL_CONNECTION_T          *_preview_connection = NULL;
-    MMAL_POOL_T                *_camera_pool        = NULL;
+    FLASHCAM_BUFFERS_T          _buffers            = {};
+    FLASHCAM_BUFFERS_T          _capture_buffers    = {};
     unsigned char              *_framebuffer        = NULL;
     FLASHCAM_PORT_USERDATA_T    _userdata           = {};
+    FLASHCAM_RING_T             _ring               = {};
+    FLASHCAM_DISPATCH_T         _dispatch           = {};
+    FLASHCAM_BATCH_T            _batch              = {};
+    FLASHCAM_PAIR_T             _pair               = {};
+    FLASHCAM_STACK_T            _stack              = {};
+    FLASHCAM_SHARED_T           _shared             = {};
+    FLASHCAM_RECORDER_T         _recorder           = {};
+    FLASHCAM_CLOCK_T            _clock              = {};
+    FLASHCAM_MEMORY_T           _memory             = {};
+    FLASHCAM_SCHED_T            _sched              = {};
+    FLASHCAM_REPLAY_T           _replay             = {};
+    FLASHCAM_METRICS_T          _metrics            = {};
 #ifdef BUILD_FLASHCAM_WITH_OPENGL
     MMAL_QUEUE_T               *_opengl_queue       = NULL;
 #endif
@@ -74,53 +105,102 @@ private:
 //    FlashCamPLL                 _PLL;
 //#endif
     
-    FLASHCAM_INTERNAL_STATE_T   _state;
+    FLASHCAM_INTERNAL_STATE_T   _state              = {};
     
     //Camera setup functions
     int resetCamera();
     int setupComponents();
     MMAL_STATUS_T setupComponentCamera();
     MMAL_STATUS_T setupComponentPreview();
-    void destroyComponents();
+    int setupPort( MMAL_PORT_T *port );
+    int destroyComponents();
     
     //callbacks for async image/update retrieval
     static void control_callback( MMAL_PORT_T *port , MMAL_BUFFER_HEADER_T *buffer );
     static void buffer_callback(  MMAL_PORT_T *port , MMAL_BUFFER_HEADER_T *buffer );
+    static void processBuffer(    MMAL_PORT_T *port , MMAL_BUFFER_HEADER_T *buffer );
+    static FLASHCAM_BUFFERS_T    *getBuffers(   FLASHCAM_PORT_USERDATA_T *userdata , MMAL_PORT_T *port );
+    static void                   postCapture(  FLASHCAM_PORT_USERDATA_T *userdata , FLASHCAM_BUFFERS_T *buffers );
+    static FLASHCAM_FRAME_VIEW_T *getFrameView( FLASHCAM_PORT_USERDATA_T *userdata , FLASHCAM_BUFFERS_T *buffers , MMAL_BUFFER_HEADER_T *buffer );
     MMAL_STATUS_T connectPorts( MMAL_PORT_T *output_port , MMAL_PORT_T *input_port , MMAL_CONNECTION_T **connection );
     
     //misc
+    void calibrateTrace();
+    int  fenceCallbacks();
+    void drainFrame();
+    int  drainViews();
+    void unwindCapture();
     MMAL_STATUS_T setParameterRational( int id , int  val );
     MMAL_STATUS_T getParameterRational( int id , int *val );
     
-    // -- SINGLETON --    
-    // Copy & assign overide: not implemented as a singleton cannot have copies.
+    // Copy & assign overide: not implemented as an instance owns a camera.
     FlashCam(FlashCam const&);
     void operator=(FlashCam const&);
+    
+public:
     // Constructor / Destructor
+    //  Each instance runs an independent pipeline (select the sensor with setCameraNum()), 
+    //  so multiple cameras can capture concurrently from separate threads.
     FlashCam();
+    FlashCam( unsigned int cameranum );
     ~FlashCam();
-    
-public:
-    // -- SINGLETON --
+
+    // Default instance
     static FlashCam& get() {
         static FlashCam cam;
         return cam;
     }
     // ---------------
     
-    //all to default values
-    void clear();
+    //all to default values (refused while zero-copy frames are not released)
+    int clear();
     
     // capture image
     int startCapture();
     int stopCapture();
     
+    // burst of stills (capture mode): `num` frames are captured one request after another into `frames` (getFrameSize() bytes each),
+    //  `pts` receives their timestamps (MMAL_TIME_UNKNOWN when lost). Frame callbacks are not called.
+    int captureBurst(unsigned int num, unsigned char **frames, uint64_t *pts);
+    
+    // bytes of a frame (framebuffer) with the current size and extraction settings
+    int getFrameSize(unsigned int *size);
+    
     //callback options --> for when a full frame is received
     void setFrameCallback(FLASHCAM_CALLBACK_T callback);
+    void setFrameCallback(FLASHCAM_CALLBACK_VIEW_T callback);
+    void setFrameCallback(FLASHCAM_CALLBACK_BATCH_T callback);
+    void setFrameCallback(FLASHCAM_CALLBACK_PAIR_T callback);
+    void setFrameCallback(FLASHCAM_CALLBACK_STACK_T callback);
 #ifdef BUILD_FLASHCAM_WITH_OPENGL
     void setFrameCallback(FLASHCAM_CALLBACK_OPENGL_T callback);
 #endif
     void resetFrameCallback();
+    
+    // return a zero-copy frame to the camera (FLASHCAM_DELIVERY_ZEROCOPY)
+    int releaseFrame(FLASHCAM_FRAME_VIEW_T *frame);
+    
+    // delivery statistics. Can be read while streaming, reset when not capturing.
+    int getStats(FLASHCAM_STATS_T *stats);
+    int resetStats();
+    
+    // stream health: received, dropped (timestamp gaps), discarded and aborted frames. Can be read while streaming.
+    int getStreamStats(FLASHCAM_STREAM_STATS_T *stats);
+    int resetStreamStats();
+    
+    // progress of the recorder (setting `recorder`): frames written and frames not recorded as the disk fell behind.
+    int getRecorderStats(FLASHCAM_RECORDER_STATS_T *stats);
+    
+    // frame memory (setting `memory`): regions mapped and reused across resets, page faults of the process.
+    int getMemoryStats(FLASHCAM_MEMORY_STATS_T *stats);
+    
+    // wake-up jitter of threads (see FLASHCAM_SCHED_T), always measured
+    int getSchedJitter(FLASHCAM_THREAD_T thread, FLASHCAM_HISTOGRAM_T *hist);
+    int resetSchedJitter();
+    
+    // latency histograms (setting `trace`), see FLASHCAM_TRACE_STAGE_T
+    int getTrace(FLASHCAM_TRACE_STAGE_T stage, FLASHCAM_HISTOGRAM_T *hist);
+    int resetTrace();
         
     /******************************************/
     /*********   GETTERS / SETTERS  ***********/
@@ -128,6 +208,11 @@ public:
     
     int getGPUtime(uint64_t *us);
     
+    // GPU clock (timestamps of frames) in CLOCK_MONOTONIC, estimated in the background (setting `clock_interval`).
+    //  translateTime maps a GPU time, such as `pts`, onto CLOCK_MONOTONIC with an error bound (us). No MMAL calls.
+    int getClockEstimate(FLASHCAM_CLOCK_ESTIMATE_T *estimate);
+    int translateTime(uint64_t gpu_us, uint64_t *host_us, uint32_t *error_us);
+    
     /* Library Settings */
     
     // setting utilities
@@ -141,6 +226,16 @@ public:
 
     int setSettingSize( unsigned int  width, unsigned int  height );
     int getSettingSize( unsigned int *width, unsigned int *height );
+    
+    // Row pitch of delivered frames (bytes per Y row, U/V rows are half). 0 = packed. 
+    //  getSettingPitch returns the pitch in use, also when packed.
+    int setSettingPitch( unsigned int  pitch );
+    int getSettingPitch( unsigned int *pitch );
+    
+    // Planes and regions copied into frames (FLASHCAM_EXTRACT_T); the callback receives the size of the first region.
+    //  getSettingExtract returns the regions in use, including their position (`pitch`, `offset`) in the frame.
+    int setSettingExtract( const FLASHCAM_EXTRACT_T *extract );
+    int getSettingExtract( FLASHCAM_EXTRACT_T *extract );
 
     int setSettingVerbose( int  verbose );
     int getSettingVerbose( int *verbose );
@@ -150,10 +245,80 @@ public:
     
     int setSettingCaptureMode( FLASHCAM_MODE_T  mode );
     int getSettingCaptureMode( FLASHCAM_MODE_T *mode );
+    
+    // Keep video and capture port enabled with their own buffers, so switching modes costs about a frame (not with OpenGL).
+    int setSettingArmed( unsigned int  armed );
+    int getSettingArmed( unsigned int *armed );
 
     int setSettingSensorMode( unsigned int  sensormode );
     int getSettingSensorMode( unsigned int *sensormode );
 
+    int setSettingDelivery( FLASHCAM_DELIVERY_T  delivery );
+    int getSettingDelivery( FLASHCAM_DELIVERY_T *delivery );
+
+    int setSettingRingSize( unsigned int  size );
+    int getSettingRingSize( unsigned int *size );
+    
+    // Batches (FLASHCAM_DELIVERY_BATCH): frames per batch handed to the batch callback. See FLASHCAM_BATCH_VIEW_T.
+    int setSettingBatchSize( unsigned int  size );
+    int getSettingBatchSize( unsigned int *size );
+    
+    // Pairs (FLASHCAM_DELIVERY_PAIR): deliver the saturating difference lit - unlit of the Y planes instead of both frames.
+    //  The difference is computed while the second frame of a pair is stitched. See FLASHCAM_PAIR_VIEW_T.
+    int setSettingPairSubtract( unsigned int  enabled );
+    int getSettingPairSubtract( unsigned int *enabled );
+    
+    // Stacks (FLASHCAM_DELIVERY_STACK): sum or moving average of `window` frames, delivered every `interval` frames.
+    //  Y planes only, unless `chroma` is set. See FLASHCAM_STACK_VIEW_T.
+    int setSettingStack( FLASHCAM_STACK_MODE_T  mode, unsigned int  window, unsigned int  interval, unsigned int  chroma );
+    int getSettingStack( FLASHCAM_STACK_MODE_T *mode, unsigned int *window, unsigned int *interval, unsigned int *chroma );
+    
+    // Shared ring (FLASHCAM_DELIVERY_SHARED): POSIX shared-memory segment `name` with `ring size` frames. See FlashCamShared for readers.
+    int setSettingShared( const char  *name );
+    int getSettingShared( const char **name );
+
+    // Dispatch pool (FLASHCAM_DELIVERY_DISPATCH): number of workers, queue length and backpressure policy.
+    int setSettingDispatch( unsigned int  threads, unsigned int  queue, FLASHCAM_DISPATCH_POLICY_T  policy );
+    int getSettingDispatch( unsigned int *threads, unsigned int *queue, FLASHCAM_DISPATCH_POLICY_T *policy );
+
+    int setSettingTrace( unsigned int  trace );
+    int getSettingTrace( unsigned int *trace );
+    
+    // Record the camera buffers of each capture to `path` (NULL = off). Not with OpenGL.
+    int setSettingRecord( const char  *path );
+    int getSettingRecord( const char **path );
+    
+    // Record delivered frames to `path` (NULL = off) through a writer thread, queueing at most `memory` bytes. Not with OpenGL.
+    //  See FLASHCAM_RECORDER_HEADER_T for the format.
+    int setSettingRecorder( const char  *path, unsigned int  memory );
+    int getSettingRecorder( const char **path, unsigned int *memory );
+    
+    // Interval (ms) at which the GPU clock is sampled against CLOCK_MONOTONIC (0 = off), see translateTime().
+    int setSettingClock( unsigned int  interval );
+    int getSettingClock( unsigned int *interval );
+    
+    // Frame memory (framebuffer, ring and dispatch frames): mask of FLASHCAM_MEMORY_*. Memory is kept across resets
+    //  and only mapped again when frames grow. Locking requires a sufficient RLIMIT_MEMLOCK (or CAP_IPC_LOCK).
+    int setSettingMemory( unsigned int  flags );
+    int getSettingMemory( unsigned int *flags );
+    
+    // Scheduling of `thread`: SCHED_FIFO `priority` (0 = default policy) and CPU affinity mask `cpus` (0 = all CPUs).
+    //  Applied from the next startCapture(). Real-time priorities require CAP_SYS_NICE or a sufficient RLIMIT_RTPRIO.
+    int setSettingSched( FLASHCAM_THREAD_T thread, int  priority, unsigned int  cpus );
+    int getSettingSched( FLASHCAM_THREAD_T thread, int *priority, unsigned int *cpus );
+    
+    // Replay a recording instead of the camera (NULL = off), in video mode. The recording should match the size and pitch settings.
+    int setSettingReplay( const char  *path, FLASHCAM_REPLAY_MODE_T  mode );
+    int getSettingReplay( const char **path, FLASHCAM_REPLAY_MODE_T *mode );
+    
+    // Publish runtime metrics (FLASHCAM_METRICS_BLOCK_T) as POSIX shared-memory segment `name` (NULL = off), see FlashCamMetrics::attach().
+    int setSettingMetrics( const char  *name );
+    int getSettingMetrics( const char **name );
+    
+    // Video buffers: number (0 = tuned to the time frames are held) and memory limit in bytes (0 = none).
+    int setSettingBuffers( unsigned int  num, unsigned int  memory );
+    int getSettingBuffers( unsigned int *num, unsigned int *memory );
+
     //PLL
     int setPLLEnabled( unsigned int  enabled );
     int getPLLEnabled( unsigned int *enabled );
@@ -42,6 +42,10 @@
 #include "interface/mmal/mmal.h"
 #include "interface/mmal/mmal_logging.h"
 
+#include <atomic>
+#include <pthread.h>
+#include <stdio.h>
+
 #ifdef BUILD_FLASHCAM_WITH_OPENGL
 #include <vector>
 #include "GLES2/gl2.h"
@@ -67,8 +71,14 @@
 #define CAPTURE_FRAME_RATE_NUM 0
 #define CAPTURE_FRAME_RATE_DEN 1
 
-//minimum video buffer
-#define VIDEO_OUTPUT_BUFFERS_NUM 3
+// Camera buffers (see FLASHCAM_BUFFERS_T)
+#define FLASHCAM_BUFFERS_MIN        3           // Minimum number of video buffers when tuning
+#define FLASHCAM_BUFFERS_MAX        32          // Maximum number of buffers in a pool
+#define FLASHCAM_BUFFERS_WINDOW     1000000     // Tuning window (us)
+#define FLASHCAM_BUFFERS_SHRINK     5           // Windows with a lower demand before a buffer is released
+#define FLASHCAM_DRAIN_TIMEOUT_US   1000000     // Longest wait for zero-copy frames held by the user when destroying buffers
+#define FLASHCAM_STILL_TIMEOUT_US   5000000     // Longest wait for a still of a burst (on top of its shutter speed)
+#define FLASHCAM_FENCE_TIMEOUT_US   1000000     // Longest wait for buffer callbacks in progress when stopping
 
 // Mode of FlashCam: it is either setup to do image-capturing, or it streams at a set fps images.
 typedef enum {
@@ -77,11 +87,379 @@ typedef enum {
     FLASHCAM_MODE_CAPTURE
 } FLASHCAM_MODE_T;
 
+// Delivery of frames to the user (non-OpenGL only).
+typedef enum {
+    FLASHCAM_DELIVERY_COPY = 0,                 // Frame is stitched into the internal framebuffer, callback receives a pointer to it.
+    FLASHCAM_DELIVERY_ZEROCOPY,                 // Callback receives plane views into the MMAL buffer. Frame must be released with `releaseFrame()`.
+    FLASHCAM_DELIVERY_RING,                     // Frame is stitched into a slot of a ring, callback is called from a separate consumer thread.
+    FLASHCAM_DELIVERY_DISPATCH,                 // Frame is queued for a pool of worker threads, callback is called concurrently from these workers.
+    FLASHCAM_DELIVERY_SHARED,                   // Frame is stitched into a slot of a shared-memory ring for other processes, callback receives a pointer to the slot.
+    FLASHCAM_DELIVERY_BATCH,                    // Frames are stitched into a batch of consecutive frames, batch callback is called per batch from a consumer thread.
+    FLASHCAM_DELIVERY_PAIR,                     // Lit frames (PLL) are paired with the nearest unlit frame, pair callback is called per pair from a consumer thread.
+    FLASHCAM_DELIVERY_STACK                     // Frames are stacked into 16-bit accumulators, stack callback is called every `stack_interval` frames from a consumer thread.
+} FLASHCAM_DELIVERY_T;
+
+// Stacking of frames (FLASHCAM_DELIVERY_STACK), see FLASHCAM_STACK_VIEW_T.
+typedef enum {
+    FLASHCAM_STACK_SUM = 0,                     // Sum of the last `stack_window` frames
+    FLASHCAM_STACK_AVERAGE                      // Exponential moving average with weight 1 / `stack_window` (rounded down to a power of 2)
+} FLASHCAM_STACK_MODE_T;
+
+// Backpressure of the dispatch queue (FLASHCAM_DELIVERY_DISPATCH): what to do with a new frame when the queue is full.
+typedef enum {
+    FLASHCAM_DISPATCH_DROP_OLDEST = 0,          // Oldest queued frame is dropped in favour of the new frame.
+    FLASHCAM_DISPATCH_DROP_NEWEST,              // New frame is dropped.
+    FLASHCAM_DISPATCH_BLOCK                     // Camera callback waits until a worker takes a frame from the queue.
+} FLASHCAM_DISPATCH_POLICY_T;
+
+// Replay of a recorded stream (see FLASHCAM_REPLAY_T).
+typedef enum {
+    FLASHCAM_REPLAY_CADENCE = 0,                // Buffers are replayed at the timing of their recorded timestamps.
+    FLASHCAM_REPLAY_FAST                        // Buffers are replayed as soon as a replay buffer is available.
+} FLASHCAM_REPLAY_MODE_T;
+
+// Threads with their own scheduling settings and wake-up jitter (see FLASHCAM_SCHED_T).
+typedef enum {
+    FLASHCAM_THREAD_CALLBACK = 0,               // MMAL thread calling the camera callback (copy, zero-copy and shared delivery)
+    FLASHCAM_THREAD_OPENGL,                     // OpenGL worker
+    FLASHCAM_THREAD_WORKER,                     // Ring, batch, pair and stack consumers, dispatch workers
+    FLASHCAM_THREADS
+} FLASHCAM_THREAD_T;
+
+// Planes to extract (FLASHCAM_EXTRACT_T)
+#define FLASHCAM_PLANE_Y            1
+#define FLASHCAM_PLANE_U            2
+#define FLASHCAM_PLANE_V            4
+#define FLASHCAM_PLANE_YUV          (FLASHCAM_PLANE_Y | FLASHCAM_PLANE_U | FLASHCAM_PLANE_V)
+#define FLASHCAM_EXTRACT_MAX_ROIS   8
+
+// Frame memory (FLASHCAM_MEMORY_T)
+#define FLASHCAM_MEMORY_LOCK        1           // Regions are page-locked (mlock)
+#define FLASHCAM_MEMORY_HUGEPAGES   2           // Regions are backed by hugepages (explicit, else transparent)
+
+/*
+ * FLASHCAM_ROI_T
+ * Rectangle of the image, in pixels. Position and size are rounded to even values (chroma is subsampled).
+ *  `pitch` and `offset` describe where the region is stored in the delivered frame; these are set by FlashCam.
+ */
+typedef struct {
+    unsigned int x;                             // Left column
+    unsigned int y;                             // Top row
+    unsigned int width;                         // Width
+    unsigned int height;                        // Height
+    unsigned int pitch;                         // Output: bytes per Y row in frame (U/V: half)
+    unsigned int offset[3];                     // Output: offset of Y, U and V plane in frame (extracted planes only)
+} FLASHCAM_ROI_T;
+
+/*
+ * FLASHCAM_EXTRACT_T
+ * Parts of the image which are copied from the camera into delivered frames (copy, ring and dispatch delivery).
+ *  Without regions the full image is copied at the set pitch. Regions are stored in order, each with its selected planes
+ *  back to back: with all planes and no regions this is the regular I420 frame, with only the Y plane just that.
+ */
+typedef struct {
+    unsigned int            planes;             // Planes to copy: mask of FLASHCAM_PLANE_*
+    unsigned int            num_rois;           // Number of regions: 0 (full image) to FLASHCAM_EXTRACT_MAX_ROIS
+    FLASHCAM_ROI_T          rois[FLASHCAM_EXTRACT_MAX_ROIS];
+} FLASHCAM_EXTRACT_T;
+
+/*
+ * FLASHCAM_SCHED_PARAMS_T
+ * Scheduling of a thread (FLASHCAM_THREAD_T). Without priority and CPUs the thread is left as created.
+ */
+typedef struct {
+    int                     priority;           // SCHED_FIFO priority: 0 (default policy) or 1 to 99
+    unsigned int            cpus;               // CPU affinity: mask of CPUs, bit i is CPU i (0: all CPUs)
+} FLASHCAM_SCHED_PARAMS_T;
+
+/*
+ * FLASHCAM_FRAME_VIEW_T
+ * View on a frame which is still owned by MMAL (FLASHCAM_DELIVERY_ZEROCOPY).
+ *  The planes are valid until the view is passed to `FlashCam::releaseFrame()`. Until then
+ *  the underlying buffer is not returned to the camera, so release views as soon as possible.
+ */
+typedef struct {
+    unsigned char          *data[3];            // Y, U, V planes
+    unsigned int            stride[3];          // Bytes per row of each plane
+    unsigned int            width;              // Width of image
+    unsigned int            height;             // Height of image
+    uint64_t                pts;                // Presentation timestamp of frame (GPU time, microseconds)
+    bool                    pll_state;          // PLL active in frame?
+    uint64_t                host;               // `pts` in CLOCK_MONOTONIC (us), 0 when the GPU clock is not estimated
+    uint32_t                host_error;         // Error bound of `host` (us)
+    MMAL_PORT_T            *port;               // Internal: port which produced the frame
+    MMAL_BUFFER_HEADER_T   *buffer;             // Internal: locked MMAL buffer holding the planes
+    uint64_t                arrival;            // Internal: arrival of buffer (buffer tuning)
+} FLASHCAM_FRAME_VIEW_T;
+
+/*
+ * FLASHCAM_STATS_T
+ * Delivery statistics, a snapshot of the delivery counters (see: `FLASHCAM_COUNTERS_T`).
+ */
+typedef struct {
+    uint64_t frames;                            // Frames delivered to the user
+    uint64_t bytes_copied;                      // Bytes copied by FlashCam to deliver these frames
+    uint64_t overruns;                          // Frames dropped as the ring (or all batches, pairs, stack slots) was full (FLASHCAM_DELIVERY_RING, _BATCH, _PAIR, _STACK)
+    uint64_t skipped;                           // Unlit frames not copied as they cannot be paired (FLASHCAM_DELIVERY_PAIR), frames outside of any window (FLASHCAM_DELIVERY_STACK)
+    uint64_t unpaired;                          // Lit frames dropped without an unlit frame nearby, unlit frames dropped without a lit frame (FLASHCAM_DELIVERY_PAIR)
+    unsigned int dispatch_depth;                // Frames currently queued for dispatch (FLASHCAM_DELIVERY_DISPATCH)
+    unsigned int dispatch_depth_max;            // Maximum number of frames queued for dispatch
+    uint64_t dispatch_dropped_oldest;           // Queued frames dropped (FLASHCAM_DISPATCH_DROP_OLDEST)
+    uint64_t dispatch_dropped_newest;           // New frames dropped (FLASHCAM_DISPATCH_DROP_NEWEST)
+    uint64_t dispatch_blocked;                  // Times the camera callback waited for the queue (FLASHCAM_DISPATCH_BLOCK)
+    unsigned int buffers;                       // Camera buffers in circulation
+    unsigned int buffers_max;                   // Camera buffers allowed by the memory limit
+} FLASHCAM_STATS_T;
+
+/*
+ * FLASHCAM_COUNTERS_T
+ * Delivery counters, written by the camera callback and by the consumer threads (ring, dispatch, batch, pair, stack)
+ *  and readable without locking. Fields match those of `FLASHCAM_STATS_T`.
+ */
+typedef struct {
+    std::atomic<uint64_t>     frames;
+    std::atomic<uint64_t>     bytes_copied;
+    std::atomic<uint64_t>     overruns;
+    std::atomic<uint64_t>     skipped;
+    std::atomic<uint64_t>     unpaired;
+    std::atomic<unsigned int> dispatch_depth;
+    std::atomic<unsigned int> dispatch_depth_max;
+    std::atomic<uint64_t>     dispatch_dropped_oldest;
+    std::atomic<uint64_t>     dispatch_dropped_newest;
+    std::atomic<uint64_t>     dispatch_blocked;
+} FLASHCAM_COUNTERS_T;
+
+/*
+ * FLASHCAM_TRACE_STAMPS_T
+ * Timestamps of a single frame. All stamps are microseconds in the GPU clock domain (see: `FlashCam::getGPUtime()`),
+ *  hence they can be compared with the sensor timestamp. Stamps which do not apply to the delivery path are 0.
+ */
+typedef struct {
+    uint64_t pts;                               // Sensor timestamp (buffer->pts)
+    uint64_t arrival;                           // First buffer of frame arrived in buffer_callback
+    uint64_t copied;                            // Planes copied/stitched (copy, ring and dispatch delivery)
+    uint64_t dequeued;                          // Frame taken from queue by OpenGL worker
+    uint64_t textured;                          // `mmalbuf2TextureOES` done
+    uint64_t entry;                             // User callback entered
+    uint64_t exit;                              // User callback returned
+} FLASHCAM_TRACE_STAMPS_T;
+
+// Traced stages; each stage has its own latency histogram.
+typedef enum {
+    FLASHCAM_TRACE_SENSOR = 0,                  // pts      -> arrival
+    FLASHCAM_TRACE_COPY,                        // arrival  -> copied
+    FLASHCAM_TRACE_HANDOFF,                     // copied   -> entry    (ring/dispatch: wait for consumer)
+    FLASHCAM_TRACE_GL_DEQUEUE,                  // arrival  -> dequeued (wait for OpenGL worker)
+    FLASHCAM_TRACE_GL_TEXTURE,                  // dequeued -> textured
+    FLASHCAM_TRACE_CALLBACK,                    // entry    -> exit     (user callback, including `callback_egl`)
+    FLASHCAM_TRACE_TOTAL,                       // pts      -> exit
+    FLASHCAM_TRACE_STAGES
+} FLASHCAM_TRACE_STAGE_T;
+
+// Log-bucketed histogram: bucket 0 holds 0us, bucket i (i > 0) holds [2^(i-1), 2^i) us. The last bucket holds all larger values.
+#define FLASHCAM_TRACE_BUCKETS 32
+
+typedef struct {
+    uint64_t count;                             // Number of samples
+    uint64_t sum;                               // Sum of samples (us)
+    uint64_t min;                               // Smallest sample (us)
+    uint64_t max;                               // Largest sample (us)
+    uint64_t buckets[FLASHCAM_TRACE_BUCKETS];   // Number of samples per bucket
+} FLASHCAM_HISTOGRAM_T;
+
+/*
+ * FLASHCAM_TRACE_T
+ * Latency tracer. Histograms are updated from the camera callback and the delivery threads and can be read at any time.
+ */
+typedef struct {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> min;
+    std::atomic<uint64_t> max;
+    std::atomic<uint64_t> buckets[FLASHCAM_TRACE_BUCKETS];
+} FLASHCAM_TRACE_HISTOGRAM_T;
+
+typedef struct {
+    bool                        enabled;        // Stamp and record frames?
+    int64_t                     offset;         // GPU time - CLOCK_MONOTONIC (us), set by calibration
+    FLASHCAM_TRACE_HISTOGRAM_T  hist[FLASHCAM_TRACE_STAGES];
+} FLASHCAM_TRACE_T;
+
+/*
+ * FLASHCAM_STREAM_STATS_T
+ * Health of the camera stream. Frames are either delivered, dropped before they reached FlashCam (gap in the sensor
+ *  timestamps vs. the set framerate), discarded by FlashCam or aborted by the camera. Rates cover the last second.
+ */
+typedef struct {
+    uint64_t received;                          // Frames received from the camera (complete or aborted)
+    uint64_t dropped;                           // Frames missing between received frames (sensor / pool level)
+    uint64_t discarded;                         // Received frames not delivered by FlashCam (queue or ring full, dispatch drop)
+    uint64_t aborted;                           // Frames aborted by the camera (MMAL_BUFFER_HEADER_FLAG_TRANSMISSION_FAILED)
+    uint64_t gap_max;                           // Largest interval between sensor timestamps (us)
+    float    fps;                               // Received frames per second
+    float    drop_rate;                         // Fraction of frames dropped      (dropped   / (received + dropped))
+    float    discard_rate;                      // Fraction of frames discarded    (discarded / received)
+    float    abort_rate;                        // Fraction of frames aborted      (aborted   / received)
+} FLASHCAM_STREAM_STATS_T;
+
+/*
+ * FLASHCAM_STREAM_T
+ * Stream counters, written by the camera callback only and readable without locking.
+ */
+typedef struct {
+    std::atomic<uint64_t> received;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> discarded;
+    std::atomic<uint64_t> aborted;
+    std::atomic<uint64_t> gap_max;
+    std::atomic<float>    fps;
+    std::atomic<float>    drop_rate;
+    std::atomic<float>    discard_rate;
+    std::atomic<float>    abort_rate;
+    uint64_t              last_pts;             // Sensor timestamp of previous frame (0: none)
+    uint64_t              window_start;         // Start of rate window (us)
+    uint64_t              window[4];            // Counters at start of rate window: received, dropped, discarded, aborted
+} FLASHCAM_STREAM_T;
+
+/*
+ * FLASHCAM_CLOCK_ESTIMATE_T
+ * Relation between the GPU clock (sensor timestamps, MMAL_PARAM_TIMESTAMP_MODE_RAW_STC) and CLOCK_MONOTONIC, fitted
+ *  over recent samples of both clocks. A GPU time `t` maps onto CLOCK_MONOTONIC as:
+ *      t + offset + drift * (t - gpu)    (us)    with error bound    error + |t - gpu| * drift_error
+ */
+typedef struct {
+    uint64_t     gpu;                           // GPU time of latest sample (us), 0: no estimate yet
+    double       offset;                        // CLOCK_MONOTONIC - GPU time at `gpu` (us)
+    double       drift;                         // Drift of CLOCK_MONOTONIC against the GPU clock (1e-6: 1 ppm)
+    double       drift_error;                   // Error bound of `drift`
+    double       error;                         // Error bound of `offset` (us): residuals of fit and sampling intervals
+    unsigned int samples;                       // Samples in fit
+} FLASHCAM_CLOCK_ESTIMATE_T;
+
+/*
+ * FLASHCAM_CLOCK_T
+ * Estimator of the GPU clock: a thread samples the GPU clock against CLOCK_MONOTONIC and refits the estimate, which
+ *  the camera callback reads without MMAL calls or locks (seqlock).
+ */
+#define FLASHCAM_CLOCK_WINDOW 16
+
+typedef struct {
+    uint64_t     gpu;                           // GPU time (us)
+    uint64_t     mono;                          // CLOCK_MONOTONIC halfway the read of `gpu` (us)
+    uint64_t     interval;                      // Duration of the read of `gpu` (us)
+} FLASHCAM_CLOCK_SAMPLE_T;
+
+typedef struct {
+    MMAL_PORT_T                *port;           // Port to read the GPU time from (camera control port)
+    unsigned int                interval;       // Sampling interval (ms)
+    FLASHCAM_CLOCK_SAMPLE_T     window[FLASHCAM_CLOCK_WINDOW];
+    unsigned int                num;            // Samples taken (window holds the last FLASHCAM_CLOCK_WINDOW)
+    FLASHCAM_CLOCK_ESTIMATE_T   estimate;       // Latest fit, guarded by `seq`
+    std::atomic<unsigned int>   seq;            // Odd while `estimate` is updated
+    VCOS_THREAD_T               thread;         // Sampling thread
+    bool                        active;         // Sampling thread running?
+    std::atomic<bool>           stop;           // Sampling thread action: terminate
+} FLASHCAM_CLOCK_T;
+
+/*
+ * FLASHCAM_SCHED_T
+ * Scheduling of the threads of an instance and their wake-up jitter. A thread takes on its scheduling itself, the
+ *  MMAL callback thread in the first callback. Jitter is the difference between the interval at which a thread starts on
+ *  frames and the interval of their timestamps: delays by the scheduler, independent of the clock domains.
+ */
+typedef struct {
+    uint64_t                    wake;           // CLOCK_MONOTONIC the thread started on the last frame (us)
+    uint64_t                    pts;            // Timestamp of that frame (0: none yet)
+} FLASHCAM_SCHED_WAKE_T;
+
+typedef struct {
+    FLASHCAM_SCHED_PARAMS_T     params[FLASHCAM_THREADS];   // Scheduling of each thread, taken from the settings at start
+    FLASHCAM_TRACE_HISTOGRAM_T  jitter[FLASHCAM_THREADS];   // Wake-up jitter of each thread (us)
+    FLASHCAM_SCHED_PARAMS_T     callback_applied;           // Scheduling applied to `callback_thread`
+    pthread_t                   callback_thread;            // MMAL callback thread last seen
+    FLASHCAM_SCHED_WAKE_T       callback_wake;              // Last frame of the camera callback
+} FLASHCAM_SCHED_T;
+
+/*
+ * FLASHCAM_BATCH_FRAME_T / FLASHCAM_BATCH_VIEW_T
+ * Batch of consecutive frames (FLASHCAM_DELIVERY_BATCH), handed to the batch callback in one call. The frames are stored
+ *  back to back in `data`, `framesize` bytes apart, each starting on a cache line: frame i is at `data + i * framesize`.
+ *  The batch is valid until the callback returns.
+ */
+typedef struct {
+    uint64_t                 pts;               // Presentation timestamp of frame (GPU time, microseconds)
+    uint64_t                 seq;               // Sequence number of frame (gaps: frames dropped)
+    uint64_t                 host;              // `pts` in CLOCK_MONOTONIC (us), 0 when the GPU clock is not estimated
+    uint32_t                 host_error;        // Error bound of `host` (us)
+    bool                     pll_state;         // PLL active in frame?
+} FLASHCAM_BATCH_FRAME_T;
+
+typedef struct {
+    unsigned char           *data;              // Frames of batch
+    unsigned int             num;               // Number of frames: setting `batch_size` (fewer in the last batch of a stream)
+    unsigned int             framesize;         // Bytes between frames
+    unsigned int             width;             // Width of frames  (first region, see FLASHCAM_EXTRACT_T)
+    unsigned int             height;            // Height of frames
+    unsigned int             pitch;             // Bytes per Y row of frames (U/V: half)
+    FLASHCAM_BATCH_FRAME_T  *frames;            // Metadata of frames
+} FLASHCAM_BATCH_VIEW_T;
+
+/*
+ * FLASHCAM_PAIR_VIEW_T
+ * Lit frame and the nearest unlit frame (FLASHCAM_DELIVERY_PAIR), handed to the pair callback in one call. A frame is lit
+ *  when it was exposed during the pulse of the PLL (`pll_state`). The pair is valid until the callback returns.
+ *  With setting `pair_subtract`, only their difference is delivered: Y = max(lit - unlit, 0), U and V of the lit frame.
+ */
+typedef struct {
+    unsigned char           *lit;               // Frame exposed during the pulse          (NULL with `pair_subtract`)
+    unsigned char           *unlit;             // Nearest frame exposed without pulse     (NULL with `pair_subtract`)
+    unsigned char           *difference;        // Lit frame without ambient light         (NULL without `pair_subtract`)
+    FLASHCAM_BATCH_FRAME_T   lit_frame;         // Metadata of `lit`
+    FLASHCAM_BATCH_FRAME_T   unlit_frame;       // Metadata of `unlit`
+    int64_t                  offset;            // unlit_frame.pts - lit_frame.pts (us; < 0: unlit frame precedes)
+    unsigned int             width;             // Width of frames  (first region, see FLASHCAM_EXTRACT_T)
+    unsigned int             height;            // Height of frames
+    unsigned int             pitch;             // Bytes per Y row of frames (U/V: half)
+} FLASHCAM_PAIR_VIEW_T;
+
+/*
+ * FLASHCAM_STACK_VIEW_T
+ * Stack of frames (FLASHCAM_DELIVERY_STACK), handed to the stack callback every `stack_interval` frames. Element i of `data`
+ *  belongs to byte i of a frame (see FLASHCAM_EXTRACT_T), the mean of the stacked pixels is `data[i] / divisor`:
+ *  - FLASHCAM_STACK_SUM     : sum of the last `frames` frames (up to `stack_window`), `divisor` = `frames`.
+ *  - FLASHCAM_STACK_AVERAGE : moving average in fixed point, `divisor` = 2^FLASHCAM_COPY_AVERAGE_BITS (128).
+ *  Only the Y planes are stacked unless `stack_chroma` is set, elements of U and V are 0 then. Valid until the callback returns.
+ */
+typedef struct {
+    const uint16_t          *data;              // Stacked frame: `size` elements
+    unsigned int             size;              // Elements of `data` (bytes of a frame)
+    unsigned int             frames;            // Frames in the stack
+    unsigned int             divisor;           // Mean = data[i] / divisor
+    FLASHCAM_STACK_MODE_T    mode;              // Sum or moving average
+    FLASHCAM_BATCH_FRAME_T   first;             // Metadata of the oldest frame in the stack (FLASHCAM_STACK_SUM), of the first frame since the last stack (FLASHCAM_STACK_AVERAGE)
+    FLASHCAM_BATCH_FRAME_T   last;              // Metadata of the newest frame in the stack
+    unsigned int             width;             // Width of frames  (first region, see FLASHCAM_EXTRACT_T)
+    unsigned int             height;            // Height of frames
+    unsigned int             pitch;             // Elements per Y row of frames (U/V: half)
+} FLASHCAM_STACK_VIEW_T;
+
 // Function pointer for callback:
 //  - unsigned char *frame  : pointer to frame containing frame data
 //  - int width             : width of image
 //  - int height            : height of image
 typedef void (*FLASHCAM_CALLBACK_T) (unsigned char *, int, int);
+// Function pointer for zero-copy callback:
+//  - FLASHCAM_FRAME_VIEW_T *frame : view on the frame. Pass to `FlashCam::releaseFrame()` when done.
+typedef void (*FLASHCAM_CALLBACK_VIEW_T) (FLASHCAM_FRAME_VIEW_T *);
+// Function pointer for batch callback:
+//  - const FLASHCAM_BATCH_VIEW_T *batch : consecutive frames, valid until the callback returns.
+typedef void (*FLASHCAM_CALLBACK_BATCH_T) (const FLASHCAM_BATCH_VIEW_T *);
+// Function pointer for pair callback:
+//  - const FLASHCAM_PAIR_VIEW_T *pair : lit and unlit frame, valid until the callback returns.
+typedef void (*FLASHCAM_CALLBACK_PAIR_T) (const FLASHCAM_PAIR_VIEW_T *);
+// Function pointer for stack callback:
+//  - const FLASHCAM_STACK_VIEW_T *stack : stacked frames, valid until the callback returns.
+typedef void (*FLASHCAM_CALLBACK_STACK_T) (const FLASHCAM_STACK_VIEW_T *);
 #ifdef BUILD_FLASHCAM_WITH_OPENGL
 typedef void (*FLASHCAM_CALLBACK_OPENGL_T) (GLuint texid, int w, int h, uint64_t pts, bool pll_state);
 #endif
@@ -133,6 +511,33 @@ typedef struct {
     unsigned int opengl_enabled;                // Framecaptures are stored and provided in the callback via OpenGL textures instead of plain memory buffers.
                                                 // Note: Captured frame data stays in GPU domain during texture creation.
                                                 // Note: Only works in video mode.
+    FLASHCAM_DELIVERY_T delivery;               // Frame delivery to user. See: FLASHCAM_DELIVERY_T;
+    unsigned int ring_size;                     // Number of slots in ring : > 1            (FLASHCAM_DELIVERY_RING, FLASHCAM_DELIVERY_SHARED)
+    unsigned int batch_size;                    // Frames per batch       : > 0             (FLASHCAM_DELIVERY_BATCH)
+    unsigned int pair_subtract;                 // Deliver lit - unlit    : On (1) or Off (0)  (FLASHCAM_DELIVERY_PAIR; Y plane, fused with the copy)
+    FLASHCAM_STACK_MODE_T stack_mode;           // Stacking. See: FLASHCAM_STACK_MODE_T;  (FLASHCAM_DELIVERY_STACK)
+    unsigned int stack_window;                  // Frames per stack       : 1 to FLASHCAM_STACK_MAX_WINDOW (FLASHCAM_DELIVERY_STACK)
+    unsigned int stack_interval;                // Frames between stacks  : > 0             (FLASHCAM_DELIVERY_STACK)
+    unsigned int stack_chroma;                  // Stack U and V as well  : On (1) or Off (0)  (FLASHCAM_DELIVERY_STACK)
+    const char *shared;                         // Name of POSIX shared-memory segment of ring  (FLASHCAM_DELIVERY_SHARED)
+    unsigned int dispatch_threads;              // Number of workers      : > 0             (FLASHCAM_DELIVERY_DISPATCH)
+    unsigned int dispatch_queue;                // Length of work queue   : > 0             (FLASHCAM_DELIVERY_DISPATCH)
+    FLASHCAM_DISPATCH_POLICY_T dispatch_policy; // Backpressure policy. See: FLASHCAM_DISPATCH_POLICY_T;
+    unsigned int trace;                         // Latency tracing    : On (1) or Off (0)
+    unsigned int pitch;                         // Row pitch of frames: 0 (packed) or >= width (bytes per Y row; U/V rows: pitch / 2)
+    unsigned int buffer_num;                    // Video buffers      : 0 (auto) or > 0     (auto: tuned to the time buffers are held vs. frame period)
+    unsigned int buffer_memory;                 // Buffer memory limit: 0 (none) or bytes   (limits the number of buffers, up to FLASHCAM_BUFFERS_MAX)
+    FLASHCAM_EXTRACT_T extract;                 // Planes and regions copied into frames. See: FLASHCAM_EXTRACT_T;
+    unsigned int armed;                         // Arm both ports : 0 (port of mode only) or 1   (video & capture port enabled: fast mode switching, not with OpenGL)
+    const char *record;                         // Record camera buffers: NULL (off) or path of file   (not with OpenGL)
+    const char *replay;                         // Replay recording     : NULL (off) or path of file   (video mode, instead of camera)
+    FLASHCAM_REPLAY_MODE_T replay_mode;         // Replay timing. See: FLASHCAM_REPLAY_MODE_T;
+    const char *metrics;                        // Publish metrics  : NULL (off) or name of POSIX shared-memory segment (e.g. "/flashcam0")
+    const char *recorder;                       // Record frames    : NULL (off) or path of file     (not with OpenGL)
+    unsigned int recorder_memory;               // Memory of recorder queue in bytes (at least 2 frames)
+    unsigned int clock_interval;                // Sampling interval of GPU clock against CLOCK_MONOTONIC in ms (0: off)
+    unsigned int memory;                        // Frame memory       : mask of FLASHCAM_MEMORY_*      (framebuffer, ring & dispatch frames)
+    FLASHCAM_SCHED_PARAMS_T sched[FLASHCAM_THREADS]; // Scheduling of threads. See: FLASHCAM_THREAD_T;
 #ifdef BUILD_FLASHCAM_WITH_PLL  
     // PLL: Phase Lock Loop ==> Allows the camera (in videomode) to send lightpulse/flash upon frameexposure.
     //                          The Raspberry firmware only support flash when in capture mode, hence this option.
@@ -149,6 +554,526 @@ typedef struct {
 } FLASHCAM_SETTINGS_T;
 
 
+/*
+ * FLASHCAM_MEMORY_REGION_T
+ * Region of frame memory: anonymous mapping, aligned to pages (and thus cache lines), touched once when mapped.
+ */
+#define FLASHCAM_MEMORY_ALIGN       64
+#define FLASHCAM_MEMORY_HUGEPAGE    (2 * 1024 * 1024)
+
+typedef struct {
+    unsigned char           *data;              // Start of region (NULL: not mapped)
+    size_t                   size;              // Mapped bytes
+    size_t                   used;              // Bytes requested by the last user
+    unsigned int             flags;             // FLASHCAM_MEMORY_* the region was mapped with
+    bool                     locked;            // Page-locked?
+    bool                     hugepages;         // Backed by explicit hugepages?
+} FLASHCAM_MEMORY_REGION_T;
+
+/*
+ * FLASHCAM_MEMORY_STATS_T
+ * Allocations of frame memory. Page faults are counted for the whole process (getrusage); in steady state these
+ *  should not increase while streaming, nor should `allocations` across resets that do not grow the frames.
+ */
+typedef struct {
+    uint64_t allocations;                       // Regions mapped
+    uint64_t reuses;                            // Requests served by an already mapped region
+    uint64_t mapped;                            // Bytes mapped
+    uint64_t locked;                            // Bytes page-locked
+    uint64_t hugepages;                         // Bytes backed by explicit hugepages
+    uint64_t prefaults;                         // Page faults taken while touching new regions
+    uint64_t faults_minor;                      // Minor page faults of the process
+    uint64_t faults_major;                      // Major page faults of the process
+} FLASHCAM_MEMORY_STATS_T;
+
+/*
+ * FLASHCAM_MEMORY_T
+ * Pool of frame memory of an instance. Regions outlive the components (resetCamera) and are replaced only when a
+ *  larger region, or other flags, are requested.
+ */
+typedef struct {
+    FLASHCAM_MEMORY_REGION_T frame;             // Internal framebuffer
+    FLASHCAM_MEMORY_REGION_T ring;              // Slots of ring     (FLASHCAM_DELIVERY_RING)
+    FLASHCAM_MEMORY_REGION_T dispatch;          // Frames of dispatch (FLASHCAM_DELIVERY_DISPATCH)
+    FLASHCAM_MEMORY_REGION_T batch;             // Frames of batches  (FLASHCAM_DELIVERY_BATCH)
+    FLASHCAM_MEMORY_REGION_T pair;              // Frames of pairs    (FLASHCAM_DELIVERY_PAIR)
+    FLASHCAM_MEMORY_REGION_T stack;             // Accumulator & frames of stack (FLASHCAM_DELIVERY_STACK)
+    FLASHCAM_MEMORY_STATS_T  stats;             // Counters, see FLASHCAM_MEMORY_STATS_T
+} FLASHCAM_MEMORY_T;
+
+/*
+ * FLASHCAM_FRAME_T
+ * Preallocated frame, used by the ring and dispatch deliveries.
+ */
+typedef struct {
+    unsigned char           *data;              // Frame data (I420)
+    uint64_t                 pts;               // Presentation timestamp of frame
+    bool                     pll_state;         // PLL active in frame?
+    uint64_t                 seq;               // Sequence number of frame
+    FLASHCAM_TRACE_STAMPS_T  stamps;            // Latency trace of frame
+} FLASHCAM_FRAME_T;
+
+/*
+ * FLASHCAM_RING_T
+ * Ring of preallocated frames (FLASHCAM_DELIVERY_RING). Single producer (camera callback),
+ * single consumer (ring worker thread). Slots are handed over via `head` and `tail` only.
+ */
+typedef struct {
+    unsigned int               size;            // Number of slots
+    unsigned int               framesize;       // Size of a slot
+    FLASHCAM_FRAME_T          *slots;           // Slots; memory for all frames is allocated at once in `slots[0].data`
+    std::atomic<unsigned int>  head;            // Number of published frames (written by producer)
+    std::atomic<unsigned int>  tail;            // Number of consumed frames  (written by consumer)
+    bool                       filling;         // Producer is stitching a frame in slot `head`
+    uint64_t                   seq;             // Sequence number of next frame
+    VCOS_SEMAPHORE_T           sem;             // Signals the consumer that a frame is published
+    VCOS_THREAD_T              thread;          // Consumer thread
+    bool                       active;          // Consumer thread running?
+    std::atomic<bool>          stop;            // Consumer action: terminate
+    FLASHCAM_CALLBACK_T        callback;        // Callback to user function
+    unsigned int               width;           // Width of frames
+    unsigned int               height;          // Height of frames
+    FLASHCAM_COUNTERS_T       *stats;           // Statistics: `overruns` updated by producer, `frames` by consumer
+    FLASHCAM_TRACE_T          *trace;           // Latency tracer, updated by consumer
+    FLASHCAM_SCHED_T          *sched;           // Scheduling & wake-up jitter of consumer (FLASHCAM_THREAD_WORKER)
+} FLASHCAM_RING_T;
+
+
+/*
+ * FLASHCAM_DISPATCH_T
+ * Bounded work queue served by a pool of worker threads (FLASHCAM_DELIVERY_DISPATCH).
+ * Frames cycle between `free`, the producer (camera callback), `queue` and the workers. With
+ * `threads + queue + 1` frames, the producer always finds a free frame at the start of a new one.
+ */
+#define FLASHCAM_DISPATCH_MAX_THREADS 16
+
+typedef struct {
+    unsigned int               threads;         // Number of worker threads
+    unsigned int               capacity;        // Maximum length of `queue`
+    unsigned int               framesize;       // Size of a frame
+    FLASHCAM_DISPATCH_POLICY_T policy;          // Backpressure policy
+    unsigned int               num;             // Number of frames (threads + capacity + 1)
+    FLASHCAM_FRAME_T          *frames;          // Frames; memory for all frames is allocated at once in `frames[0].data`
+    unsigned int              *free;            // Stack of free frames (indices)
+    unsigned int               free_num;        // Number of frames on `free`
+    unsigned int              *queue;           // FIFO of queued frames (indices)
+    unsigned int               queue_head;      // Index of oldest queued frame in `queue`
+    unsigned int               queue_num;       // Number of queued frames
+    int                        filling;         // Frame being stitched by the producer (-1: none)
+    uint64_t                   seq;             // Sequence number of next frame
+    VCOS_MUTEX_T               lock;            // Protects frames/free/queue and dispatch stats
+    VCOS_SEMAPHORE_T           sem_items;       // One post per queued frame (and per worker on stop)
+    VCOS_SEMAPHORE_T           sem_space;       // Posted when a worker takes a frame (FLASHCAM_DISPATCH_BLOCK)
+    VCOS_THREAD_T              thread[FLASHCAM_DISPATCH_MAX_THREADS];
+    bool                       active;          // Workers running?
+    bool                       stop;            // Worker action: terminate (protected by `lock`)
+    FLASHCAM_CALLBACK_T        callback;        // Callback to user function
+    unsigned int               width;           // Width of frames
+    unsigned int               height;          // Height of frames
+    FLASHCAM_COUNTERS_T       *stats;           // Statistics: frames and dispatch counters (written under `lock`)
+    FLASHCAM_TRACE_T          *trace;           // Latency tracer, updated by workers
+    FLASHCAM_SCHED_T          *sched;           // Scheduling & wake-up jitter of workers (FLASHCAM_THREAD_WORKER)
+} FLASHCAM_DISPATCH_T;
+
+
+/*
+ * FLASHCAM_BATCH_T
+ * Batches of consecutive frames (FLASHCAM_DELIVERY_BATCH). The producer (camera callback) stitches frames into batch `head`
+ *  and hands it to the consumer thread once it holds `size` frames: one wake-up and one callback per batch.
+ *  Batches are handed over via `head` and `tail` only. When all batches are taken, new frames are dropped (overruns).
+ */
+#define FLASHCAM_BATCH_NUM 3
+
+typedef struct {
+    unsigned int               size;            // Frames per batch
+    unsigned int               framesize;       // Bytes between frames
+    FLASHCAM_BATCH_VIEW_T      batches[FLASHCAM_BATCH_NUM];
+    FLASHCAM_BATCH_FRAME_T    *frames;          // Metadata of the frames of all batches
+    FLASHCAM_TRACE_STAMPS_T   *stamps;          // Latency trace of the frames of all batches
+    std::atomic<unsigned int>  head;            // Number of published batches (written by producer)
+    std::atomic<unsigned int>  tail;            // Number of delivered batches (written by consumer)
+    bool                       open;            // Producer holds batch `head`
+    bool                       filling;         // Producer is stitching a frame into batch `head`
+    uint64_t                   seq;             // Sequence number of next frame
+    VCOS_SEMAPHORE_T           sem;             // Signals the consumer that a batch is published
+    VCOS_THREAD_T              thread;          // Consumer thread
+    bool                       active;          // Consumer thread running?
+    std::atomic<bool>          stop;            // Consumer action: terminate
+    FLASHCAM_CALLBACK_BATCH_T  callback;        // Batch callback to user function
+    FLASHCAM_COUNTERS_T       *stats;           // Statistics: `overruns` updated by producer, `frames` by consumer
+    FLASHCAM_TRACE_T          *trace;           // Latency tracer, updated by consumer
+    FLASHCAM_SCHED_T          *sched;           // Scheduling & wake-up jitter of consumer (FLASHCAM_THREAD_WORKER)
+} FLASHCAM_BATCH_T;
+
+/*
+ * FLASHCAM_PAIR_T
+ * Pairing of lit and unlit frames (FLASHCAM_DELIVERY_PAIR). The producer (camera callback) keeps the last unlit frame and
+ *  pairs each lit frame with it when it is adjacent, otherwise with the nearer of it and the next unlit frame. Unlit frames
+ *  which cannot be the partner of a lit frame (pll_divider > 2) are not copied at all. The partner of a frame is chosen when
+ *  its first band arrives: with `subtract`, the band is subtracted from (or by) the partner in its slot while being stitched,
+ *  so only the stored frame of a pair is ever copied. Frames live in `slots`, which are claimed by the producer and
+ *  returned by the consumer (`free`). Pairs are handed over via `head` and `tail` only.
+ */
+#define FLASHCAM_PAIR_NUM      2
+#define FLASHCAM_PAIR_SLOTS    (2 * FLASHCAM_PAIR_NUM + 3)  // pairs + frame in progress, last unlit and pending lit frame
+#define FLASHCAM_PAIR_DISTANCE 2                            // Maximum distance (frames) between lit and unlit frame
+
+typedef struct {
+    unsigned int               framesize;       // Bytes between slots
+    unsigned char             *data;            // FLASHCAM_PAIR_SLOTS frames
+    FLASHCAM_BATCH_FRAME_T     frames[FLASHCAM_PAIR_SLOTS + 1];   // Metadata of frames in slots, and of the frame in progress
+    FLASHCAM_TRACE_STAMPS_T    stamps[FLASHCAM_PAIR_SLOTS + 1];   // Latency trace of frames in slots, and of the frame in progress
+    std::atomic<unsigned int>  free;            // Mask of free slots (claimed by producer, returned by consumer)
+    FLASHCAM_PAIR_VIEW_T       pairs[FLASHCAM_PAIR_NUM];
+    int                        slots[FLASHCAM_PAIR_NUM][2];   // Slots held by pairs (-1: none)
+    FLASHCAM_TRACE_STAMPS_T    queued[FLASHCAM_PAIR_NUM][2];  // Latency trace of lit and unlit frame of pairs
+    std::atomic<unsigned int>  head;            // Number of published pairs (written by producer)
+    std::atomic<unsigned int>  tail;            // Number of delivered pairs (written by consumer)
+    int                        filling;         // Slot the frame in progress is stitched into (-1: none)
+    int                        partner;         // Slot of the partner of the frame in progress (-1: frame is kept)
+    bool                       filling_lit;     // Frame in progress is lit?
+    bool                       skipping;        // Frame in progress is skipped (not copied)
+    unsigned int               dropped;         // Frames dropped while pairing, reported by the next `publish`
+    int                        unlit;           // Slot of last unlit frame (-1: none)
+    int                        lit;             // Slot of lit frame waiting for the next unlit frame (-1: none)
+    bool                       subtract;        // Deliver the difference of pairs (setting `pair_subtract`)
+    const FLASHCAM_EXTRACT_T  *extract;         // Layout of frames
+    uint64_t                   lit_pts;         // Timestamp of last lit frame (0: none yet)
+    uint64_t                   seq;             // Sequence number of next frame
+    unsigned int               period;          // Frame period (us)
+    unsigned int               divider;         // Frames per pulse of PLL (pll_divider)
+    VCOS_SEMAPHORE_T           sem;             // Signals the consumer that a pair is published
+    VCOS_THREAD_T              thread;          // Consumer thread
+    bool                       active;          // Consumer thread running?
+    std::atomic<bool>          stop;            // Consumer action: terminate
+    FLASHCAM_CALLBACK_PAIR_T   callback;        // Pair callback to user function
+    FLASHCAM_COUNTERS_T       *stats;           // Statistics: `overruns`, `skipped` & `unpaired` updated by producer, `frames` by consumer
+    FLASHCAM_TRACE_T          *trace;           // Latency tracer, updated by consumer
+    FLASHCAM_SCHED_T          *sched;           // Scheduling & wake-up jitter of consumer (FLASHCAM_THREAD_WORKER)
+} FLASHCAM_PAIR_T;
+
+/*
+ * FLASHCAM_STACK_T
+ * Stacking of frames (FLASHCAM_DELIVERY_STACK). The producer (camera callback) stitches frames into `slots`, the consumer
+ *  thread adds them to the accumulator and calls the stack callback every `interval` frames (by sequence number, so drops
+ *  do not shift the stacks). A running sum over a window longer than the interval keeps the frames of the window in their
+ *  slots until they leave it (subtracted from the sum); otherwise the accumulator restarts at the window of the next stack
+ *  and frames outside of any window are not copied at all. Slots are handed over via `head` and `tail` only.
+ */
+#define FLASHCAM_STACK_MAX_WINDOW 256           // 256 x 255 fits 16 bits, weight 1/256 of the average fits 8.7 fixed point
+#define FLASHCAM_STACK_SLOTS      4             // Slots for frames waiting for the consumer
+
+typedef struct {
+    unsigned int               framesize;       // Bytes between slots
+    unsigned int               num;             // Number of slots: FLASHCAM_STACK_SLOTS (+ window of a running sum)
+    unsigned char             *data;            // Slots
+    uint16_t                  *acc;             // Accumulator: `framesize` elements
+    FLASHCAM_BATCH_FRAME_T    *frames;          // Metadata of frames in slots
+    FLASHCAM_TRACE_STAMPS_T   *stamps;          // Latency trace of frames in slots
+    unsigned int               ranges[3 * FLASHCAM_EXTRACT_MAX_ROIS][2];  // Stacked bytes of a frame: offset & length
+    unsigned int               num_ranges;      // Number of `ranges`
+    FLASHCAM_STACK_MODE_T      mode;            // Sum or moving average
+    unsigned int               window;          // Frames per stack
+    unsigned int               interval;        // Frames between stacks
+    unsigned int               shift;           // Weight of moving average: 1 / 2^shift
+    bool                       sliding;         // Running sum: frames are held until they leave the window
+    std::atomic<unsigned int>  head;            // Number of published frames (written by producer)
+    std::atomic<unsigned int>  tail;            // Number of released frames  (written by consumer)
+    bool                       filling;         // Producer is stitching a frame into slot `head`
+    bool                       skipping;        // Frame in progress is skipped (not copied)
+    uint64_t                   seq;             // Sequence number of next frame
+    VCOS_SEMAPHORE_T           sem;             // Signals the consumer that a frame is published
+    VCOS_THREAD_T              thread;          // Consumer thread
+    bool                       active;          // Consumer thread running?
+    std::atomic<bool>          stop;            // Consumer action: terminate
+    FLASHCAM_CALLBACK_STACK_T  callback;        // Stack callback to user function
+    FLASHCAM_STACK_VIEW_T      view;            // Stack handed to the callback
+    FLASHCAM_COUNTERS_T       *stats;           // Statistics: `overruns` & `skipped` updated by producer, `frames` by consumer
+    FLASHCAM_TRACE_T          *trace;           // Latency tracer, updated by consumer
+    FLASHCAM_SCHED_T          *sched;           // Scheduling & wake-up jitter of consumer (FLASHCAM_THREAD_WORKER)
+} FLASHCAM_STACK_T;
+
+
+/*
+ * FLASHCAM_BUFFERS_T
+ * Camera buffers of a port. The pool holds `max` headers, but only `circulating` of them have a payload
+ *  and cycle between port, FlashCam and user. The others are kept as spares without memory. When tuning, the number of
+ *  circulating buffers follows the longest time a buffer is held (hold) relative to the frame period: 
+ *  buffers = hold / period + 2 (one being filled by the camera, one spare for jitter).
+ */
+typedef struct {
+    MMAL_POOL_T               *pool;            // Pool of headers
+    MMAL_PORT_T               *port;            // Port of pool (payload allocator)
+    MMAL_QUEUE_T              *spares;          // Headers without payload
+    FLASHCAM_FRAME_VIEW_T     *views;           // View per header (FLASHCAM_DELIVERY_ZEROCOPY)
+    unsigned int               size;            // Payload size
+    unsigned int               min;             // Minimum number of circulating buffers
+    unsigned int               max;             // Number of headers
+    bool                       tune;            // Tune the number of circulating buffers?
+    std::atomic<unsigned int>  circulating;     // Buffers with payload
+    std::atomic<unsigned int>  target;          // Buffers that should circulate
+    std::atomic<uint64_t>      hold_peak;       // Longest hold of a buffer in current window (us)
+    uint64_t                   window_start;    // Start of current window (us)
+    float                      period;          // Frame period (us)
+    unsigned int               low;             // Consecutive windows with a lower demand
+} FLASHCAM_BUFFERS_T;
+
+
+/*
+ * FLASHCAM_REPLAY_HEADER_T / FLASHCAM_REPLAY_RECORD_T
+ * Recording of camera buffers: a header, followed by a record per buffer with `length` bytes of data.
+ *  A frame spans the buffers up to MMAL_BUFFER_HEADER_FLAG_FRAME_END, each buffer holds a band of rows (slice).
+ */
+#define FLASHCAM_REPLAY_MAGIC   "FCREPLAY"
+#define FLASHCAM_REPLAY_VERSION 1
+
+typedef struct {
+    char     magic[8];                          // FLASHCAM_REPLAY_MAGIC
+    uint32_t version;                           // FLASHCAM_REPLAY_VERSION
+    uint32_t width;                             // Image width
+    uint32_t height;                            // Image height
+    uint32_t stride;                            // Bytes per Y row of buffers
+    uint32_t slice_height;                      // Y rows per plane of buffers
+    uint32_t buffer_size;                       // Size of camera buffers
+    float    framerate;                         // Framerate during recording
+} FLASHCAM_REPLAY_HEADER_T;
+
+typedef struct {
+    uint64_t pts;                               // buffer->pts
+    uint32_t flags;                             // buffer->flags
+    uint32_t length;                            // buffer->length
+} FLASHCAM_REPLAY_RECORD_T;
+
+/*
+ * FLASHCAM_REPLAY_T
+ * Recorder and replayer of camera buffers. The recorder is written by the camera callback. The replayer feeds buffers of
+ *  its own pool into `buffer_callback` through `port`, which is never enabled: released buffers return to the pool.
+ */
+typedef struct {
+    FILE                      *record;          // Recording (NULL: not recording)
+    FILE                      *replay;          // Replay    (NULL: not replaying)
+    FLASHCAM_REPLAY_MODE_T     mode;            // Replay timing
+    FLASHCAM_REPLAY_HEADER_T   header;          // Header of replay
+    MMAL_POOL_T               *pool;            // Replay buffers
+    MMAL_PORT_T                port;            // Port passed to callback
+    MMAL_PORT_BH_CB_T          callback;        // Camera callback
+    VCOS_THREAD_T              thread;          // Replay thread
+    bool                       active;          // Replay thread running?
+    std::atomic<bool>          stop;            // Replay thread action: terminate
+} FLASHCAM_REPLAY_T;
+
+
+/*
+ * FLASHCAM_BURST_T
+ * Burst of stills (FlashCam::captureBurst). Frames are stitched into framebuffers of the caller instead of being delivered.
+ */
+typedef struct {
+    std::atomic<unsigned char **> frames;       // Framebuffers of burst (NULL: no burst active); published last, cleared first
+    uint64_t                *pts;               // Timestamps of frames (MMAL_TIME_UNKNOWN: frame lost)
+    unsigned int             num;               // Number of frames
+    std::atomic<unsigned int> idx;              // Frame being captured, written by the callback after `pts[idx]` (frames beyond `num` are dropped)
+} FLASHCAM_BURST_T;
+
+
+/*
+ * FLASHCAM_METRICS_BLOCK_T
+ * Runtime counters (monotonic) and gauges (last value) of an instance, published in POSIX shared memory for external
+ *  monitors. Fields are lock-free atomics updated with relaxed ordering, a monitor reads them at any time without locks.
+ *  The layout only grows at the end: a reader checks `magic`, `version` and uses `size` to skip unknown fields.
+ *  Times in nanoseconds.
+ */
+#define FLASHCAM_METRICS_MAGIC   "FCMETRIC"
+#define FLASHCAM_METRICS_VERSION 1
+
+typedef struct {
+    char                     magic[8];          // FLASHCAM_METRICS_MAGIC (set last, once the block is valid)
+    uint32_t                 version;           // FLASHCAM_METRICS_VERSION
+    uint32_t                 size;              // sizeof(FLASHCAM_METRICS_BLOCK_T) of writer
+    uint32_t                 cameranum;         // Camera of instance
+    uint32_t                 pid;               // Process of instance
+    //counters
+    std::atomic<uint64_t>    buffers;           // Buffers received from the camera
+    std::atomic<uint64_t>    frames;            // Frames received from the camera (complete)
+    std::atomic<uint64_t>    bytes_copied;      // Bytes copied into frames
+    std::atomic<uint64_t>    copy_ns;           // Time spent copying
+    std::atomic<uint64_t>    callbacks;         // User callbacks called (camera callback & OpenGL worker)
+    std::atomic<uint64_t>    callback_ns;       // Time spent in user callbacks
+    //gauges
+    std::atomic<uint64_t>    pool_circulating;  // Camera buffers with payload
+    std::atomic<uint64_t>    pool_lent;         // Camera buffers held by the user (FLASHCAM_DELIVERY_ZEROCOPY)
+    std::atomic<uint64_t>    opengl_queue;      // Buffers queued for the OpenGL worker
+    std::atomic<int64_t>     pll_error_us;      // Last timing error between frame and PWM pulse (us)
+    std::atomic<uint64_t>    updated_ns;        // CLOCK_MONOTONIC of last update
+} FLASHCAM_METRICS_BLOCK_T;
+
+/*
+ * FLASHCAM_METRICS_T
+ * Metrics of an instance. `block` points to `local` until it is published, then to the shared-memory segment.
+ */
+typedef struct {
+    FLASHCAM_METRICS_BLOCK_T  local;            // Block when not published
+    FLASHCAM_METRICS_BLOCK_T *block;            // Block being updated
+    char                     name[64];          // Name of segment ("" : not published)
+} FLASHCAM_METRICS_T;
+
+
+/*
+ * FLASHCAM_SHARED_HEADER_T / FLASHCAM_SHARED_SLOT_T
+ * Ring of frames in POSIX shared memory (FLASHCAM_DELIVERY_SHARED): the header, `slots` slot descriptors and, from
+ *  `data_offset`, the frames (`slot_size` bytes apart, page aligned). Frame `seq` (1, 2, ..) is stored in slot `seq % slots`.
+ *  The camera callback never waits for readers: readers map the ring read-only and validate a frame via the sequence
+ *  of its slot (seqlock) before and after using it. The layout only grows at the end, see `version` & `header_size`.
+ */
+#define FLASHCAM_SHARED_MAGIC   "FCSHARED"
+#define FLASHCAM_SHARED_VERSION 2
+
+typedef struct {
+    std::atomic<uint64_t>    seq;               // 2 x seq: frame `seq` is valid; odd: being written; 0: empty
+    uint64_t                 pts;               // Sensor timestamp of frame
+    uint64_t                 time;              // CLOCK_MONOTONIC (us) of publication
+    uint32_t                 pll_state;         // PLL active in frame?
+    uint32_t                 host_error;        // Error bound of `host` (us)
+    uint64_t                 host;              // `pts` in CLOCK_MONOTONIC (us), 0 when the GPU clock is not estimated
+} FLASHCAM_SHARED_SLOT_T;
+
+typedef struct {
+    char                     magic[8];          // FLASHCAM_SHARED_MAGIC (cleared when the ring is removed)
+    uint32_t                 version;           // FLASHCAM_SHARED_VERSION
+    uint32_t                 header_size;       // sizeof(FLASHCAM_SHARED_HEADER_T) of writer
+    uint32_t                 slots;             // Number of slots
+    uint32_t                 slot_size;         // Distance between frames (bytes)
+    uint32_t                 frame_size;        // Size of a frame (bytes)
+    uint32_t                 data_offset;       // Offset of first frame from the header (bytes)
+    uint32_t                 width;             // Width of frame (first region)
+    uint32_t                 height;            // Height of frame (first region)
+    uint32_t                 pitch;             // Bytes per Y row of first region (U/V: half)
+    uint32_t                 planes;            // Planes in frame: mask of FLASHCAM_PLANE_*
+    std::atomic<uint64_t>    head;              // Sequence number of the latest published frame (0: none)
+    //followed by slot descriptors, from `header_size`
+} FLASHCAM_SHARED_HEADER_T;
+
+/*
+ * FLASHCAM_SHARED_T
+ * Writer of the shared-memory ring (camera callback).
+ */
+typedef struct {
+    FLASHCAM_SHARED_HEADER_T *header;           // Mapped segment (NULL: none)
+    size_t                    size;             // Size of segment
+    char                      name[64];         // Name of segment
+    uint64_t                  seq;              // Sequence number of next frame
+    bool                      filling;          // Frame `seq` is being stitched
+} FLASHCAM_SHARED_T;
+
+
+/*
+ * FLASHCAM_RECORDER_HEADER_T / FLASHCAM_RECORDER_RECORD_T / FLASHCAM_RECORDER_INDEX_T / FLASHCAM_RECORDER_FOOTER_T
+ * Recording of frames (append-only): a header of `header_size` bytes followed by one record of `record_size` bytes per frame.
+ *  A record starts with FLASHCAM_RECORDER_RECORD_T, the frame (`frame_size` bytes, layout as delivered to the callback) 
+ *  follows at `data_offset`. Sizes are multiples of FLASHCAM_RECORDER_ALIGN, so records are written with O_DIRECT.
+ *  A closed recording ends with an index of its records, located by the footer in the last bytes of the file. A recording
+ *  which was not closed has no footer: its index follows from the records.
+ */
+#define FLASHCAM_RECORDER_MAGIC         "FCRECORD"
+#define FLASHCAM_RECORDER_INDEX_MAGIC   "FCRINDEX"
+#define FLASHCAM_RECORDER_VERSION       1
+#define FLASHCAM_RECORDER_ALIGN         4096
+
+typedef struct {
+    char     magic[8];                          // FLASHCAM_RECORDER_MAGIC
+    uint32_t version;                           // FLASHCAM_RECORDER_VERSION
+    uint32_t header_size;                       // Offset of first record
+    uint32_t record_size;                       // Size of a record
+    uint32_t data_offset;                       // Offset of frame in record
+    uint32_t frame_size;                        // Size of frame
+    uint32_t width;                             // Width of frame (first region)
+    uint32_t height;                            // Height of frame (first region)
+    uint32_t pitch;                             // Bytes per Y row of first region (U/V: half)
+    uint32_t planes;                            // Planes in frame: mask of FLASHCAM_PLANE_*
+    float    framerate;                         // Framerate during recording
+} FLASHCAM_RECORDER_HEADER_T;
+
+typedef struct {
+    uint64_t seq;                               // Sequence number of frame (frames received from the camera; gaps: frames not recorded)
+    uint64_t pts;                               // Sensor timestamp of frame
+    uint32_t pll_state;                         // PLL active in frame?
+    uint32_t host_error;                        // Error bound of `host` (us)
+    uint64_t host;                              // `pts` in CLOCK_MONOTONIC (us), 0 when the GPU clock was not estimated
+} FLASHCAM_RECORDER_RECORD_T;
+
+typedef struct {
+    uint64_t seq;                               // Sequence number of frame
+    uint64_t pts;                               // Sensor timestamp of frame
+    uint64_t offset;                            // Offset of record in file
+} FLASHCAM_RECORDER_INDEX_T;
+
+typedef struct {
+    uint64_t entries;                           // Number of index entries (records)
+    uint64_t offset;                            // Offset of index in file
+    char     magic[8];                          // FLASHCAM_RECORDER_INDEX_MAGIC
+} FLASHCAM_RECORDER_FOOTER_T;
+
+/*
+ * FLASHCAM_RECORDER_STATS_T
+ * Progress of the recorder. Frames are dropped from the recording when the queue is full (disk behind).
+ */
+typedef struct {
+    uint64_t recorded;                          // Frames written
+    uint64_t dropped;                           // Frames not recorded as the queue was full
+    uint64_t bytes;                             // Bytes written
+    unsigned int queued;                        // Frames waiting to be written
+    unsigned int queued_max;                    // Maximum number of frames waiting
+    unsigned int slots;                         // Size of queue (frames)
+    uint64_t write_us_max;                      // Longest write to disk (us)
+    bool     direct;                            // Written with O_DIRECT?
+} FLASHCAM_RECORDER_STATS_T;
+
+/*
+ * FLASHCAM_RECORDER_T
+ * Asynchronous recorder: the camera callback copies frames into aligned slots, a writer thread appends them to the file.
+ *  Single producer (camera callback), single consumer (writer), slots are handed over via `head` and `tail` only.
+ */
+typedef struct {
+    int                        fd;              // File of recording
+    FLASHCAM_RECORDER_HEADER_T header;          // Layout of recording
+    unsigned int               size;            // Number of slots
+    unsigned char             *slots;           // Slots (records), allocated at once
+    std::atomic<unsigned int>  head;            // Number of published records (written by producer)
+    std::atomic<unsigned int>  tail;            // Number of written records   (written by writer)
+    bool                       filling;         // Producer is copying a frame into slot `head`
+    uint64_t                   offset;          // File offset of next record
+    VCOS_SEMAPHORE_T           sem;             // Signals the writer that a record is published
+    VCOS_THREAD_T              thread;          // Writer thread
+    bool                       active;          // Writer thread running?
+    std::atomic<bool>          stop;            // Writer action: terminate
+    std::atomic<uint64_t>      recorded;        // Statistics, see FLASHCAM_RECORDER_STATS_T
+    std::atomic<uint64_t>      dropped;
+    std::atomic<unsigned int>  queued_max;
+    std::atomic<uint64_t>      write_us_max;
+    std::atomic<bool>          direct;          // Writing with O_DIRECT? (cleared when the file system does not support it)
+    bool                       failed;          // Write failed: remaining frames are not recorded (writer only)
+    FLASHCAM_RECORDER_INDEX_T *index;           // Index of written records (writer only, kept across recordings)
+    size_t                     index_num;       // Entries in `index`
+    size_t                     index_max;       // Capacity of `index`
+    bool                       index_lost;      // Index could not grow: no footer is written
+} FLASHCAM_RECORDER_T;
+
+/*
+ * FLASHCAM_RECORDING_T
+ * Recording mapped read-only for random access. Frames are used in place, without copying.
+ */
+typedef struct {
+    const unsigned char              *map;      // Mapped file (NULL: not open)
+    size_t                            size;     // Size of mapping
+    const FLASHCAM_RECORDER_HEADER_T *header;   // Header of recording
+    const FLASHCAM_RECORDER_INDEX_T  *index;    // Index: footer of file, or `rebuilt`
+    FLASHCAM_RECORDER_INDEX_T        *rebuilt;  // Index rebuilt from the records (recording was not closed, or its index is corrupt)
+    uint64_t                          frames;   // Number of frames (index entries)
+} FLASHCAM_RECORDING_T;
+
+
+//internal state of a FlashCam instance (defined below)
+struct FLASHCAM_INTERNAL_STATE_S;
+
 /*
  * FLASHCAM_PORT_USERDATA_T
  * used internally for communication and status-updates with the camera
@@ -156,14 +1081,45 @@ typedef struct {
 typedef struct {
     FLASHCAM_PARAMS_T       *params;            // Pointer to param set
     FLASHCAM_SETTINGS_T     *settings;          // Pointer to setting set
-    MMAL_POOL_T             *camera_pool;       // Pool of buffers for camera
+    FLASHCAM_BUFFERS_T      *buffers;           // Buffers of video port
+    FLASHCAM_BUFFERS_T      *capture_buffers;   // Buffers of capture port
     unsigned char           *framebuffer;       // Buffer for final image   
     unsigned int             framebuffer_size;  // Size of buffer
-    unsigned int             framebuffer_idx;   // Tracker to stitch imager properly from the camera-callback payloads
+    std::atomic<unsigned int> framebuffer_idx;  // Tracker to stitch imager properly from the camera-callback payloads (next Y row, 0: no frame in progress)
+    unsigned int             framebuffer_pitch; // Bytes per Y row of `framebuffer` (U/V: half)
+    FLASHCAM_EXTRACT_T       extract;           // Regions copied into `framebuffer` (full image: single region)
+    unsigned int             stride;            // Bytes per Y row of MMAL buffers (committed port format; U/V: half)
+    unsigned int             slice_height;      // Y rows per plane of MMAL buffers (committed port format; U/V: half)
     VCOS_SEMAPHORE_T         sem_capture;       // Semaphore indicating the completion of a frame capture 
     //      - In Capturemode: used to indicate completion of frame
     //      - In VideoMode + EGL: used to signal EGL-worker to process frame
+    VCOS_SEMAPHORE_T         sem_drain;         // Semaphore indicating the end of a frame while `draining`
+    std::atomic<bool>        draining;          // Caller waits for the frame in progress (FlashCam::drainFrame)
     FLASHCAM_CALLBACK_T      callback;          // Callback to user function
+    FLASHCAM_CALLBACK_VIEW_T callback_view;     // Zero-copy callback to user function
+    FLASHCAM_CALLBACK_BATCH_T callback_batch;   // Batch callback to user function
+    FLASHCAM_CALLBACK_PAIR_T callback_pair;     // Pair callback to user function
+    FLASHCAM_CALLBACK_STACK_T callback_stack;   // Stack callback to user function
+    FLASHCAM_COUNTERS_T      stats;             // Delivery counters
+    FLASHCAM_RING_T         *ring;              // Ring of frames (FLASHCAM_DELIVERY_RING)
+    FLASHCAM_DISPATCH_T     *dispatch;          // Dispatch pool (FLASHCAM_DELIVERY_DISPATCH)
+    FLASHCAM_BATCH_T        *batch;             // Batches of frames (FLASHCAM_DELIVERY_BATCH)
+    FLASHCAM_PAIR_T         *pair;              // Pairs of lit and unlit frames (FLASHCAM_DELIVERY_PAIR)
+    FLASHCAM_STACK_T        *stack;             // Stacking of frames (FLASHCAM_DELIVERY_STACK)
+    FLASHCAM_SHARED_T       *shared;            // Shared-memory ring (FLASHCAM_DELIVERY_SHARED)
+    FLASHCAM_RECORDER_T     *recorder;          // Recorder of frames (NULL: off)
+    FLASHCAM_CLOCK_T        *clock;             // Estimator of the GPU clock
+    FLASHCAM_SCHED_T        *sched;             // Scheduling & wake-up jitter of threads
+    FLASHCAM_TRACE_T         trace;             // Latency tracer
+    FLASHCAM_TRACE_STAMPS_T  stamps;            // Latency trace of frame being stitched
+    FLASHCAM_STREAM_T        stream;            // Stream counters
+    FLASHCAM_REPLAY_T       *replay;            // Recorder / replayer of buffers
+    FLASHCAM_BURST_T         burst;             // Burst of stills being captured
+    FLASHCAM_METRICS_T      *metrics;           // Runtime metrics
+    struct FLASHCAM_INTERNAL_STATE_S *state;    // Internal state of the owning instance (PLL / OpenGL)
+    std::atomic<unsigned int> callbacks_entered; // Buffer callbacks started  (fence for stopping)
+    std::atomic<unsigned int> callbacks_exited;  // Buffer callbacks returned (fence for stopping)
+    std::atomic<unsigned int> views_lent;        // Zero-copy frames not yet released by user
 #ifdef BUILD_FLASHCAM_WITH_OPENGL  
     MMAL_QUEUE_T            *opengl_queue;      // Pointer to OpenGL Queue
     FLASHCAM_CALLBACK_OPENGL_T  callback_egl;      // OpenGL Callback to user function
@@ -195,6 +1151,7 @@ typedef struct {
 #ifdef BUILD_FLASHCAM_WITH_PLL  
     bool                  pll_state;            // PLL active in frame?
 #endif
+    FLASHCAM_TRACE_STAMPS_T stamps;             // Latency trace of frame
 } FLASHCAM_OPENGL_BUF_T;
 #endif
 
@@ -211,7 +1168,7 @@ typedef struct {
  * FLASHCAM_INTERNAL_STATE_T
  * PLL results and test data. Only user for intern-tracking
  */
-typedef struct { 
+typedef struct FLASHCAM_INTERNAL_STATE_S { 
     //values managed by FlashCam.cpp
     MMAL_PORT_T                 *port;
     FLASHCAM_SETTINGS_T         *settings;
@@ -220,7 +1177,7 @@ typedef struct {
     
     //values managed by FlashCam_pll.cpp
 #ifdef BUILD_FLASHCAM_WITH_PLL  
-    bool pll_active;
+    std::atomic<bool> pll_active;               // PLL running; read by the buffer callback (seq_cst, paired with its fence counters)
     bool pll_initialised;
     
     //timing
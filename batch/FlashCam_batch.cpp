@@ -0,0 +1,264 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_batch.h"
+
+#include "FlashCam_trace.h"
+#include "FlashCam_sched.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace FlashCamBatch {
+    
+    //consumer thread: delivers published batches to the user
+    static void *worker(void *arg) {
+        FLASHCAM_BATCH_T *batch = (FLASHCAM_BATCH_T*) arg;
+        FLASHCAM_SCHED_WAKE_T last = {};
+        
+        FlashCamSched::enter(batch->sched, FLASHCAM_THREAD_WORKER, "batch");
+        
+        while (true) {
+            //wait for update
+            vcos_semaphore_wait(&(batch->sem));
+            
+            // deliver all published batches
+            unsigned int tail = batch->tail.load(std::memory_order_relaxed);
+            unsigned int head = batch->head.load(std::memory_order_acquire);
+            
+            for (; tail != head; tail++) {
+                unsigned int           idx    = tail % FLASHCAM_BATCH_NUM;
+                FLASHCAM_BATCH_VIEW_T *view   = &(batch->batches[idx]);
+                FLASHCAM_TRACE_STAMPS_T *stamps = &(batch->stamps[idx * batch->size]);
+                
+                FlashCamSched::wake(batch->sched, FLASHCAM_THREAD_WORKER, &last, view->frames[0].pts);
+                
+                uint64_t entry = FlashCamTrace::now(batch->trace);
+                if (batch->callback)
+                    batch->callback(view);
+                uint64_t exit  = FlashCamTrace::now(batch->trace);
+                for (unsigned int i=0; i<view->num; i++) {
+                    stamps[i].entry = entry;
+                    stamps[i].exit  = exit;
+                    FlashCamTrace::record(batch->trace, &stamps[i]);
+                }
+                batch->stats->frames.fetch_add(view->num, std::memory_order_relaxed);
+                
+                //batch can be reused by producer
+                batch->tail.store(tail + 1, std::memory_order_release);
+            }
+            
+            // Stop when requested and all batches are delivered.
+            if (batch->stop.load(std::memory_order_acquire) && (tail == batch->head.load(std::memory_order_acquire)))
+                break;
+        }
+        return NULL;
+    }
+    
+    // hand batch `head` to the consumer
+    static void handover(FLASHCAM_BATCH_T *batch) {
+        batch->open = false;
+        batch->head.store(batch->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        vcos_semaphore_post(&(batch->sem));
+    }
+    
+    int init(FLASHCAM_BATCH_T *batch, unsigned int size, unsigned int framesize, unsigned char *data) {
+        if (batch->active) {
+            fprintf(stderr, "%s: Cannot resize batches while they are in use.\n", __func__);
+            return -1;
+        }
+        
+        if (size < 1) {
+            fprintf(stderr, "%s: Batch requires at least 1 frame (%d).\n", __func__, size);
+            return -1;
+        }
+        
+        // Nothing changed?
+        if (batch->frames && (batch->size == size) && (batch->framesize == framesize) && (batch->batches[0].data == data))
+            return 0;
+        
+        destroy(batch);
+        
+        if (vcos_semaphore_create(&(batch->sem), "FlashCam_batch_sem", 0) != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to create semaphore", __func__);
+            return -1;
+        }
+        
+        batch->frames = new FLASHCAM_BATCH_FRAME_T[FLASHCAM_BATCH_NUM * size]();
+        batch->stamps = new FLASHCAM_TRACE_STAMPS_T[FLASHCAM_BATCH_NUM * size]();
+        for (unsigned int i=0; i<FLASHCAM_BATCH_NUM; i++) {
+            batch->batches[i]           = {};
+            batch->batches[i].data      = &data[((size_t) i) * size * framesize];
+            batch->batches[i].framesize = framesize;
+            batch->batches[i].frames    = &(batch->frames[i * size]);
+        }
+        
+        batch->size      = size;
+        batch->framesize = framesize;
+        batch->head      = 0;
+        batch->tail      = 0;
+        batch->open      = false;
+        batch->filling   = false;
+        batch->seq       = 0;
+        return 0;
+    }
+    
+    void destroy(FLASHCAM_BATCH_T *batch) {
+        stop(batch);
+        
+        if (batch->frames) {
+            delete[] batch->frames;
+            delete[] batch->stamps;
+            vcos_semaphore_delete(&(batch->sem));
+        }
+        batch->frames    = NULL;
+        batch->stamps    = NULL;
+        batch->size      = 0;
+        batch->framesize = 0;
+    }
+    
+    int start(FLASHCAM_BATCH_T *batch, FLASHCAM_CALLBACK_BATCH_T callback, unsigned int width, unsigned int height, unsigned int pitch,
+              FLASHCAM_COUNTERS_T *stats, FLASHCAM_TRACE_T *trace, FLASHCAM_SCHED_T *sched) {
+        VCOS_STATUS_T status;
+        
+        if (!batch->frames || batch->active)
+            return -1;
+        
+        //reset batches
+        while (vcos_semaphore_trywait(&(batch->sem)) != VCOS_EAGAIN);
+        for (unsigned int i=0; i<FLASHCAM_BATCH_NUM; i++) {
+            batch->batches[i].num    = 0;
+            batch->batches[i].width  = width;
+            batch->batches[i].height = height;
+            batch->batches[i].pitch  = pitch;
+        }
+        batch->head     = 0;
+        batch->tail     = 0;
+        batch->open     = false;
+        batch->filling  = false;
+        batch->stop     = false;
+        batch->callback = callback;
+        batch->stats    = stats;
+        batch->trace    = trace;
+        batch->sched    = sched;
+        
+        //start consumer thread
+        status = vcos_thread_create( &(batch->thread), "FlashCamBatch-worker", NULL, FlashCamBatch::worker, batch);
+        if (status != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to start `FlashCamBatch-worker` (%d)", VCOS_FUNCTION, status);
+            return -1;
+        }
+        
+        batch->active = true;
+        return 0;
+    }
+    
+    void stop(FLASHCAM_BATCH_T *batch) {
+        if (!batch->active)
+            return;
+        
+        //incomplete batch is delivered as well (producer has stopped)
+        cancel(batch);
+        if (batch->open && batch->batches[batch->head.load(std::memory_order_relaxed) % FLASHCAM_BATCH_NUM].num)
+            handover(batch);
+        batch->open = false;
+        
+        //notify worker we are done.
+        batch->stop.store(true, std::memory_order_release);
+        vcos_semaphore_post(&(batch->sem));
+        
+        //Wait for worker to deliver remaining batches and terminate.
+        vcos_thread_join(&(batch->thread), NULL);
+        batch->active = false;
+    }
+    
+    unsigned char* acquire(FLASHCAM_BATCH_T *batch) {
+        // frame in progress is replaced
+        batch->filling = false;
+        
+        unsigned int head = batch->head.load(std::memory_order_relaxed);
+        if (!batch->open) {
+            unsigned int tail = batch->tail.load(std::memory_order_acquire);
+            
+            // All batches taken? Consumer is too slow: drop frame.
+            if ((head - tail) >= FLASHCAM_BATCH_NUM) {
+                batch->stats->overruns.fetch_add(1, std::memory_order_relaxed);
+                batch->seq++;
+                return NULL;
+            }
+            batch->batches[head % FLASHCAM_BATCH_NUM].num = 0;
+            batch->open = true;
+        }
+        
+        batch->filling = true;
+        return current(batch);
+    }
+    
+    unsigned char* current(FLASHCAM_BATCH_T *batch) {
+        if (!batch->filling)
+            return NULL;
+        FLASHCAM_BATCH_VIEW_T *view = &(batch->batches[batch->head.load(std::memory_order_relaxed) % FLASHCAM_BATCH_NUM]);
+        return &(view->data[((size_t) view->num) * batch->framesize]);
+    }
+    
+    unsigned int publish(FLASHCAM_BATCH_T *batch, uint64_t pts, bool pll_state, uint64_t host, uint32_t host_error, const FLASHCAM_TRACE_STAMPS_T *stamps) {
+        if (!batch->filling)
+            return 1;
+        
+        unsigned int idx = batch->head.load(std::memory_order_relaxed) % FLASHCAM_BATCH_NUM;
+        FLASHCAM_BATCH_VIEW_T  *view  = &(batch->batches[idx]);
+        FLASHCAM_BATCH_FRAME_T *frame = &(view->frames[view->num]);
+        frame->pts        = pts;
+        frame->seq        = batch->seq++;
+        frame->host       = host;
+        frame->host_error = host_error;
+        frame->pll_state  = pll_state;
+        batch->stamps[idx * batch->size + view->num] = *stamps;
+        batch->filling = false;
+        
+        //full batch: hand over to consumer
+        if (++view->num == batch->size)
+            handover(batch);
+        return 0;
+    }
+    
+    void cancel(FLASHCAM_BATCH_T *batch) {
+        if (batch->filling)
+            batch->seq++;
+        batch->filling = false;
+    }
+}
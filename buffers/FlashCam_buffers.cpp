@@ -0,0 +1,261 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_buffers.h"
+
+#include "interface/mmal/util/mmal_util.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <math.h>
+
+namespace FlashCamBuffers {
+    
+    // Give a spare header a payload and send it to the port.
+    static int grow(FLASHCAM_BUFFERS_T *buffers, MMAL_PORT_T *port) {
+        MMAL_BUFFER_HEADER_T *buffer = mmal_queue_get(buffers->spares);
+        if (!buffer)
+            return -1;
+        
+        buffer->data = (uint8_t *) mmal_port_payload_alloc(port, buffers->size);
+        if (!buffer->data) {
+            vcos_log_error("%s: Unable to allocate buffer payload", __func__);
+            mmal_queue_put_back(buffers->spares, buffer);
+            return -1;
+        }
+        buffer->alloc_size = buffers->size;
+        buffers->circulating++;
+        
+        if (mmal_port_send_buffer(port, buffer) != MMAL_SUCCESS) {
+            vcos_log_error("%s: Unable to send a buffer to camera output port", __func__);
+            mmal_port_payload_free(port, buffer->data);
+            buffer->data       = NULL;
+            buffer->alloc_size = 0;
+            buffers->circulating--;
+            mmal_queue_put_back(buffers->spares, buffer);
+            return -1;
+        }
+        return 0;
+    }
+    
+    // Free the payload of a released header and keep it as spare.
+    static void shrink(FLASHCAM_BUFFERS_T *buffers, MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+        mmal_port_payload_free(port, buffer->data);
+        buffer->data       = NULL;
+        buffer->alloc_size = 0;
+        buffers->circulating--;
+        mmal_queue_put(buffers->spares, buffer);
+    }
+    
+    int create(FLASHCAM_BUFFERS_T *buffers, MMAL_PORT_T *port, unsigned int num, unsigned int max, bool tune) {
+        destroy(buffers);
+        
+        if (max < num)
+            max = num;
+        
+        port->buffer_num  = max;
+        if (port->buffer_size < port->buffer_size_min)
+            port->buffer_size = port->buffer_size_min;
+        
+        // Headers only: payloads are allocated per circulating buffer.
+        buffers->pool = mmal_port_pool_create(port, max, 0);
+        if (!buffers->pool) {
+            vcos_log_error("%s: Failed to create buffer header pool", __func__);
+            return -1;
+        }
+        
+        buffers->spares = mmal_queue_create();
+        if (!buffers->spares) {
+            vcos_log_error("%s: Failed to create queue for spare buffers", __func__);
+            destroy(buffers);
+            return -1;
+        }
+        
+        buffers->views = new FLASHCAM_FRAME_VIEW_T[max]();
+        
+        // All headers are spares until `start`
+        MMAL_BUFFER_HEADER_T *buffer;
+        while ((buffer = mmal_queue_get(buffers->pool->queue)) != NULL) {
+            buffer->data       = NULL;
+            buffer->alloc_size = 0;
+            mmal_queue_put(buffers->spares, buffer);
+        }
+        
+        buffers->port         = port;
+        buffers->size         = port->buffer_size;
+        buffers->min          = num;
+        buffers->max          = max;
+        buffers->tune         = tune;
+        buffers->circulating  = 0;
+        buffers->target       = num;
+        buffers->hold_peak    = 0;
+        buffers->window_start = 0;
+        buffers->period       = 0;
+        buffers->low          = 0;
+        return 0;
+    }
+    
+    void destroy(FLASHCAM_BUFFERS_T *buffers) {
+        MMAL_BUFFER_HEADER_T *buffer;
+        
+        // Spares back to the pool
+        if (buffers->spares) {
+            while ((buffer = mmal_queue_get(buffers->spares)) != NULL)
+                mmal_queue_put(buffers->pool->queue, buffer);
+            mmal_queue_destroy(buffers->spares);
+        }
+        
+        // Free payloads; all buffers should be returned to the pool (port disabled, frames released).
+        if (buffers->pool) {
+            for (unsigned int i=0; i<buffers->pool->headers_num; i++) {
+                buffer = buffers->pool->header[i];
+                if (buffer->data)
+                    mmal_port_payload_free(buffers->port, buffer->data);
+                buffer->data       = NULL;
+                buffer->alloc_size = 0;
+            }
+            mmal_pool_destroy(buffers->pool);
+        }
+        
+        if (buffers->views)
+            delete[] buffers->views;
+        
+        buffers->pool        = NULL;
+        buffers->spares      = NULL;
+        buffers->views       = NULL;
+        buffers->port        = NULL;
+        buffers->circulating = 0;
+        buffers->max         = 0;
+    }
+    
+    FLASHCAM_FRAME_VIEW_T *view(FLASHCAM_BUFFERS_T *buffers, MMAL_BUFFER_HEADER_T *buffer) {
+        if (!buffers->pool)
+            return NULL;
+        
+        // view with same index as header in pool
+        for (unsigned int i=0; i<buffers->pool->headers_num; i++) {
+            if (buffers->pool->header[i] == buffer)
+                return &buffers->views[i];
+        }
+        return NULL;
+    }
+    
+    int start(FLASHCAM_BUFFERS_T *buffers, MMAL_PORT_T *port) {
+        int status = 0;
+        while (buffers->circulating < buffers->target) {
+            if (grow(buffers, port)) {
+                status = -1;
+                break;
+            }
+        }
+        return status;
+    }
+    
+    int send(FLASHCAM_BUFFERS_T *buffers, MMAL_PORT_T *port) {
+        if (!port->is_enabled)
+            return 0;
+        
+        MMAL_BUFFER_HEADER_T *buffer = mmal_queue_get(buffers->pool->queue);
+        if (!buffer) {
+            vcos_log_error("%s: Unable to get a buffer from the pool", __func__);
+            return -1;
+        }
+        
+        // Too many buffers: do not replace released buffer
+        if (buffers->tune && (buffers->circulating > buffers->target)) {
+            shrink(buffers, port, buffer);
+            return 0;
+        }
+        
+        if (mmal_port_send_buffer(port, buffer) != MMAL_SUCCESS) {
+            vcos_log_error("%s: Unable to return the buffer to the camera port", __func__);
+            return -1;
+        }
+        
+        // Too few buffers: add spares
+        while (buffers->tune && (buffers->circulating < buffers->target)) {
+            if (grow(buffers, port))
+                break;
+        }
+        return 0;
+    }
+    
+    void hold(FLASHCAM_BUFFERS_T *buffers, uint64_t us) {
+        uint64_t peak = buffers->hold_peak.load(std::memory_order_relaxed);
+        while ((us > peak) && !buffers->hold_peak.compare_exchange_weak(peak, us, std::memory_order_relaxed));
+    }
+    
+    void frame(FLASHCAM_BUFFERS_T *buffers, float framerate) {
+        if (!buffers->tune)
+            return;
+        
+        // Frame period of the camera; frames dropped by FlashCam or user do not change it.
+        if (framerate > 0)
+            buffers->period = 1000000.0f / framerate;
+        
+        uint64_t t = now();
+        if (buffers->window_start == 0)
+            buffers->window_start = t;
+        if ((t - buffers->window_start < FLASHCAM_BUFFERS_WINDOW) || (buffers->period <= 0))
+            return;
+        
+        // End of window: buffers required for the longest hold
+        uint64_t peak = buffers->hold_peak.exchange(0, std::memory_order_relaxed);
+        unsigned int need = (unsigned int) ceilf(peak / buffers->period) + 2;
+        if (need < buffers->min) need = buffers->min;
+        if (need > buffers->max) need = buffers->max;
+        
+        // Grow at once, shrink when demand stays lower
+        unsigned int target = buffers->target;
+        if (need > target) {
+            buffers->target = need;
+            buffers->low    = 0;
+        } else if ((need < target) && (++buffers->low >= FLASHCAM_BUFFERS_SHRINK)) {
+            buffers->target = target - 1;
+            buffers->low    = 0;
+        } else if (need >= target) {
+            buffers->low    = 0;
+        }
+        buffers->window_start = t;
+    }
+    
+    uint64_t now() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+    }
+}
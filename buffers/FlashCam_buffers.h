@@ -0,0 +1,71 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_buffers_h
+#define FlashCam_buffers_h
+
+
+#include "FlashCam_types.h"
+
+namespace FlashCamBuffers {
+    
+    // Create pool of `max` headers for `port`, of which `num` get a payload. When `tune` is set, the number
+    //  of circulating buffers is tuned between `num` and `max`. Sets `port->buffer_num` and `port->buffer_size`.
+    //  Each header gets a view for zero-copy delivery.
+    int create(FLASHCAM_BUFFERS_T *buffers, MMAL_PORT_T *port, unsigned int num, unsigned int max, bool tune);
+    void destroy(FLASHCAM_BUFFERS_T *buffers);
+    
+    // Zero-copy view of a header of the pool (NULL: not of this pool).
+    FLASHCAM_FRAME_VIEW_T *view(FLASHCAM_BUFFERS_T *buffers, MMAL_BUFFER_HEADER_T *buffer);
+    
+    // Send all circulating buffers to the (enabled) port.
+    int start(FLASHCAM_BUFFERS_T *buffers, MMAL_PORT_T *port);
+    
+    // Replace a buffer which was released to the pool. When tuning, buffers are added or removed here.
+    int send(FLASHCAM_BUFFERS_T *buffers, MMAL_PORT_T *port);
+    
+    //tuning input
+    // - hold  : a buffer was held for `us` microseconds before it was released.
+    // - frame : a frame is completed while the camera runs at `framerate` (camera callback only).
+    void hold(FLASHCAM_BUFFERS_T *buffers, uint64_t us);
+    void frame(FLASHCAM_BUFFERS_T *buffers, float framerate);
+    
+    // CLOCK_MONOTONIC in microseconds
+    uint64_t now();
+}
+
+#endif /* FlashCam_buffers_h */
@@ -0,0 +1,203 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_clock.h"
+
+#include "interface/mmal/util/mmal_util_params.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+// Read attempts per sample
+#define FLASHCAM_CLOCK_READS        5
+// Drift bound until the drift is estimated: tolerance of the clock crystals
+#define FLASHCAM_CLOCK_DRIFT_MAX    100e-6
+// Samples needed to estimate the drift and its error
+#define FLASHCAM_CLOCK_DRIFT_MIN    3
+
+namespace FlashCamClock {
+    
+    static uint64_t monotonic_us() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+    }
+    
+    // Least-squares fit of (CLOCK_MONOTONIC - GPU time) against GPU time over the window, around the latest sample.
+    static void fit(FLASHCAM_CLOCK_T *clock, FLASHCAM_CLOCK_ESTIMATE_T *estimate) {
+        unsigned int n = (clock->num < FLASHCAM_CLOCK_WINDOW) ? clock->num : FLASHCAM_CLOCK_WINDOW;
+        const FLASHCAM_CLOCK_SAMPLE_T *latest = &(clock->window[(clock->num - 1) % FLASHCAM_CLOCK_WINDOW]);
+        double x[FLASHCAM_CLOCK_WINDOW], d[FLASHCAM_CLOCK_WINDOW];
+        double mx = 0, md = 0;
+        
+        for (unsigned int i=0; i<n; i++) {
+            x[i] = (double) ((int64_t) (clock->window[i].gpu  - latest->gpu));
+            d[i] = (double) ((int64_t) (clock->window[i].mono - clock->window[i].gpu));
+            mx  += x[i] / n;
+            md  += d[i] / n;
+        }
+        
+        double sxx = 0, sxd = 0;
+        for (unsigned int i=0; i<n; i++) {
+            sxx += (x[i] - mx) * (x[i] - mx);
+            sxd += (x[i] - mx) * (d[i] - md);
+        }
+        
+        estimate->gpu     = latest->gpu;
+        estimate->drift   = (sxx > 0) ? (sxd / sxx) : 0;
+        estimate->offset  = md - estimate->drift * mx;
+        estimate->samples = n;
+        
+        // error: worst sample (residual & half its read interval); drift: three standard errors of the slope
+        double error = 0, ssr = 0;
+        for (unsigned int i=0; i<n; i++) {
+            double r = d[i] - (estimate->offset + estimate->drift * x[i]);
+            double e = fabs(r) + clock->window[i].interval / 2.0;
+            error    = (e > error) ? e : error;
+            ssr     += r * r;
+        }
+        estimate->error       = error;
+        estimate->drift_error = ((n >= FLASHCAM_CLOCK_DRIFT_MIN) && (sxx > 0)) ? (3.0 * sqrt(ssr / (n - 2) / sxx)) : FLASHCAM_CLOCK_DRIFT_MAX;
+    }
+    
+    //sampling thread: refits the estimate with each sample
+    static void *worker(void *arg) {
+        FLASHCAM_CLOCK_T *clock = (FLASHCAM_CLOCK_T*) arg;
+        
+        while (!clock->stop.load(std::memory_order_acquire)) {
+            FLASHCAM_CLOCK_SAMPLE_T s;
+            
+            if (sample(clock->port, &s) == 0) {
+                FLASHCAM_CLOCK_ESTIMATE_T estimate;
+                clock->window[clock->num % FLASHCAM_CLOCK_WINDOW] = s;
+                clock->num++;
+                fit(clock, &estimate);
+                
+                // publish (seqlock): readers retry while the sequence is odd or changed
+                unsigned int seq = clock->seq.load(std::memory_order_relaxed);
+                clock->seq.store(seq + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                clock->estimate = estimate;
+                clock->seq.store(seq + 2, std::memory_order_release);
+            }
+            
+            // until the drift is known, sample four times as often
+            unsigned int wait = (clock->num < FLASHCAM_CLOCK_DRIFT_MIN) ? (clock->interval >> 2) : clock->interval;
+            for (unsigned int t=0; (t < wait) && !clock->stop.load(std::memory_order_acquire); t += 10)
+                vcos_sleep(10);
+        }
+        return NULL;
+    }
+    
+    int sample(MMAL_PORT_T *port, FLASHCAM_CLOCK_SAMPLE_T *sample) {
+        sample->interval = UINT64_MAX;
+        
+        for (unsigned int i=0; i<FLASHCAM_CLOCK_READS; i++) {
+            uint64_t gpu_us;
+            uint64_t before = monotonic_us();
+            MMAL_STATUS_T status = mmal_port_parameter_get_uint64(port, MMAL_PARAMETER_SYSTEM_TIME, &gpu_us);
+            uint64_t after  = monotonic_us();
+            
+            if (status != MMAL_SUCCESS)
+                return -1;
+            
+            // shortest read: GPU time was taken closest to halfway
+            if ((after - before) < sample->interval) {
+                sample->gpu      = gpu_us;
+                sample->mono     = before + ((after - before) >> 1);
+                sample->interval = after - before;
+            }
+        }
+        return 0;
+    }
+    
+    int start(FLASHCAM_CLOCK_T *clock, MMAL_PORT_T *port, unsigned int interval) {
+        VCOS_STATUS_T status;
+        
+        if (clock->active || !port || (interval == 0))
+            return -1;
+        
+        clock->port     = port;
+        clock->interval = interval;
+        clock->stop     = false;
+        
+        //start sampling thread
+        status = vcos_thread_create( &(clock->thread), "FlashCamClock-sampler", NULL, FlashCamClock::worker, clock);
+        if (status != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to start `FlashCamClock-sampler` (%d)", VCOS_FUNCTION, status);
+            return -1;
+        }
+        
+        clock->active = true;
+        return 0;
+    }
+    
+    void stop(FLASHCAM_CLOCK_T *clock) {
+        if (!clock->active)
+            return;
+        
+        clock->stop.store(true, std::memory_order_release);
+        vcos_thread_join(&(clock->thread), NULL);
+        clock->active = false;
+    }
+    
+    void get(FLASHCAM_CLOCK_T *clock, FLASHCAM_CLOCK_ESTIMATE_T *estimate) {
+        unsigned int seq;
+        do {
+            seq = clock->seq.load(std::memory_order_acquire);
+            *estimate = clock->estimate;
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) || (seq != clock->seq.load(std::memory_order_relaxed)));
+    }
+    
+    int translate(FLASHCAM_CLOCK_T *clock, uint64_t gpu_us, uint64_t *host_us, uint32_t *error_us) {
+        FLASHCAM_CLOCK_ESTIMATE_T estimate;
+        get(clock, &estimate);
+        
+        *host_us  = 0;
+        *error_us = 0;
+        if (estimate.gpu == 0)
+            return -1;
+        
+        double dt    = (double) ((int64_t) (gpu_us - estimate.gpu));
+        double error = ceil(estimate.error + fabs(dt) * estimate.drift_error);
+        *host_us     = (uint64_t) (((int64_t) gpu_us) + llround(estimate.offset + estimate.drift * dt));
+        *error_us    = (error < UINT32_MAX) ? (uint32_t) error : UINT32_MAX;
+        return 0;
+    }
+}
@@ -0,0 +1,61 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_clock_h
+#define FlashCam_clock_h
+
+#include "FlashCam_types.h"
+
+namespace FlashCamClock {
+    
+    // Read the GPU time of `port` between two CLOCK_MONOTONIC readings. Of a few reads, the shortest is kept.
+    int sample(MMAL_PORT_T *port, FLASHCAM_CLOCK_SAMPLE_T *sample);
+    
+    // start/stop sampling thread: samples `port` every `interval` ms (faster until the drift is known).
+    //  Samples and estimate are kept across restarts, as the clocks run on.
+    int start(FLASHCAM_CLOCK_T *clock, MMAL_PORT_T *port, unsigned int interval);
+    void stop(FLASHCAM_CLOCK_T *clock);
+    
+    // Map GPU time `gpu_us` onto CLOCK_MONOTONIC, with error bound. Lock-free, no MMAL calls (camera callback).
+    //  Returns -1 (and 0 as time and error) when there is no estimate yet.
+    int translate(FLASHCAM_CLOCK_T *clock, uint64_t gpu_us, uint64_t *host_us, uint32_t *error_us);
+    
+    // Copy of the latest estimate.
+    void get(FLASHCAM_CLOCK_T *clock, FLASHCAM_CLOCK_ESTIMATE_T *estimate);
+}
+
+#endif /* FlashCam_clock_h */
@@ -0,0 +1,330 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_dispatch.h"
+
+#include "FlashCam_trace.h"
+#include "FlashCam_sched.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace FlashCamDispatch {
+    
+    //worker thread: takes queued frames and delivers them to the user
+    static void *worker(void *arg) {
+        FLASHCAM_DISPATCH_T *dispatch = (FLASHCAM_DISPATCH_T*) arg;
+        FLASHCAM_SCHED_WAKE_T last = {};
+        
+        FlashCamSched::enter(dispatch->sched, FLASHCAM_THREAD_WORKER, "dispatch");
+        
+        while (true) {
+            //wait for a frame (or a stop-token)
+            vcos_semaphore_wait(&(dispatch->sem_items));
+            
+            vcos_mutex_lock(&(dispatch->lock));
+            if (dispatch->queue_num == 0) {
+                // No frame: token is spurious or a stop-token.
+                bool stop = dispatch->stop;
+                vcos_mutex_unlock(&(dispatch->lock));
+                if (stop)
+                    break;
+                continue;
+            }
+            
+            // take oldest frame
+            unsigned int idx = dispatch->queue[dispatch->queue_head];
+            dispatch->queue_head = (dispatch->queue_head + 1) % dispatch->capacity;
+            dispatch->queue_num--;
+            dispatch->stats->dispatch_depth.store(dispatch->queue_num, std::memory_order_relaxed);
+            vcos_mutex_unlock(&(dispatch->lock));
+            
+            //producer might be waiting for space
+            if (dispatch->policy == FLASHCAM_DISPATCH_BLOCK)
+                vcos_semaphore_post(&(dispatch->sem_space));
+            
+            FLASHCAM_FRAME_T *frame = &(dispatch->frames[idx]);
+            FlashCamSched::wake(dispatch->sched, FLASHCAM_THREAD_WORKER, &last, frame->pts);
+            frame->stamps.entry = FlashCamTrace::now(dispatch->trace);
+            if (dispatch->callback)
+                dispatch->callback(frame->data, dispatch->width, dispatch->height);
+            frame->stamps.exit  = FlashCamTrace::now(dispatch->trace);
+            FlashCamTrace::record(dispatch->trace, &(frame->stamps));
+            
+            //return frame
+            vcos_mutex_lock(&(dispatch->lock));
+            dispatch->free[dispatch->free_num++] = idx;
+            dispatch->stats->frames.fetch_add(1, std::memory_order_relaxed);
+            vcos_mutex_unlock(&(dispatch->lock));
+        }
+        return NULL;
+    }
+    
+    unsigned int frames(unsigned int threads, unsigned int capacity) {
+        return threads + capacity + 1;
+    }
+    
+    int init(FLASHCAM_DISPATCH_T *dispatch, unsigned int threads, unsigned int capacity, FLASHCAM_DISPATCH_POLICY_T policy, unsigned int framesize, unsigned char *data) {
+        if (dispatch->active) {
+            fprintf(stderr, "%s: Cannot resize dispatch pool while it is in use.\n", __func__);
+            return -1;
+        }
+        
+        if ((threads < 1) || (threads > FLASHCAM_DISPATCH_MAX_THREADS)) {
+            fprintf(stderr, "%s: Dispatch pool requires 1 to %d threads (%d).\n", __func__, FLASHCAM_DISPATCH_MAX_THREADS, threads);
+            return -1;
+        }
+        
+        if (capacity < 1) {
+            fprintf(stderr, "%s: Dispatch queue requires at least 1 frame (%d).\n", __func__, capacity);
+            return -1;
+        }
+        
+        dispatch->policy = policy;
+        
+        // Nothing changed?
+        if (dispatch->frames && (dispatch->threads == threads) && (dispatch->capacity == capacity) && (dispatch->framesize == framesize) && (dispatch->frames[0].data == data))
+            return 0;
+        
+        destroy(dispatch);
+        
+        if (vcos_mutex_create(&(dispatch->lock), "FlashCam_dispatch_lock") != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to create mutex", __func__);
+            return -1;
+        }
+        if (vcos_semaphore_create(&(dispatch->sem_items), "FlashCam_dispatch_items", 0) != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to create semaphore", __func__);
+            vcos_mutex_delete(&(dispatch->lock));
+            return -1;
+        }
+        if (vcos_semaphore_create(&(dispatch->sem_space), "FlashCam_dispatch_space", 0) != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to create semaphore", __func__);
+            vcos_semaphore_delete(&(dispatch->sem_items));
+            vcos_mutex_delete(&(dispatch->lock));
+            return -1;
+        }
+        
+        unsigned int num = frames(threads, capacity);
+        dispatch->frames = new FLASHCAM_FRAME_T[num]();
+        dispatch->free   = new unsigned int[num];
+        dispatch->queue  = new unsigned int[capacity];
+        for (unsigned int i=0; i<num; i++)
+            dispatch->frames[i].data = &data[((size_t) i) * framesize];
+        
+        dispatch->threads   = threads;
+        dispatch->capacity  = capacity;
+        dispatch->framesize = framesize;
+        dispatch->num       = num;
+        dispatch->seq       = 0;
+        return 0;
+    }
+    
+    void destroy(FLASHCAM_DISPATCH_T *dispatch) {
+        stop(dispatch);
+        
+        if (dispatch->frames) {
+            delete[] dispatch->frames;
+            delete[] dispatch->free;
+            delete[] dispatch->queue;
+            vcos_semaphore_delete(&(dispatch->sem_space));
+            vcos_semaphore_delete(&(dispatch->sem_items));
+            vcos_mutex_delete(&(dispatch->lock));
+        }
+        dispatch->frames    = NULL;
+        dispatch->free      = NULL;
+        dispatch->queue     = NULL;
+        dispatch->threads   = 0;
+        dispatch->capacity  = 0;
+        dispatch->framesize = 0;
+        dispatch->num       = 0;
+    }
+    
+    int start(FLASHCAM_DISPATCH_T *dispatch, FLASHCAM_CALLBACK_T callback, unsigned int width, unsigned int height, FLASHCAM_COUNTERS_T *stats, FLASHCAM_TRACE_T *trace, FLASHCAM_SCHED_T *sched) {
+        VCOS_STATUS_T status;
+        
+        if (!dispatch->frames || dispatch->active)
+            return -1;
+        
+        //reset pool: all frames are free
+        while (vcos_semaphore_trywait(&(dispatch->sem_items)) != VCOS_EAGAIN);
+        while (vcos_semaphore_trywait(&(dispatch->sem_space)) != VCOS_EAGAIN);
+        for (unsigned int i=0; i<dispatch->num; i++)
+            dispatch->free[i] = i;
+        dispatch->free_num   = dispatch->num;
+        dispatch->queue_head = 0;
+        dispatch->queue_num  = 0;
+        dispatch->filling    = -1;
+        dispatch->stop       = false;
+        dispatch->callback   = callback;
+        dispatch->width      = width;
+        dispatch->height     = height;
+        dispatch->stats      = stats;
+        dispatch->trace      = trace;
+        dispatch->sched      = sched;
+        
+        //start workers
+        for (unsigned int i=0; i<dispatch->threads; i++) {
+            status = vcos_thread_create( &(dispatch->thread[i]), "FlashCamDispatch-worker", NULL, FlashCamDispatch::worker, dispatch);
+            if (status != VCOS_SUCCESS) {
+                vcos_log_error("%s: Failed to start `FlashCamDispatch-worker` %d (%d)", VCOS_FUNCTION, i, status);
+                
+                //terminate workers started so far
+                vcos_mutex_lock(&(dispatch->lock));
+                dispatch->stop = true;
+                vcos_mutex_unlock(&(dispatch->lock));
+                for (unsigned int j=0; j<i; j++)
+                    vcos_semaphore_post(&(dispatch->sem_items));
+                for (unsigned int j=0; j<i; j++)
+                    vcos_thread_join(&(dispatch->thread[j]), NULL);
+                return -1;
+            }
+        }
+        
+        dispatch->active = true;
+        return 0;
+    }
+    
+    void stop(FLASHCAM_DISPATCH_T *dispatch) {
+        if (!dispatch->active)
+            return;
+        
+        //notify workers we are done: one token per worker, queued frames are delivered first.
+        vcos_mutex_lock(&(dispatch->lock));
+        dispatch->stop = true;
+        vcos_mutex_unlock(&(dispatch->lock));
+        for (unsigned int i=0; i<dispatch->threads; i++)
+            vcos_semaphore_post(&(dispatch->sem_items));
+        
+        //Wait for workers to terminate.
+        for (unsigned int i=0; i<dispatch->threads; i++)
+            vcos_thread_join(&(dispatch->thread[i]), NULL);
+        dispatch->active = false;
+    }
+    
+    unsigned char* acquire(FLASHCAM_DISPATCH_T *dispatch) {
+        vcos_mutex_lock(&(dispatch->lock));
+        
+        // frame in progress is replaced
+        if (dispatch->filling >= 0) {
+            dispatch->free[dispatch->free_num++] = dispatch->filling;
+            dispatch->seq++;
+        }
+        
+        // There is always a free frame, see FLASHCAM_DISPATCH_T.
+        dispatch->filling = dispatch->free[--dispatch->free_num];
+        unsigned char *data = dispatch->frames[dispatch->filling].data;
+        
+        vcos_mutex_unlock(&(dispatch->lock));
+        return data;
+    }
+    
+    unsigned char* current(FLASHCAM_DISPATCH_T *dispatch) {
+        // `filling` is only written by the producer
+        if (dispatch->filling < 0)
+            return NULL;
+        return dispatch->frames[dispatch->filling].data;
+    }
+    
+    unsigned int publish(FLASHCAM_DISPATCH_T *dispatch, uint64_t pts, bool pll_state, const FLASHCAM_TRACE_STAMPS_T *stamps) {
+        if (dispatch->filling < 0)
+            return 1;
+        
+        FLASHCAM_FRAME_T *frame = &(dispatch->frames[dispatch->filling]);
+        frame->pts       = pts;
+        frame->pll_state = pll_state;
+        frame->seq       = dispatch->seq++;
+        frame->stamps    = *stamps;
+        
+        vcos_mutex_lock(&(dispatch->lock));
+        
+        // Queue full: apply backpressure policy
+        if (dispatch->queue_num == dispatch->capacity) {
+            switch (dispatch->policy) {
+                case FLASHCAM_DISPATCH_DROP_NEWEST:
+                    dispatch->free[dispatch->free_num++] = dispatch->filling;
+                    dispatch->filling = -1;
+                    dispatch->stats->dispatch_dropped_newest.fetch_add(1, std::memory_order_relaxed);
+                    vcos_mutex_unlock(&(dispatch->lock));
+                    return 1;
+                    
+                case FLASHCAM_DISPATCH_DROP_OLDEST: {
+                    // Replace oldest frame; number of queued frames does not change.
+                    unsigned int *oldest = &(dispatch->queue[dispatch->queue_head]);
+                    dispatch->free[dispatch->free_num++] = *oldest;
+                    dispatch->queue_head = (dispatch->queue_head + 1) % dispatch->capacity;
+                    dispatch->queue[(dispatch->queue_head + dispatch->queue_num - 1) % dispatch->capacity] = dispatch->filling;
+                    dispatch->filling = -1;
+                    dispatch->stats->dispatch_dropped_oldest.fetch_add(1, std::memory_order_relaxed);
+                    vcos_mutex_unlock(&(dispatch->lock));
+                    return 1;
+                }
+                    
+                case FLASHCAM_DISPATCH_BLOCK:
+                    dispatch->stats->dispatch_blocked.fetch_add(1, std::memory_order_relaxed);
+                    while (dispatch->queue_num == dispatch->capacity) {
+                        vcos_mutex_unlock(&(dispatch->lock));
+                        vcos_semaphore_wait(&(dispatch->sem_space));
+                        vcos_mutex_lock(&(dispatch->lock));
+                    }
+                    break;
+            }
+        }
+        
+        dispatch->queue[(dispatch->queue_head + dispatch->queue_num) % dispatch->capacity] = dispatch->filling;
+        dispatch->queue_num++;
+        dispatch->filling = -1;
+        dispatch->stats->dispatch_depth.store(dispatch->queue_num, std::memory_order_relaxed);
+        if (dispatch->queue_num > dispatch->stats->dispatch_depth_max.load(std::memory_order_relaxed))
+            dispatch->stats->dispatch_depth_max.store(dispatch->queue_num, std::memory_order_relaxed);
+        vcos_mutex_unlock(&(dispatch->lock));
+        
+        //wake a worker
+        vcos_semaphore_post(&(dispatch->sem_items));
+        return 0;
+    }
+    
+    void cancel(FLASHCAM_DISPATCH_T *dispatch) {
+        if (dispatch->filling < 0)
+            return;
+        
+        vcos_mutex_lock(&(dispatch->lock));
+        dispatch->free[dispatch->free_num++] = dispatch->filling;
+        dispatch->filling = -1;
+        dispatch->seq++;
+        vcos_mutex_unlock(&(dispatch->lock));
+    }
+}
@@ -0,0 +1,69 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_dispatch_h
+#define FlashCam_dispatch_h
+
+
+#include "FlashCam_types.h"
+
+namespace FlashCamDispatch {
+    
+    // Frames of a pool: each worker holds one, the queue holds `capacity` and the producer fills one.
+    unsigned int frames(unsigned int threads, unsigned int capacity);
+    
+    // (re)allocate pool for `threads` workers and a queue of `capacity` frames of `framesize` bytes. The frames are laid out
+    //  in `data` (owned by the caller, `frames(threads, capacity)` frames). Pool must be stopped.
+    int init(FLASHCAM_DISPATCH_T *dispatch, unsigned int threads, unsigned int capacity, FLASHCAM_DISPATCH_POLICY_T policy, unsigned int framesize, unsigned char *data);
+    void destroy(FLASHCAM_DISPATCH_T *dispatch);
+    
+    // start/stop workers. Stopping delivers all queued frames before returning.
+    int start(FLASHCAM_DISPATCH_T *dispatch, FLASHCAM_CALLBACK_T callback, unsigned int width, unsigned int height, FLASHCAM_COUNTERS_T *stats, FLASHCAM_TRACE_T *trace, FLASHCAM_SCHED_T *sched);
+    void stop(FLASHCAM_DISPATCH_T *dispatch);
+    
+    //producer (camera callback) functions. Only `publish` may block (FLASHCAM_DISPATCH_BLOCK).
+    // - acquire : claim a free frame for a new frame.
+    // - current : frame in progress, NULL if none is claimed.
+    // - publish : queue the frame in progress according to the backpressure policy. Returns the number of frames dropped.
+    // - cancel  : drop the frame in progress.
+    unsigned char* acquire(FLASHCAM_DISPATCH_T *dispatch);
+    unsigned char* current(FLASHCAM_DISPATCH_T *dispatch);
+    unsigned int publish(FLASHCAM_DISPATCH_T *dispatch, uint64_t pts, bool pll_state, const FLASHCAM_TRACE_STAMPS_T *stamps);
+    void cancel(FLASHCAM_DISPATCH_T *dispatch);
+}
+
+#endif /* FlashCam_dispatch_h */
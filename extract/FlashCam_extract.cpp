@@ -0,0 +1,163 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_extract.h"
+#include "FlashCam_util_copy.h"
+
+#include <stdio.h>
+
+namespace FlashCamExtract {
+    
+    unsigned int init(FLASHCAM_EXTRACT_T *extract, unsigned int width, unsigned int height, unsigned int pitch) {
+        if (!(extract->planes & FLASHCAM_PLANE_YUV) || (extract->num_rois > FLASHCAM_EXTRACT_MAX_ROIS)) {
+            fprintf(stderr, "%s: No planes selected or too many regions (%u)\n", __func__, extract->num_rois);
+            return 0;
+        }
+        
+        // Full image: a single region at `pitch`
+        bool full = (extract->num_rois == 0);
+        if (full) {
+            extract->rois[0].x      = 0;
+            extract->rois[0].y      = 0;
+            extract->rois[0].width  = width;
+            extract->rois[0].height = height;
+            extract->num_rois       = 1;
+        }
+        
+        // Regions in order, planes of a region compact
+        unsigned int size = 0;
+        for (unsigned int i=0; i<extract->num_rois; i++) {
+            FLASHCAM_ROI_T *roi = &(extract->rois[i]);
+            unsigned int x0 = roi->x & ~1u;
+            unsigned int y0 = roi->y & ~1u;
+            unsigned int x1 = VCOS_ALIGN_UP(roi->x + roi->width , 2);
+            unsigned int y1 = VCOS_ALIGN_UP(roi->y + roi->height, 2);
+            
+            if ((roi->width == 0) || (roi->height == 0) || (x1 > width) || (y1 > height)) {
+                fprintf(stderr, "%s: Region %u (%u,%u %ux%u) outside of image (%ux%u)\n", __func__, i, roi->x, roi->y, roi->width, roi->height, width, height);
+                return 0;
+            }
+            
+            roi->x      = x0;
+            roi->y      = y0;
+            roi->width  = x1 - x0;
+            roi->height = y1 - y0;
+            roi->pitch  = full ? pitch : roi->width;
+            
+            for (unsigned int p=0; p<3; p++) {
+                roi->offset[p] = size;
+                if (extract->planes & (1 << p))
+                    size += (p == 0) ? (roi->pitch * roi->height) : ((roi->pitch >> 1) * (roi->height >> 1));
+            }
+        }
+        return size;
+    }
+    
+    // Operation of a band on the frame
+    typedef enum {
+        FLASHCAM_BAND_COPY = 0,                 // frame = band
+        FLASHCAM_BAND_LIT,                      // Y: frame = band - frame, U/V: frame = band
+        FLASHCAM_BAND_UNLIT                     // Y: frame = frame - band, U/V: kept
+    } FLASHCAM_BAND_OP_T;
+    
+    static unsigned int process(const FLASHCAM_EXTRACT_T *extract, unsigned char *frame, const uint8_t *src, unsigned int stride, unsigned int row, unsigned int rows, FLASHCAM_BAND_OP_T op) {
+        const uint8_t *src_Y = src;
+        const uint8_t *src_U = src_Y + rows * stride;
+        const uint8_t *src_V = src_U + (rows >> 1) * (stride >> 1);
+        unsigned int bytes   = 0;
+        
+        for (unsigned int i=0; i<extract->num_rois; i++) {
+            const FLASHCAM_ROI_T *roi = &(extract->rois[i]);
+            
+            // rows of region within band (even: bands and regions start at even rows)
+            unsigned int first = (row > roi->y) ? row : roi->y;
+            unsigned int last  = (row + rows < roi->y + roi->height) ? (row + rows) : (roi->y + roi->height);
+            if (first >= last)
+                continue;
+            
+            unsigned int n     = last - first;
+            unsigned int src_r = first - row;       // row in band
+            unsigned int dst_r = first - roi->y;    // row in region
+            
+            if (extract->planes & FLASHCAM_PLANE_Y) {
+                uint8_t       *dst = &frame[roi->offset[0] + dst_r * roi->pitch];
+                const uint8_t *Y   = src_Y + src_r * stride + roi->x;
+                if (op == FLASHCAM_BAND_LIT)
+                    FlashCamUtilCopy::subtractPlane(dst, roi->pitch, Y, stride, dst, roi->pitch, roi->width, n);
+                else if (op == FLASHCAM_BAND_UNLIT)
+                    FlashCamUtilCopy::subtractPlane(dst, roi->pitch, dst, roi->pitch, Y, stride, roi->width, n);
+                else
+                    FlashCamUtilCopy::copyPlane(dst, roi->pitch, Y, stride, roi->width, n);
+                bytes += n * roi->width;
+            }
+            if (op == FLASHCAM_BAND_UNLIT)
+                continue;
+            if (extract->planes & FLASHCAM_PLANE_U) {
+                FlashCamUtilCopy::copyPlane(&frame[roi->offset[1] + (dst_r >> 1) * (roi->pitch >> 1)], roi->pitch >> 1,
+                                            src_U + (src_r >> 1) * (stride >> 1) + (roi->x >> 1), stride >> 1, roi->width >> 1, n >> 1);
+                bytes += (n >> 1) * (roi->width >> 1);
+            }
+            if (extract->planes & FLASHCAM_PLANE_V) {
+                FlashCamUtilCopy::copyPlane(&frame[roi->offset[2] + (dst_r >> 1) * (roi->pitch >> 1)], roi->pitch >> 1,
+                                            src_V + (src_r >> 1) * (stride >> 1) + (roi->x >> 1), stride >> 1, roi->width >> 1, n >> 1);
+                bytes += (n >> 1) * (roi->width >> 1);
+            }
+        }
+        return bytes;
+    }
+    
+    unsigned int band(const FLASHCAM_EXTRACT_T *extract, unsigned char *frame, const uint8_t *src, unsigned int stride, unsigned int row, unsigned int rows) {
+        return process(extract, frame, src, stride, row, rows, FLASHCAM_BAND_COPY);
+    }
+    
+    unsigned int subtractBand(const FLASHCAM_EXTRACT_T *extract, unsigned char *frame, const uint8_t *src, unsigned int stride, unsigned int row, unsigned int rows, bool lit) {
+        return process(extract, frame, src, stride, row, rows, lit ? FLASHCAM_BAND_LIT : FLASHCAM_BAND_UNLIT);
+    }
+    
+    unsigned int subtract(const FLASHCAM_EXTRACT_T *extract, unsigned char *lit, const unsigned char *unlit) {
+        unsigned int bytes = 0;
+        if (!(extract->planes & FLASHCAM_PLANE_Y))
+            return 0;
+        
+        for (unsigned int i=0; i<extract->num_rois; i++) {
+            const FLASHCAM_ROI_T *roi = &(extract->rois[i]);
+            FlashCamUtilCopy::subtractPlane(&lit[roi->offset[0]], roi->pitch, &lit[roi->offset[0]], roi->pitch, &unlit[roi->offset[0]], roi->pitch, roi->width, roi->height);
+            bytes += roi->width * roi->height;
+        }
+        return bytes;
+    }
+}
@@ -0,0 +1,66 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_extract_h
+#define FlashCam_extract_h
+
+
+#include "FlashCam_types.h"
+
+namespace FlashCamExtract {
+    
+    // Check `extract` against the image size, round regions to even values and set their layout in the frame.
+    //  Without regions, `extract` gets a single region covering the image at `pitch`.
+    //  Returns the size of a frame, 0 when a region is invalid.
+    unsigned int init(FLASHCAM_EXTRACT_T *extract, unsigned int width, unsigned int height, unsigned int pitch);
+    
+    // Copy a band of `rows` image rows, starting at `row`, from a camera buffer into `frame`.
+    //  The Y plane of the band is at `src` with `stride` bytes per row, its U and V planes follow (half the stride and rows).
+    //  Returns the number of bytes copied.
+    unsigned int band(const FLASHCAM_EXTRACT_T *extract, unsigned char *frame, const uint8_t *src, unsigned int stride, unsigned int row, unsigned int rows);
+    
+    // As `band`, fused with the saturating difference of the Y planes (FlashCamUtilCopy::subtractPlane) with the frame in `frame`:
+    //  - lit  : band is the lit frame, `frame` holds the unlit frame. Y = band - frame, U and V are copied from the band.
+    //  - !lit : band is the unlit frame, `frame` holds the lit frame. Y = frame - band, U and V are kept.
+    //  `frame` holds the difference afterwards, the band itself is never stored. Returns the number of bytes written.
+    unsigned int subtractBand(const FLASHCAM_EXTRACT_T *extract, unsigned char *frame, const uint8_t *src, unsigned int stride, unsigned int row, unsigned int rows, bool lit);
+    
+    // Saturating difference of the Y planes of two frames in place: lit = lit - unlit. Returns the number of bytes written.
+    unsigned int subtract(const FLASHCAM_EXTRACT_T *extract, unsigned char *lit, const unsigned char *unlit);
+}
+
+#endif /* FlashCam_extract_h */
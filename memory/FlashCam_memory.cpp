@@ -0,0 +1,164 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_memory.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+namespace FlashCamMemory {
+    
+    // Page faults of the calling thread (minor + major), or of the process where threads are not counted separately.
+    static uint64_t faults() {
+        struct rusage usage;
+#ifdef RUSAGE_THREAD
+        if (getrusage(RUSAGE_THREAD, &usage))
+#endif
+            getrusage(RUSAGE_SELF, &usage);
+        return ((uint64_t) usage.ru_minflt) + ((uint64_t) usage.ru_majflt);
+    }
+    
+    // Map `size` bytes; explicit hugepages are tried first when requested.
+    static void* map(size_t size, unsigned int flags, bool *hugepages) {
+        void *data = MAP_FAILED;
+        
+        *hugepages = false;
+#ifdef MAP_HUGETLB
+        if (flags & FLASHCAM_MEMORY_HUGEPAGES) {
+            data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            *hugepages = (data != MAP_FAILED);
+        }
+#endif
+        if (data == MAP_FAILED) {
+            data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (data == MAP_FAILED)
+                return NULL;
+#ifdef MADV_HUGEPAGE
+            //no reserved hugepages: ask for transparent hugepages instead
+            if (flags & FLASHCAM_MEMORY_HUGEPAGES)
+                madvise(data, size, MADV_HUGEPAGE);
+#endif
+        }
+        return data;
+    }
+    
+    unsigned char* reserve(FLASHCAM_MEMORY_T *memory, FLASHCAM_MEMORY_REGION_T *region, size_t size, unsigned int flags) {
+        if (size == 0) {
+            fprintf(stderr, "%s: Cannot reserve an empty region.\n", __func__);
+            return NULL;
+        }
+        
+        // Mapped region fits?
+        if (region->data && (size <= region->size) && (flags == region->flags)) {
+            region->used = size;
+            memory->stats.reuses++;
+            return region->data;
+        }
+        
+        release(memory, region);
+        
+        // Hugepage mappings must span whole hugepages
+        size_t page   = (flags & FLASHCAM_MEMORY_HUGEPAGES) ? FLASHCAM_MEMORY_HUGEPAGE : (size_t) sysconf(_SC_PAGESIZE);
+        size_t mapped = ((size + page - 1) / page) * page;
+        bool   huge   = false;
+        void  *data   = map(mapped, flags, &huge);
+        if (!data) {
+            fprintf(stderr, "%s: Cannot map %zu bytes (%s).\n", __func__, mapped, strerror(errno));
+            return NULL;
+        }
+        
+        // Touch every page now: first-touch faults are taken here instead of in the first frames
+        uint64_t before = faults();
+        memset(data, 0, mapped);
+        memory->stats.prefaults += faults() - before;
+        
+        bool locked = false;
+        if (flags & FLASHCAM_MEMORY_LOCK) {
+            locked = (mlock(data, mapped) == 0);
+            if (!locked)
+                fprintf(stderr, "%s: Cannot lock %zu bytes (%s), frame memory may be paged out. Raise RLIMIT_MEMLOCK.\n", __func__, mapped, strerror(errno));
+        }
+        
+        region->data      = (unsigned char*) data;
+        region->size      = mapped;
+        region->used      = size;
+        region->flags     = flags;
+        region->locked    = locked;
+        region->hugepages = huge;
+        
+        memory->stats.allocations++;
+        memory->stats.mapped    += mapped;
+        memory->stats.locked    += locked ? mapped : 0;
+        memory->stats.hugepages += huge   ? mapped : 0;
+        return region->data;
+    }
+    
+    void release(FLASHCAM_MEMORY_T *memory, FLASHCAM_MEMORY_REGION_T *region) {
+        if (region->data) {
+            if (region->locked)
+                munlock(region->data, region->size);
+            munmap(region->data, region->size);
+            
+            memory->stats.mapped    -= region->size;
+            memory->stats.locked    -= region->locked    ? region->size : 0;
+            memory->stats.hugepages -= region->hugepages ? region->size : 0;
+        }
+        *region = {};
+    }
+    
+    void destroy(FLASHCAM_MEMORY_T *memory) {
+        release(memory, &(memory->frame));
+        release(memory, &(memory->ring));
+        release(memory, &(memory->dispatch));
+        release(memory, &(memory->batch));
+        release(memory, &(memory->pair));
+        release(memory, &(memory->stack));
+    }
+    
+    void stats(FLASHCAM_MEMORY_T *memory, FLASHCAM_MEMORY_STATS_T *stats) {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        
+        *stats              = memory->stats;
+        stats->faults_minor = (uint64_t) usage.ru_minflt;
+        stats->faults_major = (uint64_t) usage.ru_majflt;
+    }
+}
@@ -0,0 +1,58 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_memory_h
+#define FlashCam_memory_h
+
+#include "FlashCam_types.h"
+
+namespace FlashCamMemory {
+    
+    // Region of at least `size` bytes, mapped with `flags` (mask of FLASHCAM_MEMORY_*). The mapped region is reused when
+    //  it is large enough and was mapped with the same flags, otherwise it is replaced. New regions are touched (and locked)
+    //  here, so that streaming does not fault on them. Returns NULL when no memory can be mapped.
+    unsigned char* reserve(FLASHCAM_MEMORY_T *memory, FLASHCAM_MEMORY_REGION_T *region, size_t size, unsigned int flags);
+    
+    // Unmap a region / all regions of the pool.
+    void release(FLASHCAM_MEMORY_T *memory, FLASHCAM_MEMORY_REGION_T *region);
+    void destroy(FLASHCAM_MEMORY_T *memory);
+    
+    // Counters of the pool, with the page faults of the process so far.
+    void stats(FLASHCAM_MEMORY_T *memory, FLASHCAM_MEMORY_STATS_T *stats);
+}
+
+#endif /* FlashCam_memory_h */
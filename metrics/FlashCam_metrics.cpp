@@ -0,0 +1,214 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_metrics.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// A monitor maps the block in another process: the atomics must not fall back to (process-local) locks.
+#if (ATOMIC_LLONG_LOCK_FREE != 2)
+#warning "64-bit atomics are not lock-free: FlashCamMetrics cannot be shared with other processes"
+#endif
+
+namespace FlashCamMetrics {
+    
+    //counters & gauges of `src` into `dst`
+    static void transfer(FLASHCAM_METRICS_BLOCK_T *dst, FLASHCAM_METRICS_BLOCK_T *src) {
+        dst->version            = src->version;
+        dst->size               = src->size;
+        dst->cameranum          = src->cameranum;
+        dst->pid                = src->pid;
+        dst->buffers            = src->buffers.load();
+        dst->frames             = src->frames.load();
+        dst->bytes_copied       = src->bytes_copied.load();
+        dst->copy_ns            = src->copy_ns.load();
+        dst->callbacks          = src->callbacks.load();
+        dst->callback_ns        = src->callback_ns.load();
+        dst->pool_circulating   = src->pool_circulating.load();
+        dst->pool_lent          = src->pool_lent.load();
+        dst->opengl_queue       = src->opengl_queue.load();
+        dst->pll_error_us       = src->pll_error_us.load();
+        dst->updated_ns         = src->updated_ns.load();
+        //block is valid
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(dst->magic, FLASHCAM_METRICS_MAGIC, sizeof(dst->magic));
+    }
+    
+    void init(FLASHCAM_METRICS_T *metrics, unsigned int cameranum) {
+        FLASHCAM_METRICS_BLOCK_T *local = &(metrics->local);
+        
+        local->version          = FLASHCAM_METRICS_VERSION;
+        local->size             = sizeof(FLASHCAM_METRICS_BLOCK_T);
+        local->cameranum        = cameranum;
+        local->pid              = getpid();
+        local->buffers          = 0;
+        local->frames           = 0;
+        local->bytes_copied     = 0;
+        local->copy_ns          = 0;
+        local->callbacks        = 0;
+        local->callback_ns      = 0;
+        local->pool_circulating = 0;
+        local->pool_lent        = 0;
+        local->opengl_queue     = 0;
+        local->pll_error_us     = 0;
+        local->updated_ns       = 0;
+        memcpy(local->magic, FLASHCAM_METRICS_MAGIC, sizeof(local->magic));
+        
+        metrics->block   = local;
+        metrics->name[0] = '\0';
+    }
+    
+    int publish(FLASHCAM_METRICS_T *metrics, const char *name) {
+        if (strlen(name) >= sizeof(metrics->name)) {
+            fprintf(stderr, "%s: Name of segment too long: %s\n", __func__, name);
+            return -1;
+        }
+        
+        //already published?
+        if (metrics->name[0] && (strcmp(metrics->name, name) == 0))
+            return 0;
+        unpublish(metrics);
+        
+        int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "%s: Cannot create shared memory %s\n", __func__, name);
+            return -1;
+        }
+        
+        FLASHCAM_METRICS_BLOCK_T *block = (FLASHCAM_METRICS_BLOCK_T*) MAP_FAILED;
+        if (ftruncate(fd, sizeof(FLASHCAM_METRICS_BLOCK_T)) == 0)
+            block = (FLASHCAM_METRICS_BLOCK_T*) mmap(NULL, sizeof(FLASHCAM_METRICS_BLOCK_T), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        
+        if (block == MAP_FAILED) {
+            fprintf(stderr, "%s: Cannot map shared memory %s\n", __func__, name);
+            shm_unlink(name);
+            return -1;
+        }
+        
+        //invalidate (a replaced segment might be mapped by a monitor) & continue counting from local block
+        memset(block->magic, 0, sizeof(block->magic));
+        transfer(block, &(metrics->local));
+        
+        strcpy(metrics->name, name);
+        metrics->block = block;
+        return 0;
+    }
+    
+    void unpublish(FLASHCAM_METRICS_T *metrics) {
+        if (!metrics->name[0])
+            return;
+        
+        FLASHCAM_METRICS_BLOCK_T *block = metrics->block;
+        transfer(&(metrics->local), block);
+        metrics->block = &(metrics->local);
+        
+        munmap(block, sizeof(FLASHCAM_METRICS_BLOCK_T));
+        shm_unlink(metrics->name);
+        metrics->name[0] = '\0';
+    }
+    
+    void buffer(FLASHCAM_METRICS_T *metrics) {
+        metrics->block->buffers.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    void frame(FLASHCAM_METRICS_T *metrics) {
+        metrics->block->frames.fetch_add(1, std::memory_order_relaxed);
+        metrics->block->updated_ns.store(now(), std::memory_order_relaxed);
+    }
+    
+    void copy(FLASHCAM_METRICS_T *metrics, uint64_t bytes, uint64_t ns) {
+        metrics->block->bytes_copied.fetch_add(bytes, std::memory_order_relaxed);
+        metrics->block->copy_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+    
+    void callback(FLASHCAM_METRICS_T *metrics, uint64_t ns) {
+        metrics->block->callbacks.fetch_add(1, std::memory_order_relaxed);
+        metrics->block->callback_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+    
+    void pool(FLASHCAM_METRICS_T *metrics, unsigned int circulating, unsigned int lent) {
+        metrics->block->pool_circulating.store(circulating, std::memory_order_relaxed);
+        metrics->block->pool_lent.store(lent, std::memory_order_relaxed);
+    }
+    
+    void opengl(FLASHCAM_METRICS_T *metrics, unsigned int queued) {
+        metrics->block->opengl_queue.store(queued, std::memory_order_relaxed);
+    }
+    
+    void pll(FLASHCAM_METRICS_T *metrics, int64_t error_us) {
+        metrics->block->pll_error_us.store(error_us, std::memory_order_relaxed);
+    }
+    
+    const FLASHCAM_METRICS_BLOCK_T *attach(const char *name) {
+        struct stat st;
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0)
+            return NULL;
+        
+        void *block = MAP_FAILED;
+        if ((fstat(fd, &st) == 0) && (st.st_size >= (off_t) sizeof(FLASHCAM_METRICS_BLOCK_T)))
+            block = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (block == MAP_FAILED)
+            return NULL;
+        
+        const FLASHCAM_METRICS_BLOCK_T *b = (const FLASHCAM_METRICS_BLOCK_T*) block;
+        if ((memcmp(b->magic, FLASHCAM_METRICS_MAGIC, sizeof(b->magic)) != 0) || (b->version != FLASHCAM_METRICS_VERSION)) {
+            munmap(block, st.st_size);
+            return NULL;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return b;
+    }
+    
+    void detach(const FLASHCAM_METRICS_BLOCK_T *block) {
+        munmap((void*) block, block->size);
+    }
+    
+    uint64_t now() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return ((uint64_t) t.tv_sec) * 1000000000 + ((uint64_t) t.tv_nsec);
+    }
+}
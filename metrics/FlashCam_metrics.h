@@ -0,0 +1,80 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_metrics_h
+#define FlashCam_metrics_h
+
+
+
+#include "FlashCam_types.h"
+
+namespace FlashCamMetrics {
+    
+    // Clear all counters and gauges. The block is process-local until published.
+    void init(FLASHCAM_METRICS_T *metrics, unsigned int cameranum);
+    
+    // Publish the block as POSIX shared-memory segment `name` (replacing an existing one). Counters are kept.
+    //  Not while updates are in progress.
+    int publish(FLASHCAM_METRICS_T *metrics, const char *name);
+    // Remove the segment, counters are kept in the local block.
+    void unpublish(FLASHCAM_METRICS_T *metrics);
+    
+    //updates (lock-free)
+    // - buffer   : a buffer was received from the camera.
+    // - frame    : a complete frame was received from the camera.
+    // - copy     : `bytes` were copied in `ns`.
+    // - callback : the user was called for `ns`.
+    // - pool     : buffers with payload / buffers lent to the user.
+    // - opengl   : buffers queued for the OpenGL worker.
+    // - pll      : timing error of the PLL.
+    void buffer(FLASHCAM_METRICS_T *metrics);
+    void frame(FLASHCAM_METRICS_T *metrics);
+    void copy(FLASHCAM_METRICS_T *metrics, uint64_t bytes, uint64_t ns);
+    void callback(FLASHCAM_METRICS_T *metrics, uint64_t ns);
+    void pool(FLASHCAM_METRICS_T *metrics, unsigned int circulating, unsigned int lent);
+    void opengl(FLASHCAM_METRICS_T *metrics, unsigned int queued);
+    void pll(FLASHCAM_METRICS_T *metrics, int64_t error_us);
+    
+    // Monitor: map segment `name` read-only. NULL when missing or of another layout version.
+    const FLASHCAM_METRICS_BLOCK_T *attach(const char *name);
+    void detach(const FLASHCAM_METRICS_BLOCK_T *block);
+    
+    // CLOCK_MONOTONIC in nanoseconds
+    uint64_t now();
+}
+
+#endif /* FlashCam_metrics_h */
@@ -37,6 +37,9 @@
 
 #include "FlashCam_opengl.h"
 #include "FlashCam_util_opengl.h"
+#include "FlashCam_trace.h"
+#include "FlashCam_sched.h"
+#include "FlashCam_metrics.h"
 
 #include <assert.h>
 #include <bcm_host.h>
@@ -48,9 +51,6 @@
 
 namespace FlashCamOpenGL {
         
-    //private & static parameterlist
-    static FLASHCAM_INTERNAL_STATE_T *_state;
-
     //worker thread: processed captured frames
     static void *worker(void *arg) {
         FLASHCAM_INTERNAL_STATE_T* state = (FLASHCAM_INTERNAL_STATE_T*) arg;
@@ -59,6 +59,9 @@ namespace FlashCamOpenGL {
         MMAL_BUFFER_HEADER_T    *glb_mmal_buffer;
         MMAL_BUFFER_HEADER_T    *buffer;
         MMAL_STATUS_T status;
+        FLASHCAM_SCHED_WAKE_T last = {};
+        
+        FlashCamSched::enter(state->userdata->sched, FLASHCAM_THREAD_OPENGL, "opengl");
         
         //init OpenGL
         FlashCamUtilOpenGL::init(state->settings->width, state->settings->height, state->settings->opengl_packed);
@@ -75,17 +78,28 @@ namespace FlashCamOpenGL {
             // --> as we are using countin-semaphores, only process a single buffer
             if ((!state->opengl_worker_stop) && ((glb_mmal_buffer = mmal_queue_get(state->userdata->opengl_queue)) != NULL)) {      
                 
+                FlashCamMetrics::opengl(state->userdata->metrics, mmal_queue_length(state->userdata->opengl_queue));
+                
                 //get frame data.
                 glb     = (FLASHCAM_OPENGL_BUF_T*) glb_mmal_buffer->user_data;
                 buffer  = glb->buffer; 
+                FlashCamSched::wake(state->userdata->sched, FLASHCAM_THREAD_OPENGL, &last, buffer->pts);
+                glb->stamps.dequeued = FlashCamTrace::now(&(state->userdata->trace));
                 mmal_buffer_header_mem_lock(buffer);
 
                 // OPAQUE ==> TEXTURE
                 FlashCamUtilOpenGL::mmalbuf2TextureOES(buffer, state->opengl_tex_id, &(state->opengl_tex_data));
+                glb->stamps.textured = FlashCamTrace::now(&(state->userdata->trace));
                 
                 //callback user..
-                if (state->userdata->callback_egl)
+                glb->stamps.entry    = glb->stamps.textured;
+                if (state->userdata->callback_egl) {
+                    uint64_t callback_start = FlashCamMetrics::now();
                     state->userdata->callback_egl( state->opengl_tex_id, state->userdata->settings->width, state->userdata->settings->height, buffer->pts, glb->pll_state);
+                    FlashCamMetrics::callback(state->userdata->metrics, FlashCamMetrics::now() - callback_start);
+                }
+                glb->stamps.exit     = FlashCamTrace::now(&(state->userdata->trace));
+                FlashCamTrace::record(&(state->userdata->trace), &(glb->stamps));
                 
                 
                 //release opengl buffer back to pool
@@ -107,12 +121,16 @@ namespace FlashCamOpenGL {
         while ((buffer = mmal_queue_get(state->userdata->opengl_queue)) != NULL)
             mmal_buffer_header_release(buffer);   
         fprintf(stdout, "Worker: releasing.. done\n");
+        
+        //clear OpenGL: context is owned by this thread
+        FlashCamUtilOpenGL::destroyEGLImage(&(state->opengl_tex_data));            
+        FlashCamUtilOpenGL::destroy();
+        return NULL;
     }
     
     
     int init(FLASHCAM_INTERNAL_STATE_T *state) {
         fprintf(stdout, "EGL:init..\n");
-        FlashCamOpenGL::_state = state;
         
         //setup videocore-logging and semaphores
         bcm_host_init();
@@ -125,9 +143,9 @@ namespace FlashCamOpenGL {
     }
     
     
-    void initOpenGLBufferPool() {
+    void initOpenGLBufferPool(FLASHCAM_INTERNAL_STATE_T *state) {
         //setup opengl buffer pool
-        for (unsigned int i=0; i<FlashCamOpenGL::_state->port->buffer_num; i++) {
+        for (unsigned int i=0; i<state->port->buffer_num; i++) {
             //new buffer
             FLASHCAM_OPENGL_BUF_T b;
             //create lock
@@ -141,16 +159,16 @@ namespace FlashCamOpenGL {
             b.pll_state             = false;
 #endif
             //push to vector
-            FlashCamOpenGL::_state->opengl_buffer_pool.push_back(b);
+            state->opengl_buffer_pool.push_back(b);
             fprintf(stdout, "Created buffer in OpenGL pool (%d) \n", i);
         }
     }
     
-    void destroyOpenGLBufferPool() {
-        while (!(FlashCamOpenGL::_state->opengl_buffer_pool.empty())) {
+    void destroyOpenGLBufferPool(FLASHCAM_INTERNAL_STATE_T *state) {
+        while (!(state->opengl_buffer_pool.empty())) {
             //remove element from pool
-            FLASHCAM_OPENGL_BUF_T b = FlashCamOpenGL::_state->opengl_buffer_pool.back();
-            FlashCamOpenGL::_state->opengl_buffer_pool.pop_back();
+            FLASHCAM_OPENGL_BUF_T b = state->opengl_buffer_pool.back();
+            state->opengl_buffer_pool.pop_back();
 
             //clear semaphore
             vcos_semaphore_delete(&b.lock);
@@ -158,10 +176,10 @@ namespace FlashCamOpenGL {
     }
 
     //try to get a buffer. Return NULL if none are available
-    FLASHCAM_OPENGL_BUF_T* getOpenGLBuffer() {
-        for (unsigned int i=0; i<FlashCamOpenGL::_state->opengl_buffer_pool.size(); i++) {
-            if (vcos_semaphore_trywait(&(FlashCamOpenGL::_state->opengl_buffer_pool.at(i).lock)) == VCOS_SUCCESS) {
-                FLASHCAM_OPENGL_BUF_T* b = &(FlashCamOpenGL::_state->opengl_buffer_pool.at(i));
+    FLASHCAM_OPENGL_BUF_T* getOpenGLBuffer(FLASHCAM_INTERNAL_STATE_T *state) {
+        for (unsigned int i=0; i<state->opengl_buffer_pool.size(); i++) {
+            if (vcos_semaphore_trywait(&(state->opengl_buffer_pool.at(i).lock)) == VCOS_SUCCESS) {
+                FLASHCAM_OPENGL_BUF_T* b = &(state->opengl_buffer_pool.at(i));
                 //set proper address of `glb_mmal_buffer`
                 b->glb_mmal_buffer.user_data = b;
                 return b;    
@@ -172,31 +190,31 @@ namespace FlashCamOpenGL {
         return NULL;
     }
     
-    int start() {
+    int start(FLASHCAM_INTERNAL_STATE_T *state) {
         VCOS_STATUS_T status;
 
         fprintf(stdout, "EGL:starting..\n");
 
         //set basic settings
-        FlashCamOpenGL::_state->opengl_worker_stop  = false;
-        FlashCamOpenGL::_state->opengl_tex_id       = 0;
-        FlashCamOpenGL::_state->opengl_tex_data     = EGL_NO_IMAGE_KHR;
+        state->opengl_worker_stop  = false;
+        state->opengl_tex_id       = 0;
+        state->opengl_tex_data     = EGL_NO_IMAGE_KHR;
                 
         //init pool
-        destroyOpenGLBufferPool();
-        initOpenGLBufferPool();
+        destroyOpenGLBufferPool(state);
+        initOpenGLBufferPool(state);
         
         //clear queue..
         fprintf(stdout, "- resetting queue..\n");
-        while (mmal_queue_get(FlashCamOpenGL::_state->userdata->opengl_queue) != NULL);                
+        while (mmal_queue_get(state->userdata->opengl_queue) != NULL);                
 
         //reset semaphore
         fprintf(stdout, "- resetting semaphore..\n");
-        while (vcos_semaphore_trywait(&(FlashCamOpenGL::_state->userdata->sem_capture)) != VCOS_EAGAIN);
+        while (vcos_semaphore_trywait(&(state->userdata->sem_capture)) != VCOS_EAGAIN);
         
         //start worker thread
         fprintf(stdout, "- starting worker..\n");
-        status = vcos_thread_create( &(FlashCamOpenGL::_state->opengl_worker_thread), "FlashCamOpenGL-worker", NULL, FlashCamOpenGL::worker, FlashCamOpenGL::_state);
+        status = vcos_thread_create( &(state->opengl_worker_thread), "FlashCamOpenGL-worker", NULL, FlashCamOpenGL::worker, state);
         if (status != VCOS_SUCCESS)
             vcos_log_error("%s: Failed to start `FlashCamOpenGL-worker` (%d)", VCOS_FUNCTION, status);
 
@@ -209,36 +227,32 @@ namespace FlashCamOpenGL {
     
     
     
-    void stop() {      
+    void stop(FLASHCAM_INTERNAL_STATE_T *state) {      
         fprintf(stdout, "EGL:stopping..\n");
         
         // STOP SIGNAL
-        if (!FlashCamOpenGL::_state->opengl_worker_stop) {
+        if (!state->opengl_worker_stop) {
             //vcos_log_trace("Stopping GL preview");
             fprintf(stdout, "- worker is running\n");
 
             //notify worker we are done. 
             //  As the worker blocks due to the sempahore, we need to set the status and post an update
-            FlashCamOpenGL::_state->opengl_worker_stop = true;
-            vcos_semaphore_post(&(FlashCamOpenGL::_state->userdata->sem_capture));
+            state->opengl_worker_stop = true;
+            vcos_semaphore_post(&(state->userdata->sem_capture));
             
             fprintf(stdout, "- Waiting for worker\n");
 
             //Wait for worker to terminate.
-            vcos_thread_join(&(FlashCamOpenGL::_state->opengl_worker_thread), NULL);
-            
-            //clear OpenGL
-            FlashCamUtilOpenGL::destroyEGLImage(&(FlashCamOpenGL::_state->opengl_tex_data));            
-            FlashCamUtilOpenGL::destroy();
+            vcos_thread_join(&(state->opengl_worker_thread), NULL);
         
             //destroy bufferpool
-            destroyOpenGLBufferPool();
+            destroyOpenGLBufferPool(state);
             
             fprintf(stdout, "- Done\n");
         }
     }
         
-    void destroy() {
+    void destroy(FLASHCAM_INTERNAL_STATE_T *state) {
         fprintf(stdout, "EGL:destroying..\n");
 
         //vcos_semaphore_delete(&(FlashCamOpenGL::sem_captyr));
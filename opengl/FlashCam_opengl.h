@@ -53,18 +53,20 @@
 
 namespace FlashCamOpenGL {
         
+    //All worker state is kept in `state`, owned by the FlashCam instance. Each instance runs its own 
+    // worker thread with its own EGL context.
     int init(FLASHCAM_INTERNAL_STATE_T *state);
-    void destroy();    
+    void destroy(FLASHCAM_INTERNAL_STATE_T *state);    
     
-    int start();
-    void stop();
+    int start(FLASHCAM_INTERNAL_STATE_T *state);
+    void stop(FLASHCAM_INTERNAL_STATE_T *state);
     
     
     //after init, these functions can be used:
-    void initOpenGLBufferPool();
-    void destroyOpenGLBufferPool();    
+    void initOpenGLBufferPool(FLASHCAM_INTERNAL_STATE_T *state);
+    void destroyOpenGLBufferPool(FLASHCAM_INTERNAL_STATE_T *state);    
     //try to get a buffer. Return NULL if none are available
-    FLASHCAM_OPENGL_BUF_T* getOpenGLBuffer();
+    FLASHCAM_OPENGL_BUF_T* getOpenGLBuffer(FLASHCAM_INTERNAL_STATE_T *state);
 }
 
 #endif /* FlashCam_opengl_h */
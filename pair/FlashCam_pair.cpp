@@ -0,0 +1,423 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_pair.h"
+
+#include "FlashCam_trace.h"
+#include "FlashCam_sched.h"
+#include "FlashCam_extract.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Metadata of the frame in progress (`frames`, `stamps`), when it is not stitched into a slot of its own
+#define FLASHCAM_PAIR_INCOMING FLASHCAM_PAIR_SLOTS
+
+namespace FlashCamPair {
+    
+    //consumer thread: delivers published pairs to the user
+    static void *worker(void *arg) {
+        FLASHCAM_PAIR_T *pair = (FLASHCAM_PAIR_T*) arg;
+        FLASHCAM_SCHED_WAKE_T last = {};
+        
+        FlashCamSched::enter(pair->sched, FLASHCAM_THREAD_WORKER, "pair");
+        
+        while (true) {
+            //wait for update
+            vcos_semaphore_wait(&(pair->sem));
+            
+            // deliver all published pairs
+            unsigned int tail = pair->tail.load(std::memory_order_relaxed);
+            unsigned int head = pair->head.load(std::memory_order_acquire);
+            
+            for (; tail != head; tail++) {
+                unsigned int          idx  = tail % FLASHCAM_PAIR_NUM;
+                FLASHCAM_PAIR_VIEW_T *view = &(pair->pairs[idx]);
+                
+                FlashCamSched::wake(pair->sched, FLASHCAM_THREAD_WORKER, &last, view->lit_frame.pts);
+                
+                uint64_t entry = FlashCamTrace::now(pair->trace);
+                if (pair->callback)
+                    pair->callback(view);
+                uint64_t exit  = FlashCamTrace::now(pair->trace);
+                unsigned int free = 0;
+                for (unsigned int i=0; i<2; i++) {
+                    FLASHCAM_TRACE_STAMPS_T *stamps = &(pair->queued[idx][i]);
+                    stamps->entry = entry;
+                    stamps->exit  = exit;
+                    FlashCamTrace::record(pair->trace, stamps);
+                    if (pair->slots[idx][i] >= 0)
+                        free |= 1u << pair->slots[idx][i];
+                }
+                pair->stats->frames.fetch_add(2, std::memory_order_relaxed);
+                
+                //slots & pair can be reused by producer
+                pair->free.fetch_or(free, std::memory_order_release);
+                pair->tail.store(tail + 1, std::memory_order_release);
+            }
+            
+            // Stop when requested and all pairs are delivered.
+            if (pair->stop.load(std::memory_order_acquire) && (tail == pair->head.load(std::memory_order_acquire)))
+                break;
+        }
+        return NULL;
+    }
+    
+    // claim a free slot (-1: none). Only the producer claims, the consumer only returns slots.
+    static int claim(FLASHCAM_PAIR_T *pair) {
+        unsigned int free = pair->free.load(std::memory_order_acquire);
+        if (!free)
+            return -1;
+        int slot = __builtin_ctz(free);
+        pair->free.fetch_and(~(1u << slot), std::memory_order_relaxed);
+        return slot;
+    }
+    
+    static void release(FLASHCAM_PAIR_T *pair, int slot) {
+        if ((slot >= 0) && (slot < FLASHCAM_PAIR_SLOTS))
+            pair->free.fetch_or(1u << slot, std::memory_order_release);
+    }
+    
+    static unsigned char* frame(FLASHCAM_PAIR_T *pair, int slot) {
+        return &(pair->data[((size_t) slot) * pair->framesize]);
+    }
+    
+    // are frames at `a` and `b` at most `frames` frame periods apart?
+    static bool near(FLASHCAM_PAIR_T *pair, uint64_t a, uint64_t b, unsigned int frames) {
+        uint64_t distance = (a > b) ? (a - b) : (b - a);
+        return distance <= ((uint64_t) frames) * pair->period + (pair->period >> 1);
+    }
+    
+    // hand the pair of frames `lit` and `unlit` (slots or FLASHCAM_PAIR_INCOMING) to the consumer. `difference` is the slot
+    //  holding their difference (-1: none, both frames are delivered). Returns the number of frames dropped (pairs full: 1).
+    static unsigned int handover(FLASHCAM_PAIR_T *pair, int lit, int unlit, int difference) {
+        unsigned int head = pair->head.load(std::memory_order_relaxed);
+        unsigned int tail = pair->tail.load(std::memory_order_acquire);
+        
+        // All pairs taken? Consumer is too slow: drop pair.
+        if ((head - tail) >= FLASHCAM_PAIR_NUM) {
+            pair->stats->overruns.fetch_add(1, std::memory_order_relaxed);
+            release(pair, lit);
+            release(pair, unlit);
+            return 1;
+        }
+        
+        unsigned int          idx  = head % FLASHCAM_PAIR_NUM;
+        FLASHCAM_PAIR_VIEW_T *view = &(pair->pairs[idx]);
+        view->lit         = (difference < 0) ? frame(pair, lit)   : NULL;
+        view->unlit       = (difference < 0) ? frame(pair, unlit) : NULL;
+        view->difference  = (difference < 0) ? NULL : frame(pair, difference);
+        view->lit_frame   = pair->frames[lit];
+        view->unlit_frame = pair->frames[unlit];
+        view->offset      = (int64_t) (view->unlit_frame.pts - view->lit_frame.pts);
+        pair->slots[idx][0]  = (lit   < FLASHCAM_PAIR_SLOTS) ? lit   : -1;
+        pair->slots[idx][1]  = (unlit < FLASHCAM_PAIR_SLOTS) ? unlit : -1;
+        pair->queued[idx][0] = pair->stamps[lit];
+        pair->queued[idx][1] = pair->stamps[unlit];
+        
+        pair->head.store(head + 1, std::memory_order_release);
+        vcos_semaphore_post(&(pair->sem));
+        return 0;
+    }
+    
+    // lit frame waiting for the next unlit frame is paired with the last unlit frame, if near. Returns the number of frames dropped.
+    static unsigned int resolve(FLASHCAM_PAIR_T *pair) {
+        if (pair->lit < 0)
+            return 0;
+        
+        int lit   = pair->lit;
+        pair->lit = -1;
+        if ((pair->unlit >= 0) && near(pair, pair->frames[lit].pts, pair->frames[pair->unlit].pts, FLASHCAM_PAIR_DISTANCE)) {
+            int unlit   = pair->unlit;
+            pair->unlit = -1;
+            if (!pair->subtract)
+                return handover(pair, lit, unlit, -1);
+            
+            // both frames are stored: subtract in the slot of the lit frame
+            FlashCamExtract::subtract(pair->extract, frame(pair, lit), frame(pair, unlit));
+            return handover(pair, lit, unlit, lit);
+        }
+        
+        pair->stats->unpaired.fetch_add(1, std::memory_order_relaxed);
+        release(pair, lit);
+        return 1;
+    }
+    
+    // last unlit frame is not paired: it is dropped. Returns the number of frames dropped.
+    static unsigned int dropUnlit(FLASHCAM_PAIR_T *pair) {
+        if (pair->unlit < 0)
+            return 0;
+        
+        pair->stats->unpaired.fetch_add(1, std::memory_order_relaxed);
+        release(pair, pair->unlit);
+        pair->unlit = -1;
+        return 1;
+    }
+    
+    int init(FLASHCAM_PAIR_T *pair, unsigned int framesize, unsigned char *data) {
+        if (pair->active) {
+            fprintf(stderr, "%s: Cannot resize pairs while they are in use.\n", __func__);
+            return -1;
+        }
+        
+        // Nothing changed?
+        if (pair->data && (pair->framesize == framesize) && (pair->data == data))
+            return 0;
+        
+        destroy(pair);
+        
+        if (vcos_semaphore_create(&(pair->sem), "FlashCam_pair_sem", 0) != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to create semaphore", __func__);
+            return -1;
+        }
+        
+        pair->data      = data;
+        pair->framesize = framesize;
+        pair->free      = (1u << FLASHCAM_PAIR_SLOTS) - 1;
+        pair->head      = 0;
+        pair->tail      = 0;
+        pair->filling   = -1;
+        pair->partner   = -1;
+        pair->unlit     = -1;
+        pair->lit       = -1;
+        return 0;
+    }
+    
+    void destroy(FLASHCAM_PAIR_T *pair) {
+        stop(pair);
+        
+        if (pair->data)
+            vcos_semaphore_delete(&(pair->sem));
+        pair->data      = NULL;
+        pair->framesize = 0;
+    }
+    
+    int start(FLASHCAM_PAIR_T *pair, FLASHCAM_CALLBACK_PAIR_T callback, const FLASHCAM_EXTRACT_T *extract, unsigned int period, unsigned int divider,
+              bool subtract, FLASHCAM_COUNTERS_T *stats, FLASHCAM_TRACE_T *trace, FLASHCAM_SCHED_T *sched) {
+        VCOS_STATUS_T status;
+        
+        if (!pair->data || pair->active)
+            return -1;
+        
+        //reset pairs
+        while (vcos_semaphore_trywait(&(pair->sem)) != VCOS_EAGAIN);
+        for (unsigned int i=0; i<FLASHCAM_PAIR_NUM; i++) {
+            pair->pairs[i]        = {};
+            pair->pairs[i].width  = extract->rois[0].width;
+            pair->pairs[i].height = extract->rois[0].height;
+            pair->pairs[i].pitch  = extract->rois[0].pitch;
+        }
+        pair->free     = (1u << FLASHCAM_PAIR_SLOTS) - 1;
+        pair->head     = 0;
+        pair->tail     = 0;
+        pair->filling  = -1;
+        pair->partner  = -1;
+        pair->skipping = false;
+        pair->unlit    = -1;
+        pair->lit      = -1;
+        pair->lit_pts  = 0;
+        pair->seq      = 0;
+        pair->period   = period;
+        pair->divider  = divider;
+        pair->subtract = subtract;
+        pair->extract  = extract;
+        pair->stop     = false;
+        pair->callback = callback;
+        pair->stats    = stats;
+        pair->trace    = trace;
+        pair->sched    = sched;
+        
+        //start consumer thread
+        status = vcos_thread_create( &(pair->thread), "FlashCamPair-worker", NULL, FlashCamPair::worker, pair);
+        if (status != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to start `FlashCamPair-worker` (%d)", VCOS_FUNCTION, status);
+            return -1;
+        }
+        
+        pair->active = true;
+        return 0;
+    }
+    
+    void stop(FLASHCAM_PAIR_T *pair) {
+        if (!pair->active)
+            return;
+        
+        //waiting lit frame is paired with the last unlit frame (producer has stopped)
+        cancel(pair);
+        resolve(pair);
+        dropUnlit(pair);
+        
+        //notify worker we are done.
+        pair->stop.store(true, std::memory_order_release);
+        vcos_semaphore_post(&(pair->sem));
+        
+        //Wait for worker to deliver remaining pairs and terminate.
+        vcos_thread_join(&(pair->thread), NULL);
+        pair->active = false;
+    }
+    
+    unsigned char* acquire(FLASHCAM_PAIR_T *pair, uint64_t pts, bool pll_state) {
+        // frame in progress is replaced
+        cancel(pair);
+        
+        pair->filling_lit = pll_state;
+        pair->partner     = -1;
+        
+        if (pll_state) {
+            // lit frame: a lit frame still waiting gets no unlit frame after it.
+            //  This frame pairs with the last unlit frame when adjacent, otherwise it waits for the next unlit frame.
+            pair->dropped += resolve(pair);
+            pair->lit_pts  = pts;
+            if ((pair->unlit >= 0) && near(pair, pts, pair->frames[pair->unlit].pts, 1))
+                pair->partner = pair->unlit;
+            
+        } else if (pair->lit >= 0) {
+            // unlit frame: the waiting lit frame pairs with the nearer of the last and this unlit frame.
+            uint64_t lit_pts = pair->frames[pair->lit].pts;
+            bool     last    = (pair->unlit >= 0) && ((lit_pts - pair->frames[pair->unlit].pts) <= (pts - lit_pts));
+            if (!last && near(pair, lit_pts, pts, FLASHCAM_PAIR_DISTANCE))
+                pair->partner = pair->lit;
+            else
+                pair->dropped += resolve(pair);
+            
+        } else if ((pair->divider > 2) && pair->lit_pts) {
+            // unlit frame: only needed when it precedes the next lit frame.
+            //  Without a lit frame yet, or with less than two unlit frames per pulse, every unlit frame may be a partner.
+            uint64_t next = pair->lit_pts + ((uint64_t) pair->divider) * pair->period;
+            if (pts + pair->period + (pair->period >> 1) < next) {
+                pair->stats->skipped.fetch_add(1, std::memory_order_relaxed);
+                pair->skipping = true;
+                pair->seq++;
+                return NULL;
+            }
+        }
+        
+        // Difference: the frame is subtracted in the slot of its partner while it is stitched.
+        if (pair->subtract && (pair->partner >= 0)) {
+            pair->filling = pair->partner;
+            return current(pair);
+        }
+        
+        // All slots taken? Consumer is too slow: drop frame.
+        int slot = claim(pair);
+        if (slot < 0) {
+            pair->stats->overruns.fetch_add(1, std::memory_order_relaxed);
+            pair->partner = -1;
+            pair->seq++;
+            return NULL;
+        }
+        
+        pair->filling = slot;
+        return current(pair);
+    }
+    
+    unsigned char* current(FLASHCAM_PAIR_T *pair) {
+        if (pair->filling < 0)
+            return NULL;
+        return frame(pair, pair->filling);
+    }
+    
+    bool fused(FLASHCAM_PAIR_T *pair, bool *lit) {
+        *lit = pair->filling_lit;
+        return (pair->filling >= 0) && (pair->filling == pair->partner);
+    }
+    
+    unsigned int publish(FLASHCAM_PAIR_T *pair, uint64_t pts, uint64_t host, uint32_t host_error, const FLASHCAM_TRACE_STAMPS_T *stamps) {
+        unsigned int dropped = pair->dropped;
+        pair->dropped = 0;
+        
+        // skipped frames are not dropped
+        if (pair->filling < 0) {
+            dropped += pair->skipping ? 0 : 1;
+            pair->skipping = false;
+            return dropped;
+        }
+        
+        // frame is kept in its slot, or (fused) only its metadata
+        bool fused   = (pair->filling == pair->partner);
+        int  slot    = fused ? FLASHCAM_PAIR_INCOMING : pair->filling;
+        int  partner = pair->partner;
+        pair->filling = -1;
+        pair->partner = -1;
+        
+        FLASHCAM_BATCH_FRAME_T *frame = &(pair->frames[slot]);
+        frame->pts        = pts;
+        frame->seq        = pair->seq++;
+        frame->host       = host;
+        frame->host_error = host_error;
+        frame->pll_state  = pair->filling_lit;
+        pair->stamps[slot] = *stamps;
+        
+        // lit frame: pairs with the last unlit frame, or waits for the next one
+        if (pair->filling_lit) {
+            if (partner < 0) {
+                pair->lit = slot;
+                return dropped;
+            }
+            pair->unlit = -1;
+            return dropped + handover(pair, slot, partner, fused ? partner : -1);
+        }
+        
+        // unlit frame: pairs with the waiting lit frame, or becomes the last unlit frame (the previous one is dropped)
+        dropped += dropUnlit(pair);
+        if (partner < 0) {
+            pair->unlit = slot;
+            return dropped;
+        }
+        pair->lit = -1;
+        return dropped + handover(pair, partner, slot, fused ? partner : -1);
+    }
+    
+    void cancel(FLASHCAM_PAIR_T *pair) {
+        // fused: the partner is lost as well
+        if (pair->filling >= 0) {
+            if (pair->filling == pair->partner) {
+                pair->stats->unpaired.fetch_add(1, std::memory_order_relaxed);
+                pair->dropped++;
+                if (pair->partner == pair->lit)
+                    pair->lit = -1;
+                else
+                    pair->unlit = -1;
+            }
+            release(pair, pair->filling);
+            pair->seq++;
+        }
+        pair->filling  = -1;
+        pair->partner  = -1;
+        pair->skipping = false;
+    }
+}
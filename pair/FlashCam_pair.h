@@ -0,0 +1,72 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_pair_h
+#define FlashCam_pair_h
+
+#include "FlashCam_types.h"
+
+namespace FlashCamPair {
+    
+    // (re)allocate FLASHCAM_PAIR_SLOTS frames of `framesize` bytes, laid out in `data` (owned by the caller,
+    //  FLASHCAM_PAIR_SLOTS x framesize bytes). Pairs must be stopped.
+    int init(FLASHCAM_PAIR_T *pair, unsigned int framesize, unsigned char *data);
+    void destroy(FLASHCAM_PAIR_T *pair);
+    
+    // start/stop consumer thread. `period` is the frame period (us), `divider` the number of frames per pulse of the PLL,
+    //  `subtract` delivers the difference of pairs instead of both frames. `extract` is the layout of the frames.
+    //  Stopping pairs a waiting lit frame with the last unlit frame and delivers all published pairs before returning.
+    int start(FLASHCAM_PAIR_T *pair, FLASHCAM_CALLBACK_PAIR_T callback, const FLASHCAM_EXTRACT_T *extract, unsigned int period, unsigned int divider,
+              bool subtract, FLASHCAM_COUNTERS_T *stats, FLASHCAM_TRACE_T *trace, FLASHCAM_SCHED_T *sched);
+    void stop(FLASHCAM_PAIR_T *pair);
+    
+    //producer (camera callback) functions. These never block.
+    // - acquire : claim a slot for the frame at `pts`. Returns NULL when the frame cannot be paired (skipped: nothing to copy)
+    //             or when all slots are taken (overrun).
+    // - current : frame in progress, NULL if none is claimed.
+    // - fused   : is the frame in progress subtracted in place (FlashCamExtract::subtractBand)? `lit`: the frame in progress is lit.
+    // - publish : complete the frame in progress (lit or not as given to `acquire`) and pair it, pairs are handed to the consumer.
+    //             Returns the number of frames dropped.
+    // - cancel  : drop the frame in progress.
+    unsigned char* acquire(FLASHCAM_PAIR_T *pair, uint64_t pts, bool pll_state);
+    unsigned char* current(FLASHCAM_PAIR_T *pair);
+    bool fused(FLASHCAM_PAIR_T *pair, bool *lit);
+    unsigned int publish(FLASHCAM_PAIR_T *pair, uint64_t pts, uint64_t host, uint32_t host_error, const FLASHCAM_TRACE_STAMPS_T *stamps);
+    void cancel(FLASHCAM_PAIR_T *pair);
+}
+
+#endif /* FlashCam_pair_h */
@@ -47,6 +47,7 @@
 #include <stdio.h>
 #include <wiringPi.h>
 #include <math.h>
+#include <atomic>
 
 #include "interface/mmal/util/mmal_util_params.h"
 
@@ -86,26 +87,27 @@
 
 namespace FlashCamPLL {
 
-    //private & static parameterlist
-    static FLASHCAM_INTERNAL_STATE_T *_state;
+    //The PWM pin is shared by all FlashCam instances; only a single PLL can drive it.
+    static std::atomic<FLASHCAM_INTERNAL_STATE_T*> _pin_owner(NULL);
 
-    //Reset GPIO & PWM 
-    void resetGPIO();
+    //Reset GPIO & PWM (unless the pin is driven by another instance)
+    void resetGPIO(FLASHCAM_INTERNAL_STATE_T *state);
+    //Claim/release the PWM pin for `state`
+    bool claimPin(FLASHCAM_INTERNAL_STATE_T *state);
+    void releasePin(FLASHCAM_INTERNAL_STATE_T *state);
     //reset PLL parameters
-    void clearPLLstate();
+    void clearPLLstate(FLASHCAM_INTERNAL_STATE_T *state);
 
     void init(FLASHCAM_INTERNAL_STATE_T *state) {
         
         //when initialised, return.
         if (state->pll_initialised)
             return;
-        FlashCamPLL::_state = state;
         
         //clear pll-state
-        clearPLLstate();
-        FlashCamPLL::_state->pll_active                = false;
-        FlashCamPLL::_state->pll_active                = false;
-        FlashCamPLL::_state->pll_initialised           = false;
+        clearPLLstate(state);
+        state->pll_active.store(false, std::memory_order_seq_cst);
+        state->pll_initialised           = false;
         
         // Check if we have root access.. otherwise system will crash!
         if (getuid()) {
@@ -118,28 +120,41 @@ namespace FlashCamPLL {
         }
         
         // Set pin-functions
-        pinMode( PLL_PIN, PWM_OUTPUT );
-        resetGPIO();
+        if (_pin_owner.load() == NULL)
+            pinMode( PLL_PIN, PWM_OUTPUT );
+        resetGPIO(state);
 
         //initialised successfully
-        FlashCamPLL::_state->pll_initialised = true;        
+        state->pll_initialised = true;        
+    }
+
+    void destroy(FLASHCAM_INTERNAL_STATE_T *state) {
+        resetGPIO(state);
+        releasePin(state);
+        state->pll_initialised = false;        
+    }
+
+    void resetGPIO(FLASHCAM_INTERNAL_STATE_T *state){
+        FLASHCAM_INTERNAL_STATE_T *owner = _pin_owner.load();
+        if ((owner == NULL) || (owner == state))
+            pwmWrite(PLL_PIN, 0);    
     }
 
-    void destroy() {
-        resetGPIO();
-        FlashCamPLL::_state->pll_initialised = false;        
+    bool claimPin(FLASHCAM_INTERNAL_STATE_T *state) {
+        FLASHCAM_INTERNAL_STATE_T *owner = NULL;
+        return _pin_owner.compare_exchange_strong(owner, state) || (owner == state);
     }
 
-    void resetGPIO(){
-        pwmWrite(PLL_PIN, 0);    
+    void releasePin(FLASHCAM_INTERNAL_STATE_T *state) {
+        FLASHCAM_INTERNAL_STATE_T *owner = state;
+        _pin_owner.compare_exchange_strong(owner, NULL);
     }
 
-    int update(uint64_t pts, bool *pll_state) {
-        //copy pointer to local var: increases readability!
-        FLASHCAM_INTERNAL_STATE_T *state = FlashCamPLL::_state;
+    int update(FLASHCAM_INTERNAL_STATE_T *state, uint64_t pts, bool *pll_state) {
         *pll_state = false;
         
-        if (state->settings->pll_enabled) {
+        //seq_cst: a callback entered after the fence of `stop` sees the PLL stopped
+        if (state->pll_active.load(std::memory_order_seq_cst)) {
             
     // TIMING UPDATES
             // get frametimings in GPU domain.
@@ -286,6 +301,7 @@ namespace FlashCamPLL {
 
             state->pll_last_error               = error;
             state->pll_last_error_us            = error_us;
+            FlashCamMetrics::pll(state->userdata->metrics, error_us);
 
             //fprintf(stdout, "%s: PLL error %" PRId64 " \n", __func__, error_us);
 
@@ -332,9 +348,7 @@ namespace FlashCamPLL {
         return FlashCamMMAL::mmal_to_int(MMAL_SUCCESS);
     }
 
-    int start() {
-        //copy pointer to local var: increases readability!
-        FLASHCAM_INTERNAL_STATE_T *state = FlashCamPLL::_state;
+    int start(FLASHCAM_INTERNAL_STATE_T *state) {
 
         //initialisation error?
         if (!state->pll_initialised) {
@@ -342,7 +356,7 @@ namespace FlashCamPLL {
             return 1;
         }
         
-        if (state->pll_active) {
+        if (state->pll_active.load(std::memory_order_seq_cst)) {
             fprintf(stderr, "%s: PLL already running\n", __func__);
             return 1;
         }
@@ -441,8 +455,14 @@ namespace FlashCamPLL {
             //
             // Therefore, pwm_clock = 2 is sufficient for PLL.
             
+            //claim pin: with multiple cameras only one can be phase-locked to the flash
+            if (!claimPin(state)) {
+                fprintf(stderr, "%s: PWM pin is driven by another FlashCam instance\n", __func__);
+                return 1;
+            }
+            
             //reset GPIO
-            resetGPIO();
+            resetGPIO(state);
             
             //reset FPS-tracker
             //for( int i=0; i<FPSREDUCER_MEASUREMENTS; i++)
@@ -452,7 +472,7 @@ namespace FlashCamPLL {
             //fpsreducer_prev  = 0;
             
             //reset PLL-paramaters
-            clearPLLstate();
+            clearPLLstate(state);
             
             // Setup PWM pin
             pinMode( PLL_PIN, PWM_OUTPUT );
@@ -544,7 +564,7 @@ namespace FlashCamPLL {
             state->pll_startinterval_gpu = tdiff - 111;
              
             // PLL is activated..
-            state->pll_active = true;
+            state->pll_active.store(true, std::memory_order_seq_cst);
             if ( state->settings->verbose ) {
                 //clock resolution
                 struct timespec tres;
@@ -568,9 +588,7 @@ namespace FlashCamPLL {
         return 0;
     }
 
-    int stop() {
-        //copy pointer to local var: increases readability!
-        FLASHCAM_INTERNAL_STATE_T *state = FlashCamPLL::_state;
+    int stop(FLASHCAM_INTERNAL_STATE_T *state) {
 
         //initialisation error?
         if (!state->pll_initialised) {
@@ -578,25 +596,24 @@ namespace FlashCamPLL {
             return 1;
         }
         
-        if (!state->pll_active) {
-            fprintf(stderr, "%s: PLL not running\n", __func__);
+        if (!state->pll_active.load(std::memory_order_seq_cst)) {
+            if (state->settings->pll_enabled)
+                fprintf(stderr, "%s: PLL not running\n", __func__);
             return 0;
         }
         
         if (state->settings->verbose)
             fprintf(stdout, "%s: stopping PLL..\n", __func__);
 
+        //reset active-flag first
+        // --> stops PLL-callback from processing new MMAL updates.
+        //     The update in progress is awaited by the caller (FlashCam::stopCapture).
+        state->pll_active.store(false, std::memory_order_seq_cst);
         //stop PWM
-        resetGPIO();
+        resetGPIO(state);
+        releasePin(state);
         //reset fps
         state->params->framerate = state->pll_framerate;
-        //reset active-flag
-        // --> stops PLL-callback from processing new MMAL updates
-        state->settings->pll_enabled = false;
-        state->pll_active = false;
-        
-        //wait for callback to process current update
-        usleep(1000000); //sleep 1s
         
         if ( state->settings->verbose )
             fprintf(stdout, "%s: Succes.\n", __func__);
@@ -604,9 +621,7 @@ namespace FlashCamPLL {
         return 0;
     }
 
-    void clearPLLstate() {
-        //copy pointer to local var: increases readability!
-        FLASHCAM_INTERNAL_STATE_T *state = FlashCamPLL::_state;
+    void clearPLLstate(FLASHCAM_INTERNAL_STATE_T *state) {
 
         for( int i=0; i<FLASHCAM_PLL_JITTER; i++) {
             state->pll_error[i] = 0;
@@ -668,7 +683,7 @@ namespace FlashCamPLL {
 
 int FlashCam::setPLLEnabled( unsigned int  enabled ) {    
     // Is camera active?
-    if (_state.pll_active) {
+    if (_state.pll_active.load(std::memory_order_relaxed)) {
         fprintf(stderr, "%s: Cannot change PLL-mode while camera is active\n", __func__);
         return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
     }
@@ -684,7 +699,7 @@ int FlashCam::getPLLEnabled( unsigned int *enabled ) {
 
 int FlashCam::setPLLPulseWidth( float  pulsewidth ){    
     // Is camera active?
-    if (_state.pll_active) {
+    if (_state.pll_active.load(std::memory_order_relaxed)) {
         fprintf(stderr, "%s: Cannot change PLL-pulsewidth while camera is active\n", __func__);
         return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
     }
@@ -702,7 +717,7 @@ int FlashCam::getPLLPulseWidth( float *pulsewidth ) {
 
 int FlashCam::setPLLDivider( unsigned int  divider ){    
     // Is camera active?
-    if (_state.pll_active) {
+    if (_state.pll_active.load(std::memory_order_relaxed)) {
         fprintf(stderr, "%s: Cannot change PLL-divider while camera is active\n", __func__);
         return FlashCamMMAL::mmal_to_int(MMAL_EINVAL);
     }
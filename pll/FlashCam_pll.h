@@ -43,17 +43,18 @@
 
 namespace FlashCamPLL {
 
-    //init/destroy PLL setup
+    //init/destroy PLL setup. All PLL state is kept in `state`, owned by the FlashCam instance.
+    //  The PWM pin is shared: when multiple instances exist, only one can run the PLL at a time.
     void init(FLASHCAM_INTERNAL_STATE_T *state);
-    void destroy();    
+    void destroy(FLASHCAM_INTERNAL_STATE_T *state);    
 
     //start/stop PLL mechanism. Functions are invoked when camera is started/stopped in FlashCam.
-    int start();
-    int stop();
+    int start(FLASHCAM_INTERNAL_STATE_T *state);
+    int stop(FLASHCAM_INTERNAL_STATE_T *state);
 
     // Update phase-lock computation. This function is called by FlashCam each time a frame is recieved
     //  The computation uses the internal-state structure to update the relevant lock-values
-    int update(uint64_t pts, bool *pll_state);
+    int update(FLASHCAM_INTERNAL_STATE_T *state, uint64_t pts, bool *pll_state);
 
     //settings..
     void getDefaultSettings( FLASHCAM_SETTINGS_T *settings );
@@ -0,0 +1,545 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_recorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Interval of warnings when the disk falls behind (us)
+#define FLASHCAM_RECORDER_WARN_INTERVAL 1000000
+
+namespace FlashCamRecorder {
+    
+    static size_t align(size_t size, size_t alignment) {
+        return ((size + alignment - 1) / alignment) * alignment;
+    }
+    
+    static unsigned char *record(FLASHCAM_RECORDER_T *recorder, unsigned int idx) {
+        return &recorder->slots[((size_t) (idx % recorder->size)) * recorder->header.record_size];
+    }
+    
+    static uint64_t monotonic_us() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+    }
+    
+    // Write `len` bytes at `offset`. When the file system refuses O_DIRECT, the recording continues buffered.
+    static int write(FLASHCAM_RECORDER_T *recorder, const unsigned char *data, size_t len, uint64_t offset) {
+        while (len) {
+            ssize_t n = pwrite(recorder->fd, data, len, offset);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+#ifdef O_DIRECT
+                if ((errno == EINVAL) && recorder->direct) {
+                    int flags = fcntl(recorder->fd, F_GETFL);
+                    if ((flags >= 0) && (fcntl(recorder->fd, F_SETFL, flags & ~O_DIRECT) == 0)) {
+                        recorder->direct = false;
+                        continue;
+                    }
+                    errno = EINVAL;
+                }
+#endif
+                return -1;
+            }
+            data   += n;
+            len    -= n;
+            offset += n;
+        }
+        return 0;
+    }
+    
+    // Add the written records [tail, tail + num) to the index. When the index cannot grow, the recording gets no footer.
+    static void indexRecords(FLASHCAM_RECORDER_T *recorder, unsigned int tail, unsigned int num, uint64_t offset) {
+        if (recorder->index_lost)
+            return;
+        
+        if (recorder->index_num + num > recorder->index_max) {
+            size_t max = recorder->index_max ? recorder->index_max : 1024;
+            while (max < recorder->index_num + num)
+                max *= 2;
+            FLASHCAM_RECORDER_INDEX_T *index = (FLASHCAM_RECORDER_INDEX_T*) realloc(recorder->index, max * sizeof(FLASHCAM_RECORDER_INDEX_T));
+            if (!index) {
+                fprintf(stderr, "%s: Cannot extend index, recording is closed without index.\n", __func__);
+                recorder->index_lost = true;
+                return;
+            }
+            recorder->index     = index;
+            recorder->index_max = max;
+        }
+        
+        for (unsigned int i=0; i<num; i++) {
+            const FLASHCAM_RECORDER_RECORD_T *rec = (const FLASHCAM_RECORDER_RECORD_T*) record(recorder, tail + i);
+            FLASHCAM_RECORDER_INDEX_T *entry = &(recorder->index[recorder->index_num++]);
+            entry->seq    = rec->seq;
+            entry->pts    = rec->pts;
+            entry->offset = offset + ((uint64_t) i) * recorder->header.record_size;
+        }
+    }
+    
+    // Append index and footer: the footer fills the last bytes of the final aligned block.
+    static int writeFooter(FLASHCAM_RECORDER_T *recorder) {
+        FLASHCAM_RECORDER_FOOTER_T footer = {};
+        memcpy(footer.magic, FLASHCAM_RECORDER_INDEX_MAGIC, sizeof(footer.magic));
+        footer.entries = recorder->index_num;
+        footer.offset  = recorder->offset;
+        
+        size_t len  = recorder->index_num * sizeof(FLASHCAM_RECORDER_INDEX_T);
+        size_t size = align(len + sizeof(footer), FLASHCAM_RECORDER_ALIGN);
+        void *block = NULL;
+        if (posix_memalign(&block, FLASHCAM_RECORDER_ALIGN, size))
+            return -1;
+        
+        memset(block, 0, size);
+        if (len)
+            memcpy(block, recorder->index, len);
+        memcpy(((unsigned char*) block) + size - sizeof(footer), &footer, sizeof(footer));
+        int error = write(recorder, (unsigned char*) block, size, recorder->offset);
+        free(block);
+        return error;
+    }
+    
+    //writer thread: appends published records to the file
+    static void *worker(void *arg) {
+        FLASHCAM_RECORDER_T *recorder = (FLASHCAM_RECORDER_T*) arg;
+        uint64_t warned   = 0;
+        uint64_t reported = 0;
+        
+        while (true) {
+            //wait for update
+            vcos_semaphore_wait(&(recorder->sem));
+            
+            unsigned int tail = recorder->tail.load(std::memory_order_relaxed);
+            unsigned int head = recorder->head.load(std::memory_order_acquire);
+            
+            while (tail != head) {
+                // consecutive records up to the end of the queue are written at once,
+                //  at most a quarter of the queue so records are released while the disk is slow
+                unsigned int num = head - tail;
+                if (num > recorder->size - (tail % recorder->size))
+                    num = recorder->size - (tail % recorder->size);
+                if (num > (recorder->size + 3) / 4)
+                    num = (recorder->size + 3) / 4;
+                size_t len = ((size_t) num) * recorder->header.record_size;
+                
+                if (!recorder->failed) {
+                    uint64_t start = monotonic_us();
+                    if (write(recorder, record(recorder, tail), len, recorder->offset)) {
+                        fprintf(stderr, "%s: Cannot write recording (%s), remaining frames are not recorded.\n", __func__, strerror(errno));
+                        recorder->failed = true;
+                    } else {
+                        uint64_t duration = monotonic_us() - start;
+                        if (duration > recorder->write_us_max.load(std::memory_order_relaxed))
+                            recorder->write_us_max.store(duration, std::memory_order_relaxed);
+                        indexRecords(recorder, tail, num, recorder->offset);
+                        recorder->offset += len;
+                        recorder->recorded.fetch_add(num, std::memory_order_relaxed);
+                    }
+                }
+                if (recorder->failed)
+                    recorder->dropped.fetch_add(num, std::memory_order_relaxed);
+                
+                //records can be reused by producer
+                tail += num;
+                recorder->tail.store(tail, std::memory_order_release);
+                head = recorder->head.load(std::memory_order_acquire);
+                
+                // Disk falls behind: queue half full or frames dropped since the last warning.
+                uint64_t dropped = recorder->dropped.load(std::memory_order_relaxed);
+                unsigned int queued = head - tail;
+                uint64_t t = monotonic_us();
+                if ((!recorder->failed) && ((dropped != reported) || (queued * 2 >= recorder->size)) && (t - warned >= FLASHCAM_RECORDER_WARN_INTERVAL)) {
+                    fprintf(stderr, "%s: Disk falls behind: %u of %u frames queued, %llu frames not recorded.\n", __func__, 
+                            queued, recorder->size, (unsigned long long) dropped);
+                    warned   = t;
+                    reported = dropped;
+                }
+            }
+            
+            // Stop when requested and all records are written.
+            if (recorder->stop.load(std::memory_order_acquire) && (tail == recorder->head.load(std::memory_order_acquire)))
+                break;
+        }
+        return NULL;
+    }
+    
+    int start(FLASHCAM_RECORDER_T *recorder, const char *path, unsigned int memory, unsigned int framesize, unsigned int width,
+              unsigned int height, unsigned int pitch, unsigned int planes, float framerate) {
+        VCOS_STATUS_T status;
+        
+        if (recorder->active) {
+            fprintf(stderr, "%s: Recorder is in use.\n", __func__);
+            return -1;
+        }
+        
+        //layout: header & records on O_DIRECT boundaries, frame data cache-line aligned
+        FLASHCAM_RECORDER_HEADER_T header = {};
+        memcpy(header.magic, FLASHCAM_RECORDER_MAGIC, sizeof(header.magic));
+        header.version      = FLASHCAM_RECORDER_VERSION;
+        header.header_size  = FLASHCAM_RECORDER_ALIGN;
+        header.data_offset  = align(sizeof(FLASHCAM_RECORDER_RECORD_T), 64);
+        header.record_size  = align(header.data_offset + framesize, FLASHCAM_RECORDER_ALIGN);
+        header.frame_size   = framesize;
+        header.width        = width;
+        header.height       = height;
+        header.pitch        = pitch;
+        header.planes       = planes;
+        header.framerate    = framerate;
+        
+        //bounded queue: as many records as fit in `memory`
+        unsigned int size = memory / header.record_size;
+        if (size < 2)
+            size = 2;
+        
+        // (re)allocate queue
+        if ((!recorder->slots) || (recorder->size != size) || (recorder->header.record_size != header.record_size)) {
+            destroy(recorder);
+            void *slots = NULL;
+            if (posix_memalign(&slots, FLASHCAM_RECORDER_ALIGN, ((size_t) size) * header.record_size)) {
+                fprintf(stderr, "%s: Cannot allocate recorder queue (%u x %u bytes)\n", __func__, size, header.record_size);
+                return -1;
+            }
+            //clear all: touches every page, so the camera callback does not fault and padding holds no stale data
+            memset(slots, 0, ((size_t) size) * header.record_size);
+            recorder->slots = (unsigned char*) slots;
+            recorder->size  = size;
+        }
+        recorder->header = header;
+        
+        //open recording, bypassing the page cache when possible
+        recorder->direct = false;
+        recorder->fd     = -1;
+#ifdef O_DIRECT
+        recorder->fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        recorder->direct = (recorder->fd >= 0);
+#endif
+        if (recorder->fd < 0)
+            recorder->fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (recorder->fd < 0) {
+            fprintf(stderr, "%s: Cannot create recording %s (%s)\n", __func__, path, strerror(errno));
+            return -1;
+        }
+        
+        //header: its own aligned block
+        void *block = NULL;
+        int   error = posix_memalign(&block, FLASHCAM_RECORDER_ALIGN, header.header_size);
+        if (!error) {
+            memset(block, 0, header.header_size);
+            memcpy(block, &header, sizeof(header));
+            error = write(recorder, (unsigned char*) block, header.header_size, 0);
+            free(block);
+        }
+        if (error) {
+            fprintf(stderr, "%s: Cannot write recording %s\n", __func__, path);
+            ::close(recorder->fd);
+            return -1;
+        }
+        
+        if (vcos_semaphore_create(&(recorder->sem), "FlashCam_recorder_sem", 0) != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to create semaphore", __func__);
+            ::close(recorder->fd);
+            return -1;
+        }
+        
+        //reset queue
+        recorder->head         = 0;
+        recorder->tail         = 0;
+        recorder->filling      = false;
+        recorder->offset       = header.header_size;
+        recorder->stop         = false;
+        recorder->failed       = false;
+        recorder->recorded     = 0;
+        recorder->dropped      = 0;
+        recorder->queued_max   = 0;
+        recorder->write_us_max = 0;
+        recorder->index_num    = 0;
+        recorder->index_lost   = false;
+        
+        //start writer thread
+        status = vcos_thread_create( &(recorder->thread), "FlashCamRecorder-writer", NULL, FlashCamRecorder::worker, recorder);
+        if (status != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to start `FlashCamRecorder-writer` (%d)", VCOS_FUNCTION, status);
+            vcos_semaphore_delete(&(recorder->sem));
+            ::close(recorder->fd);
+            return -1;
+        }
+        
+        recorder->active = true;
+        return 0;
+    }
+    
+    void stop(FLASHCAM_RECORDER_T *recorder) {
+        if (!recorder->active)
+            return;
+        
+        //notify writer we are done.
+        recorder->filling = false;
+        recorder->stop.store(true, std::memory_order_release);
+        vcos_semaphore_post(&(recorder->sem));
+        
+        //Wait for writer to write remaining records and terminate.
+        vcos_thread_join(&(recorder->thread), NULL);
+        vcos_semaphore_delete(&(recorder->sem));
+        
+        //close recording with its index
+        if ((!recorder->failed) && (!recorder->index_lost) && writeFooter(recorder))
+            fprintf(stderr, "%s: Cannot write index of recording (%s)\n", __func__, strerror(errno));
+        ::close(recorder->fd);
+        recorder->active = false;
+    }
+    
+    void destroy(FLASHCAM_RECORDER_T *recorder) {
+        stop(recorder);
+        
+        free(recorder->slots);
+        recorder->slots = NULL;
+        recorder->size  = 0;
+        
+        free(recorder->index);
+        recorder->index     = NULL;
+        recorder->index_num = 0;
+        recorder->index_max = 0;
+    }
+    
+    unsigned char* acquire(FLASHCAM_RECORDER_T *recorder) {
+        // record in progress is replaced
+        recorder->filling = false;
+        
+        unsigned int head = recorder->head.load(std::memory_order_relaxed);
+        unsigned int tail = recorder->tail.load(std::memory_order_acquire);
+        
+        // Full? Disk is too slow: frame is not recorded.
+        if ((head - tail) >= recorder->size) {
+            recorder->dropped.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        }
+        
+        recorder->filling = true;
+        return record(recorder, head) + recorder->header.data_offset;
+    }
+    
+    unsigned char* current(FLASHCAM_RECORDER_T *recorder) {
+        if (!recorder->filling)
+            return NULL;
+        return record(recorder, recorder->head.load(std::memory_order_relaxed)) + recorder->header.data_offset;
+    }
+    
+    void publish(FLASHCAM_RECORDER_T *recorder, uint64_t seq, uint64_t pts, bool pll_state, uint64_t host, uint32_t host_error) {
+        if (!recorder->filling)
+            return;
+        
+        unsigned int head = recorder->head.load(std::memory_order_relaxed);
+        FLASHCAM_RECORDER_RECORD_T *rec = (FLASHCAM_RECORDER_RECORD_T*) record(recorder, head);
+        rec->seq        = seq;
+        rec->pts        = pts;
+        rec->pll_state  = pll_state;
+        rec->host       = host;
+        rec->host_error = host_error;
+        
+        //hand over to writer
+        recorder->filling = false;
+        recorder->head.store(head + 1, std::memory_order_release);
+        vcos_semaphore_post(&(recorder->sem));
+        
+        unsigned int queued = head + 1 - recorder->tail.load(std::memory_order_relaxed);
+        if (queued > recorder->queued_max.load(std::memory_order_relaxed))
+            recorder->queued_max.store(queued, std::memory_order_relaxed);
+    }
+    
+    void cancel(FLASHCAM_RECORDER_T *recorder) {
+        recorder->filling = false;
+    }
+    
+    void stats(FLASHCAM_RECORDER_T *recorder, FLASHCAM_RECORDER_STATS_T *stats) {
+        stats->recorded     = recorder->recorded.load(std::memory_order_relaxed);
+        stats->dropped      = recorder->dropped.load(std::memory_order_relaxed);
+        stats->bytes        = stats->recorded * recorder->header.record_size;
+        unsigned int tail   = recorder->tail.load(std::memory_order_acquire);
+        stats->queued       = recorder->head.load(std::memory_order_acquire) - tail;
+        stats->queued_max   = recorder->queued_max.load(std::memory_order_relaxed);
+        stats->slots        = recorder->size;
+        stats->write_us_max = recorder->write_us_max.load(std::memory_order_relaxed);
+        stats->direct       = recorder->direct.load(std::memory_order_relaxed);
+    }
+    
+    int open(FLASHCAM_RECORDING_T *recording, const char *path) {
+        struct stat st;
+        *recording = {};
+        
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "%s: Cannot open recording %s (%s)\n", __func__, path, strerror(errno));
+            return -1;
+        }
+        
+        void *map = MAP_FAILED;
+        if ((fstat(fd, &st) == 0) && (st.st_size >= (off_t) sizeof(FLASHCAM_RECORDER_HEADER_T)) && ((uint64_t) st.st_size <= SIZE_MAX))
+            map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "%s: Cannot map recording %s\n", __func__, path);
+            return -1;
+        }
+        recording->map    = (const unsigned char*) map;
+        recording->size   = st.st_size;
+        recording->header = (const FLASHCAM_RECORDER_HEADER_T*) map;
+        
+        const FLASHCAM_RECORDER_HEADER_T *header = recording->header;
+        if (memcmp(header->magic, FLASHCAM_RECORDER_MAGIC, sizeof(header->magic)) || (header->version != FLASHCAM_RECORDER_VERSION) ||
+            (header->header_size > recording->size) || (header->record_size < header->data_offset + header->frame_size) ||
+            (header->data_offset < sizeof(FLASHCAM_RECORDER_RECORD_T))) {
+            fprintf(stderr, "%s: %s is not a recording of this version\n", __func__, path);
+            close(recording);
+            return -1;
+        }
+        
+        //closed recording: index from footer, its records lie between header and index
+        uint64_t end = recording->size;
+        const FLASHCAM_RECORDER_FOOTER_T *footer = (const FLASHCAM_RECORDER_FOOTER_T*) &recording->map[recording->size - sizeof(FLASHCAM_RECORDER_FOOTER_T)];
+        if ((recording->size >= header->header_size + sizeof(FLASHCAM_RECORDER_FOOTER_T)) &&
+            (memcmp(footer->magic, FLASHCAM_RECORDER_INDEX_MAGIC, sizeof(footer->magic)) == 0) && (footer->offset >= header->header_size) &&
+            (footer->offset <= recording->size - sizeof(FLASHCAM_RECORDER_FOOTER_T)) &&
+            (footer->entries <= (recording->size - sizeof(FLASHCAM_RECORDER_FOOTER_T) - footer->offset) / sizeof(FLASHCAM_RECORDER_INDEX_T))) {
+            const FLASHCAM_RECORDER_INDEX_T *index = (const FLASHCAM_RECORDER_INDEX_T*) &recording->map[footer->offset];
+            uint64_t i = 0;
+            while ((i < footer->entries) && (index[i].offset >= header->header_size) && (index[i].offset <= footer->offset) &&
+                   (footer->offset - index[i].offset >= header->record_size))
+                i++;
+            if (i == footer->entries) {
+                recording->index  = index;
+                recording->frames = footer->entries;
+                return 0;
+            }
+            fprintf(stderr, "%s: Index of %s is corrupt (entry %llu), rebuilding it\n", __func__, path, (unsigned long long) i);
+            end = footer->offset;
+        }
+        
+        //not closed (or corrupt index): index of the complete records
+        uint64_t frames = (end - header->header_size) / header->record_size;
+        recording->rebuilt = (FLASHCAM_RECORDER_INDEX_T*) malloc((frames ? frames : 1) * sizeof(FLASHCAM_RECORDER_INDEX_T));
+        if (!recording->rebuilt) {
+            fprintf(stderr, "%s: Cannot allocate index of %s (%llu frames)\n", __func__, path, (unsigned long long) frames);
+            close(recording);
+            return -1;
+        }
+        for (uint64_t i=0; i<frames; i++) {
+            uint64_t offset = header->header_size + i * header->record_size;
+            const FLASHCAM_RECORDER_RECORD_T *rec = (const FLASHCAM_RECORDER_RECORD_T*) &recording->map[offset];
+            recording->rebuilt[i].seq    = rec->seq;
+            recording->rebuilt[i].pts    = rec->pts;
+            recording->rebuilt[i].offset = offset;
+        }
+        recording->index  = recording->rebuilt;
+        recording->frames = frames;
+        return 0;
+    }
+    
+    void close(FLASHCAM_RECORDING_T *recording) {
+        if (recording->map)
+            munmap((void*) recording->map, recording->size);
+        free(recording->rebuilt);
+        *recording = {};
+    }
+    
+    const FLASHCAM_RECORDER_RECORD_T *frame(const FLASHCAM_RECORDING_T *recording, uint64_t idx, FLASHCAM_FRAME_VIEW_T *view) {
+        if (idx >= recording->frames)
+            return NULL;
+        
+        const FLASHCAM_RECORDER_HEADER_T *header = recording->header;
+        const unsigned char *rec = &recording->map[recording->index[idx].offset];
+        
+        if (view) {
+            //planes of the first region, in order and back to back
+            const unsigned char *plane = rec + header->data_offset;
+            for (unsigned int p=0; p<3; p++) {
+                unsigned int pitch  = (p == 0) ? header->pitch  : (header->pitch  >> 1);
+                unsigned int height = (p == 0) ? header->height : (header->height >> 1);
+                view->data[p]   = NULL;
+                view->stride[p] = pitch;
+                if (header->planes & (1 << p)) {
+                    view->data[p] = (unsigned char*) plane;
+                    plane        += pitch * height;
+                }
+            }
+            const FLASHCAM_RECORDER_RECORD_T *r = (const FLASHCAM_RECORDER_RECORD_T*) rec;
+            view->width      = header->width;
+            view->height     = header->height;
+            view->pts        = r->pts;
+            view->pll_state  = r->pll_state;
+            view->host       = r->host;
+            view->host_error = r->host_error;
+            view->port       = NULL;
+            view->buffer     = NULL;
+            view->arrival    = 0;
+        }
+        return (const FLASHCAM_RECORDER_RECORD_T*) rec;
+    }
+    
+    uint64_t findPts(const FLASHCAM_RECORDING_T *recording, uint64_t pts) {
+        uint64_t lo = 0, hi = recording->frames;
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (recording->index[mid].pts < pts)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+    
+    uint64_t findSeq(const FLASHCAM_RECORDING_T *recording, uint64_t seq) {
+        uint64_t lo = 0, hi = recording->frames;
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (recording->index[mid].seq < seq)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+}
@@ -0,0 +1,82 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_recorder_h
+#define FlashCam_recorder_h
+
+#include "FlashCam_types.h"
+
+namespace FlashCamRecorder {
+    
+    // Create recording `path` and start the writer thread. The queue holds as many records as fit in `memory` bytes
+    //  (at least 2), its memory is kept across recordings of the same layout.
+    int start(FLASHCAM_RECORDER_T *recorder, const char *path, unsigned int memory, unsigned int framesize, unsigned int width,
+              unsigned int height, unsigned int pitch, unsigned int planes, float framerate);
+    // Write all queued records and close the recording.
+    void stop(FLASHCAM_RECORDER_T *recorder);
+    // Stop and free the queue.
+    void destroy(FLASHCAM_RECORDER_T *recorder);
+    
+    //producer (camera callback) functions. These never block.
+    // - acquire : claim a record for a new frame. Returns NULL when the queue is full (disk behind: frame not recorded).
+    // - current : frame of the record in progress, NULL if none is claimed.
+    // - publish : hand the record in progress to the writer. `host` is `pts` in CLOCK_MONOTONIC (0: unknown).
+    // - cancel  : drop the record in progress.
+    unsigned char* acquire(FLASHCAM_RECORDER_T *recorder);
+    unsigned char* current(FLASHCAM_RECORDER_T *recorder);
+    void publish(FLASHCAM_RECORDER_T *recorder, uint64_t seq, uint64_t pts, bool pll_state, uint64_t host, uint32_t host_error);
+    void cancel(FLASHCAM_RECORDER_T *recorder);
+    
+    // progress of the current (or last) recording
+    void stats(FLASHCAM_RECORDER_T *recorder, FLASHCAM_RECORDER_STATS_T *stats);
+    
+    //reader (offline analysis)
+    // - open    : map recording `path` read-only. Its index is taken from the footer, or rebuilt from the records when the
+    //             recording was not closed or an entry points outside the records. On 32-bit systems the recording should
+    //             fit in the address space.
+    // - frame   : frame `idx` (0 .. frames - 1) in place: its record (seq, pts, pll_state, host) and, optionally, a view on its
+    //             planes (first region; planes not recorded are NULL). NULL when `idx` is out of range.
+    // - findPts : first frame with a timestamp at or after `pts` (binary search), `frames` when none.
+    // - findSeq : first frame with a sequence number at or after `seq` (binary search), `frames` when none.
+    int open(FLASHCAM_RECORDING_T *recording, const char *path);
+    void close(FLASHCAM_RECORDING_T *recording);
+    const FLASHCAM_RECORDER_RECORD_T *frame(const FLASHCAM_RECORDING_T *recording, uint64_t idx, FLASHCAM_FRAME_VIEW_T *view);
+    uint64_t findPts(const FLASHCAM_RECORDING_T *recording, uint64_t pts);
+    uint64_t findSeq(const FLASHCAM_RECORDING_T *recording, uint64_t seq);
+}
+
+#endif /* FlashCam_recorder_h */
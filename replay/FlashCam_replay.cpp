@@ -0,0 +1,208 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_replay.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace FlashCamReplay {
+    
+    static uint64_t monotonic_us() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+    }
+    
+    //replay thread: reads buffers and passes these to the camera callback
+    static void *worker(void *arg) {
+        FLASHCAM_REPLAY_T *replay = (FLASHCAM_REPLAY_T*) arg;
+        FLASHCAM_REPLAY_RECORD_T record;
+        uint64_t first_pts  = 0;
+        uint64_t first_time = 0;
+        
+        while (!replay->stop.load(std::memory_order_acquire)) {
+            if (fread(&record, sizeof(record), 1, replay->replay) != 1)
+                break;
+            
+            //wait for a free buffer; buffers are returned when FlashCam or user release them
+            MMAL_BUFFER_HEADER_T *buffer = NULL;
+            while (!buffer && !replay->stop.load(std::memory_order_acquire))
+                buffer = mmal_queue_timedwait(replay->pool->queue, 100);
+            if (!buffer)
+                break;
+            
+            if ((record.length > buffer->alloc_size) || (fread(buffer->data, 1, record.length, replay->replay) != record.length)) {
+                fprintf(stderr, "%s: Corrupt or truncated recording.\n", __func__);
+                mmal_buffer_header_release(buffer);
+                break;
+            }
+            buffer->length = record.length;
+            buffer->offset = 0;
+            buffer->pts    = record.pts;
+            buffer->flags  = record.flags;
+            
+            // original cadence: delay buffer by its recorded timestamp
+            if ((replay->mode == FLASHCAM_REPLAY_CADENCE) && (record.pts != (uint64_t) MMAL_TIME_UNKNOWN)) {
+                if (first_time == 0) {
+                    first_pts  = record.pts;
+                    first_time = monotonic_us();
+                }
+                uint64_t due = first_time + (record.pts - first_pts);
+                uint64_t now;
+                while (((now = monotonic_us()) < due) && !replay->stop.load(std::memory_order_acquire))
+                    usleep((due - now > 10000) ? 10000 : (due - now));
+            }
+            
+            replay->callback(&(replay->port), buffer);
+        }
+        
+        return NULL;
+    }
+    
+    int startRecord(FLASHCAM_REPLAY_T *replay, const char *path, const FLASHCAM_REPLAY_HEADER_T *header) {
+        stopRecord(replay);
+        
+        replay->record = fopen(path, "wb");
+        if (!replay->record) {
+            fprintf(stderr, "%s: Cannot open recording `%s`.\n", __func__, path);
+            return -1;
+        }
+        
+        FLASHCAM_REPLAY_HEADER_T h = *header;
+        memcpy(h.magic, FLASHCAM_REPLAY_MAGIC, sizeof(h.magic));
+        h.version = FLASHCAM_REPLAY_VERSION;
+        if (fwrite(&h, sizeof(h), 1, replay->record) != 1) {
+            fprintf(stderr, "%s: Cannot write recording `%s`.\n", __func__, path);
+            stopRecord(replay);
+            return -1;
+        }
+        return 0;
+    }
+    
+    void stopRecord(FLASHCAM_REPLAY_T *replay) {
+        if (replay->record)
+            fclose(replay->record);
+        replay->record = NULL;
+    }
+    
+    void write(FLASHCAM_REPLAY_T *replay, MMAL_BUFFER_HEADER_T *buffer) {
+        FLASHCAM_REPLAY_RECORD_T record;
+        record.pts    = buffer->pts;
+        record.flags  = buffer->flags;
+        record.length = buffer->length;
+        
+        mmal_buffer_header_mem_lock(buffer);
+        if ((fwrite(&record, sizeof(record), 1, replay->record) != 1) ||
+            (fwrite(&buffer->data[buffer->offset], 1, buffer->length, replay->record) != buffer->length)) {
+            fprintf(stderr, "%s: Cannot write recording, stopped.\n", __func__);
+            stopRecord(replay);
+        }
+        mmal_buffer_header_mem_unlock(buffer);
+    }
+    
+    int start(FLASHCAM_REPLAY_T *replay, const char *path, FLASHCAM_REPLAY_MODE_T mode, const FLASHCAM_REPLAY_HEADER_T *header,
+              MMAL_PORT_BH_CB_T callback, FLASHCAM_PORT_USERDATA_T *userdata, unsigned int num) {
+        VCOS_STATUS_T status;
+        
+        if (replay->active)
+            return -1;
+        
+        replay->replay = fopen(path, "rb");
+        if (!replay->replay) {
+            fprintf(stderr, "%s: Cannot open recording `%s`.\n", __func__, path);
+            return -1;
+        }
+        
+        // Same layout as the camera stream?
+        FLASHCAM_REPLAY_HEADER_T *h = &(replay->header);
+        if ((fread(h, sizeof(*h), 1, replay->replay) != 1) ||
+            (memcmp(h->magic, FLASHCAM_REPLAY_MAGIC, sizeof(h->magic))) || (h->version != FLASHCAM_REPLAY_VERSION)) {
+            fprintf(stderr, "%s: `%s` is not a recording.\n", __func__, path);
+            stop(replay);
+            return -1;
+        }
+        if ((h->width != header->width) || (h->height != header->height) || (h->stride != header->stride) || (h->slice_height != header->slice_height)) {
+            fprintf(stderr, "%s: Recording of %ux%u (stride %u, slice height %u) does not match camera.\n", __func__, h->width, h->height, h->stride, h->slice_height);
+            stop(replay);
+            return -1;
+        }
+        
+        replay->pool = mmal_pool_create(num, h->buffer_size);
+        if (!replay->pool) {
+            vcos_log_error("%s: Failed to create replay pool", __func__);
+            stop(replay);
+            return -1;
+        }
+        
+        memset(&(replay->port), 0, sizeof(replay->port));
+        replay->port.userdata = (struct MMAL_PORT_USERDATA_T *) userdata;
+        replay->port.buffer_num = num;
+        replay->mode     = mode;
+        replay->callback = callback;
+        replay->stop     = false;
+        
+        // active before the first buffer is delivered
+        replay->active = true;
+        status = vcos_thread_create( &(replay->thread), "FlashCamReplay-worker", NULL, FlashCamReplay::worker, replay);
+        if (status != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to start `FlashCamReplay-worker` (%d)", VCOS_FUNCTION, status);
+            replay->active = false;
+            stop(replay);
+            return -1;
+        }
+        return 0;
+    }
+    
+    void stop(FLASHCAM_REPLAY_T *replay) {
+        if (replay->active) {
+            replay->stop.store(true, std::memory_order_release);
+            vcos_thread_join(&(replay->thread), NULL);
+            replay->active = false;
+        }
+        
+        // all buffers should be released (frames delivered, views released)
+        if (replay->pool)
+            mmal_pool_destroy(replay->pool);
+        if (replay->replay)
+            fclose(replay->replay);
+        replay->pool   = NULL;
+        replay->replay = NULL;
+    }
+}
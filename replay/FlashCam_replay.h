@@ -0,0 +1,60 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_replay_h
+#define FlashCam_replay_h
+
+
+#include "FlashCam_types.h"
+
+namespace FlashCamReplay {
+    
+    // Recording: open `path` and write the stream layout of `header`; close. 
+    int  startRecord(FLASHCAM_REPLAY_T *replay, const char *path, const FLASHCAM_REPLAY_HEADER_T *header);
+    void stopRecord(FLASHCAM_REPLAY_T *replay);
+    
+    // Append a camera buffer to the recording (camera callback).
+    void write(FLASHCAM_REPLAY_T *replay, MMAL_BUFFER_HEADER_T *buffer);
+    
+    // Replay: open `path`, which should match the stream layout of `header`, and feed its buffers into `callback`.
+    //  `userdata` is set as userdata of the replay port, `num` buffers are used.
+    int  start(FLASHCAM_REPLAY_T *replay, const char *path, FLASHCAM_REPLAY_MODE_T mode, const FLASHCAM_REPLAY_HEADER_T *header,
+               MMAL_PORT_BH_CB_T callback, FLASHCAM_PORT_USERDATA_T *userdata, unsigned int num);
+    void stop(FLASHCAM_REPLAY_T *replay);
+}
+
+#endif /* FlashCam_replay_h */
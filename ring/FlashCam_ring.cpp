@@ -0,0 +1,222 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_ring.h"
+
+#include "FlashCam_trace.h"
+#include "FlashCam_sched.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace FlashCamRing {
+    
+    //consumer thread: delivers published frames to the user
+    static void *worker(void *arg) {
+        FLASHCAM_RING_T *ring = (FLASHCAM_RING_T*) arg;
+        FLASHCAM_SCHED_WAKE_T last = {};
+        
+        FlashCamSched::enter(ring->sched, FLASHCAM_THREAD_WORKER, "ring");
+        
+        while (true) {
+            //wait for update
+            vcos_semaphore_wait(&(ring->sem));
+            
+            // deliver all published frames
+            unsigned int tail = ring->tail.load(std::memory_order_relaxed);
+            unsigned int head = ring->head.load(std::memory_order_acquire);
+            
+            for (; tail != head; tail++) {
+                FLASHCAM_FRAME_T *slot = &(ring->slots[tail % ring->size]);
+                
+                FlashCamSched::wake(ring->sched, FLASHCAM_THREAD_WORKER, &last, slot->pts);
+                slot->stamps.entry = FlashCamTrace::now(ring->trace);
+                if (ring->callback)
+                    ring->callback(slot->data, ring->width, ring->height);
+                slot->stamps.exit  = FlashCamTrace::now(ring->trace);
+                FlashCamTrace::record(ring->trace, &(slot->stamps));
+                ring->stats->frames.fetch_add(1, std::memory_order_relaxed);
+                
+                //slot can be reused by producer
+                ring->tail.store(tail + 1, std::memory_order_release);
+            }
+            
+            // Stop when requested and all frames are delivered.
+            if (ring->stop.load(std::memory_order_acquire) && (tail == ring->head.load(std::memory_order_acquire)))
+                break;
+        }
+        return NULL;
+    }
+    
+    int init(FLASHCAM_RING_T *ring, unsigned int size, unsigned int framesize, unsigned char *data) {
+        if (ring->active) {
+            fprintf(stderr, "%s: Cannot resize ring while it is in use.\n", __func__);
+            return -1;
+        }
+        
+        if (size < 2) {
+            fprintf(stderr, "%s: Ring requires at least 2 slots (%d).\n", __func__, size);
+            return -1;
+        }
+        
+        // Nothing changed?
+        if (ring->slots && (ring->size == size) && (ring->framesize == framesize) && (ring->slots[0].data == data))
+            return 0;
+        
+        destroy(ring);
+        
+        if (vcos_semaphore_create(&(ring->sem), "FlashCam_ring_sem", 0) != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to create semaphore", __func__);
+            return -1;
+        }
+        
+        ring->slots = new FLASHCAM_FRAME_T[size]();
+        for (unsigned int i=0; i<size; i++)
+            ring->slots[i].data = &data[((size_t) i) * framesize];
+        
+        ring->size      = size;
+        ring->framesize = framesize;
+        ring->head      = 0;
+        ring->tail      = 0;
+        ring->filling   = false;
+        ring->seq       = 0;
+        return 0;
+    }
+    
+    void destroy(FLASHCAM_RING_T *ring) {
+        stop(ring);
+        
+        if (ring->slots) {
+            delete[] ring->slots;
+            vcos_semaphore_delete(&(ring->sem));
+        }
+        ring->slots     = NULL;
+        ring->size      = 0;
+        ring->framesize = 0;
+    }
+    
+    int start(FLASHCAM_RING_T *ring, FLASHCAM_CALLBACK_T callback, unsigned int width, unsigned int height, FLASHCAM_COUNTERS_T *stats, FLASHCAM_TRACE_T *trace, FLASHCAM_SCHED_T *sched) {
+        VCOS_STATUS_T status;
+        
+        if (!ring->slots || ring->active)
+            return -1;
+        
+        //reset ring
+        while (vcos_semaphore_trywait(&(ring->sem)) != VCOS_EAGAIN);
+        ring->head      = 0;
+        ring->tail      = 0;
+        ring->filling   = false;
+        ring->stop      = false;
+        ring->callback  = callback;
+        ring->width     = width;
+        ring->height    = height;
+        ring->stats     = stats;
+        ring->trace     = trace;
+        ring->sched     = sched;
+        
+        //start consumer thread
+        status = vcos_thread_create( &(ring->thread), "FlashCamRing-worker", NULL, FlashCamRing::worker, ring);
+        if (status != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to start `FlashCamRing-worker` (%d)", VCOS_FUNCTION, status);
+            return -1;
+        }
+        
+        ring->active = true;
+        return 0;
+    }
+    
+    void stop(FLASHCAM_RING_T *ring) {
+        if (!ring->active)
+            return;
+        
+        //notify worker we are done.
+        ring->stop.store(true, std::memory_order_release);
+        vcos_semaphore_post(&(ring->sem));
+        
+        //Wait for worker to deliver remaining frames and terminate.
+        vcos_thread_join(&(ring->thread), NULL);
+        ring->active = false;
+    }
+    
+    unsigned char* acquire(FLASHCAM_RING_T *ring) {
+        // frame in progress is replaced
+        ring->filling = false;
+        
+        unsigned int head = ring->head.load(std::memory_order_relaxed);
+        unsigned int tail = ring->tail.load(std::memory_order_acquire);
+        
+        // Full? Consumer is too slow: drop frame.
+        if ((head - tail) >= ring->size) {
+            ring->stats->overruns.fetch_add(1, std::memory_order_relaxed);
+            ring->seq++;
+            return NULL;
+        }
+        
+        ring->filling = true;
+        return ring->slots[head % ring->size].data;
+    }
+    
+    unsigned char* current(FLASHCAM_RING_T *ring) {
+        if (!ring->filling)
+            return NULL;
+        return ring->slots[ring->head.load(std::memory_order_relaxed) % ring->size].data;
+    }
+    
+    unsigned int publish(FLASHCAM_RING_T *ring, uint64_t pts, bool pll_state, const FLASHCAM_TRACE_STAMPS_T *stamps) {
+        if (!ring->filling)
+            return 1;
+        
+        unsigned int head = ring->head.load(std::memory_order_relaxed);
+        FLASHCAM_FRAME_T *slot = &(ring->slots[head % ring->size]);
+        slot->pts       = pts;
+        slot->pll_state = pll_state;
+        slot->seq       = ring->seq++;
+        slot->stamps    = *stamps;
+        
+        //hand over to consumer
+        ring->filling = false;
+        ring->head.store(head + 1, std::memory_order_release);
+        vcos_semaphore_post(&(ring->sem));
+        return 0;
+    }
+    
+    void cancel(FLASHCAM_RING_T *ring) {
+        if (ring->filling)
+            ring->seq++;
+        ring->filling = false;
+    }
+}
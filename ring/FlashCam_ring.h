@@ -0,0 +1,64 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_ring_h
+#define FlashCam_ring_h
+
+#include "FlashCam_types.h"
+
+namespace FlashCamRing {
+    
+    // (re)allocate ring with `size` slots of `framesize` bytes, laid out in `data` (owned by the caller). Ring must be stopped.
+    int init(FLASHCAM_RING_T *ring, unsigned int size, unsigned int framesize, unsigned char *data);
+    void destroy(FLASHCAM_RING_T *ring);
+    
+    // start/stop consumer thread. Stopping delivers all published frames before returning.
+    int start(FLASHCAM_RING_T *ring, FLASHCAM_CALLBACK_T callback, unsigned int width, unsigned int height, FLASHCAM_COUNTERS_T *stats, FLASHCAM_TRACE_T *trace, FLASHCAM_SCHED_T *sched);
+    void stop(FLASHCAM_RING_T *ring);
+    
+    //producer (camera callback) functions. These never block.
+    // - acquire : claim the next slot for a new frame. Returns NULL when the ring is full (overrun).
+    // - current : slot of the frame in progress, NULL if none is claimed.
+    // - publish : hand the frame in progress to the consumer. Returns the number of frames dropped (overrun: 1).
+    // - cancel  : drop the frame in progress.
+    unsigned char* acquire(FLASHCAM_RING_T *ring);
+    unsigned char* current(FLASHCAM_RING_T *ring);
+    unsigned int publish(FLASHCAM_RING_T *ring, uint64_t pts, bool pll_state, const FLASHCAM_TRACE_STAMPS_T *stamps);
+    void cancel(FLASHCAM_RING_T *ring);
+}
+
+#endif /* FlashCam_ring_h */
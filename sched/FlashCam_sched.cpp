@@ -0,0 +1,138 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_sched.h"
+
+#include "FlashCam_trace.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace FlashCamSched {
+    
+    static uint64_t monotonic_us() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+    }
+    
+    int check(const FLASHCAM_SCHED_PARAMS_T *params) {
+        int max = sched_get_priority_max(SCHED_FIFO);
+        if ((params->priority < 0) || (params->priority > max)) {
+            fprintf(stderr, "%s: Priority should be 0 (default policy) or 1 to %d (%d)\n", __func__, max, params->priority);
+            return -1;
+        }
+        return 0;
+    }
+    
+    int apply(const FLASHCAM_SCHED_PARAMS_T *params, const char *name) {
+        int result = 0, error;
+        
+        struct sched_param param = {};
+        param.sched_priority = params->priority;
+        if ((error = pthread_setschedparam(pthread_self(), params->priority ? SCHED_FIFO : SCHED_OTHER, &param))) {
+            fprintf(stderr, "%s: Cannot set SCHED_FIFO priority %d of %s thread (%s)\n", __func__, params->priority, name, strerror(error));
+            result = -1;
+        }
+        
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        long cpus = sysconf(_SC_NPROCESSORS_CONF);
+        for (long i=0; (i < cpus) && (i < CPU_SETSIZE); i++)
+            if ((!params->cpus) || ((i < 32) && (params->cpus & (1u << i))))
+                CPU_SET(i, &set);
+        if ((error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set))) {
+            fprintf(stderr, "%s: Cannot set CPU affinity 0x%x of %s thread (%s)\n", __func__, params->cpus, name, strerror(error));
+            result = -1;
+        }
+        return result;
+    }
+    
+    void enter(FLASHCAM_SCHED_T *sched, FLASHCAM_THREAD_T thread, const char *name) {
+        const FLASHCAM_SCHED_PARAMS_T *params = &(sched->params[thread]);
+        
+        // new thread: nothing to undo
+        if (params->priority || params->cpus)
+            apply(params, name);
+    }
+    
+    void callback(FLASHCAM_SCHED_T *sched) {
+        const FLASHCAM_SCHED_PARAMS_T *params  = &(sched->params[FLASHCAM_THREAD_CALLBACK]);
+        const FLASHCAM_SCHED_PARAMS_T *applied = &(sched->callback_applied);
+        pthread_t self = pthread_self();
+        
+        // settings changed (also back to default), or another MMAL thread with settings
+        bool changed = (params->priority != applied->priority) || (params->cpus != applied->cpus);
+        bool other   = (params->priority || params->cpus) && !pthread_equal(self, sched->callback_thread);
+        if (!changed && !other)
+            return;
+        
+        apply(params, "callback");
+        sched->callback_applied = *params;
+        sched->callback_thread  = self;
+    }
+    
+    void wake(FLASHCAM_SCHED_T *sched, FLASHCAM_THREAD_T thread, FLASHCAM_SCHED_WAKE_T *last, uint64_t pts) {
+        if ((pts == 0) || (pts == (uint64_t) MMAL_TIME_UNKNOWN) || (pts == last->pts))
+            return;
+        
+        uint64_t now = monotonic_us();
+        if (last->pts && (pts > last->pts)) {
+            int64_t jitter = ((int64_t) (now - last->wake)) - ((int64_t) (pts - last->pts));
+            FlashCamTrace::sample(&(sched->jitter[thread]), (uint64_t) ((jitter < 0) ? -jitter : jitter));
+        }
+        last->wake = now;
+        last->pts  = pts;
+    }
+    
+    int get(FLASHCAM_SCHED_T *sched, FLASHCAM_THREAD_T thread, FLASHCAM_HISTOGRAM_T *hist) {
+        if ((thread < 0) || (thread >= FLASHCAM_THREADS)) {
+            fprintf(stderr, "%s: Unknown thread (%d)\n", __func__, thread);
+            return -1;
+        }
+        FlashCamTrace::copy(&(sched->jitter[thread]), hist);
+        return 0;
+    }
+    
+    void reset(FLASHCAM_SCHED_T *sched) {
+        for (unsigned int t=0; t<FLASHCAM_THREADS; t++)
+            FlashCamTrace::clear(&(sched->jitter[t]));
+    }
+}
@@ -0,0 +1,68 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_sched_h
+#define FlashCam_sched_h
+
+#include "FlashCam_types.h"
+
+namespace FlashCamSched {
+    
+    // Check scheduling settings: priority within SCHED_FIFO range (or 0). Returns -1 when invalid.
+    int check(const FLASHCAM_SCHED_PARAMS_T *params);
+    
+    // Take on the scheduling of `params` in the calling thread; without priority/CPUs the default policy and all CPUs.
+    //  Returns -1 when (part of) it is not permitted (e.g. SCHED_FIFO without CAP_SYS_NICE / RLIMIT_RTPRIO).
+    int apply(const FLASHCAM_SCHED_PARAMS_T *params, const char *name);
+    
+    // Called by a worker when it starts: takes on the scheduling of `thread`, if set.
+    void enter(FLASHCAM_SCHED_T *sched, FLASHCAM_THREAD_T thread, const char *name);
+    
+    // Called by the camera callback: (re)applies the scheduling of FLASHCAM_THREAD_CALLBACK when the settings or the
+    //  MMAL thread changed. Costs a comparison otherwise.
+    void callback(FLASHCAM_SCHED_T *sched);
+    
+    // A thread starts on the frame with timestamp `pts` (us): adds its wake-up jitter. `last` holds the previous frame
+    //  of this thread. Frames without timestamp, or of the same timestamp (slices), are skipped.
+    void wake(FLASHCAM_SCHED_T *sched, FLASHCAM_THREAD_T thread, FLASHCAM_SCHED_WAKE_T *last, uint64_t pts);
+    
+    // Copy jitter histogram of `thread`; clear all histograms.
+    int  get(FLASHCAM_SCHED_T *sched, FLASHCAM_THREAD_T thread, FLASHCAM_HISTOGRAM_T *hist);
+    void reset(FLASHCAM_SCHED_T *sched);
+}
+
+#endif /* FlashCam_sched_h */
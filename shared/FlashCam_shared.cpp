@@ -0,0 +1,251 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_shared.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace FlashCamShared {
+    
+    static size_t align(size_t size, size_t alignment) {
+        return ((size + alignment - 1) / alignment) * alignment;
+    }
+    
+    static FLASHCAM_SHARED_SLOT_T *slot(const FLASHCAM_SHARED_HEADER_T *header, uint64_t seq) {
+        return ((FLASHCAM_SHARED_SLOT_T*) (((char*) header) + header->header_size)) + (seq % header->slots);
+    }
+    
+    static unsigned char *data(const FLASHCAM_SHARED_HEADER_T *header, uint64_t seq) {
+        return ((unsigned char*) header) + header->data_offset + (seq % header->slots) * header->slot_size;
+    }
+    
+    static size_t size(const FLASHCAM_SHARED_HEADER_T *header) {
+        return header->data_offset + ((size_t) header->slots) * header->slot_size;
+    }
+    
+    static uint64_t monotonic_us() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+    }
+    
+    int init(FLASHCAM_SHARED_T *shared, const char *name, unsigned int slots, unsigned int framesize,
+             unsigned int width, unsigned int height, unsigned int pitch, unsigned int planes) {
+        size_t page = sysconf(_SC_PAGESIZE);
+        
+        if ((!name) || (strlen(name) >= sizeof(shared->name)) || (slots < 2)) {
+            fprintf(stderr, "%s: Invalid ring: %s (%u slots)\n", __func__, name ? name : "-", slots);
+            return -1;
+        }
+        
+        //same ring: keep it, readers stay attached
+        FLASHCAM_SHARED_HEADER_T *header = shared->header;
+        if (header && (strcmp(shared->name, name) == 0) && (header->slots == slots) && (header->frame_size == framesize) &&
+            (header->width == width) && (header->height == height) && (header->pitch == pitch) && (header->planes == planes)) {
+            cancel(shared);
+            return 0;
+        }
+        destroy(shared);
+        
+        //layout: header & slot descriptors, frames on page boundaries
+        FLASHCAM_SHARED_HEADER_T layout = {};
+        layout.header_size  = sizeof(FLASHCAM_SHARED_HEADER_T);
+        layout.slots        = slots;
+        layout.slot_size    = align(framesize, page);
+        layout.data_offset  = align(layout.header_size + slots * sizeof(FLASHCAM_SHARED_SLOT_T), page);
+        
+        int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "%s: Cannot create shared memory %s\n", __func__, name);
+            return -1;
+        }
+        
+        header = (FLASHCAM_SHARED_HEADER_T*) MAP_FAILED;
+        if (ftruncate(fd, size(&layout)) == 0)
+            header = (FLASHCAM_SHARED_HEADER_T*) mmap(NULL, size(&layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        
+        if (header == MAP_FAILED) {
+            fprintf(stderr, "%s: Cannot map shared memory %s (%zu bytes)\n", __func__, name, size(&layout));
+            shm_unlink(name);
+            return -1;
+        }
+        
+        //clear all: touches every page, so the camera callback does not fault
+        memset((void*) header, 0, size(&layout));
+        header->version     = FLASHCAM_SHARED_VERSION;
+        header->header_size = layout.header_size;
+        header->slots       = layout.slots;
+        header->slot_size   = layout.slot_size;
+        header->frame_size  = framesize;
+        header->data_offset = layout.data_offset;
+        header->width       = width;
+        header->height      = height;
+        header->pitch       = pitch;
+        header->planes      = planes;
+        header->head.store(0, std::memory_order_relaxed);
+        for (unsigned int i=0; i<layout.slots; i++)
+            slot(header, i)->seq.store(0, std::memory_order_relaxed);
+        //ring is valid
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(header->magic, FLASHCAM_SHARED_MAGIC, sizeof(header->magic));
+        
+        strcpy(shared->name, name);
+        shared->header  = header;
+        shared->size    = size(&layout);
+        shared->seq     = 1;
+        shared->filling = false;
+        return 0;
+    }
+    
+    void destroy(FLASHCAM_SHARED_T *shared) {
+        if (!shared->header)
+            return;
+        
+        //readers: ring is gone
+        memset(shared->header->magic, 0, sizeof(shared->header->magic));
+        munmap(shared->header, shared->size);
+        shm_unlink(shared->name);
+        
+        shared->header  = NULL;
+        shared->name[0] = '\0';
+        shared->filling = false;
+    }
+    
+    unsigned char* acquire(FLASHCAM_SHARED_T *shared) {
+        FLASHCAM_SHARED_SLOT_T *s = slot(shared->header, shared->seq);
+        
+        //readers of the previous frame in this slot fail validation from here on
+        s->seq.store(2 * shared->seq - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        
+        shared->filling = true;
+        return data(shared->header, shared->seq);
+    }
+    
+    unsigned char* current(FLASHCAM_SHARED_T *shared) {
+        return shared->filling ? data(shared->header, shared->seq) : NULL;
+    }
+    
+    void publish(FLASHCAM_SHARED_T *shared, uint64_t pts, bool pll_state, uint64_t host, uint32_t host_error) {
+        if (!shared->filling)
+            return;
+        
+        FLASHCAM_SHARED_SLOT_T *s = slot(shared->header, shared->seq);
+        s->pts        = pts;
+        s->time       = monotonic_us();
+        s->pll_state  = pll_state;
+        s->host       = host;
+        s->host_error = host_error;
+        s->seq.store(2 * shared->seq, std::memory_order_release);
+        shared->header->head.store(shared->seq, std::memory_order_release);
+        
+        shared->seq++;
+        shared->filling = false;
+    }
+    
+    void cancel(FLASHCAM_SHARED_T *shared) {
+        if (!shared->filling)
+            return;
+        
+        //slot is reused by the next frame
+        slot(shared->header, shared->seq)->seq.store(0, std::memory_order_release);
+        shared->filling = false;
+    }
+    
+    const FLASHCAM_SHARED_HEADER_T *attach(const char *name) {
+        struct stat st;
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0)
+            return NULL;
+        
+        void *header = MAP_FAILED;
+        if ((fstat(fd, &st) == 0) && (st.st_size >= (off_t) sizeof(FLASHCAM_SHARED_HEADER_T)))
+            header = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (header == MAP_FAILED)
+            return NULL;
+        
+        const FLASHCAM_SHARED_HEADER_T *h = (const FLASHCAM_SHARED_HEADER_T*) header;
+        if ((memcmp(h->magic, FLASHCAM_SHARED_MAGIC, sizeof(h->magic)) != 0) || (h->version != FLASHCAM_SHARED_VERSION) ||
+            ((off_t) size(h) > st.st_size)) {
+            munmap(header, st.st_size);
+            return NULL;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return h;
+    }
+    
+    void detach(const FLASHCAM_SHARED_HEADER_T *header) {
+        munmap((void*) header, size(header));
+    }
+    
+    uint64_t latest(const FLASHCAM_SHARED_HEADER_T *header) {
+        return header->head.load(std::memory_order_acquire);
+    }
+    
+    const unsigned char *frame(const FLASHCAM_SHARED_HEADER_T *header, uint64_t seq, FLASHCAM_SHARED_SLOT_T *desc) {
+        if (seq == 0)
+            return NULL;
+        
+        FLASHCAM_SHARED_SLOT_T *s = slot(header, seq);
+        if (s->seq.load(std::memory_order_acquire) != 2 * seq)
+            return NULL;
+        
+        if (desc) {
+            desc->pts        = s->pts;
+            desc->time       = s->time;
+            desc->pll_state  = s->pll_state;
+            desc->host       = s->host;
+            desc->host_error = s->host_error;
+        }
+        
+        //descriptor might be of a newer frame
+        return valid(header, seq) ? data(header, seq) : NULL;
+    }
+    
+    bool valid(const FLASHCAM_SHARED_HEADER_T *header, uint64_t seq) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot(header, seq)->seq.load(std::memory_order_relaxed) == 2 * seq;
+    }
+}
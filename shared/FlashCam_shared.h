@@ -0,0 +1,78 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_shared_h
+#define FlashCam_shared_h
+
+
+
+#include "FlashCam_types.h"
+
+namespace FlashCamShared {
+    
+    //writer (FlashCam)
+    // - init    : (re)create ring `name` with `slots` frames of `framesize` bytes. Kept when the layout is unchanged.
+    // - destroy : remove ring, readers still attached see an invalid header.
+    int init(FLASHCAM_SHARED_T *shared, const char *name, unsigned int slots, unsigned int framesize,
+             unsigned int width, unsigned int height, unsigned int pitch, unsigned int planes);
+    void destroy(FLASHCAM_SHARED_T *shared);
+    
+    //producer (camera callback) functions. These never block.
+    // - acquire : claim the slot of the next frame, readers see it as being written.
+    // - current : slot of the frame in progress, NULL if none is claimed.
+    // - publish : frame in progress is complete; readers can use it until it is overwritten `slots - 1` frames later.
+    //             `host` is `pts` in CLOCK_MONOTONIC (0: unknown) with error bound `host_error`.
+    // - cancel  : drop the frame in progress.
+    unsigned char* acquire(FLASHCAM_SHARED_T *shared);
+    unsigned char* current(FLASHCAM_SHARED_T *shared);
+    void publish(FLASHCAM_SHARED_T *shared, uint64_t pts, bool pll_state, uint64_t host, uint32_t host_error);
+    void cancel(FLASHCAM_SHARED_T *shared);
+    
+    //reader (other process)
+    // - attach  : map ring `name` read-only. NULL when missing or of another layout version.
+    // - latest  : sequence number of the latest published frame (0: none).
+    // - frame   : frame `seq` in place, NULL when it is not in the ring. `slot` (optional) receives pts, time, pll_state and host.
+    // - valid   : frame `seq` was not overwritten since `frame()`. Check after using the data.
+    // A reader should re-attach when `magic` is cleared (ring removed or recreated).
+    const FLASHCAM_SHARED_HEADER_T *attach(const char *name);
+    void detach(const FLASHCAM_SHARED_HEADER_T *header);
+    uint64_t latest(const FLASHCAM_SHARED_HEADER_T *header);
+    const unsigned char *frame(const FLASHCAM_SHARED_HEADER_T *header, uint64_t seq, FLASHCAM_SHARED_SLOT_T *slot);
+    bool valid(const FLASHCAM_SHARED_HEADER_T *header, uint64_t seq);
+}
+
+#endif /* FlashCam_shared_h */
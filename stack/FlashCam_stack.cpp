@@ -0,0 +1,376 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_stack.h"
+
+#include "FlashCam_trace.h"
+#include "FlashCam_sched.h"
+#include "FlashCam_util_copy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace FlashCamStack {
+    
+    // accumulator += frame `in` - frame `out` (NULL: none), or moving average with frame `in`, over the stacked bytes
+    static void accumulate(FLASHCAM_STACK_T *stack, const unsigned char *in, const unsigned char *out) {
+        for (unsigned int i=0; i<stack->num_ranges; i++) {
+            unsigned int offset = stack->ranges[i][0];
+            FlashCamUtilCopy::accumulate(&(stack->acc[offset]), &in[offset], out ? &out[offset] : NULL, stack->ranges[i][1]);
+        }
+    }
+    
+    static void average(FLASHCAM_STACK_T *stack, const unsigned char *in, unsigned int shift) {
+        for (unsigned int i=0; i<stack->num_ranges; i++) {
+            unsigned int offset = stack->ranges[i][0];
+            FlashCamUtilCopy::average(&(stack->acc[offset]), &in[offset], shift, stack->ranges[i][1]);
+        }
+    }
+    
+    static void clear(FLASHCAM_STACK_T *stack) {
+        for (unsigned int i=0; i<stack->num_ranges; i++)
+            memset(&(stack->acc[stack->ranges[i][0]]), 0, stack->ranges[i][1] * sizeof(uint16_t));
+    }
+    
+    // hand the stack to the user. `stamps`: latency trace of the newest frame in the stack
+    static void deliver(FLASHCAM_STACK_T *stack, unsigned int count, unsigned int *pending, FLASHCAM_TRACE_STAMPS_T *stamps) {
+        stack->view.frames  = count;
+        stack->view.divisor = (stack->mode == FLASHCAM_STACK_AVERAGE) ? (1 << FLASHCAM_COPY_AVERAGE_BITS) : count;
+        
+        stamps->entry = FlashCamTrace::now(stack->trace);
+        if (stack->callback)
+            stack->callback(&(stack->view));
+        stamps->exit  = FlashCamTrace::now(stack->trace);
+        FlashCamTrace::record(stack->trace, stamps);
+        
+        stack->stats->frames.fetch_add(*pending, std::memory_order_relaxed);
+        *pending = 0;
+    }
+    
+    //consumer thread: stacks published frames, delivers a stack every `interval` frames
+    static void *worker(void *arg) {
+        FLASHCAM_STACK_T *stack = (FLASHCAM_STACK_T*) arg;
+        FLASHCAM_SCHED_WAKE_T   last    = {};
+        FLASHCAM_TRACE_STAMPS_T stamps  = {};
+        unsigned int            next    = 0;        // Next frame to stack
+        unsigned int            count   = 0;        // Frames in accumulator
+        unsigned int            pending = 0;        // Frames stacked since the last delivery
+        
+        FlashCamSched::enter(stack->sched, FLASHCAM_THREAD_WORKER, "stack");
+        
+        while (true) {
+            //wait for update
+            vcos_semaphore_wait(&(stack->sem));
+            
+            // stack all published frames
+            unsigned int head = stack->head.load(std::memory_order_acquire);
+            
+            for (; next != head; next++) {
+                unsigned int            idx   = next % stack->num;
+                FLASHCAM_BATCH_FRAME_T *frame = &(stack->frames[idx]);
+                unsigned char          *data  = &(stack->data[((size_t) idx) * stack->framesize]);
+                
+                FlashCamSched::wake(stack->sched, FLASHCAM_THREAD_WORKER, &last, frame->pts);
+                
+                // The last frame of an interval was dropped: deliver the stack of that interval first
+                if (pending && ((frame->seq / stack->interval) != (stack->view.last.seq / stack->interval)))
+                    deliver(stack, count, &pending, &stamps);
+                
+                if (stack->mode == FLASHCAM_STACK_AVERAGE) {
+                    // first frame sets the average
+                    average(stack, data, count ? stack->shift : 0);
+                    if (count < (1u << stack->shift))
+                        count++;
+                } else if (stack->sliding) {
+                    // full window: oldest frame leaves the sum (and its slot)
+                    const unsigned char *out = NULL;
+                    if (count == stack->window)
+                        out = &(stack->data[((size_t) ((next - count) % stack->num)) * stack->framesize]);
+                    else
+                        count++;
+                    accumulate(stack, data, out);
+                } else {
+                    // window of a new stack
+                    if (!pending) {
+                        clear(stack);
+                        count = 0;
+                    }
+                    accumulate(stack, data, NULL);
+                    count++;
+                }
+                
+                if (stack->sliding)
+                    stack->view.first = stack->frames[(next + 1 - count) % stack->num];
+                else if (!pending)
+                    stack->view.first = *frame;
+                stack->view.last = *frame;
+                stamps = stack->stamps[idx];
+                pending++;
+                
+                //slots can be reused by producer: all but the frames in the window of a running sum
+                stack->tail.store(next + 1 - (stack->sliding ? count : 0), std::memory_order_release);
+                
+                if (((frame->seq + 1) % stack->interval) == 0)
+                    deliver(stack, count, &pending, &stamps);
+            }
+            
+            // Stop when requested and all frames are stacked: deliver the incomplete stack.
+            if (stack->stop.load(std::memory_order_acquire) && (next == stack->head.load(std::memory_order_acquire))) {
+                if (pending)
+                    deliver(stack, count, &pending, &stamps);
+                break;
+            }
+        }
+        return NULL;
+    }
+    
+    unsigned int slots(FLASHCAM_STACK_MODE_T mode, unsigned int window, unsigned int interval) {
+        if ((mode == FLASHCAM_STACK_SUM) && (window > interval))
+            return window + FLASHCAM_STACK_SLOTS;
+        return FLASHCAM_STACK_SLOTS;
+    }
+    
+    int init(FLASHCAM_STACK_T *stack, unsigned int num, unsigned int framesize, unsigned char *data) {
+        if (stack->active) {
+            fprintf(stderr, "%s: Cannot resize stack while it is in use.\n", __func__);
+            return -1;
+        }
+        
+        if (num < FLASHCAM_STACK_SLOTS) {
+            fprintf(stderr, "%s: Stack requires at least %d slots (%d).\n", __func__, FLASHCAM_STACK_SLOTS, num);
+            return -1;
+        }
+        
+        // Nothing changed?
+        if (stack->frames && (stack->num == num) && (stack->framesize == framesize) && (stack->acc == (uint16_t *) data))
+            return 0;
+        
+        destroy(stack);
+        
+        if (vcos_semaphore_create(&(stack->sem), "FlashCam_stack_sem", 0) != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to create semaphore", __func__);
+            return -1;
+        }
+        
+        stack->frames    = new FLASHCAM_BATCH_FRAME_T[num]();
+        stack->stamps    = new FLASHCAM_TRACE_STAMPS_T[num]();
+        stack->acc       = (uint16_t *) data;
+        stack->data      = &data[2 * ((size_t) framesize)];
+        stack->num       = num;
+        stack->framesize = framesize;
+        stack->head      = 0;
+        stack->tail      = 0;
+        stack->filling   = false;
+        stack->skipping  = false;
+        stack->seq       = 0;
+        return 0;
+    }
+    
+    void destroy(FLASHCAM_STACK_T *stack) {
+        stop(stack);
+        
+        if (stack->frames) {
+            delete[] stack->frames;
+            delete[] stack->stamps;
+            vcos_semaphore_delete(&(stack->sem));
+        }
+        stack->frames    = NULL;
+        stack->stamps    = NULL;
+        stack->acc       = NULL;
+        stack->data      = NULL;
+        stack->num       = 0;
+        stack->framesize = 0;
+    }
+    
+    int start(FLASHCAM_STACK_T *stack, FLASHCAM_CALLBACK_STACK_T callback, const FLASHCAM_EXTRACT_T *extract, FLASHCAM_STACK_MODE_T mode,
+              unsigned int window, unsigned int interval, bool chroma, FLASHCAM_COUNTERS_T *stats, FLASHCAM_TRACE_T *trace, FLASHCAM_SCHED_T *sched) {
+        VCOS_STATUS_T status;
+        
+        if (!stack->frames || stack->active)
+            return -1;
+        
+        if ((window < 1) || (window > FLASHCAM_STACK_MAX_WINDOW) || (interval < 1) || (stack->num < slots(mode, window, interval))) {
+            fprintf(stderr, "%s: Invalid window (%u) or interval (%u) for %u slots.\n", __func__, window, interval, stack->num);
+            return -1;
+        }
+        
+        // Stacked bytes: Y planes (and U, V planes) of all regions. Regions are stored in order, adjacent planes are merged.
+        stack->num_ranges = 0;
+        for (unsigned int i=0; i<extract->num_rois; i++) {
+            const FLASHCAM_ROI_T *roi = &(extract->rois[i]);
+            for (unsigned int p=0; p<3; p++) {
+                if (!(extract->planes & (1 << p)) || ((p > 0) && !chroma))
+                    continue;
+                unsigned int offset = roi->offset[p];
+                unsigned int length = (p == 0) ? (roi->pitch * roi->height) : ((roi->pitch >> 1) * (roi->height >> 1));
+                
+                unsigned int *prev = stack->num_ranges ? stack->ranges[stack->num_ranges - 1] : NULL;
+                if (prev && (prev[0] + prev[1] == offset)) {
+                    prev[1] += length;
+                } else {
+                    stack->ranges[stack->num_ranges][0] = offset;
+                    stack->ranges[stack->num_ranges][1] = length;
+                    stack->num_ranges++;
+                }
+            }
+        }
+        if (!stack->num_ranges) {
+            fprintf(stderr, "%s: Frames hold no planes to stack.\n", __func__);
+            return -1;
+        }
+        
+        // U and V are 0 when not stacked
+        memset(stack->acc, 0, ((size_t) stack->framesize) * sizeof(uint16_t));
+        
+        //reset stack
+        while (vcos_semaphore_trywait(&(stack->sem)) != VCOS_EAGAIN);
+        stack->mode     = mode;
+        stack->window   = window;
+        stack->interval = interval;
+        stack->shift    = 0;
+        while ((2u << stack->shift) <= window)
+            stack->shift++;
+        stack->sliding  = (slots(mode, window, interval) > FLASHCAM_STACK_SLOTS);
+        stack->view     = {};
+        stack->view.data   = stack->acc;
+        stack->view.size   = stack->framesize;
+        stack->view.mode   = mode;
+        stack->view.width  = extract->rois[0].width;
+        stack->view.height = extract->rois[0].height;
+        stack->view.pitch  = extract->rois[0].pitch;
+        stack->head     = 0;
+        stack->tail     = 0;
+        stack->filling  = false;
+        stack->skipping = false;
+        stack->seq      = 0;
+        stack->stop     = false;
+        stack->callback = callback;
+        stack->stats    = stats;
+        stack->trace    = trace;
+        stack->sched    = sched;
+        
+        //start consumer thread
+        status = vcos_thread_create( &(stack->thread), "FlashCamStack-worker", NULL, FlashCamStack::worker, stack);
+        if (status != VCOS_SUCCESS) {
+            vcos_log_error("%s: Failed to start `FlashCamStack-worker` (%d)", VCOS_FUNCTION, status);
+            return -1;
+        }
+        
+        stack->active = true;
+        return 0;
+    }
+    
+    void stop(FLASHCAM_STACK_T *stack) {
+        if (!stack->active)
+            return;
+        
+        cancel(stack);
+        
+        //notify worker we are done.
+        stack->stop.store(true, std::memory_order_release);
+        vcos_semaphore_post(&(stack->sem));
+        
+        //Wait for worker to stack remaining frames and terminate.
+        vcos_thread_join(&(stack->thread), NULL);
+        stack->active = false;
+    }
+    
+    unsigned char* acquire(FLASHCAM_STACK_T *stack) {
+        // frame in progress is replaced
+        stack->filling  = false;
+        stack->skipping = false;
+        
+        // Restarting sums: frames before the window of the next stack are not needed
+        if (!stack->sliding && (stack->mode == FLASHCAM_STACK_SUM) && ((stack->seq % stack->interval) < (stack->interval - stack->window))) {
+            stack->stats->skipped.fetch_add(1, std::memory_order_relaxed);
+            stack->skipping = true;
+            stack->seq++;
+            return NULL;
+        }
+        
+        // All slots taken? Consumer is too slow: drop frame.
+        unsigned int head = stack->head.load(std::memory_order_relaxed);
+        unsigned int tail = stack->tail.load(std::memory_order_acquire);
+        if ((head - tail) >= stack->num) {
+            stack->stats->overruns.fetch_add(1, std::memory_order_relaxed);
+            stack->seq++;
+            return NULL;
+        }
+        
+        stack->filling = true;
+        return current(stack);
+    }
+    
+    unsigned char* current(FLASHCAM_STACK_T *stack) {
+        if (!stack->filling)
+            return NULL;
+        return &(stack->data[((size_t) (stack->head.load(std::memory_order_relaxed) % stack->num)) * stack->framesize]);
+    }
+    
+    unsigned int publish(FLASHCAM_STACK_T *stack, uint64_t pts, bool pll_state, uint64_t host, uint32_t host_error, const FLASHCAM_TRACE_STAMPS_T *stamps) {
+        // skipped frames are not dropped
+        if (!stack->filling) {
+            unsigned int dropped = stack->skipping ? 0 : 1;
+            stack->skipping = false;
+            return dropped;
+        }
+        
+        unsigned int head = stack->head.load(std::memory_order_relaxed);
+        unsigned int idx  = head % stack->num;
+        FLASHCAM_BATCH_FRAME_T *frame = &(stack->frames[idx]);
+        frame->pts        = pts;
+        frame->seq        = stack->seq++;
+        frame->host       = host;
+        frame->host_error = host_error;
+        frame->pll_state  = pll_state;
+        stack->stamps[idx] = *stamps;
+        stack->filling = false;
+        
+        //hand over to consumer
+        stack->head.store(head + 1, std::memory_order_release);
+        vcos_semaphore_post(&(stack->sem));
+        return 0;
+    }
+    
+    void cancel(FLASHCAM_STACK_T *stack) {
+        if (stack->filling)
+            stack->seq++;
+        stack->filling  = false;
+        stack->skipping = false;
+    }
+}
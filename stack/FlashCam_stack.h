@@ -0,0 +1,70 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+#ifndef FlashCam_stack_h
+#define FlashCam_stack_h
+
+#include "FlashCam_types.h"
+
+namespace FlashCamStack {
+    
+    // Number of slots needed for `mode`, `window` and `interval` (a running sum keeps the frames of its window).
+    unsigned int slots(FLASHCAM_STACK_MODE_T mode, unsigned int window, unsigned int interval);
+    
+    // (re)allocate `num` slots of `framesize` bytes. `data` (owned by the caller) holds the accumulator followed by
+    //  the slots: (2 + num) x framesize bytes. The stack must be stopped.
+    int init(FLASHCAM_STACK_T *stack, unsigned int num, unsigned int framesize, unsigned char *data);
+    void destroy(FLASHCAM_STACK_T *stack);
+    
+    // start/stop consumer thread. `extract` gives the planes to stack (Y, and U/V with `chroma`). The slots must hold
+    //  `slots(mode, window, interval)` frames. Stopping stacks all published frames and delivers the incomplete stack.
+    int start(FLASHCAM_STACK_T *stack, FLASHCAM_CALLBACK_STACK_T callback, const FLASHCAM_EXTRACT_T *extract, FLASHCAM_STACK_MODE_T mode,
+              unsigned int window, unsigned int interval, bool chroma, FLASHCAM_COUNTERS_T *stats, FLASHCAM_TRACE_T *trace, FLASHCAM_SCHED_T *sched);
+    void stop(FLASHCAM_STACK_T *stack);
+    
+    //producer (camera callback) functions. These never block.
+    // - acquire : claim slot `head` for a new frame. Returns NULL when the frame is not needed by any stack (skipped),
+    //             or when all slots are taken (overrun).
+    // - current : frame in progress, NULL if none is claimed.
+    // - publish : hand the frame in progress to the consumer. Returns the number of frames dropped (overrun: 1).
+    // - cancel  : drop the frame in progress.
+    unsigned char* acquire(FLASHCAM_STACK_T *stack);
+    unsigned char* current(FLASHCAM_STACK_T *stack);
+    unsigned int publish(FLASHCAM_STACK_T *stack, uint64_t pts, bool pll_state, uint64_t host, uint32_t host_error, const FLASHCAM_TRACE_STAMPS_T *stamps);
+    void cancel(FLASHCAM_STACK_T *stack);
+}
+
+#endif /* FlashCam_stack_h */
@@ -0,0 +1,775 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+//
+// Software stand-in for MMAL (see interface/mmal/mmal.h).
+//
+// The `vc.ril.camera` component generates synthetic I420 frames on its video and
+// capture ports, so that the FlashCam control flow (buffer_callback, PLL update(),
+// start/stop capture) can run on a plain Linux host. Behaviour can be tuned through
+// environment variables:
+//
+//  FLASHCAM_STANDIN_FPS            frame rate used when the port rate is 0 (default 30)
+//  FLASHCAM_STANDIN_SLICES         number of buffers (slices) per frame (default 1)
+//  FLASHCAM_STANDIN_FAIL_EVERY     flag every N-th frame TRANSMISSION_FAILED (default 0 = never)
+//  FLASHCAM_STANDIN_STC_OFFSET     offset of the STC against CLOCK_MONOTONIC in us (default 0)
+//  FLASHCAM_STANDIN_STC_DRIFT_PPM  drift of the STC against CLOCK_MONOTONIC in ppm (default 0)
+//
+// Timestamps are in the STC domain (us), which is what MMAL_PARAM_TIMESTAMP_MODE_RAW_STC
+// and MMAL_PARAMETER_SYSTEM_TIME return on the real camera. Frames generated while the
+// PWM pin of the PLL is high (wiringPi stand-in) are lit: their Y plane is brighter.
+//
+
+#include "interface/mmal/mmal.h"
+#include "interface/mmal/util/mmal_util.h"
+#include "interface/mmal/util/mmal_util_params.h"
+#include "interface/mmal/util/mmal_connection.h"
+#include "interface/mmal/util/mmal_default_components.h"
+#include "wiringPi.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+/* STC */
+
+static int64_t standin_env(const char *name, int64_t def) {
+    const char *v = getenv(name);
+    return (v && *v) ? atoll(v) : def;
+}
+
+static uint64_t standin_monotonic_us() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1000000 + t.tv_nsec / 1000;
+}
+
+static uint64_t standin_stc_us() {
+    static uint64_t base   = standin_monotonic_us();
+    static int64_t  offset = standin_env("FLASHCAM_STANDIN_STC_OFFSET", 0);
+    static double   drift  = standin_env("FLASHCAM_STANDIN_STC_DRIFT_PPM", 0) * 1e-6;
+    uint64_t        now    = standin_monotonic_us();
+    return base + offset + (int64_t) ((now - base) * (1.0 + drift));
+}
+
+/* queues */
+
+struct MMAL_QUEUE_T {
+    pthread_mutex_t       lock;
+    pthread_cond_t        cond;
+    MMAL_BUFFER_HEADER_T *first;
+    MMAL_BUFFER_HEADER_T *last;
+    unsigned int          length;
+};
+
+MMAL_QUEUE_T *mmal_queue_create(void) {
+    MMAL_QUEUE_T *queue = new MMAL_QUEUE_T;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&queue->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    queue->first  = NULL;
+    queue->last   = NULL;
+    queue->length = 0;
+    return queue;
+}
+
+void mmal_queue_put(MMAL_QUEUE_T *queue, MMAL_BUFFER_HEADER_T *buffer) {
+    if (!queue || !buffer) return;
+    pthread_mutex_lock(&queue->lock);
+    buffer->next = NULL;
+    if (queue->last) queue->last->next = buffer;
+    else             queue->first      = buffer;
+    queue->last = buffer;
+    queue->length++;
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void mmal_queue_put_back(MMAL_QUEUE_T *queue, MMAL_BUFFER_HEADER_T *buffer) {
+    if (!queue || !buffer) return;
+    pthread_mutex_lock(&queue->lock);
+    buffer->next = queue->first;
+    queue->first = buffer;
+    if (!queue->last) queue->last = buffer;
+    queue->length++;
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static MMAL_BUFFER_HEADER_T *standin_queue_pop(MMAL_QUEUE_T *queue) {
+    MMAL_BUFFER_HEADER_T *buffer = queue->first;
+    if (buffer) {
+        queue->first = buffer->next;
+        if (!queue->first) queue->last = NULL;
+        queue->length--;
+        buffer->next = NULL;
+    }
+    return buffer;
+}
+
+MMAL_BUFFER_HEADER_T *mmal_queue_get(MMAL_QUEUE_T *queue) {
+    if (!queue) return NULL;
+    pthread_mutex_lock(&queue->lock);
+    MMAL_BUFFER_HEADER_T *buffer = standin_queue_pop(queue);
+    pthread_mutex_unlock(&queue->lock);
+    return buffer;
+}
+
+MMAL_BUFFER_HEADER_T *mmal_queue_wait(MMAL_QUEUE_T *queue) {
+    if (!queue) return NULL;
+    pthread_mutex_lock(&queue->lock);
+    while (!queue->first)
+        pthread_cond_wait(&queue->cond, &queue->lock);
+    MMAL_BUFFER_HEADER_T *buffer = standin_queue_pop(queue);
+    pthread_mutex_unlock(&queue->lock);
+    return buffer;
+}
+
+MMAL_BUFFER_HEADER_T *mmal_queue_timedwait(MMAL_QUEUE_T *queue, VCOS_UNSIGNED timeout) {
+    if (!queue) return NULL;
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    t.tv_sec  += timeout / 1000;
+    t.tv_nsec += (timeout % 1000) * 1000000;
+    if (t.tv_nsec >= 1000000000) { t.tv_sec++; t.tv_nsec -= 1000000000; }
+    pthread_mutex_lock(&queue->lock);
+    while (!queue->first)
+        if (pthread_cond_timedwait(&queue->cond, &queue->lock, &t) == ETIMEDOUT)
+            break;
+    MMAL_BUFFER_HEADER_T *buffer = standin_queue_pop(queue);
+    pthread_mutex_unlock(&queue->lock);
+    return buffer;
+}
+
+unsigned int mmal_queue_length(MMAL_QUEUE_T *queue) {
+    if (!queue) return 0;
+    pthread_mutex_lock(&queue->lock);
+    unsigned int length = queue->length;
+    pthread_mutex_unlock(&queue->lock);
+    return length;
+}
+
+void mmal_queue_destroy(MMAL_QUEUE_T *queue) {
+    if (!queue) return;
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->cond);
+    delete queue;
+}
+
+/* buffer headers & pools */
+
+struct MMAL_BUFFER_HEADER_PRIVATE_T {
+    std::atomic<int>  refcount;
+    MMAL_POOL_T      *pool;
+    uint8_t          *payload;
+};
+
+typedef struct {
+    MMAL_POOL_T       pool;
+    MMAL_POOL_BH_CB_T cb;
+    void             *cb_userdata;
+} STANDIN_POOL_T;
+
+static MMAL_BUFFER_HEADER_T *standin_header_create(MMAL_POOL_T *pool, uint32_t payload_size) {
+    MMAL_BUFFER_HEADER_T *header = new MMAL_BUFFER_HEADER_T;
+    memset(header, 0, sizeof(*header));
+    header->priv           = new MMAL_BUFFER_HEADER_PRIVATE_T;
+    header->priv->refcount = 0;
+    header->priv->pool     = pool;
+    header->priv->payload  = payload_size ? new uint8_t[payload_size] : NULL;
+    header->data           = header->priv->payload;
+    header->alloc_size     = payload_size;
+    header->pts            = MMAL_TIME_UNKNOWN;
+    header->dts            = MMAL_TIME_UNKNOWN;
+    return header;
+}
+
+static void standin_header_destroy(MMAL_BUFFER_HEADER_T *header) {
+    delete[] header->priv->payload;
+    delete header->priv;
+    delete header;
+}
+
+void mmal_buffer_header_acquire(MMAL_BUFFER_HEADER_T *header) {
+    header->priv->refcount++;
+}
+
+void mmal_buffer_header_reset(MMAL_BUFFER_HEADER_T *header) {
+    header->length = 0;
+    header->offset = 0;
+    header->flags  = 0;
+    header->pts    = MMAL_TIME_UNKNOWN;
+    header->dts    = MMAL_TIME_UNKNOWN;
+}
+
+void mmal_buffer_header_release(MMAL_BUFFER_HEADER_T *header) {
+    if (!header || --header->priv->refcount > 0) return;
+    header->priv->refcount = 0;
+    header->cmd  = 0;
+    mmal_buffer_header_reset(header);
+
+    MMAL_POOL_T *pool = header->priv->pool;
+    if (!pool) {
+        standin_header_destroy(header);
+        return;
+    }
+    STANDIN_POOL_T *p = (STANDIN_POOL_T *) pool;
+    if (p->cb && !p->cb(pool, header, p->cb_userdata))
+        return;
+    mmal_queue_put(pool->queue, header);
+}
+
+MMAL_STATUS_T mmal_buffer_header_mem_lock(MMAL_BUFFER_HEADER_T *header)  { return MMAL_SUCCESS; }
+void          mmal_buffer_header_mem_unlock(MMAL_BUFFER_HEADER_T *header) { }
+
+MMAL_POOL_T *mmal_pool_create(unsigned int headers, uint32_t payload_size) {
+    STANDIN_POOL_T *p = new STANDIN_POOL_T;
+    p->cb                = NULL;
+    p->cb_userdata       = NULL;
+    p->pool.queue        = mmal_queue_create();
+    p->pool.headers_num  = headers;
+    p->pool.header       = new MMAL_BUFFER_HEADER_T*[headers ? headers : 1];
+    for (unsigned int i = 0; i < headers; i++) {
+        p->pool.header[i] = standin_header_create(&p->pool, payload_size);
+        mmal_queue_put(p->pool.queue, p->pool.header[i]);
+    }
+    return &p->pool;
+}
+
+MMAL_STATUS_T mmal_pool_resize(MMAL_POOL_T *pool, unsigned int headers, uint32_t payload_size) {
+    if (!pool || mmal_queue_length(pool->queue) != pool->headers_num)
+        return MMAL_EINVAL;
+    for (unsigned int i = 0; i < pool->headers_num; i++)
+        standin_header_destroy(mmal_queue_get(pool->queue));
+    delete[] pool->header;
+    pool->headers_num = headers;
+    pool->header      = new MMAL_BUFFER_HEADER_T*[headers ? headers : 1];
+    for (unsigned int i = 0; i < headers; i++) {
+        pool->header[i] = standin_header_create(pool, payload_size);
+        mmal_queue_put(pool->queue, pool->header[i]);
+    }
+    return MMAL_SUCCESS;
+}
+
+void mmal_pool_destroy(MMAL_POOL_T *pool) {
+    if (!pool) return;
+    for (unsigned int i = 0; i < pool->headers_num; i++)
+        standin_header_destroy(pool->header[i]);
+    delete[] pool->header;
+    mmal_queue_destroy(pool->queue);
+    delete (STANDIN_POOL_T *) pool;
+}
+
+void mmal_pool_callback_set(MMAL_POOL_T *pool, MMAL_POOL_BH_CB_T cb, void *userdata) {
+    STANDIN_POOL_T *p = (STANDIN_POOL_T *) pool;
+    p->cb          = cb;
+    p->cb_userdata = userdata;
+}
+
+/* ports */
+
+struct MMAL_PORT_PRIVATE_T {
+    MMAL_PORT_BH_CB_T                         cb;
+    MMAL_QUEUE_T                             *queue;        // buffers sent to the port
+    MMAL_ES_FORMAT_T                          format;
+    MMAL_ES_SPECIFIC_FORMAT_T                 es;
+    std::map<uint32_t, std::vector<uint8_t> > params;
+    pthread_mutex_t                           lock;         // protects params & capture
+    pthread_cond_t                            cond;
+    bool                                      capture;
+    unsigned int                              capture_seq;  // incremented on every capture request
+    bool                                      running;
+    bool                                      generator;    // port produces frames
+    pthread_t                                 thread;
+};
+
+static MMAL_PORT_T *standin_port_create(MMAL_COMPONENT_T *component, MMAL_PORT_TYPE_T type, uint16_t index, const char *name) {
+    MMAL_PORT_T *port = new MMAL_PORT_T;
+    memset(port, 0, sizeof(*port));
+    port->priv            = new MMAL_PORT_PRIVATE_T;
+    port->priv->cb        = NULL;
+    port->priv->queue     = mmal_queue_create();
+    port->priv->capture   = false;
+    port->priv->capture_seq = 0;
+    port->priv->running   = false;
+    port->priv->generator = false;
+    memset(&port->priv->format, 0, sizeof(MMAL_ES_FORMAT_T));
+    memset(&port->priv->es, 0, sizeof(MMAL_ES_SPECIFIC_FORMAT_T));
+    port->priv->format.type = (type == MMAL_PORT_TYPE_CONTROL) ? MMAL_ES_TYPE_CONTROL : MMAL_ES_TYPE_VIDEO;
+    port->priv->format.es   = &port->priv->es;
+    pthread_mutex_init(&port->priv->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&port->priv->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    port->name                   = name;
+    port->type                   = type;
+    port->index                  = index;
+    port->format                 = &port->priv->format;
+    port->buffer_alignment_min   = 16;
+    port->buffer_num_min         = 1;
+    port->buffer_num_recommended = 1;
+    port->component              = component;
+    return port;
+}
+
+static void standin_port_destroy(MMAL_PORT_T *port) {
+    if (!port) return;
+    if (port->is_enabled)
+        mmal_port_disable(port);
+    mmal_queue_destroy(port->priv->queue);
+    pthread_mutex_destroy(&port->priv->lock);
+    pthread_cond_destroy(&port->priv->cond);
+    delete port->priv;
+    delete port;
+}
+
+static uint32_t standin_frame_size(MMAL_PORT_T *port) {
+    MMAL_VIDEO_FORMAT_T *video = &port->format->es->video;
+    if (port->format->encoding == MMAL_ENCODING_OPAQUE)
+        return 128;
+    return VCOS_ALIGN_UP(video->width, 32) * VCOS_ALIGN_UP(video->height, 16) * 3 / 2;
+}
+
+MMAL_STATUS_T mmal_port_format_commit(MMAL_PORT_T *port) {
+    if (!port || port->is_enabled)
+        return MMAL_EINVAL;
+    port->buffer_size_min         = standin_frame_size(port);
+    port->buffer_size_recommended = port->buffer_size_min;
+    port->buffer_num_min          = 1;
+    port->buffer_num_recommended  = (port->index == 2) ? 1 : 3;
+    if (port->buffer_size < port->buffer_size_min) port->buffer_size = port->buffer_size_recommended;
+    if (port->buffer_num  < port->buffer_num_min ) port->buffer_num  = port->buffer_num_recommended;
+    return MMAL_SUCCESS;
+}
+
+static bool standin_param_get(MMAL_PORT_T *port, uint32_t id, void *value, size_t size) {
+    pthread_mutex_lock(&port->priv->lock);
+    std::map<uint32_t, std::vector<uint8_t> >::iterator it = port->priv->params.find(id);
+    bool found = it != port->priv->params.end() && it->second.size() >= size;
+    if (found) memcpy(value, &it->second[0], size);
+    pthread_mutex_unlock(&port->priv->lock);
+    return found;
+}
+
+// Frame period in us (rate set on the port, else the committed format, else env/default).
+static uint64_t standin_frame_period(MMAL_PORT_T *port) {
+    MMAL_PARAMETER_FRAME_RATE_T param;
+    MMAL_RATIONAL_T rate = port->format->es->video.frame_rate;
+    if (standin_param_get(port, MMAL_PARAMETER_VIDEO_FRAME_RATE, &param, sizeof(param)) && param.frame_rate.num > 0)
+        rate = param.frame_rate;
+    if (rate.num <= 0 || rate.den <= 0) {
+        rate.num = standin_env("FLASHCAM_STANDIN_FPS", 30);
+        rate.den = 1;
+    }
+    return (uint64_t) (1000000.0 * rate.den / rate.num);
+}
+
+// Brightness added to the Y plane of frames exposed during the PWM pulse
+#define STANDIN_LIT 64
+
+// Fills one horizontal band of the frame in the I420 slice layout (Y-band, U-band, V-band).
+static uint32_t standin_fill_slice(MMAL_PORT_T *port, uint8_t *data, uint32_t row0, uint32_t rows, uint64_t frame, bool lit) {
+    uint32_t w  = VCOS_ALIGN_UP(port->format->es->video.width, 32);
+    uint32_t cw = port->format->es->video.crop.width ? port->format->es->video.crop.width : w;
+    uint32_t ch = port->format->es->video.crop.height ? port->format->es->video.crop.height : port->format->es->video.height;
+    uint8_t *p = data;
+    // image: Y = row + frame (+ STANDIN_LIT when lit), U = 64 + row/2, V = 192 - row/2; padding (outside crop): 0xEE
+    for (uint32_t r = row0; r < row0 + rows; r++, p += w) {
+        memset(p, r < ch ? (uint8_t) (r + frame + (lit ? STANDIN_LIT : 0)) : 0xEE, w);
+        memset(p + cw, 0xEE, w - cw);
+    }
+    for (uint32_t plane = 0; plane < 2; plane++) {
+        for (uint32_t r = (row0 >> 1); r < ((row0 + rows) >> 1); r++, p += (w >> 1)) {
+            memset(p, r < (ch >> 1) ? (uint8_t) (plane ? 192 - (r & 63) : 64 + (r & 63)) : 0xEE, w >> 1);
+            memset(p + (cw >> 1), 0xEE, (w - cw) >> 1);
+        }
+    }
+    return p - data;
+}
+
+static bool standin_wait_capture(MMAL_PORT_T *port) {
+    pthread_mutex_lock(&port->priv->lock);
+    while (port->priv->running && !port->priv->capture)
+        pthread_cond_wait(&port->priv->cond, &port->priv->lock);
+    bool running = port->priv->running;
+    pthread_mutex_unlock(&port->priv->lock);
+    return running;
+}
+
+// Sleeps until `deadline` (CLOCK_MONOTONIC, us), returns false when the port stops meanwhile.
+static bool standin_wait_until(MMAL_PORT_T *port, uint64_t deadline) {
+    struct timespec t;
+    t.tv_sec  = deadline / 1000000;
+    t.tv_nsec = (deadline % 1000000) * 1000;
+    pthread_mutex_lock(&port->priv->lock);
+    while (port->priv->running && port->priv->capture)
+        if (pthread_cond_timedwait(&port->priv->cond, &port->priv->lock, &t) == ETIMEDOUT)
+            break;
+    bool ok = port->priv->running && port->priv->capture;
+    pthread_mutex_unlock(&port->priv->lock);
+    return ok;
+}
+
+static void *standin_generator(void *arg) {
+    MMAL_PORT_T *port       = (MMAL_PORT_T *) arg;
+    uint64_t     frame      = 0;
+    int64_t      fail_every = standin_env("FLASHCAM_STANDIN_FAIL_EVERY", 0);
+    uint64_t     deadline   = 0;
+
+    while (standin_wait_capture(port)) {
+        uint64_t period = standin_frame_period(port);
+        uint64_t now    = standin_monotonic_us();
+        if (deadline == 0 || now > deadline + period)
+            deadline = now;
+        deadline += period;
+        if (!standin_wait_until(port, deadline))
+            continue;
+
+        // slices are multiples of 16 rows
+        uint32_t bands  = VCOS_ALIGN_UP(port->format->es->video.height, 16) >> 4;
+        uint32_t slices = standin_env("FLASHCAM_STANDIN_SLICES", 1);
+        if (slices < 1)     slices = 1;
+        if (slices > bands) slices = bands;
+        if (port->format->encoding == MMAL_ENCODING_OPAQUE) slices = 1;
+
+        int64_t  pts = standin_stc_us();
+        bool     lit = standin_pwm_high(standin_monotonic_us());
+        uint32_t row = 0;
+        frame++;
+
+        pthread_mutex_lock(&port->priv->lock);
+        unsigned int capture_seq = port->priv->capture_seq;
+        pthread_mutex_unlock(&port->priv->lock);
+
+        // no buffer at the start of a frame: the sensor frame is lost.
+        MMAL_BUFFER_HEADER_T *buffer = mmal_queue_get(port->priv->queue);
+        for (uint32_t s = 0; buffer && s < slices; s++) {
+            uint32_t rows = ((bands * (s + 1)) / slices - (bands * s) / slices) << 4;
+            if (port->format->encoding == MMAL_ENCODING_OPAQUE) {
+                memcpy(buffer->data, &frame, sizeof(frame));
+                buffer->length = sizeof(frame);
+            } else {
+                uint32_t needed = rows * VCOS_ALIGN_UP(port->format->es->video.width, 32) * 3 / 2;
+                buffer->length  = needed <= buffer->alloc_size ? standin_fill_slice(port, buffer->data, row, rows, frame, lit) : 0;
+            }
+            buffer->offset = 0;
+            buffer->pts    = pts;
+            buffer->dts    = MMAL_TIME_UNKNOWN;
+            buffer->flags  = (s == 0 ? MMAL_BUFFER_HEADER_FLAG_FRAME_START : 0);
+            if (s == slices - 1) {
+                buffer->flags |= MMAL_BUFFER_HEADER_FLAG_FRAME_END;
+                if (fail_every > 0 && (frame % fail_every) == 0)
+                    buffer->flags |= MMAL_BUFFER_HEADER_FLAG_TRANSMISSION_FAILED;
+            }
+            row += rows;
+            port->priv->cb(port, buffer);
+
+            // wait for the next slice buffer (the client returns them from its callback)
+            buffer = NULL;
+            while (s + 1 < slices && !buffer && port->priv->running)
+                buffer = mmal_queue_timedwait(port->priv->queue, 10);
+        }
+        if (buffer)
+            mmal_queue_put_back(port->priv->queue, buffer);
+
+        // one-shot stills (unless a new capture was requested meanwhile)
+        if (port->index == 2) {
+            pthread_mutex_lock(&port->priv->lock);
+            if (port->priv->capture_seq == capture_seq)
+                port->priv->capture = false;
+            pthread_mutex_unlock(&port->priv->lock);
+        }
+    }
+    return NULL;
+}
+
+MMAL_STATUS_T mmal_port_enable(MMAL_PORT_T *port, MMAL_PORT_BH_CB_T cb) {
+    if (!port || port->is_enabled)
+        return MMAL_EINVAL;
+    port->priv->cb      = cb;
+    port->is_enabled    = 1;
+    port->priv->running = true;
+    if (cb && port->priv->generator) {
+        if (pthread_create(&port->priv->thread, NULL, standin_generator, port) != 0) {
+            port->is_enabled    = 0;
+            port->priv->running = false;
+            return MMAL_ENOSPC;
+        }
+    }
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_port_disable(MMAL_PORT_T *port) {
+    if (!port || !port->is_enabled)
+        return MMAL_EINVAL;
+    port->is_enabled = 0;
+    pthread_mutex_lock(&port->priv->lock);
+    port->priv->running = false;
+    pthread_cond_broadcast(&port->priv->cond);
+    pthread_mutex_unlock(&port->priv->lock);
+    if (port->priv->cb && port->priv->generator)
+        pthread_join(port->priv->thread, NULL);
+    mmal_port_flush(port);
+    port->priv->cb = NULL;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_port_flush(MMAL_PORT_T *port) {
+    MMAL_BUFFER_HEADER_T *buffer;
+    while ((buffer = mmal_queue_get(port->priv->queue)) != NULL) {
+        buffer->length = 0;
+        if (port->priv->cb) port->priv->cb(port, buffer);
+        else                mmal_buffer_header_release(buffer);
+    }
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_port_send_buffer(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+    if (!port || !buffer || !port->is_enabled)
+        return MMAL_EINVAL;
+    mmal_buffer_header_acquire(buffer);
+    mmal_queue_put(port->priv->queue, buffer);
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_port_parameter_set(MMAL_PORT_T *port, const MMAL_PARAMETER_HEADER_T *param) {
+    if (!port || !param || param->size < sizeof(MMAL_PARAMETER_HEADER_T))
+        return MMAL_EINVAL;
+    if (param->id == MMAL_PARAMETER_SYSTEM_TIME)
+        return MMAL_EINVAL;
+    pthread_mutex_lock(&port->priv->lock);
+    const uint8_t *p = (const uint8_t *) param;
+    port->priv->params[param->id].assign(p, p + param->size);
+    if (param->id == MMAL_PARAMETER_CAPTURE) {
+        port->priv->capture = ((const MMAL_PARAMETER_BOOLEAN_T *) param)->enable != 0;
+        port->priv->capture_seq++;
+        pthread_cond_broadcast(&port->priv->cond);
+    }
+    pthread_mutex_unlock(&port->priv->lock);
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_port_parameter_get(MMAL_PORT_T *port, MMAL_PARAMETER_HEADER_T *param) {
+    if (!port || !param || param->size < sizeof(MMAL_PARAMETER_HEADER_T))
+        return MMAL_EINVAL;
+    if (param->id == MMAL_PARAMETER_SYSTEM_TIME) {
+        if (param->size < sizeof(MMAL_PARAMETER_UINT64_T)) return MMAL_EINVAL;
+        ((MMAL_PARAMETER_UINT64_T *) param)->value = standin_stc_us();
+        return MMAL_SUCCESS;
+    }
+    uint32_t id   = param->id;
+    uint32_t size = param->size;
+    pthread_mutex_lock(&port->priv->lock);
+    std::map<uint32_t, std::vector<uint8_t> >::iterator it = port->priv->params.find(id);
+    // unset parameters read back as zero (the camera's "default")
+    memset((uint8_t *) param + sizeof(MMAL_PARAMETER_HEADER_T), 0, size - sizeof(MMAL_PARAMETER_HEADER_T));
+    if (it != port->priv->params.end())
+        memcpy(param, &it->second[0], it->second.size() < size ? it->second.size() : size);
+    param->id   = id;
+    param->size = size;
+    pthread_mutex_unlock(&port->priv->lock);
+    return MMAL_SUCCESS;
+}
+
+/* components */
+
+struct MMAL_COMPONENT_PRIVATE_T {
+    std::vector<MMAL_PORT_T *> ports;
+};
+
+MMAL_STATUS_T mmal_component_create(const char *name, MMAL_COMPONENT_T **component) {
+    if (!name || !component)
+        return MMAL_EINVAL;
+
+    bool camera = strcmp(name, MMAL_COMPONENT_DEFAULT_CAMERA)    == 0;
+    bool sink   = strcmp(name, MMAL_COMPONENT_DEFAULT_NULL_SINK) == 0;
+    if (!camera && !sink)
+        return MMAL_ENOENT;
+
+    MMAL_COMPONENT_T *c = new MMAL_COMPONENT_T;
+    memset(c, 0, sizeof(*c));
+    c->priv    = new MMAL_COMPONENT_PRIVATE_T;
+    c->name    = name;
+    c->control = standin_port_create(c, MMAL_PORT_TYPE_CONTROL, 0, "control");
+    c->priv->ports.push_back(c->control);
+
+    if (camera) {
+        static const char *names[] = { "preview", "video", "capture" };
+        c->output_num = 3;
+        c->output     = new MMAL_PORT_T*[3];
+        for (int i = 0; i < 3; i++) {
+            c->output[i] = standin_port_create(c, MMAL_PORT_TYPE_OUTPUT, i, names[i]);
+            c->output[i]->priv->generator = (i != 0);
+            c->priv->ports.push_back(c->output[i]);
+        }
+    } else {
+        c->input_num = 1;
+        c->input     = new MMAL_PORT_T*[1];
+        c->input[0]  = standin_port_create(c, MMAL_PORT_TYPE_INPUT, 0, "in");
+        c->priv->ports.push_back(c->input[0]);
+    }
+    c->port_num = c->priv->ports.size();
+    c->port     = &c->priv->ports[0];
+
+    *component = c;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_component_destroy(MMAL_COMPONENT_T *component) {
+    if (!component)
+        return MMAL_EINVAL;
+    for (size_t i = 0; i < component->priv->ports.size(); i++)
+        standin_port_destroy(component->priv->ports[i]);
+    delete[] component->output;
+    delete[] component->input;
+    delete component->priv;
+    delete component;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_component_enable(MMAL_COMPONENT_T *component) {
+    if (!component) return MMAL_EINVAL;
+    component->is_enabled = 1;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_component_disable(MMAL_COMPONENT_T *component) {
+    if (!component) return MMAL_EINVAL;
+    for (size_t i = 0; i < component->priv->ports.size(); i++)
+        if (component->priv->ports[i]->is_enabled)
+            mmal_port_disable(component->priv->ports[i]);
+    component->is_enabled = 0;
+    return MMAL_SUCCESS;
+}
+
+/* connections (tunnelled: no buffers are exchanged) */
+
+MMAL_STATUS_T mmal_connection_create(MMAL_CONNECTION_T **connection, MMAL_PORT_T *out, MMAL_PORT_T *in, uint32_t flags) {
+    if (!connection || !out || !in)
+        return MMAL_EINVAL;
+    MMAL_CONNECTION_T *c = new MMAL_CONNECTION_T;
+    memset(c, 0, sizeof(*c));
+    c->out   = out;
+    c->in    = in;
+    c->flags = flags;
+    c->name  = "connection";
+    *connection = c;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_connection_enable(MMAL_CONNECTION_T *connection) {
+    if (!connection || connection->is_enabled)
+        return MMAL_EINVAL;
+    mmal_port_enable(connection->out, NULL);
+    mmal_port_enable(connection->in , NULL);
+    connection->is_enabled = 1;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_connection_disable(MMAL_CONNECTION_T *connection) {
+    if (!connection || !connection->is_enabled)
+        return MMAL_EINVAL;
+    if (connection->out->is_enabled) mmal_port_disable(connection->out);
+    if (connection->in ->is_enabled) mmal_port_disable(connection->in );
+    connection->is_enabled = 0;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_connection_destroy(MMAL_CONNECTION_T *connection) {
+    if (!connection)
+        return MMAL_EINVAL;
+    if (connection->is_enabled)
+        mmal_connection_disable(connection);
+    delete connection;
+    return MMAL_SUCCESS;
+}
+
+/* util */
+
+uint32_t mmal_encoding_width_to_stride(uint32_t encoding, uint32_t width) {
+    return (encoding == MMAL_ENCODING_I420) ? VCOS_ALIGN_UP(width, 32) : width;
+}
+
+MMAL_POOL_T *mmal_port_pool_create(MMAL_PORT_T *port, unsigned int headers, uint32_t payload_size) {
+    return mmal_pool_create(headers, payload_size);
+}
+
+uint8_t *mmal_port_payload_alloc(MMAL_PORT_T *port, uint32_t payload_size) {
+    return new uint8_t[payload_size ? payload_size : 1];
+}
+
+void mmal_port_payload_free(MMAL_PORT_T *port, uint8_t *payload) {
+    delete[] payload;
+}
+
+void mmal_port_pool_destroy(MMAL_PORT_T *port, MMAL_POOL_T *pool) {
+    mmal_pool_destroy(pool);
+}
+
+/* util params */
+
+#define STANDIN_PARAM_ACCESSORS(suffix, type, param_t, member)                                    \
+MMAL_STATUS_T mmal_port_parameter_set_##suffix(MMAL_PORT_T *port, uint32_t id, type value) {       \
+    param_t param = {{id, sizeof(param)}, value};                                                  \
+    return mmal_port_parameter_set(port, &param.hdr);                                              \
+}                                                                                                  \
+MMAL_STATUS_T mmal_port_parameter_get_##suffix(MMAL_PORT_T *port, uint32_t id, type *value) {      \
+    param_t param;                                                                                 \
+    param.hdr.id   = id;                                                                           \
+    param.hdr.size = sizeof(param);                                                                \
+    MMAL_STATUS_T status = mmal_port_parameter_get(port, &param.hdr);                              \
+    if (status == MMAL_SUCCESS) *value = param.member;                                             \
+    return status;                                                                                 \
+}
+
+STANDIN_PARAM_ACCESSORS(boolean , MMAL_BOOL_T    , MMAL_PARAMETER_BOOLEAN_T , enable)
+STANDIN_PARAM_ACCESSORS(uint64  , uint64_t       , MMAL_PARAMETER_UINT64_T  , value )
+STANDIN_PARAM_ACCESSORS(int64   , int64_t        , MMAL_PARAMETER_INT64_T   , value )
+STANDIN_PARAM_ACCESSORS(uint32  , uint32_t       , MMAL_PARAMETER_UINT32_T  , value )
+STANDIN_PARAM_ACCESSORS(int32   , int32_t        , MMAL_PARAMETER_INT32_T   , value )
+STANDIN_PARAM_ACCESSORS(rational, MMAL_RATIONAL_T, MMAL_PARAMETER_RATIONAL_T, value )
@@ -0,0 +1,75 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "wiringPi.h"
+
+#include <time.h>
+#include <unistd.h>
+
+// Last PWM state, so the synthetic camera / tests can observe the PLL output.
+static volatile int          standin_pwm_value = 0;
+static volatile unsigned int standin_pwm_range = 1024;
+static volatile int          standin_pwm_clock = 1;
+static volatile uint64_t     standin_pwm_start = 0;     // Restart of the PWM clock (CLOCK_MONOTONIC, us)
+
+static uint64_t standin_pwm_now_us() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1000000 + t.tv_nsec / 1000;
+}
+
+int  wiringPiSetup(void)                { return 0; }
+void pinMode(int pin, int mode)         { }
+void pwmSetMode(int mode)               { }
+void pwmSetRange(unsigned int range)    { standin_pwm_range = range; }
+void pwmWrite(int pin, int value)       { standin_pwm_value = value; }
+
+// wiringPi waits at least 110 + 1 us for the PWM clock, which restarts the PWM period.
+void pwmSetClock(int divisor) {
+    usleep(111);
+    standin_pwm_clock = (divisor > 0) ? divisor : 1;
+    standin_pwm_start = standin_pwm_now_us();
+}
+
+// Mark-space mode: the pin is high for the first `value` of every `range` ticks of the 19.2 MHz / divisor clock.
+bool standin_pwm_high(uint64_t us) {
+    uint64_t start = standin_pwm_start;
+    if ((standin_pwm_value <= 0) || (start == 0) || (us < start) || (standin_pwm_range == 0))
+        return false;
+    uint64_t ticks = (us - start) * 192 / (10 * (uint64_t) standin_pwm_clock);
+    return (ticks % standin_pwm_range) < (uint64_t) standin_pwm_value;
+}
@@ -0,0 +1,529 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+//
+// Software stand-in for the subset of MMAL used by FlashCam.
+// Only used when building with BUILD_FLASHCAM_WITH_STANDIN (see CMakeLists.txt).
+//
+// Types, names and semantics follow `userland/interface/mmal`, but only the
+// members and functions used by FlashCam are provided. The camera component
+// (`vc.ril.camera`) generates synthetic I420 frames; see FlashCam_standin_mmal.cpp.
+//
+
+#ifndef FlashCam_standin_mmal_h
+#define FlashCam_standin_mmal_h
+
+#include "interface/vcos/vcos.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* mmal_types.h */
+
+typedef enum {
+    MMAL_SUCCESS = 0,
+    MMAL_ENOMEM,
+    MMAL_ENOSPC,
+    MMAL_EINVAL,
+    MMAL_ENOSYS,
+    MMAL_ENOENT,
+    MMAL_ENXIO,
+    MMAL_EIO,
+    MMAL_ESPIPE,
+    MMAL_ECORRUPT,
+    MMAL_ENOTREADY,
+    MMAL_ECONFIG,
+    MMAL_EISCONN,
+    MMAL_ENOTCONN,
+    MMAL_EAGAIN,
+    MMAL_EFAULT,
+    MMAL_STATUS_MAX = 0x7FFFFFFF
+} MMAL_STATUS_T;
+
+typedef int32_t MMAL_BOOL_T;
+#define MMAL_FALSE 0
+#define MMAL_TRUE  1
+
+typedef uint32_t MMAL_FOURCC_T;
+#define MMAL_FOURCC(a,b,c,d) ((a) | (b << 8) | (c << 16) | (d << 24))
+
+typedef struct { int32_t x, y, width, height; } MMAL_RECT_T;
+typedef struct { int32_t num, den; } MMAL_RATIONAL_T;
+
+#define MMAL_TIME_UNKNOWN (INT64_C(1) << 63)
+
+/* mmal_encodings.h */
+
+#define MMAL_ENCODING_I420   MMAL_FOURCC('I','4','2','0')
+#define MMAL_ENCODING_OPAQUE MMAL_FOURCC('O','P','Q','V')
+
+/* mmal_format.h */
+
+typedef enum {
+    MMAL_ES_TYPE_UNKNOWN,
+    MMAL_ES_TYPE_CONTROL,
+    MMAL_ES_TYPE_AUDIO,
+    MMAL_ES_TYPE_VIDEO,
+    MMAL_ES_TYPE_SUBPICTURE
+} MMAL_ES_TYPE_T;
+
+typedef struct {
+    uint32_t        width;
+    uint32_t        height;
+    MMAL_RECT_T     crop;
+    MMAL_RATIONAL_T frame_rate;
+    MMAL_RATIONAL_T par;
+    MMAL_FOURCC_T   color_space;
+} MMAL_VIDEO_FORMAT_T;
+
+typedef union {
+    MMAL_VIDEO_FORMAT_T video;
+} MMAL_ES_SPECIFIC_FORMAT_T;
+
+typedef struct MMAL_ES_FORMAT_T {
+    MMAL_ES_TYPE_T             type;
+    MMAL_FOURCC_T              encoding;
+    MMAL_FOURCC_T              encoding_variant;
+    MMAL_ES_SPECIFIC_FORMAT_T *es;
+    uint32_t                   bitrate;
+    uint32_t                   flags;
+    uint32_t                   extradata_size;
+    uint8_t                   *extradata;
+} MMAL_ES_FORMAT_T;
+
+/* mmal_buffer.h */
+
+#define MMAL_BUFFER_HEADER_FLAG_EOS                    (1<<0)
+#define MMAL_BUFFER_HEADER_FLAG_FRAME_START            (1<<1)
+#define MMAL_BUFFER_HEADER_FLAG_FRAME_END              (1<<2)
+#define MMAL_BUFFER_HEADER_FLAG_FRAME                  (MMAL_BUFFER_HEADER_FLAG_FRAME_START|MMAL_BUFFER_HEADER_FLAG_FRAME_END)
+#define MMAL_BUFFER_HEADER_FLAG_KEYFRAME               (1<<3)
+#define MMAL_BUFFER_HEADER_FLAG_DISCONTINUITY          (1<<4)
+#define MMAL_BUFFER_HEADER_FLAG_CONFIG                 (1<<5)
+#define MMAL_BUFFER_HEADER_FLAG_ENCRYPTED              (1<<6)
+#define MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO          (1<<7)
+#define MMAL_BUFFER_HEADER_FLAGS_SNAPSHOT              (1<<8)
+#define MMAL_BUFFER_HEADER_FLAG_CORRUPTED              (1<<9)
+#define MMAL_BUFFER_HEADER_FLAG_TRANSMISSION_FAILED    (1<<10)
+
+struct MMAL_BUFFER_HEADER_PRIVATE_T;
+
+typedef struct MMAL_BUFFER_HEADER_T {
+    struct MMAL_BUFFER_HEADER_T         *next;
+    struct MMAL_BUFFER_HEADER_PRIVATE_T *priv;
+    uint32_t                             cmd;
+    uint8_t                             *data;
+    uint32_t                             alloc_size;
+    uint32_t                             length;
+    uint32_t                             offset;
+    uint32_t                             flags;
+    int64_t                              pts;
+    int64_t                              dts;
+    void                                *type;
+    void                                *user_data;
+} MMAL_BUFFER_HEADER_T;
+
+void          mmal_buffer_header_acquire(MMAL_BUFFER_HEADER_T *header);
+void          mmal_buffer_header_reset(MMAL_BUFFER_HEADER_T *header);
+void          mmal_buffer_header_release(MMAL_BUFFER_HEADER_T *header);
+MMAL_STATUS_T mmal_buffer_header_mem_lock(MMAL_BUFFER_HEADER_T *header);
+void          mmal_buffer_header_mem_unlock(MMAL_BUFFER_HEADER_T *header);
+
+/* mmal_queue.h */
+
+typedef struct MMAL_QUEUE_T MMAL_QUEUE_T;
+
+MMAL_QUEUE_T         *mmal_queue_create(void);
+void                  mmal_queue_put(MMAL_QUEUE_T *queue, MMAL_BUFFER_HEADER_T *buffer);
+void                  mmal_queue_put_back(MMAL_QUEUE_T *queue, MMAL_BUFFER_HEADER_T *buffer);
+MMAL_BUFFER_HEADER_T *mmal_queue_get(MMAL_QUEUE_T *queue);
+MMAL_BUFFER_HEADER_T *mmal_queue_wait(MMAL_QUEUE_T *queue);
+MMAL_BUFFER_HEADER_T *mmal_queue_timedwait(MMAL_QUEUE_T *queue, VCOS_UNSIGNED timeout);
+unsigned int          mmal_queue_length(MMAL_QUEUE_T *queue);
+void                  mmal_queue_destroy(MMAL_QUEUE_T *queue);
+
+/* mmal_pool.h */
+
+typedef struct MMAL_POOL_T {
+    MMAL_QUEUE_T          *queue;
+    uint32_t               headers_num;
+    MMAL_BUFFER_HEADER_T **header;
+} MMAL_POOL_T;
+
+typedef MMAL_BOOL_T (*MMAL_POOL_BH_CB_T)(MMAL_POOL_T *pool, MMAL_BUFFER_HEADER_T *buffer, void *userdata);
+
+MMAL_POOL_T  *mmal_pool_create(unsigned int headers, uint32_t payload_size);
+uint8_t      *mmal_port_payload_alloc(struct MMAL_PORT_T *port, uint32_t payload_size);
+void          mmal_port_payload_free(struct MMAL_PORT_T *port, uint8_t *payload);
+MMAL_STATUS_T mmal_pool_resize(MMAL_POOL_T *pool, unsigned int headers, uint32_t payload_size);
+void          mmal_pool_destroy(MMAL_POOL_T *pool);
+void          mmal_pool_callback_set(MMAL_POOL_T *pool, MMAL_POOL_BH_CB_T cb, void *userdata);
+
+/* mmal_parameters_common.h / mmal_parameters_camera.h */
+
+typedef struct MMAL_PARAMETER_HEADER_T {
+    uint32_t id;
+    uint32_t size;
+} MMAL_PARAMETER_HEADER_T;
+
+#define MMAL_PARAMETER_GROUP_COMMON (0<<16)
+#define MMAL_PARAMETER_GROUP_CAMERA (1<<16)
+#define MMAL_PARAMETER_GROUP_VIDEO  (2<<16)
+
+enum {
+    MMAL_PARAMETER_UNUSED = MMAL_PARAMETER_GROUP_COMMON,
+    MMAL_PARAMETER_SUPPORTED_ENCODINGS,
+    MMAL_PARAMETER_URI,
+    MMAL_PARAMETER_CHANGE_EVENT_REQUEST,
+    MMAL_PARAMETER_ZERO_COPY,
+    MMAL_PARAMETER_BUFFER_REQUIREMENTS,
+    MMAL_PARAMETER_STATISTICS,
+    MMAL_PARAMETER_CORE_STATISTICS,
+    MMAL_PARAMETER_MEM_USAGE,
+    MMAL_PARAMETER_BUFFER_FLAG_FILTER,
+    MMAL_PARAMETER_SEEK,
+    MMAL_PARAMETER_POWERMON_ENABLE,
+    MMAL_PARAMETER_LOGGING,
+    MMAL_PARAMETER_SYSTEM_TIME,
+    MMAL_PARAMETER_NO_IMAGE_PADDING,
+    MMAL_PARAMETER_LOCKSTEP_ENABLE
+};
+
+enum {
+    MMAL_PARAMETER_THUMBNAIL_CONFIGURATION = MMAL_PARAMETER_GROUP_CAMERA,
+    MMAL_PARAMETER_CAPTURE_QUALITY,
+    MMAL_PARAMETER_ROTATION,
+    MMAL_PARAMETER_EXIF_DISABLE,
+    MMAL_PARAMETER_EXIF,
+    MMAL_PARAMETER_AWB_MODE,
+    MMAL_PARAMETER_IMAGE_EFFECT,
+    MMAL_PARAMETER_COLOUR_EFFECT,
+    MMAL_PARAMETER_FLICKER_AVOID,
+    MMAL_PARAMETER_FLASH,
+    MMAL_PARAMETER_REDEYE,
+    MMAL_PARAMETER_FOCUS,
+    MMAL_PARAMETER_FOCAL_LENGTHS,
+    MMAL_PARAMETER_EXPOSURE_COMP,
+    MMAL_PARAMETER_ZOOM,
+    MMAL_PARAMETER_MIRROR,
+    MMAL_PARAMETER_CAMERA_NUM,
+    MMAL_PARAMETER_CAPTURE,
+    MMAL_PARAMETER_EXPOSURE_MODE,
+    MMAL_PARAMETER_EXP_METERING_MODE,
+    MMAL_PARAMETER_FOCUS_STATUS,
+    MMAL_PARAMETER_CAMERA_CONFIG,
+    MMAL_PARAMETER_CAPTURE_STATUS,
+    MMAL_PARAMETER_FACE_TRACK,
+    MMAL_PARAMETER_DRAW_BOX_FACES_AND_FOCUS,
+    MMAL_PARAMETER_JPEG_Q_FACTOR,
+    MMAL_PARAMETER_FRAME_RATE,
+    MMAL_PARAMETER_USE_STC,
+    MMAL_PARAMETER_CAMERA_INFO,
+    MMAL_PARAMETER_VIDEO_STABILISATION,
+    MMAL_PARAMETER_FACE_TRACK_RESULTS,
+    MMAL_PARAMETER_ENABLE_RAW_CAPTURE,
+    MMAL_PARAMETER_DPF_FILE,
+    MMAL_PARAMETER_ENABLE_DPF_FILE,
+    MMAL_PARAMETER_DPF_FAIL_IS_FATAL,
+    MMAL_PARAMETER_CAPTURE_MODE,
+    MMAL_PARAMETER_FOCUS_REGIONS,
+    MMAL_PARAMETER_INPUT_CROP,
+    MMAL_PARAMETER_SENSOR_INFORMATION,
+    MMAL_PARAMETER_FLASH_SELECT,
+    MMAL_PARAMETER_FIELD_OF_VIEW,
+    MMAL_PARAMETER_HIGH_DYNAMIC_RANGE,
+    MMAL_PARAMETER_DYNAMIC_RANGE_COMPRESSION,
+    MMAL_PARAMETER_ALGORITHM_CONTROL,
+    MMAL_PARAMETER_SHARPNESS,
+    MMAL_PARAMETER_CONTRAST,
+    MMAL_PARAMETER_BRIGHTNESS,
+    MMAL_PARAMETER_SATURATION,
+    MMAL_PARAMETER_ISO,
+    MMAL_PARAMETER_ANTISHAKE,
+    MMAL_PARAMETER_IMAGE_EFFECT_PARAMETERS,
+    MMAL_PARAMETER_CAMERA_BURST_CAPTURE,
+    MMAL_PARAMETER_CAMERA_MIN_ISO,
+    MMAL_PARAMETER_CAMERA_USE_CASE,
+    MMAL_PARAMETER_CAPTURE_STATS_PASS,
+    MMAL_PARAMETER_CAMERA_CUSTOM_SENSOR_CONFIG,
+    MMAL_PARAMETER_ENABLE_REGISTER_FILE,
+    MMAL_PARAMETER_REGISTER_FAIL_IS_FATAL,
+    MMAL_PARAMETER_CONFIGFILE_REGISTERS,
+    MMAL_PARAMETER_CONFIGFILE_CHUNK_REGISTERS,
+    MMAL_PARAMETER_JPEG_ATTACH_LOG,
+    MMAL_PARAMETER_ZERO_SHUTTER_LAG,
+    MMAL_PARAMETER_FPS_RANGE,
+    MMAL_PARAMETER_CAPTURE_EXPOSURE_COMP,
+    MMAL_PARAMETER_SW_SHARPEN_DISABLE,
+    MMAL_PARAMETER_FLASH_REQUIRED,
+    MMAL_PARAMETER_SW_SATURATION_DISABLE,
+    MMAL_PARAMETER_SHUTTER_SPEED,
+    MMAL_PARAMETER_CUSTOM_AWB_GAINS,
+    MMAL_PARAMETER_CAMERA_SETTINGS,
+    MMAL_PARAMETER_PRIVACY_INDICATOR,
+    MMAL_PARAMETER_VIDEO_DENOISE,
+    MMAL_PARAMETER_STILLS_DENOISE,
+    MMAL_PARAMETER_ANNOTATE,
+    MMAL_PARAMETER_STEREOSCOPIC_MODE
+};
+
+enum {
+    MMAL_PARAMETER_DISPLAYREGION = MMAL_PARAMETER_GROUP_VIDEO,
+    MMAL_PARAMETER_SUPPORTED_PROFILES,
+    MMAL_PARAMETER_PROFILE,
+    MMAL_PARAMETER_INTRAPERIOD,
+    MMAL_PARAMETER_RATECONTROL,
+    MMAL_PARAMETER_NALUNITFORMAT,
+    MMAL_PARAMETER_MINIMISE_FRAGMENTATION,
+    MMAL_PARAMETER_MB_ROWS_PER_SLICE,
+    MMAL_PARAMETER_VIDEO_LEVEL_EXTENSION,
+    MMAL_PARAMETER_VIDEO_EEDE_ENABLE,
+    MMAL_PARAMETER_VIDEO_EEDE_LOSSRATE,
+    MMAL_PARAMETER_VIDEO_REQUEST_I_FRAME,
+    MMAL_PARAMETER_VIDEO_INTRA_REFRESH,
+    MMAL_PARAMETER_VIDEO_IMMUTABLE_INPUT,
+    MMAL_PARAMETER_VIDEO_BIT_RATE,
+    MMAL_PARAMETER_VIDEO_FRAME_RATE
+};
+
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; MMAL_BOOL_T     enable; } MMAL_PARAMETER_BOOLEAN_T;
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; uint32_t        value;  } MMAL_PARAMETER_UINT32_T;
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; int32_t         value;  } MMAL_PARAMETER_INT32_T;
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; uint64_t        value;  } MMAL_PARAMETER_UINT64_T;
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; int64_t         value;  } MMAL_PARAMETER_INT64_T;
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; MMAL_RATIONAL_T value;  } MMAL_PARAMETER_RATIONAL_T;
+
+typedef struct {
+    MMAL_PARAMETER_HEADER_T hdr;
+    uint32_t                change_id;
+    MMAL_BOOL_T             enable;
+} MMAL_PARAMETER_CHANGE_EVENT_REQUEST_T;
+
+typedef enum {
+    MMAL_PARAM_AWBMODE_OFF,
+    MMAL_PARAM_AWBMODE_AUTO,
+    MMAL_PARAM_AWBMODE_SUNLIGHT,
+    MMAL_PARAM_AWBMODE_CLOUDY,
+    MMAL_PARAM_AWBMODE_SHADE,
+    MMAL_PARAM_AWBMODE_TUNGSTEN,
+    MMAL_PARAM_AWBMODE_FLUORESCENT,
+    MMAL_PARAM_AWBMODE_INCANDESCENT,
+    MMAL_PARAM_AWBMODE_FLASH,
+    MMAL_PARAM_AWBMODE_HORIZON,
+    MMAL_PARAM_AWBMODE_MAX = 0x7fffffff
+} MMAL_PARAM_AWBMODE_T;
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; MMAL_PARAM_AWBMODE_T value; } MMAL_PARAMETER_AWBMODE_T;
+
+typedef enum {
+    MMAL_PARAM_FLASH_OFF,
+    MMAL_PARAM_FLASH_AUTO,
+    MMAL_PARAM_FLASH_ON,
+    MMAL_PARAM_FLASH_REDEYE,
+    MMAL_PARAM_FLASH_FILLIN,
+    MMAL_PARAM_FLASH_TORCH,
+    MMAL_PARAM_FLASH_MAX = 0x7FFFFFFF
+} MMAL_PARAM_FLASH_T;
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; MMAL_PARAM_FLASH_T value; } MMAL_PARAMETER_FLASH_T;
+
+typedef enum {
+    MMAL_PARAM_MIRROR_NONE,
+    MMAL_PARAM_MIRROR_VERTICAL,
+    MMAL_PARAM_MIRROR_HORIZONTAL,
+    MMAL_PARAM_MIRROR_BOTH
+} MMAL_PARAM_MIRROR_T;
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; MMAL_PARAM_MIRROR_T value; } MMAL_PARAMETER_MIRROR_T;
+
+typedef enum {
+    MMAL_PARAM_EXPOSUREMODE_OFF,
+    MMAL_PARAM_EXPOSUREMODE_AUTO,
+    MMAL_PARAM_EXPOSUREMODE_NIGHT,
+    MMAL_PARAM_EXPOSUREMODE_NIGHTPREVIEW,
+    MMAL_PARAM_EXPOSUREMODE_BACKLIGHT,
+    MMAL_PARAM_EXPOSUREMODE_SPOTLIGHT,
+    MMAL_PARAM_EXPOSUREMODE_SPORTS,
+    MMAL_PARAM_EXPOSUREMODE_SNOW,
+    MMAL_PARAM_EXPOSUREMODE_BEACH,
+    MMAL_PARAM_EXPOSUREMODE_VERYLONG,
+    MMAL_PARAM_EXPOSUREMODE_FIXEDFPS,
+    MMAL_PARAM_EXPOSUREMODE_ANTISHAKE,
+    MMAL_PARAM_EXPOSUREMODE_FIREWORKS,
+    MMAL_PARAM_EXPOSUREMODE_MAX = 0x7fffffff
+} MMAL_PARAM_EXPOSUREMODE_T;
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; MMAL_PARAM_EXPOSUREMODE_T value; } MMAL_PARAMETER_EXPOSUREMODE_T;
+
+typedef enum {
+    MMAL_PARAM_EXPOSUREMETERINGMODE_AVERAGE,
+    MMAL_PARAM_EXPOSUREMETERINGMODE_SPOT,
+    MMAL_PARAM_EXPOSUREMETERINGMODE_BACKLIT,
+    MMAL_PARAM_EXPOSUREMETERINGMODE_MATRIX,
+    MMAL_PARAM_EXPOSUREMETERINGMODE_MAX = 0x7fffffff
+} MMAL_PARAM_EXPOSUREMETERINGMODE_T;
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; MMAL_PARAM_EXPOSUREMETERINGMODE_T value; } MMAL_PARAMETER_EXPOSUREMETERINGMODE_T;
+
+typedef enum {
+    MMAL_PARAM_TIMESTAMP_MODE_ZERO,
+    MMAL_PARAM_TIMESTAMP_MODE_RAW_STC,
+    MMAL_PARAM_TIMESTAMP_MODE_RESET_STC,
+    MMAL_PARAM_TIMESTAMP_MODE_MAX = 0x7FFFFFFF
+} MMAL_CAMERA_STC_MODE_T;
+
+typedef struct {
+    MMAL_PARAMETER_HEADER_T hdr;
+    uint32_t max_stills_w;
+    uint32_t max_stills_h;
+    uint32_t stills_yuv422;
+    uint32_t one_shot_stills;
+    uint32_t max_preview_video_w;
+    uint32_t max_preview_video_h;
+    uint32_t num_preview_video_frames;
+    uint32_t stills_capture_circular_buffer_height;
+    uint32_t fast_preview_resume;
+    MMAL_CAMERA_STC_MODE_T use_stc_timestamp;
+} MMAL_PARAMETER_CAMERA_CONFIG_T;
+
+typedef struct {
+    MMAL_PARAMETER_HEADER_T hdr;
+    MMAL_RATIONAL_T         frame_rate;
+} MMAL_PARAMETER_FRAME_RATE_T;
+
+typedef enum {
+    MMAL_PARAMETER_DRC_STRENGTH_OFF,
+    MMAL_PARAMETER_DRC_STRENGTH_LOW,
+    MMAL_PARAMETER_DRC_STRENGTH_MEDIUM,
+    MMAL_PARAMETER_DRC_STRENGTH_HIGH,
+    MMAL_PARAMETER_DRC_STRENGTH_MAX = 0x7fffffff
+} MMAL_PARAMETER_DRC_STRENGTH_T;
+typedef struct { MMAL_PARAMETER_HEADER_T hdr; MMAL_PARAMETER_DRC_STRENGTH_T strength; } MMAL_PARAMETER_DRC_T;
+
+typedef struct {
+    MMAL_PARAMETER_HEADER_T hdr;
+    MMAL_RATIONAL_T         r_gain;
+    MMAL_RATIONAL_T         b_gain;
+} MMAL_PARAMETER_AWB_GAINS_T;
+
+typedef struct {
+    MMAL_PARAMETER_HEADER_T hdr;
+    uint32_t        exposure;
+    MMAL_RATIONAL_T analog_gain;
+    MMAL_RATIONAL_T digital_gain;
+    MMAL_RATIONAL_T awb_red_gain;
+    MMAL_RATIONAL_T awb_blue_gain;
+    MMAL_RATIONAL_T focus_position;
+} MMAL_PARAMETER_CAMERA_SETTINGS_T;
+
+/* mmal_events.h */
+
+#define MMAL_EVENT_ERROR                 MMAL_FOURCC('E','R','R','O')
+#define MMAL_EVENT_EOS                   MMAL_FOURCC('E','E','O','S')
+#define MMAL_EVENT_FORMAT_CHANGED        MMAL_FOURCC('E','F','C','H')
+#define MMAL_EVENT_PARAMETER_CHANGED     MMAL_FOURCC('E','P','C','H')
+
+typedef struct {
+    MMAL_PARAMETER_HEADER_T hdr;
+} MMAL_EVENT_PARAMETER_CHANGED_T;
+
+/* mmal_port.h */
+
+typedef enum {
+    MMAL_PORT_TYPE_UNKNOWN = 0,
+    MMAL_PORT_TYPE_CONTROL,
+    MMAL_PORT_TYPE_INPUT,
+    MMAL_PORT_TYPE_OUTPUT,
+    MMAL_PORT_TYPE_CLOCK
+} MMAL_PORT_TYPE_T;
+
+struct MMAL_PORT_PRIVATE_T;
+struct MMAL_PORT_USERDATA_T;
+struct MMAL_COMPONENT_T;
+
+typedef struct MMAL_PORT_T {
+    struct MMAL_PORT_PRIVATE_T  *priv;
+    const char                  *name;
+    MMAL_PORT_TYPE_T             type;
+    uint16_t                     index;
+    uint16_t                     index_all;
+    uint32_t                     is_enabled;
+    MMAL_ES_FORMAT_T            *format;
+    uint32_t                     buffer_num_min;
+    uint32_t                     buffer_size_min;
+    uint32_t                     buffer_alignment_min;
+    uint32_t                     buffer_num_recommended;
+    uint32_t                     buffer_size_recommended;
+    uint32_t                     buffer_num;
+    uint32_t                     buffer_size;
+    struct MMAL_COMPONENT_T     *component;
+    struct MMAL_PORT_USERDATA_T *userdata;
+    uint32_t                     capabilities;
+} MMAL_PORT_T;
+
+typedef void (*MMAL_PORT_BH_CB_T)(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+MMAL_STATUS_T mmal_port_format_commit(MMAL_PORT_T *port);
+MMAL_STATUS_T mmal_port_enable(MMAL_PORT_T *port, MMAL_PORT_BH_CB_T cb);
+MMAL_STATUS_T mmal_port_disable(MMAL_PORT_T *port);
+MMAL_STATUS_T mmal_port_flush(MMAL_PORT_T *port);
+MMAL_STATUS_T mmal_port_parameter_set(MMAL_PORT_T *port, const MMAL_PARAMETER_HEADER_T *param);
+MMAL_STATUS_T mmal_port_parameter_get(MMAL_PORT_T *port, MMAL_PARAMETER_HEADER_T *param);
+MMAL_STATUS_T mmal_port_send_buffer(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+/* mmal_component.h */
+
+struct MMAL_COMPONENT_PRIVATE_T;
+
+typedef struct MMAL_COMPONENT_T {
+    struct MMAL_COMPONENT_PRIVATE_T *priv;
+    void                            *userdata;
+    const char                      *name;
+    uint32_t                         is_enabled;
+    MMAL_PORT_T                     *control;
+    uint32_t                         input_num;
+    MMAL_PORT_T                    **input;
+    uint32_t                         output_num;
+    MMAL_PORT_T                    **output;
+    uint32_t                         clock_num;
+    MMAL_PORT_T                    **clock;
+    uint32_t                         port_num;
+    MMAL_PORT_T                    **port;
+    uint32_t                         id;
+} MMAL_COMPONENT_T;
+
+MMAL_STATUS_T mmal_component_create(const char *name, MMAL_COMPONENT_T **component);
+MMAL_STATUS_T mmal_component_destroy(MMAL_COMPONENT_T *component);
+MMAL_STATUS_T mmal_component_enable(MMAL_COMPONENT_T *component);
+MMAL_STATUS_T mmal_component_disable(MMAL_COMPONENT_T *component);
+
+#endif /* FlashCam_standin_mmal_h */
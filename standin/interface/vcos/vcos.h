@@ -0,0 +1,205 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+//
+// Software stand-in for the subset of VCOS used by FlashCam.
+// Only used when building with BUILD_FLASHCAM_WITH_STANDIN (see CMakeLists.txt).
+//
+
+#ifndef FlashCam_standin_vcos_h
+#define FlashCam_standin_vcos_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+typedef uint32_t VCOS_UNSIGNED;
+
+typedef enum {
+    VCOS_SUCCESS = 0,
+    VCOS_EAGAIN,
+    VCOS_ENOENT,
+    VCOS_ENOSPC,
+    VCOS_EINVAL,
+    VCOS_EACCESS,
+    VCOS_ENOMEM,
+    VCOS_ENOSYS,
+    VCOS_EEXIST,
+    VCOS_ENXIO,
+    VCOS_EINTR
+} VCOS_STATUS_T;
+
+#define VCOS_FUNCTION               __func__
+#define vcos_min(x,y) ((x) < (y) ? (x) : (y))
+#define vcos_max(x,y) ((x) > (y) ? (x) : (y))
+#define VCOS_ALIGN_UP(value, round) ((((unsigned long)(value)) + (round) - 1) & ~((unsigned long)(round) - 1))
+#define VCOS_ALIGN_DOWN(value, round) (((unsigned long)(value)) & ~((unsigned long)(round) - 1))
+
+/* semaphores */
+typedef sem_t VCOS_SEMAPHORE_T;
+
+static inline VCOS_STATUS_T vcos_semaphore_create(VCOS_SEMAPHORE_T *sem, const char *name, VCOS_UNSIGNED count) {
+    (void) name;
+    return sem_init(sem, 0, count) == 0 ? VCOS_SUCCESS : VCOS_ENOSPC;
+}
+
+static inline void vcos_semaphore_wait(VCOS_SEMAPHORE_T *sem) {
+    while (sem_wait(sem) == -1 && errno == EINTR);
+}
+
+static inline VCOS_STATUS_T vcos_semaphore_trywait(VCOS_SEMAPHORE_T *sem) {
+    return sem_trywait(sem) == 0 ? VCOS_SUCCESS : VCOS_EAGAIN;
+}
+
+static inline VCOS_STATUS_T vcos_semaphore_wait_timeout(VCOS_SEMAPHORE_T *sem, VCOS_UNSIGNED timeout) {
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    t.tv_sec  += timeout / 1000;
+    t.tv_nsec += (timeout % 1000) * 1000000;
+    if (t.tv_nsec >= 1000000000) {
+        t.tv_sec  += 1;
+        t.tv_nsec -= 1000000000;
+    }
+    int ret;
+    while (((ret = sem_timedwait(sem, &t)) == -1) && (errno == EINTR));
+    return (ret == 0) ? VCOS_SUCCESS : VCOS_EAGAIN;
+}
+
+static inline VCOS_STATUS_T vcos_semaphore_post(VCOS_SEMAPHORE_T *sem) {
+    sem_post(sem);
+    return VCOS_SUCCESS;
+}
+
+static inline void vcos_semaphore_delete(VCOS_SEMAPHORE_T *sem) {
+    sem_destroy(sem);
+}
+
+/* mutexes */
+typedef pthread_mutex_t VCOS_MUTEX_T;
+
+static inline VCOS_STATUS_T vcos_mutex_create(VCOS_MUTEX_T *m, const char *name) {
+    (void) name;
+    return pthread_mutex_init(m, NULL) == 0 ? VCOS_SUCCESS : VCOS_ENOSPC;
+}
+
+static inline void vcos_mutex_lock(VCOS_MUTEX_T *m)   { pthread_mutex_lock(m);   }
+static inline void vcos_mutex_unlock(VCOS_MUTEX_T *m) { pthread_mutex_unlock(m); }
+static inline void vcos_mutex_delete(VCOS_MUTEX_T *m) { pthread_mutex_destroy(m); }
+
+/* threads */
+typedef void *(*VCOS_THREAD_ENTRY_FN_T)(void *);
+
+typedef struct {
+    pthread_t thread;
+} VCOS_THREAD_T;
+
+typedef struct {
+    int unused;
+} VCOS_THREAD_ATTR_T;
+
+static inline VCOS_STATUS_T vcos_thread_create(VCOS_THREAD_T *thread, const char *name, VCOS_THREAD_ATTR_T *attrs, VCOS_THREAD_ENTRY_FN_T entry, void *arg) {
+    (void) name; (void) attrs;
+    return pthread_create(&thread->thread, NULL, entry, arg) == 0 ? VCOS_SUCCESS : VCOS_ENOSPC;
+}
+
+static inline void vcos_thread_join(VCOS_THREAD_T *thread, void **pData) {
+    pthread_join(thread->thread, pData);
+}
+
+static inline void vcos_sleep(uint32_t ms) {
+    usleep(ms * 1000);
+}
+
+static inline VCOS_STATUS_T vcos_init(void) {
+    return VCOS_SUCCESS;
+}
+
+/* logging */
+typedef enum {
+    VCOS_LOG_UNINITIALIZED = 0,
+    VCOS_LOG_NEVER,
+    VCOS_LOG_ERROR,
+    VCOS_LOG_WARN,
+    VCOS_LOG_INFO,
+    VCOS_LOG_TRACE
+} VCOS_LOG_LEVEL_T;
+
+typedef struct {
+    VCOS_LOG_LEVEL_T level;
+    const char      *name;
+} VCOS_LOG_CAT_T;
+
+#ifndef VCOS_LOG_CATEGORY
+#define VCOS_LOG_CATEGORY (&vcos_standin_log_category)
+static VCOS_LOG_CAT_T __attribute__((unused)) vcos_standin_log_category = { VCOS_LOG_ERROR, "standin" };
+#endif
+
+static inline void vcos_log_register(const char *name, VCOS_LOG_CAT_T *category) {
+    category->name = name;
+    if (category->level == VCOS_LOG_UNINITIALIZED)
+        category->level = VCOS_LOG_ERROR;
+}
+
+static inline void vcos_log_set_level(VCOS_LOG_CAT_T *category, VCOS_LOG_LEVEL_T level) {
+    category->level = level;
+}
+
+static inline void vcos_standin_log(VCOS_LOG_CAT_T *category, VCOS_LOG_LEVEL_T level, const char *fmt, ...) {
+    if (level > category->level)
+        return;
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", category->name ? category->name : "vcos");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+}
+
+#define vcos_log_error(...) vcos_standin_log(VCOS_LOG_CATEGORY, VCOS_LOG_ERROR, __VA_ARGS__)
+#define vcos_log_warn(...)  vcos_standin_log(VCOS_LOG_CATEGORY, VCOS_LOG_WARN,  __VA_ARGS__)
+#define vcos_log_info(...)  vcos_standin_log(VCOS_LOG_CATEGORY, VCOS_LOG_INFO,  __VA_ARGS__)
+#define vcos_log_trace(...) vcos_standin_log(VCOS_LOG_CATEGORY, VCOS_LOG_TRACE, __VA_ARGS__)
+
+#endif /* FlashCam_standin_vcos_h */
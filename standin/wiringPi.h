@@ -0,0 +1,66 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+//
+// wiringPi stand-in: the PLL drives the PWM pin through these calls. Without
+// real hardware the last written duty cycle is kept so tests can inspect it.
+//
+
+#ifndef FlashCam_standin_wiringPi_h
+#define FlashCam_standin_wiringPi_h
+
+#include <stdint.h>
+
+#define INPUT             0
+#define OUTPUT            1
+#define PWM_OUTPUT        2
+#define GPIO_CLOCK        3
+
+#define PWM_MODE_MS       0
+#define PWM_MODE_BAL      1
+
+int  wiringPiSetup(void);
+void pinMode(int pin, int mode);
+void pwmSetMode(int mode);
+void pwmSetRange(unsigned int range);
+void pwmSetClock(int divisor);
+void pwmWrite(int pin, int value);
+
+// Stand-in only: is the PWM pin high at `us` (CLOCK_MONOTONIC)? The synthetic camera brightens frames exposed during the pulse.
+bool standin_pwm_high(uint64_t us);
+
+#endif /* FlashCam_standin_wiringPi_h */
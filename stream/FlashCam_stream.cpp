@@ -0,0 +1,159 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_stream.h"
+
+#include "interface/mmal/mmal.h"
+
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+
+// Rate window (us)
+#define FLASHCAM_STREAM_WINDOW 1000000
+
+namespace FlashCamStream {
+    
+    static uint64_t monotonic_us() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+    }
+    
+    // Single writer (camera callback): plain read-modify-write, atomic for readers.
+    static inline void inc(std::atomic<uint64_t> &counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    
+    static float ratio(uint64_t n, uint64_t d) {
+        return (d > 0) ? ((float) n / (float) d) : 0.0f;
+    }
+    
+    // Interval to previous frame: frames missing in between.
+    static void gap(FLASHCAM_STREAM_T *stream, uint64_t pts, float framerate) {
+        if (pts == (uint64_t) MMAL_TIME_UNKNOWN)
+            return;
+        
+        if ((stream->last_pts) && (pts > stream->last_pts)) {
+            uint64_t interval = pts - stream->last_pts;
+            if (interval > stream->gap_max.load(std::memory_order_relaxed))
+                stream->gap_max.store(interval, std::memory_order_relaxed);
+            
+            // An interval of 1.5 period or more is at least one missing frame
+            if (framerate > 0) {
+                float periods = roundf(interval * framerate / 1000000.0f);
+                if (periods > 1)
+                    inc(stream->dropped, (uint64_t) periods - 1);
+            }
+        }
+        stream->last_pts = pts;
+    }
+    
+    // Update rates once per window
+    static void rates(FLASHCAM_STREAM_T *stream) {
+        uint64_t t = monotonic_us();
+        if (stream->window_start == 0)
+            stream->window_start = t;
+        if (t - stream->window_start < FLASHCAM_STREAM_WINDOW)
+            return;
+        
+        uint64_t received  = stream->received.load(std::memory_order_relaxed)  - stream->window[0];
+        uint64_t dropped   = stream->dropped.load(std::memory_order_relaxed)   - stream->window[1];
+        uint64_t discarded = stream->discarded.load(std::memory_order_relaxed) - stream->window[2];
+        uint64_t aborted   = stream->aborted.load(std::memory_order_relaxed)   - stream->window[3];
+        
+        stream->fps.store(received * 1000000.0f / (t - stream->window_start), std::memory_order_relaxed);
+        stream->drop_rate.store(ratio(dropped, received + dropped), std::memory_order_relaxed);
+        stream->discard_rate.store(ratio(discarded, received), std::memory_order_relaxed);
+        stream->abort_rate.store(ratio(aborted, received), std::memory_order_relaxed);
+        
+        stream->window[0]   += received;
+        stream->window[1]   += dropped;
+        stream->window[2]   += discarded;
+        stream->window[3]   += aborted;
+        stream->window_start = t;
+    }
+    
+    void start(FLASHCAM_STREAM_T *stream) {
+        stream->last_pts     = 0;
+        stream->window_start = 0;
+        stream->window[0]    = stream->received.load(std::memory_order_relaxed);
+        stream->window[1]    = stream->dropped.load(std::memory_order_relaxed);
+        stream->window[2]    = stream->discarded.load(std::memory_order_relaxed);
+        stream->window[3]    = stream->aborted.load(std::memory_order_relaxed);
+    }
+    
+    void frame(FLASHCAM_STREAM_T *stream, uint64_t pts, float framerate) {
+        inc(stream->received, 1);
+        gap(stream, pts, framerate);
+        rates(stream);
+    }
+    
+    void discard(FLASHCAM_STREAM_T *stream, unsigned int frames) {
+        inc(stream->discarded, frames);
+    }
+    
+    void abort(FLASHCAM_STREAM_T *stream, uint64_t pts, float framerate) {
+        inc(stream->aborted, 1);
+        frame(stream, pts, framerate);
+    }
+    
+    void get(FLASHCAM_STREAM_T *stream, FLASHCAM_STREAM_STATS_T *stats) {
+        stats->received     = stream->received.load(std::memory_order_relaxed);
+        stats->dropped      = stream->dropped.load(std::memory_order_relaxed);
+        stats->discarded    = stream->discarded.load(std::memory_order_relaxed);
+        stats->aborted      = stream->aborted.load(std::memory_order_relaxed);
+        stats->gap_max      = stream->gap_max.load(std::memory_order_relaxed);
+        stats->fps          = stream->fps.load(std::memory_order_relaxed);
+        stats->drop_rate    = stream->drop_rate.load(std::memory_order_relaxed);
+        stats->discard_rate = stream->discard_rate.load(std::memory_order_relaxed);
+        stats->abort_rate   = stream->abort_rate.load(std::memory_order_relaxed);
+    }
+    
+    void reset(FLASHCAM_STREAM_T *stream) {
+        stream->received.store(0, std::memory_order_relaxed);
+        stream->dropped.store(0, std::memory_order_relaxed);
+        stream->discarded.store(0, std::memory_order_relaxed);
+        stream->aborted.store(0, std::memory_order_relaxed);
+        stream->gap_max.store(0, std::memory_order_relaxed);
+        stream->fps.store(0, std::memory_order_relaxed);
+        stream->drop_rate.store(0, std::memory_order_relaxed);
+        stream->discard_rate.store(0, std::memory_order_relaxed);
+        stream->abort_rate.store(0, std::memory_order_relaxed);
+        start(stream);
+    }
+}
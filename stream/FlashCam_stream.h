@@ -0,0 +1,66 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_stream_h
+#define FlashCam_stream_h
+
+
+#include "FlashCam_types.h"
+
+namespace FlashCamStream {
+    
+    // New stream: the first frame does not count as a gap. Counters are kept.
+    void start(FLASHCAM_STREAM_T *stream);
+    
+    // A frame with sensor timestamp `pts` arrived while the camera runs at `framerate`.
+    //  Missing frames are derived from the interval to the previous frame.
+    void frame(FLASHCAM_STREAM_T *stream, uint64_t pts, float framerate);
+    
+    // `frames` received frames were not delivered.
+    void discard(FLASHCAM_STREAM_T *stream, unsigned int frames);
+    
+    // A frame was aborted by the camera.
+    void abort(FLASHCAM_STREAM_T *stream, uint64_t pts, float framerate);
+    
+    // Copy counters and rates. Lock-free, can be called while streaming.
+    void get(FLASHCAM_STREAM_T *stream, FLASHCAM_STREAM_STATS_T *stats);
+    
+    // Clear all counters (not while streaming).
+    void reset(FLASHCAM_STREAM_T *stream);
+}
+
+#endif /* FlashCam_stream_h */
@@ -0,0 +1,162 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// 0-7
+#define SENSORMODE   7
+// Pixels
+#define FRAME_WIDTH  320
+#define FRAME_HEIGHT 240
+// hz - framerate of camera
+#define FRAMERATE    120
+// seconds of capture per run
+#define DURATION     5
+
+// kernel: temporal sum of the Y plane (cheap, memory bound)
+static uint32_t acc[FRAME_WIDTH * FRAME_HEIGHT];
+static volatile unsigned long frames = 0, callbacks = 0;
+static volatile uint64_t kernel_us = 0;
+
+static uint64_t now_us() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+}
+
+static uint64_t cpu_us() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return ((uint64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// per frame: accumulator is read and written for every frame
+void flashcam_callback(unsigned char *frame, int w, int h) {
+    uint64_t start = now_us();
+    for (int i=0; i<w*h; i++)
+        acc[i] += frame[i];
+    kernel_us += now_us() - start;
+    frames++;
+    callbacks++;
+}
+
+// per batch: accumulator is read and written once for all frames of the batch
+void flashcam_callback_batch(const FLASHCAM_BATCH_VIEW_T *batch) {
+    uint64_t start = now_us();
+    unsigned int n = batch->width * batch->height;
+    for (unsigned int i=0; i<n; i+=64) {
+        uint32_t sum[64] = {};
+        for (unsigned int f=0; f<batch->num; f++) {
+            const unsigned char *y = batch->data + ((size_t) f) * batch->framesize + i;
+            for (unsigned int j=0; j<64; j++)
+                sum[j] += y[j];
+        }
+        for (unsigned int j=0; j<64; j++)
+            acc[i + j] += sum[j];
+    }
+    kernel_us += now_us() - start;
+    frames += batch->num;
+    callbacks++;
+}
+
+void run(FLASHCAM_DELIVERY_T delivery, unsigned int size) {
+    FLASHCAM_STREAM_STATS_T stream;
+    FLASHCAM_STATS_T stats;
+    
+    FlashCam::get().setSettingDelivery(delivery);
+    FlashCam::get().setSettingBatchSize(size);
+    frames = callbacks = kernel_us = 0;
+    FlashCam::get().resetStreamStats();
+    FlashCam::get().resetStats();
+    
+    uint64_t cpu = cpu_us(), start = now_us();
+    FlashCam::get().startCapture();
+    sleep(DURATION);
+    FlashCam::get().stopCapture();
+    cpu = cpu_us() - cpu;
+    float seconds = (now_us() - start) / 1000000.0f;
+    
+    FlashCam::get().getStreamStats( &stream );
+    FlashCam::get().getStats( &stats );
+    fprintf(stdout, "%-5s (K=%2u): frames: %5lu; callbacks: %5lu; fps: %6.2f; dropped: %3llu; overruns: %3llu; cpu: %6.1f us/frame; kernel: %5.1f us/frame\n",
+            (delivery == FLASHCAM_DELIVERY_BATCH) ? "batch" : "copy", size, frames, callbacks, frames / seconds, (unsigned long long) stream.dropped,
+            (unsigned long long) stats.overruns, frames ? cpu / (float) frames : 0.0f, frames ? kernel_us / (float) frames : 0.0f);
+    fflush(stdout);
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- BATCH-BENCHMARK -- \n\n");
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings: Y plane only
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    settings.extract.planes=FLASHCAM_PLANE_Y;
+    
+    //create camera with settings
+    FlashCam::get().setSettings( &settings );
+    FlashCam::get().setFrameRate(FRAMERATE);
+    FlashCam::get().setFrameCallback(flashcam_callback);
+    FlashCam::get().setFrameCallback(flashcam_callback_batch);
+    
+    //get & print settings
+    FlashCam::get().getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\n");
+    fflush(stdout);
+    
+    run(FLASHCAM_DELIVERY_COPY , 1);
+    run(FLASHCAM_DELIVERY_BATCH, 1);
+    run(FLASHCAM_DELIVERY_BATCH, 4);
+    run(FLASHCAM_DELIVERY_BATCH, 8);
+    run(FLASHCAM_DELIVERY_BATCH, 16);
+    return 0;
+}
@@ -0,0 +1,142 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// 0-7
+#define SENSORMODE   5
+// Pixels
+#define FRAME_WIDTH  1640
+#define FRAME_HEIGHT 922
+// hz - framerate of camera
+#define FRAMERATE    30
+// seconds of capture
+#define DURATION     10
+// ms between samples of the GPU clock
+#define INTERVAL     500
+// calls for timing translateTime() and getGPUtime()
+#define CALLS        10000
+
+static uint64_t now_us() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+}
+
+// frames in CLOCK_MONOTONIC: time from exposure (host) to callback, and error bound of host
+static volatile unsigned long frames = 0, unknown = 0;
+static volatile uint64_t latency = 0, latency_max = 0, error = 0, error_max = 0;
+
+void flashcam_callback_view(FLASHCAM_FRAME_VIEW_T *frame) {
+    uint64_t t = now_us();
+    if (frame->host) {
+        uint64_t l  = t - frame->host;
+        latency    += l;
+        latency_max = (l > latency_max) ? l : latency_max;
+        error      += frame->host_error;
+        error_max   = (frame->host_error > error_max) ? frame->host_error : error_max;
+        frames++;
+    } else {
+        unknown++;
+    }
+    FlashCam::get().releaseFrame(frame);
+}
+
+int main(int argc, const char **argv) {
+    FLASHCAM_CLOCK_ESTIMATE_T estimate;
+    
+    fprintf(stdout, "\n -- CLOCK-BENCHMARK -- \n\n");
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    settings.delivery=FLASHCAM_DELIVERY_ZEROCOPY;
+    settings.clock_interval=INTERVAL;
+    
+    //create camera with settings
+    FlashCam::get().setSettings( &settings );
+    FlashCam::get().setFrameRate(FRAMERATE);
+    FlashCam::get().setFrameCallback(flashcam_callback_view);
+    
+    //get & print settings
+    FlashCam::get().getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\n");
+    fflush(stdout);
+    
+    //estimate converges while streaming
+    FlashCam::get().startCapture();
+    for (unsigned int i=0; i<DURATION; i++) {
+        sleep(1);
+        FlashCam::get().getClockEstimate( &estimate );
+        fprintf(stdout, "%2us: samples: %2u; offset: %16.1f us; drift: %8.3f ppm (+/- %7.3f); error: %6.1f us\n", i+1, estimate.samples,
+                estimate.offset, estimate.drift * 1e6, estimate.drift_error * 1e6, estimate.error);
+        fflush(stdout);
+    }
+    
+    //cost of a timestamp: translation vs. MMAL round trip
+    uint64_t gpu_us = 0, host_us, t0, t1, t2;
+    uint32_t error_us;
+    FlashCam::get().getGPUtime(&gpu_us);
+    t0 = now_us();
+    for (unsigned int i=0; i<CALLS; i++)
+        FlashCam::get().translateTime(gpu_us + i, &host_us, &error_us);
+    t1 = now_us();
+    for (unsigned int i=0; i<CALLS; i++)
+        FlashCam::get().getGPUtime(&gpu_us);
+    t2 = now_us();
+    FlashCam::get().stopCapture();
+    
+    fprintf(stdout, "\nframes    : with host time: %5lu; without: %3lu\n", frames, unknown);
+    fprintf(stdout, "latency   : exposure to callback: avg %7.2f ms, max %7.2f ms\n", frames ? latency / 1000.0 / frames : 0.0, latency_max / 1000.0);
+    fprintf(stdout, "error     : avg %7.1f us, max %7" PRIu64 " us\n", frames ? ((double) error) / frames : 0.0, (uint64_t) error_max);
+    fprintf(stdout, "cost      : translateTime %7.3f us/call; getGPUtime %7.3f us/call\n", (t1 - t0) / (double) CALLS, (t2 - t1) / (double) CALLS);
+    return 0;
+}
@@ -0,0 +1,139 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_util_copy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ALIGN_UP(v, a) ((((v) + (a) - 1) / (a)) * (a))
+
+// seconds per kernel and resolution
+#define DURATION 0.5
+
+typedef struct {
+    unsigned int width;
+    unsigned int height;
+} RESOLUTION_T;
+
+// From the smallest sensible size up to the full resolution of the V2 sensor
+static const RESOLUTION_T resolutions[] = {
+    {  320,  240 },
+    {  640,  480 },
+    { 1280,  720 },
+    { 1640,  922 },
+    { 1920, 1080 },
+    { 2592, 1944 },
+    { 3280, 2464 },
+};
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Copy a padded I420 frame (as delivered by MMAL) into a packed frame
+static void copyFrame(uint8_t *dst, const uint8_t *src, unsigned int w, unsigned int h, unsigned int stride, unsigned int slice) {
+    const uint8_t *src_U = src   + stride * slice;
+    const uint8_t *src_V = src_U + (stride >> 1) * (slice >> 1);
+    uint8_t       *dst_U = dst   + w * h;
+    uint8_t       *dst_V = dst_U + (w >> 1) * (h >> 1);
+    
+    FlashCamUtilCopy::copyPlane(dst  , w     , src  , stride     , w     , h     );
+    FlashCamUtilCopy::copyPlane(dst_U, w >> 1, src_U, stride >> 1, w >> 1, h >> 1);
+    FlashCamUtilCopy::copyPlane(dst_V, w >> 1, src_V, stride >> 1, w >> 1, h >> 1);
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- PLANE-COPY-BENCHMARK -- \n\n");
+    
+    FLASHCAM_COPY_KERNEL_T kernels[] = { FLASHCAM_COPY_SCALAR, FLASHCAM_COPY_ARMV6, FLASHCAM_COPY_NEON, FLASHCAM_COPY_SSE2 };
+    
+    FlashCamUtilCopy::setKernel(FLASHCAM_COPY_AUTO);
+    fprintf(stdout, "Runtime selected kernel: %s\n\n", FlashCamUtilCopy::getKernelName(FlashCamUtilCopy::getKernel()));
+    fprintf(stdout, "%-11s %-7s %10s %10s %10s\n", "resolution", "kernel", "us/frame", "MB/s", "result");
+    
+    for (unsigned int r=0; r<sizeof(resolutions)/sizeof(resolutions[0]); r++) {
+        unsigned int w      = resolutions[r].width;
+        unsigned int h      = resolutions[r].height;
+        unsigned int stride = ALIGN_UP(w, 32);
+        unsigned int slice  = ALIGN_UP(h, 16);
+        size_t src_size     = stride * slice * 3 / 2;
+        size_t dst_size     = w * h * 3 / 2;
+        
+        uint8_t *src = (uint8_t *) malloc(src_size);
+        uint8_t *ref = (uint8_t *) malloc(dst_size);
+        uint8_t *dst = (uint8_t *) malloc(dst_size);
+        for (size_t i=0; i<src_size; i++)
+            src[i] = (uint8_t) (i * 7);
+        
+        //reference result
+        FlashCamUtilCopy::setKernel(FLASHCAM_COPY_SCALAR);
+        copyFrame(ref, src, w, h, stride, slice);
+        
+        for (unsigned int k=0; k<sizeof(kernels)/sizeof(kernels[0]); k++) {
+            if (!FlashCamUtilCopy::isSupported(kernels[k])) {
+                fprintf(stdout, "%5ux%-5u %-7s %10s %10s %10s\n", w, h, FlashCamUtilCopy::getKernelName(kernels[k]), "-", "-", "n/a");
+                continue;
+            }
+            FlashCamUtilCopy::setKernel(kernels[k]);
+            
+            memset(dst, 0, dst_size);
+            copyFrame(dst, src, w, h, stride, slice);
+            bool ok = (memcmp(dst, ref, dst_size) == 0);
+            
+            unsigned int frames = 0;
+            double t0 = now(), t1;
+            do {
+                copyFrame(dst, src, w, h, stride, slice);
+                frames++;
+            } while ((t1 = now()) - t0 < DURATION);
+            
+            double us = (t1 - t0) * 1e6 / frames;
+            fprintf(stdout, "%5ux%-5u %-7s %10.1f %10.1f %10s\n", w, h, FlashCamUtilCopy::getKernelName(kernels[k]), us, dst_size / us, ok ? "ok" : "MISMATCH");
+        }
+        
+        free(src);
+        free(ref);
+        free(dst);
+    }
+    
+    return 0;
+}
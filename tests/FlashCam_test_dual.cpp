@@ -0,0 +1,174 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// 0-7
+#define SENSORMODE   5
+// Pixels
+#define FRAME_WIDTH  1640
+#define FRAME_HEIGHT 922
+// hz - framerate of camera
+#define FRAMERATE    30
+// seconds per run
+#define DURATION     5
+// number of cameras (Compute Module: 2)
+#define CAMERAS      2
+
+typedef struct {
+    FlashCam            *cam;
+    double               elapsed;       // Duration of run (s)
+    std::atomic<double>  last;          // Time of last callback (s)
+    std::atomic<double>  gap_max;       // Longest interval between callbacks (s)
+    FLASHCAM_STATS_T     stats;         // Stats of run
+} CAMERA_T;
+
+static CAMERA_T cameras[CAMERAS];
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// one callback per camera: callbacks do not carry the instance
+template <int N>
+void flashcam_callback(unsigned char *frame, int w, int h) {
+    double t    = now();
+    double last = cameras[N].last.exchange(t);
+    if ((last > 0) && (t - last > cameras[N].gap_max))
+        cameras[N].gap_max = t - last;
+}
+
+static void *run_camera(void *arg) {
+    CAMERA_T *camera = (CAMERA_T*) arg;
+    
+    camera->last    = 0;
+    camera->gap_max = 0;
+    camera->cam->resetStats();
+    
+    double t0 = now();
+    camera->cam->startCapture();
+    sleep(DURATION);
+    camera->cam->stopCapture();
+    camera->elapsed = now() - t0;
+    
+    camera->cam->getStats( &(camera->stats) );
+    return NULL;
+}
+
+static void report(const char *name, unsigned int n) {
+    CAMERA_T *camera = &cameras[n];
+    fprintf(stdout, "%-10s: camera %u; frames: %6llu; fps: %6.2f; copied: %7.2f MB/s; max gap: %6.2f ms\n", name, n,
+            (unsigned long long) camera->stats.frames, camera->stats.frames / camera->elapsed,
+            camera->stats.bytes_copied / camera->elapsed / 1e6, camera->gap_max * 1000.0);
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- DUAL-CAMERA-BENCHMARK -- \n\n");
+    
+    FLASHCAM_CALLBACK_T callbacks[CAMERAS] = { &flashcam_callback<0>, &flashcam_callback<1> };
+    VCOS_THREAD_T       threads[CAMERAS];
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    
+    //create an instance per camera
+    for (unsigned int n=0; n<CAMERAS; n++) {
+        cameras[n].cam = new FlashCam(n);
+        cameras[n].cam->setSettings( &settings );
+        cameras[n].cam->setFrameCallback( callbacks[n] );
+        cameras[n].cam->setFrameRate(FRAMERATE);
+    }
+    
+    //get & print settings
+    cameras[0].cam->getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\n");
+    
+    //before: one camera at a time
+    for (unsigned int n=0; n<CAMERAS; n++) {
+        run_camera(&cameras[n]);
+        report("alone", n);
+    }
+    
+    //after: all cameras concurrently, each driven from its own thread
+    for (unsigned int n=0; n<CAMERAS; n++)
+        vcos_thread_create(&threads[n], "camera", NULL, run_camera, &cameras[n]);
+    for (unsigned int n=0; n<CAMERAS; n++)
+        vcos_thread_join(&threads[n], NULL);
+    for (unsigned int n=0; n<CAMERAS; n++)
+        report("concurrent", n);
+    
+#ifdef BUILD_FLASHCAM_WITH_PLL
+    //pin conflict: only one instance can drive the PWM pin. The second camera fails to start with the PLL,
+    // and must then start without it (its ring consumer was started before the PLL).
+    for (unsigned int n=0; n<CAMERAS; n++)
+        cameras[n].cam->setPLLEnabled(1);
+    cameras[1].cam->setSettingDelivery(FLASHCAM_DELIVERY_RING);
+    int first  = cameras[0].cam->startCapture();
+    int second = cameras[1].cam->startCapture();
+    fprintf(stdout, "pll       : camera 0 %s; camera 1 %s (expected: started, refused)\n",
+            first ? "refused" : "started", second ? "refused" : "started");
+    
+    cameras[1].cam->setPLLEnabled(0);
+    run_camera(&cameras[1]);
+    report("restarted", 1);
+    if (cameras[1].stats.frames == 0)
+        fprintf(stdout, "restarted : camera 1 delivered no frames after the pin conflict!\n");
+    
+    cameras[0].cam->stopCapture();
+#endif
+    
+    for (unsigned int n=0; n<CAMERAS; n++)
+        delete cameras[n].cam;
+    
+    return 0;
+}
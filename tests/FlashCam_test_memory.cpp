@@ -0,0 +1,164 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// 0-7
+#define SENSORMODE   5
+// Pixels
+#define FRAME_WIDTH  1640
+#define FRAME_HEIGHT 922
+// hz - framerate of camera
+#define FRAMERATE    30
+// resets per configuration
+#define CYCLES       4
+// seconds of capture per cycle (first second: start of stream)
+#define DURATION     3
+
+static volatile unsigned long frames = 0;
+static volatile unsigned int checksum = 0;
+
+void flashcam_callback(unsigned char *frame, int w, int h) {
+    //read a row, as a consumer would
+    for (int x=0; x<w; x+=64)
+        checksum += frame[x];
+    frames++;
+}
+
+static const char* name(unsigned int flags) {
+    switch (flags) {
+        case 0                                              : return "pageable";
+        case FLASHCAM_MEMORY_LOCK                           : return "locked";
+        case FLASHCAM_MEMORY_HUGEPAGES                      : return "hugepages";
+        case FLASHCAM_MEMORY_LOCK | FLASHCAM_MEMORY_HUGEPAGES: return "locked hugepages";
+    }
+    return "?";
+}
+
+// page faults of the process, apart from those taken when frame memory is mapped
+static uint64_t faults(FLASHCAM_MEMORY_STATS_T *stats) {
+    FlashCam::get().getMemoryStats( stats );
+    return stats->faults_minor + stats->faults_major - stats->prefaults;
+}
+
+// reset the camera and stream, repeatedly: faults at the start of the stream and in steady state
+void run(unsigned int flags) {
+    FLASHCAM_MEMORY_STATS_T stats;
+    FLASHCAM_SETTINGS_T settings;
+    uint64_t first = 0, steady = 0, first_max = 0;
+    
+    FlashCam::get().setSettingMemory(flags);
+    FlashCam::get().getMemoryStats( &stats );
+    uint64_t allocations = stats.allocations, reuses = stats.reuses;
+    
+    for (unsigned int c=0; c<CYCLES; c++) {
+        //re-applying the settings resets the camera (and its callback)
+        FlashCam::get().getSettings( &settings );
+        FlashCam::get().setSettings( &settings );
+        FlashCam::get().setFrameCallback(flashcam_callback);
+        
+        uint64_t f0 = faults(&stats);
+        FlashCam::get().startCapture();
+        sleep(1);
+        uint64_t f1 = faults(&stats);
+        sleep(DURATION - 1);
+        uint64_t f2 = faults(&stats);
+        FlashCam::get().stopCapture();
+        
+        first    += f1 - f0;
+        steady   += f2 - f1;
+        first_max = ((f1 - f0) > first_max) ? (f1 - f0) : first_max;
+    }
+    
+    FlashCam::get().getMemoryStats( &stats );
+    fprintf(stdout, "%-16s: mapped %6.1f MB (locked %6.1f MB, hugepages %6.1f MB); allocations: %3" PRIu64 "; reuses: %3" PRIu64 "\n", name(flags),
+            stats.mapped / 1048576.0f, stats.locked / 1048576.0f, stats.hugepages / 1048576.0f, stats.allocations - allocations, stats.reuses - reuses);
+    fprintf(stdout, "%-16s: page faults: first second %7.1f (max %5" PRIu64 "); steady state %7.1f /s\n", "", first / (double) CYCLES, first_max,
+            steady / (double) (CYCLES * (DURATION - 1)));
+    fflush(stdout);
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- MEMORY-BENCHMARK -- \n\n");
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    settings.delivery=FLASHCAM_DELIVERY_RING;
+    
+    //create camera with settings
+    FlashCam::get().setSettings( &settings );
+    FlashCam::get().setFrameRate(FRAMERATE);
+    FlashCam::get().setFrameCallback(flashcam_callback);
+    
+    //get & print settings
+    FlashCam::get().getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\n");
+    fflush(stdout);
+    
+    run(0);
+    run(FLASHCAM_MEMORY_LOCK);
+    run(FLASHCAM_MEMORY_LOCK | FLASHCAM_MEMORY_HUGEPAGES);
+    
+    //smaller frames fit in the mapped regions
+    FLASHCAM_MEMORY_STATS_T stats, before;
+    FlashCam::get().getMemoryStats( &before );
+    FlashCam::get().setSettingSize(FRAME_WIDTH / 2, FRAME_HEIGHT / 2);
+    FlashCam::get().setFrameCallback(flashcam_callback);
+    FlashCam::get().startCapture();
+    sleep(1);
+    FlashCam::get().stopCapture();
+    FlashCam::get().getMemoryStats( &stats );
+    fprintf(stdout, "\nsmaller         : allocations: %3" PRIu64 "; reuses: %3" PRIu64 "\n", stats.allocations - before.allocations,
+            stats.reuses - before.reuses);
+    fprintf(stdout, "frames          : %lu\n", frames);
+    return 0;
+}
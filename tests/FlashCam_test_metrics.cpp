@@ -0,0 +1,169 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// 0-7
+#define SENSORMODE   5
+// Pixels
+#define FRAME_WIDTH  1640
+#define FRAME_HEIGHT 922
+// hz - framerate of camera
+#define FRAMERATE    30
+// seconds per run
+#define DURATION     5
+// us between samples of monitor
+#define SAMPLE_US    100
+// shared-memory segment
+#define SEGMENT      "/flashcam_test_metrics"
+
+static volatile sig_atomic_t monitor_stop = 0;
+
+static void monitor_signal(int sig) {
+    monitor_stop = 1;
+}
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// external monitor: samples the published metrics until stopped
+static void monitor() {
+    const FLASHCAM_METRICS_BLOCK_T *block = NULL;
+    unsigned long samples = 0, regressions = 0;
+    uint64_t frames = 0;
+    
+    signal(SIGTERM, monitor_signal);
+    
+    //wait for FlashCam to publish
+    while (!monitor_stop && !(block = FlashCamMetrics::attach(SEGMENT)))
+        usleep(1000);
+    if (!block)
+        exit(0);
+    
+    double t0 = now();
+    while (!monitor_stop) {
+        uint64_t f = block->frames.load(std::memory_order_relaxed);
+        block->bytes_copied.load(std::memory_order_relaxed);
+        block->copy_ns.load(std::memory_order_relaxed);
+        block->callback_ns.load(std::memory_order_relaxed);
+        block->pool_circulating.load(std::memory_order_relaxed);
+        block->pll_error_us.load(std::memory_order_relaxed);
+        regressions += (f < frames);
+        frames       = f;
+        samples++;
+        usleep(SAMPLE_US);
+    }
+    double elapsed = now() - t0;
+    
+    fprintf(stdout, "monitor   : samples: %lu (%.0f/s); counter regressions: %lu\n", samples, samples / elapsed, regressions);
+    fprintf(stdout, "            frames: %llu; copied: %llu bytes in %.2f ms; callbacks: %llu in %.2f ms; pool: %llu (%llu lent)\n",
+            (unsigned long long) block->frames.load(), (unsigned long long) block->bytes_copied.load(), block->copy_ns.load() / 1e6,
+            (unsigned long long) block->callbacks.load(), block->callback_ns.load() / 1e6,
+            (unsigned long long) block->pool_circulating.load(), (unsigned long long) block->pool_lent.load());
+    FlashCamMetrics::detach(block);
+    exit(0);
+}
+
+void flashcam_callback(unsigned char *frame, int w, int h) {
+}
+
+static void run(const char *name) {
+    FLASHCAM_STATS_T stats;
+    
+    FlashCam::get().setSettingMetrics( name );
+    FlashCam::get().resetStats();
+    
+    double t0 = now();
+    FlashCam::get().startCapture();
+    sleep(DURATION);
+    FlashCam::get().stopCapture();
+    double elapsed = now() - t0;
+    
+    FlashCam::get().getStats( &stats );
+    fprintf(stdout, "%-10s: frames: %6llu; fps: %6.2f\n", name ? "monitored" : "local",
+            (unsigned long long) stats.frames, stats.frames / elapsed);
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- METRICS-BENCHMARK -- \n\n");
+    fflush(stdout);
+    
+    //monitor is forked before the camera threads exist
+    pid_t pid = fork();
+    if (pid == 0)
+        monitor();
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    
+    //create camera with settings
+    FlashCam::get().setSettings( &settings );
+    FlashCam::get().setFrameCallback( &flashcam_callback );
+    FlashCam::get().setFrameRate(FRAMERATE);
+    
+    //get & print settings
+    FlashCam::get().getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\n");
+    
+    //before: metrics not published; after: published and sampled every SAMPLE_US by the monitor
+    run(NULL);
+    run(SEGMENT);
+    fflush(stdout);
+    
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return 0;
+}
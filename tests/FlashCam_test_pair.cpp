@@ -0,0 +1,152 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 0-7
+#define SENSORMODE    7
+// Pixels
+#define FRAME_WIDTH   320
+#define FRAME_HEIGHT  240
+// hz - framerate of camera
+#define FRAMERATE     60
+// milliseconds - Pulsewidth (shorter than the frame period)
+#define PLLPULSEWIDTH 5.0f
+// seconds of capture per run
+#define DURATION      5
+
+// ambient-light rejection: mean of max(lit - unlit, 0) over the Y plane
+static volatile unsigned long pairs = 0, adjacent = 0;
+static volatile int64_t offset_max = 0;
+static volatile double mean = 0;
+
+void flashcam_callback_pair(const FLASHCAM_PAIR_VIEW_T *pair) {
+    uint64_t sum = 0;
+    for (unsigned int y=0; y<pair->height; y++) {
+        const unsigned char *lit   = pair->lit   + y * pair->pitch;
+        const unsigned char *unlit = pair->unlit + y * pair->pitch;
+        for (unsigned int x=0; x<pair->width; x++)
+            sum += (lit[x] > unlit[x]) ? (lit[x] - unlit[x]) : 0;
+    }
+    mean = sum / (double) (pair->width * pair->height);
+    
+    int64_t offset = (pair->offset < 0) ? -pair->offset : pair->offset;
+    if (offset > offset_max)
+        offset_max = offset;
+    if (pair->unlit_frame.seq + 1 == pair->lit_frame.seq || pair->lit_frame.seq + 1 == pair->unlit_frame.seq)
+        adjacent++;
+    pairs++;
+}
+
+bool run(unsigned int divider) {
+    FLASHCAM_STREAM_STATS_T stream;
+    FLASHCAM_STATS_T stats;
+    
+    FlashCam::get().setPLLDivider(divider);
+    pairs = adjacent = 0;
+    offset_max = 0;
+    FlashCam::get().resetStreamStats();
+    FlashCam::get().resetStats();
+    
+    FlashCam::get().startCapture();
+    sleep(DURATION);
+    FlashCam::get().stopCapture();
+    
+    FlashCam::get().getStreamStats( &stream );
+    FlashCam::get().getStats( &stats );
+    fprintf(stdout, "divider %u: received: %4llu; pairs: %4lu (adjacent: %4lu; max offset: %6lld us); skipped: %4llu; unpaired: %3llu; overruns: %3llu; copied: %6.1f kB/s; mean(lit - unlit): %5.2f\n",
+            divider, (unsigned long long) stream.received, pairs, adjacent, (long long) offset_max, (unsigned long long) stats.skipped,
+            (unsigned long long) stats.unpaired, (unsigned long long) stats.overruns, stats.bytes_copied / (1024.0f * DURATION), mean);
+    
+    // one lit frame per `divider` frames, each paired; of the other frames only the one before the next lit frame is copied
+    unsigned long long lit     = stream.received / divider;
+    unsigned long long skip    = (divider > 2) ? stream.received * (divider - 2) / divider : 0;
+    unsigned long long margin  = 2 + stream.received / 50;
+    bool               ok      = (pairs + margin >= lit) && (pairs <= lit + margin) && (stats.skipped + margin >= skip) && (stats.skipped <= skip + margin);
+    fprintf(stdout, "divider %u: expected pairs: %4llu; skipped: %4llu (+/- %llu) --> %s\n", divider, lit, skip, margin, ok ? "ok" : "MISMATCH");
+    
+    // every received frame is paired, skipped, unpaired or dropped by an overrun
+    unsigned long long accounted = 2 * pairs + stats.skipped + stats.unpaired + stats.overruns;
+    bool               complete  = (accounted + margin >= stream.received) && (accounted <= stream.received + margin);
+    fprintf(stdout, "divider %u: accounted frames: %4llu of %4llu (+/- %llu) --> %s\n", divider, accounted, (unsigned long long) stream.received, margin, complete ? "ok" : "MISMATCH");
+    fflush(stdout);
+    return ok && complete;
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- PAIR-BENCHMARK -- \n\n");
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings: Y plane only, lit frames paired with unlit frames
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    settings.delivery=FLASHCAM_DELIVERY_PAIR;
+    settings.extract.planes=FLASHCAM_PLANE_Y;
+    //frames start half a pulse after the pulse, so lit frames are exposed during the pulse
+    settings.pll_offset=(1000000 / FRAMERATE) - (int) (PLLPULSEWIDTH * 500);
+    
+    //create camera with settings
+    FlashCam::get().setSettings( &settings );
+    FlashCam::get().setFrameRate(FRAMERATE);
+    FlashCam::get().setFrameCallback(flashcam_callback_pair);
+    FlashCam::get().setPLLEnabled(1);
+    FlashCam::get().setPLLPulseWidth(PLLPULSEWIDTH);
+    
+    //get & print settings
+    FlashCam::get().getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\n");
+    fflush(stdout);
+    
+    bool ok = true;
+    ok &= run(2);
+    ok &= run(3);
+    ok &= run(4);
+    return ok ? 0 : 1;
+}
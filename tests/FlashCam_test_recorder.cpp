@@ -0,0 +1,175 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// 0-7
+#define SENSORMODE   5
+// Pixels
+#define FRAME_WIDTH  1640
+#define FRAME_HEIGHT 922
+// hz - framerate of camera
+#define FRAMERATE    30
+// seconds of capture
+#define DURATION     10
+// recording (first argument overrides)
+#define RECORDING    "/tmp/flashcam_test_recorder.fcr"
+// random seeks in recording
+#define SEEKS        100000
+
+static uint64_t now_us() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+}
+
+// read back the recording: records should follow each other in sequence and time, random seeks by timestamp are timed
+static void verify(const char *path, uint64_t recorded) {
+    FLASHCAM_RECORDING_T recording;
+    FLASHCAM_FRAME_VIEW_T view;
+    unsigned long order = 0, pll = 0, missed = 0;
+    uint64_t seq = 0, pts = 0;
+    volatile unsigned int checksum = 0;
+    
+    if (FlashCamRecorder::open(&recording, path)) {
+        fprintf(stdout, "verify    : cannot read recording %s\n", path);
+        return;
+    }
+    
+    for (uint64_t i=0; i<recording.frames; i++) {
+        const FLASHCAM_RECORDER_RECORD_T *record = FlashCamRecorder::frame(&recording, i, NULL);
+        if (i && ((record->seq <= seq) || (record->pts <= pts)))
+            order++;
+        seq  = record->seq;
+        pts  = record->pts;
+        pll += record->pll_state;
+    }
+    fprintf(stdout, "verify    : %llu frames of %u bytes (%s, index %s); out of order: %lu; with PLL: %lu\n", (unsigned long long) recording.frames,
+            recording.header->record_size, (recording.frames == recorded) ? "complete" : "INCOMPLETE", recording.rebuilt ? "rebuilt" : "footer", order, pll);
+    
+    //seek: frame at a random timestamp, read a row of its Y plane in place
+    if (recording.frames) {
+        uint64_t first = FlashCamRecorder::frame(&recording, 0, NULL)->pts;
+        uint64_t span  = pts - first + 1;
+        uint64_t start = now_us();
+        for (unsigned int i=0; i<SEEKS; i++) {
+            uint64_t idx = FlashCamRecorder::findPts(&recording, first + ((uint64_t) rand()) % span);
+            if (!FlashCamRecorder::frame(&recording, idx, &view)) {
+                missed++;
+                continue;
+            }
+            const unsigned char *row = view.data[0] + (rand() % view.height) * view.stride[0];
+            for (unsigned int x=0; x<view.width; x+=64)
+                checksum += row[x];
+        }
+        float us = (float) (now_us() - start);
+        fprintf(stdout, "seek      : %u seeks in %7.2f ms (%6.2f us/seek); missed: %lu\n", SEEKS, us / 1000.0f, us / SEEKS, missed);
+    }
+    FlashCamRecorder::close(&recording);
+}
+
+void run(const char *path, unsigned int memory) {
+    FLASHCAM_RECORDER_STATS_T stats;
+    FLASHCAM_STREAM_STATS_T stream;
+    
+    FlashCam::get().setSettingRecorder(path, memory);
+    FlashCam::get().resetStreamStats();
+    
+    uint64_t start = now_us();
+    FlashCam::get().startCapture();
+    sleep(DURATION);
+    FlashCam::get().stopCapture();
+    //stopping writes the queued frames
+    float seconds = (now_us() - start) / 1000000.0f;
+    
+    FlashCam::get().getRecorderStats( &stats );
+    FlashCam::get().getStreamStats( &stream );
+    fprintf(stdout, "memory    : %5.1f MB (%u frames)\n", memory / 1048576.0f, stats.slots);
+    fprintf(stdout, "frames    : received: %5llu; recorded: %5llu; not recorded: %5llu\n", (unsigned long long) stream.received,
+            (unsigned long long) stats.recorded, (unsigned long long) stats.dropped);
+    fprintf(stdout, "throughput: %7.2f MB/s; queued max: %3u; write max: %7.2f ms; O_DIRECT: %s\n", stats.bytes / 1048576.0f / seconds,
+            stats.queued_max, stats.write_us_max / 1000.0f, stats.direct ? "yes" : "no");
+    verify(path, stats.recorded);
+    fprintf(stdout, "\n");
+    fflush(stdout);
+}
+
+int main(int argc, const char **argv) {
+    const char *path = (argc > 1) ? argv[1] : RECORDING;
+    
+    fprintf(stdout, "\n -- RECORDER-BENCHMARK -- \n\n");
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    settings.recorder=path;
+    
+    //create camera with settings
+    FlashCam::get().setSettings( &settings );
+    FlashCam::get().setFrameRate(FRAMERATE);
+    
+    //get & print settings
+    FlashCam::get().getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\n");
+    fflush(stdout);
+    
+    //sustained: default queue
+    fprintf(stdout, "Recording to %s (default queue):\n", path);
+    run(path, settings.recorder_memory);
+    
+    //disk behind: queue of 2 frames, a slow write drops frames instead of stalling the camera
+    fprintf(stdout, "Recording to %s (minimal queue):\n", path);
+    run(path, 0);
+    
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,148 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam.h"
+
+#include <atomic>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// 0-7
+#define SENSORMODE   5
+// Pixels
+#define FRAME_WIDTH  1640
+#define FRAME_HEIGHT 922
+// hz - framerate of camera
+#define FRAMERATE    30
+// seconds of capture per run
+#define DURATION     10
+// busy threads per CPU
+#define LOAD         2
+// SCHED_FIFO priorities (callback thread, dispatch workers)
+#define PRIO_CALLBACK 50
+#define PRIO_WORKER   40
+
+static std::atomic<bool> loaded(false);
+static volatile unsigned long frames = 0;
+
+// background load: competes with the capture threads for the CPUs
+static void *spin(void *arg) {
+    volatile uint64_t x = 0;
+    while (loaded)
+        for (unsigned int i=0; i<100000; i++)
+            x += i;
+    return NULL;
+}
+
+void flashcam_callback(unsigned char *frame, int w, int h) {
+    frames++;
+}
+
+static void print(const char *name, FLASHCAM_THREAD_T thread) {
+    FLASHCAM_HISTOGRAM_T hist;
+    FlashCam::get().getSchedJitter(thread, &hist);
+    fprintf(stdout, "%-10s: frames: %5" PRIu64 "; jitter avg %7.1f us, p50 <%6" PRIu64 " us, p99 <%6" PRIu64 " us, max %6" PRIu64 " us\n", name, hist.count,
+            hist.count ? ((double) hist.sum) / hist.count : 0.0, FlashCamTrace::percentile(&hist, 0.50f), FlashCamTrace::percentile(&hist, 0.99f), hist.max);
+}
+
+void run(const char *name, int priority, unsigned int cpus, bool load) {
+    long num = load ? LOAD * sysconf(_SC_NPROCESSORS_ONLN) : 0;
+    pthread_t *threads = new pthread_t[num + 1];
+    
+    FlashCam::get().setSettingSched(FLASHCAM_THREAD_CALLBACK, priority ? PRIO_CALLBACK : 0, cpus);
+    FlashCam::get().setSettingSched(FLASHCAM_THREAD_WORKER  , priority ? PRIO_WORKER   : 0, cpus);
+    
+    loaded = true;
+    for (long i=0; i<num; i++)
+        pthread_create(&threads[i], NULL, spin, NULL);
+    
+    FlashCam::get().resetSchedJitter();
+    FlashCam::get().startCapture();
+    sleep(DURATION);
+    FlashCam::get().stopCapture();
+    
+    loaded = false;
+    for (long i=0; i<num; i++)
+        pthread_join(threads[i], NULL);
+    delete[] threads;
+    
+    fprintf(stdout, "%s (%ld busy threads)\n", name, num);
+    print("callback", FLASHCAM_THREAD_CALLBACK);
+    print("workers" , FLASHCAM_THREAD_WORKER);
+    fprintf(stdout, "\n");
+    fflush(stdout);
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- SCHED-BENCHMARK -- \n\n");
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    settings.delivery=FLASHCAM_DELIVERY_DISPATCH;
+    
+    //create camera with settings
+    FlashCam::get().setSettings( &settings );
+    FlashCam::get().setFrameRate(FRAMERATE);
+    FlashCam::get().setFrameCallback(flashcam_callback);
+    
+    //get & print settings
+    FlashCam::get().getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\n");
+    fflush(stdout);
+    
+    //CPU 0 usually serves interrupts: pin capture threads to the last CPU
+    unsigned int last = 1u << (sysconf(_SC_NPROCESSORS_ONLN) - 1);
+    
+    run("idle, default scheduling", 0, 0, false);
+    run("load, default scheduling", 0, 0, true);
+    run("load, SCHED_FIFO"        , 1, 0, true);
+    run("load, SCHED_FIFO, pinned", 1, last, true);
+    fprintf(stdout, "frames    : %lu\n", frames);
+    return 0;
+}
@@ -0,0 +1,175 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// 0-7
+#define SENSORMODE   5
+// Pixels
+#define FRAME_WIDTH  1640
+#define FRAME_HEIGHT 922
+// hz - framerate of camera
+#define FRAMERATE    30
+// seconds of capture
+#define DURATION     5
+// frames in shared ring
+#define SLOTS        4
+// reader processes
+#define READERS      3
+// shared-memory segment
+#define SEGMENT      "/flashcam_test_shared"
+
+static volatile sig_atomic_t reader_stop = 0;
+
+static void reader_signal(int sig) {
+    reader_stop = 1;
+}
+
+static uint64_t now_us() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+}
+
+// reader process: follows the latest frame and sums its Y plane in place
+static void reader(unsigned int id) {
+    const FLASHCAM_SHARED_HEADER_T *ring = NULL;
+    FLASHCAM_SHARED_SLOT_T slot;
+    unsigned long consumed = 0, skipped = 0, overwritten = 0;
+    uint64_t seq = 0, latency = 0, latency_max = 0;
+    volatile unsigned int checksum = 0;
+    
+    signal(SIGTERM, reader_signal);
+    
+    //wait for FlashCam to create the ring
+    while (!reader_stop && !(ring = FlashCamShared::attach(SEGMENT)))
+        usleep(1000);
+    
+    while (!reader_stop) {
+        uint64_t latest = FlashCamShared::latest(ring);
+        if (latest == seq) {
+            usleep(1000);
+            continue;
+        }
+        skipped += seq ? (latest - seq - 1) : 0;
+        seq      = latest;
+        
+        const unsigned char *frame = FlashCamShared::frame(ring, seq, &slot);
+        if (!frame) {
+            overwritten++;
+            continue;
+        }
+        uint64_t l   = now_us() - slot.time;
+        latency     += l;
+        latency_max  = (l > latency_max) ? l : latency_max;
+        
+        unsigned int sum = 0;
+        for (unsigned int i=0; i<ring->pitch * ring->height; i++)
+            sum += frame[i];
+        checksum += sum;
+        
+        //frame might be overwritten while summing
+        if (FlashCamShared::valid(ring, seq))
+            consumed++;
+        else
+            overwritten++;
+    }
+    
+    fprintf(stdout, "reader %u  : consumed: %5lu; skipped: %4lu; overwritten: %4lu; latency: avg %6.2f ms, max %6.2f ms\n", id,
+            consumed, skipped, overwritten, consumed ? latency / 1000.0 / consumed : 0.0, latency_max / 1000.0);
+    if (ring)
+        FlashCamShared::detach(ring);
+    exit(0);
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- SHARED-RING-BENCHMARK -- \n\n");
+    fflush(stdout);
+    
+    //readers are forked before the camera threads exist
+    pid_t pids[READERS];
+    for (unsigned int i=0; i<READERS; i++)
+        if ((pids[i] = fork()) == 0)
+            reader(i);
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    settings.delivery=FLASHCAM_DELIVERY_SHARED;
+    settings.ring_size=SLOTS;
+    settings.shared=SEGMENT;
+    
+    //create camera with settings
+    FlashCam::get().setSettings( &settings );
+    FlashCam::get().setFrameRate(FRAMERATE);
+    
+    //get & print settings
+    FlashCam::get().getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\n");
+    fflush(stdout);
+    
+    FLASHCAM_STATS_T stats;
+    FlashCam::get().resetStats();
+    FlashCam::get().startCapture();
+    sleep(DURATION);
+    FlashCam::get().stopCapture();
+    FlashCam::get().getStats( &stats );
+    fprintf(stdout, "camera    : published: %5llu; bytes copied/frame: %10.1f\n", (unsigned long long) stats.frames,
+            stats.frames ? ((double) stats.bytes_copied) / stats.frames : 0.0);
+    fflush(stdout);
+    
+    for (unsigned int i=0; i<READERS; i++) {
+        kill(pids[i], SIGTERM);
+        waitpid(pids[i], NULL, 0);
+    }
+    return 0;
+}
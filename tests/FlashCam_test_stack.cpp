@@ -0,0 +1,170 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+#include "FlashCam.h"
+#include "FlashCam_util_copy.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// 0-7
+#define SENSORMODE   7
+// Pixels
+#define FRAME_WIDTH  640
+#define FRAME_HEIGHT 480
+// hz - framerate of camera
+#define FRAMERATE    90
+// seconds of capture per run
+#define DURATION     5
+// frames of the running sum computed by the user (copy delivery)
+#define USER_WINDOW  16
+#define USER_INTERVAL 4
+
+// user-side stacking (copy delivery): history of the window and a 16-bit running sum, as an application would do it
+static uint8_t  history[USER_WINDOW][FRAME_WIDTH * FRAME_HEIGHT];
+static uint16_t sum[FRAME_WIDTH * FRAME_HEIGHT];
+static volatile unsigned long frames = 0, stacks = 0;
+static volatile double level = 0;
+
+static uint64_t now_us() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+}
+
+static uint64_t cpu_us() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return ((uint64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+void flashcam_callback(unsigned char *frame, int w, int h) {
+    unsigned int n    = w * h;
+    uint8_t     *slot = history[frames % USER_WINDOW];
+    if (frames < USER_WINDOW) {
+        for (unsigned int i=0; i<n; i++)
+            sum[i] += frame[i];
+    } else {
+        for (unsigned int i=0; i<n; i++)
+            sum[i] = sum[i] + frame[i] - slot[i];
+    }
+    memcpy(slot, frame, n);
+    frames++;
+    if ((frames % USER_INTERVAL) == 0) {
+        unsigned int count = (frames < USER_WINDOW) ? frames : USER_WINDOW;
+        level = sum[n >> 1] / (double) count;
+        stacks++;
+    }
+}
+
+void flashcam_callback_stack(const FLASHCAM_STACK_VIEW_T *stack) {
+    // centre pixel of the Y plane
+    level = stack->data[(stack->height >> 1) * stack->pitch + (stack->width >> 1)] / (double) stack->divisor;
+    stacks++;
+}
+
+void run(FLASHCAM_DELIVERY_T delivery, FLASHCAM_STACK_MODE_T mode, unsigned int window, unsigned int interval) {
+    FLASHCAM_STREAM_STATS_T stream;
+    FLASHCAM_STATS_T stats;
+    
+    FlashCam::get().setSettingDelivery(delivery);
+    FlashCam::get().setSettingStack(mode, window, interval, 0);
+    frames = stacks = 0;
+    memset(sum, 0, sizeof(sum));
+    FlashCam::get().resetStreamStats();
+    FlashCam::get().resetStats();
+    
+    uint64_t cpu = cpu_us(), start = now_us();
+    FlashCam::get().startCapture();
+    sleep(DURATION);
+    FlashCam::get().stopCapture();
+    cpu = cpu_us() - cpu;
+    float seconds = (now_us() - start) / 1000000.0f;
+    
+    FlashCam::get().getStreamStats( &stream );
+    FlashCam::get().getStats( &stats );
+    // stacked frames; cpu per received frame (skipped frames are not copied)
+    if (delivery == FLASHCAM_DELIVERY_STACK)
+        frames = stats.frames;
+    fprintf(stdout, "%-5s %-7s (N=%3u, M=%2u): received: %5llu; stacked: %5lu; stacks: %4lu; fps: %6.2f; dropped: %3llu; overruns: %3llu; skipped: %4llu; cpu: %6.1f us/frame; level: %6.2f\n",
+            (delivery == FLASHCAM_DELIVERY_STACK) ? "stack" : "copy", (mode == FLASHCAM_STACK_AVERAGE) ? "average" : "sum", window, interval,
+            (unsigned long long) stream.received, frames, stacks, stream.received / seconds, (unsigned long long) stream.dropped, (unsigned long long) stats.overruns,
+            (unsigned long long) stats.skipped, stream.received ? cpu / (float) stream.received : 0.0f, level);
+    fflush(stdout);
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- STACK-BENCHMARK -- \n\n");
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings: Y plane only
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    settings.extract.planes=FLASHCAM_PLANE_Y;
+    
+    //create camera with settings
+    FlashCam::get().setSettings( &settings );
+    FlashCam::get().setFrameRate(FRAMERATE);
+    FlashCam::get().setFrameCallback(flashcam_callback);
+    FlashCam::get().setFrameCallback(flashcam_callback_stack);
+    
+    //get & print settings
+    FlashCam::get().getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\nRuntime selected kernel: %s\n\n", FlashCamUtilCopy::getKernelName(FlashCamUtilCopy::getKernel()));
+    fflush(stdout);
+    
+    // running sums: by the user, sliding window (frames held in slots), restarting window (frames outside skipped)
+    run(FLASHCAM_DELIVERY_COPY , FLASHCAM_STACK_SUM    , USER_WINDOW, USER_INTERVAL);
+    run(FLASHCAM_DELIVERY_STACK, FLASHCAM_STACK_SUM    , USER_WINDOW, USER_INTERVAL);
+    run(FLASHCAM_DELIVERY_STACK, FLASHCAM_STACK_SUM    ,   8,  8);
+    run(FLASHCAM_DELIVERY_STACK, FLASHCAM_STACK_SUM    ,   4, 16);
+    run(FLASHCAM_DELIVERY_STACK, FLASHCAM_STACK_SUM    , 256, 30);
+    // moving average
+    run(FLASHCAM_DELIVERY_STACK, FLASHCAM_STACK_AVERAGE, USER_WINDOW, USER_INTERVAL);
+    return 0;
+}
@@ -0,0 +1,174 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_util_copy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ALIGN_UP(v, a) ((((v) + (a) - 1) / (a)) * (a))
+
+// seconds per kernel, method and resolution
+#define DURATION 0.5
+
+typedef struct {
+    unsigned int width;
+    unsigned int height;
+} RESOLUTION_T;
+
+// From the smallest sensible size up to the full resolution of the V2 sensor
+static const RESOLUTION_T resolutions[] = {
+    {  320,  240 },
+    {  640,  480 },
+    { 1280,  720 },
+    { 1640,  922 },
+    { 1920, 1080 },
+    { 2592, 1944 },
+    { 3280, 2464 },
+};
+
+// Ways to get lit - unlit of the Y plane of a padded camera buffer (`lit`), with the unlit frame stored packed:
+//  - copy+subtract : copy the lit frame out of the buffer, then subtract (the lit frame is materialised)
+//  - fused         : subtract straight out of the buffer into the stored unlit frame (FlashCamExtract::subtractBand)
+//  - in place      : subtract two stored frames (FlashCamExtract::subtract)
+typedef enum {
+    METHOD_COPY_SUBTRACT = 0,
+    METHOD_FUSED,
+    METHOD_INPLACE,
+    METHODS
+} METHOD_T;
+
+static const char *methods[] = { "copy+sub", "fused", "in place" };
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// frames stored before the difference is taken (not timed): the unlit frame (fused) or both frames (in place)
+static void prepare(METHOD_T method, uint8_t *dst, const uint8_t *lit, const uint8_t *unlit, unsigned int w, unsigned int h, unsigned int stride) {
+    if (method == METHOD_FUSED)
+        memcpy(dst, unlit, w * h);
+    else if (method == METHOD_INPLACE)
+        FlashCamUtilCopy::copyPlane(dst, w, lit, stride, w, h);
+}
+
+static void difference(METHOD_T method, uint8_t *dst, uint8_t *tmp, const uint8_t *lit, const uint8_t *unlit, unsigned int w, unsigned int h, unsigned int stride) {
+    switch (method) {
+        case METHOD_COPY_SUBTRACT:
+            FlashCamUtilCopy::copyPlane(tmp, w, lit, stride, w, h);
+            FlashCamUtilCopy::subtractPlane(dst, w, tmp, w, unlit, w, w, h);
+            break;
+        case METHOD_FUSED:
+            FlashCamUtilCopy::subtractPlane(dst, w, lit, stride, dst, w, w, h);
+            break;
+        default:
+            FlashCamUtilCopy::subtractPlane(dst, w, dst, w, unlit, w, w, h);
+            break;
+    }
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- SUBTRACT-BENCHMARK -- \n\n");
+    
+    FLASHCAM_COPY_KERNEL_T kernels[] = { FLASHCAM_COPY_SCALAR, FLASHCAM_COPY_ARMV6, FLASHCAM_COPY_NEON, FLASHCAM_COPY_SSE2 };
+    
+    FlashCamUtilCopy::setKernel(FLASHCAM_COPY_AUTO);
+    fprintf(stdout, "Runtime selected kernel: %s\n\n", FlashCamUtilCopy::getKernelName(FlashCamUtilCopy::getKernel()));
+    fprintf(stdout, "%-11s %-7s %-9s %10s %10s %10s\n", "resolution", "kernel", "method", "us/frame", "MB/s", "result");
+    
+    for (unsigned int r=0; r<sizeof(resolutions)/sizeof(resolutions[0]); r++) {
+        unsigned int w      = resolutions[r].width;
+        unsigned int h      = resolutions[r].height;
+        unsigned int stride = ALIGN_UP(w, 32);
+        size_t size         = w * h;
+        
+        uint8_t *lit   = (uint8_t *) malloc(stride * h);
+        uint8_t *unlit = (uint8_t *) malloc(size);
+        uint8_t *ref   = (uint8_t *) malloc(size);
+        uint8_t *dst   = (uint8_t *) malloc(size);
+        uint8_t *tmp   = (uint8_t *) malloc(size);
+        for (size_t i=0; i<stride * h; i++)
+            lit[i] = (uint8_t) (i * 7);
+        for (size_t i=0; i<size; i++)
+            unlit[i] = (uint8_t) (i * 5 + 3);
+        
+        //reference result
+        for (unsigned int y=0; y<h; y++)
+            for (unsigned int x=0; x<w; x++)
+                ref[y * w + x] = (lit[y * stride + x] > unlit[y * w + x]) ? (lit[y * stride + x] - unlit[y * w + x]) : 0;
+        
+        for (unsigned int k=0; k<sizeof(kernels)/sizeof(kernels[0]); k++) {
+            if (!FlashCamUtilCopy::isSupported(kernels[k])) {
+                fprintf(stdout, "%5ux%-5u %-7s %-9s %10s %10s %10s\n", w, h, FlashCamUtilCopy::getKernelName(kernels[k]), "-", "-", "-", "n/a");
+                continue;
+            }
+            FlashCamUtilCopy::setKernel(kernels[k]);
+            
+            for (unsigned int m=0; m<METHODS; m++) {
+                memset(dst, 0, size);
+                prepare((METHOD_T) m, dst, lit, unlit, w, h, stride);
+                difference((METHOD_T) m, dst, tmp, lit, unlit, w, h, stride);
+                bool ok = (memcmp(dst, ref, size) == 0);
+                
+                unsigned int frames = 0;
+                double t = 0, t0;
+                do {
+                    prepare((METHOD_T) m, dst, lit, unlit, w, h, stride);
+                    t0 = now();
+                    difference((METHOD_T) m, dst, tmp, lit, unlit, w, h, stride);
+                    t += now() - t0;
+                    frames++;
+                } while (t < DURATION);
+                
+                double us = t * 1e6 / frames;
+                fprintf(stdout, "%5ux%-5u %-7s %-9s %10.1f %10.1f %10s\n", w, h, FlashCamUtilCopy::getKernelName(kernels[k]), methods[m], us, size / us, ok ? "ok" : "MISMATCH");
+            }
+        }
+        
+        free(lit);
+        free(unlit);
+        free(ref);
+        free(dst);
+        free(tmp);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,165 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// 0-7
+#define SENSORMODE   5
+// Pixels
+#define FRAME_WIDTH  1640
+#define FRAME_HEIGHT 922
+// hz - framerate of camera
+#define FRAMERATE    30
+// video -> still -> video cycles per setting
+#define CYCLES       20
+
+// time of first frame after (re)starting video
+static VCOS_SEMAPHORE_T    sem_frame;
+static std::atomic<bool>   wait_frame;
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+void flashcam_callback(unsigned char *frame, int w, int h) {
+    if (wait_frame.exchange(false))
+        vcos_semaphore_post(&sem_frame);
+}
+
+// duration of a step, summed over all cycles
+typedef struct {
+    double sum;
+    double max;
+} TIMING_T;
+
+static void add(TIMING_T *timing, double t0, double t1) {
+    timing->sum += t1 - t0;
+    timing->max  = (t1 - t0 > timing->max) ? t1 - t0 : timing->max;
+}
+
+static void report(const char *step, TIMING_T *timing) {
+    fprintf(stdout, "  %-24s: avg %7.2f ms, max %7.2f ms\n", step, timing->sum * 1000.0 / CYCLES, timing->max * 1000.0);
+}
+
+static void run(unsigned int armed) {
+    TIMING_T to_still_switch = {}, to_still_frame = {};
+    TIMING_T to_video_switch = {}, to_video_frame = {};
+    double t0, t1;
+    
+    FlashCam::get().setSettingArmed( armed );
+    
+    for (int i=0; i<CYCLES; i++) {
+        // monitor video until the first frame
+        wait_frame = true;
+        FlashCam::get().setSettingCaptureMode( FLASHCAM_MODE_VIDEO );
+        FlashCam::get().startCapture();
+        vcos_semaphore_wait(&sem_frame);
+        FlashCam::get().stopCapture();
+        
+        // video -> still: switch of mode, then capture returns with the still
+        t0 = now();
+        FlashCam::get().setSettingCaptureMode( FLASHCAM_MODE_CAPTURE );
+        t1 = now();
+        add(&to_still_switch, t0, t1);
+        
+        t0 = now();
+        FlashCam::get().startCapture();
+        t1 = now();
+        add(&to_still_frame, t0, t1);
+        
+        // still -> video: switch of mode, then first frame of video
+        t0 = now();
+        FlashCam::get().setSettingCaptureMode( FLASHCAM_MODE_VIDEO );
+        t1 = now();
+        add(&to_video_switch, t0, t1);
+        
+        t0 = now();
+        wait_frame = true;
+        FlashCam::get().startCapture();
+        vcos_semaphore_wait(&sem_frame);
+        t1 = now();
+        FlashCam::get().stopCapture();
+        add(&to_video_frame, t0, t1);
+    }
+    
+    fprintf(stdout, "armed: %u; frame period: %5.2f ms\n", armed, 1000.0 / FRAMERATE);
+    report("video->still: switch", &to_still_switch);
+    report("video->still: still", &to_still_frame);
+    report("still->video: switch", &to_video_switch);
+    report("still->video: 1st frame", &to_video_frame);
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- MODE-SWITCH-BENCHMARK -- \n\n");
+    
+    vcos_semaphore_create(&sem_frame, "sem_frame", 0);
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    
+    //create camera with settings
+    FlashCam::get().setSettings( &settings );
+    FlashCam::get().setFrameCallback( &flashcam_callback );
+    FlashCam::get().setFrameRate(FRAMERATE);
+    
+    //get & print settings
+    FlashCam::get().getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\n");
+    
+    //before: port of mode is enabled on each switch; after: both ports armed
+    run(0);
+    run(1);
+    
+    vcos_semaphore_delete(&sem_frame);
+    return 0;
+}
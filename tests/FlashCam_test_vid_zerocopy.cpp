@@ -0,0 +1,128 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// 0-7
+#define SENSORMODE   5
+// Pixels
+#define FRAME_WIDTH  1640
+#define FRAME_HEIGHT 922
+// hz - framerate of camera
+#define FRAMERATE    30
+// seconds per delivery mode
+#define DURATION     10
+
+// Consumer work: sum a row of every plane, so the frame is actually touched.
+static volatile unsigned int checksum;
+
+static void consume(unsigned char *Y, unsigned char *U, unsigned char *V, int w) {
+    unsigned int sum = 0;
+    for (int i=0; i<w; i++)         sum += Y[i];
+    for (int i=0; i<(w>>1); i++)    sum += U[i] + V[i];
+    checksum += sum;
+}
+
+void flashcam_callback(unsigned char *frame, int w, int h) {
+    consume(&frame[0], &frame[w*h], &frame[(w*h*5)>>2], w);
+}
+
+void flashcam_callback_view(FLASHCAM_FRAME_VIEW_T *frame) {
+    consume(frame->data[0], frame->data[1], frame->data[2], frame->width);
+    FlashCam::get().releaseFrame(frame);
+}
+
+static void run(FLASHCAM_DELIVERY_T delivery, const char *name) {
+    FLASHCAM_STATS_T stats;
+    struct timespec t0, t1;
+    
+    FlashCam::get().setSettingDelivery( delivery );
+    FlashCam::get().resetStats();
+    
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    FlashCam::get().startCapture();
+    sleep(DURATION);
+    FlashCam::get().stopCapture();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    
+    FlashCam::get().getStats( &stats );
+    double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    
+    fprintf(stdout, "%-9s: frames: %8llu; fps: %7.2f; bytes copied: %12llu; bytes copied/frame: %10.1f\n", name,
+            (unsigned long long) stats.frames, stats.frames / elapsed,
+            (unsigned long long) stats.bytes_copied,
+            stats.frames ? ((double) stats.bytes_copied) / stats.frames : 0.0);
+}
+
+int main(int argc, const char **argv) {
+    fprintf(stdout, "\n -- VIDEO-ZEROCOPY-BENCHMARK -- \n\n");
+    
+    //get default settings
+    FLASHCAM_SETTINGS_T settings = {};
+    FlashCam::getDefaultSettings( &settings );
+    
+    //update settings
+    settings.width=FRAME_WIDTH;
+    settings.height=FRAME_HEIGHT;
+    settings.verbose=0;
+    settings.update=0;
+    settings.mode=FLASHCAM_MODE_VIDEO;
+    settings.sensormode=SENSORMODE;
+    
+    //create camera with settings
+    FlashCam::get().setSettings( &settings );
+    
+    //set callbacks: the delivery setting decides which is used.
+    FlashCam::get().setFrameCallback( &flashcam_callback );
+    FlashCam::get().setFrameCallback( &flashcam_callback_view );
+    FlashCam::get().setFrameRate(FRAMERATE);
+    
+    //get & print settings
+    FlashCam::get().getSettings( &settings );
+    FlashCam::printSettings( &settings );
+    fprintf(stdout, "\n");
+    
+    //before: copy into framebuffer; after: plane views into MMAL buffers
+    run(FLASHCAM_DELIVERY_COPY    , "copy");
+    run(FLASHCAM_DELIVERY_ZEROCOPY, "zerocopy");
+    
+    return 0;
+}
@@ -0,0 +1,153 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_trace.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+namespace FlashCamTrace {
+    
+    static uint64_t monotonic_us() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+    }
+    
+    // bucket 0: 0us; bucket i: [2^(i-1), 2^i) us
+    static unsigned int bucket(uint64_t us) {
+        if (us == 0)
+            return 0;
+        unsigned int b = 64 - __builtin_clzll(us);
+        return (b < FLASHCAM_TRACE_BUCKETS) ? b : (FLASHCAM_TRACE_BUCKETS - 1);
+    }
+    
+    static void add(FLASHCAM_TRACE_HISTOGRAM_T *hist, uint64_t from, uint64_t to) {
+        // stage not passed by frame
+        if (!from || !to)
+            return;
+        
+        // Stamps taken in different threads or an inaccurate calibration might yield small negative latencies
+        sample(hist, (to > from) ? (to - from) : 0);
+    }
+    
+    void sample(FLASHCAM_TRACE_HISTOGRAM_T *hist, uint64_t us) {
+        hist->count.fetch_add(1, std::memory_order_relaxed);
+        hist->sum.fetch_add(us, std::memory_order_relaxed);
+        hist->buckets[bucket(us)].fetch_add(1, std::memory_order_relaxed);
+        
+        uint64_t v = hist->min.load(std::memory_order_relaxed);
+        while ((us < v) && !hist->min.compare_exchange_weak(v, us, std::memory_order_relaxed));
+        v = hist->max.load(std::memory_order_relaxed);
+        while ((us > v) && !hist->max.compare_exchange_weak(v, us, std::memory_order_relaxed));
+    }
+    
+    void calibrate(FLASHCAM_TRACE_T *trace, uint64_t gpu_us, uint64_t mono_before, uint64_t mono_after) {
+        // GPU time was read somewhere in [before, after]: assume halfway.
+        uint64_t mono_us = mono_before + ((mono_after - mono_before) >> 1);
+        trace->offset = ((int64_t) gpu_us) - ((int64_t) mono_us);
+    }
+    
+    uint64_t now(FLASHCAM_TRACE_T *trace) {
+        if (!trace->enabled)
+            return 0;
+        return (uint64_t) (((int64_t) monotonic_us()) + trace->offset);
+    }
+    
+    void record(FLASHCAM_TRACE_T *trace, const FLASHCAM_TRACE_STAMPS_T *s) {
+        if (!trace->enabled)
+            return;
+        
+        add(&(trace->hist[FLASHCAM_TRACE_SENSOR])    , s->pts     , s->arrival);
+        add(&(trace->hist[FLASHCAM_TRACE_COPY])      , s->arrival , s->copied);
+        add(&(trace->hist[FLASHCAM_TRACE_HANDOFF])   , s->copied  , s->entry);
+        add(&(trace->hist[FLASHCAM_TRACE_GL_DEQUEUE]), s->arrival , s->dequeued);
+        add(&(trace->hist[FLASHCAM_TRACE_GL_TEXTURE]), s->dequeued, s->textured);
+        add(&(trace->hist[FLASHCAM_TRACE_CALLBACK])  , s->entry   , s->exit);
+        add(&(trace->hist[FLASHCAM_TRACE_TOTAL])     , s->pts     , s->exit);
+    }
+    
+    int get(FLASHCAM_TRACE_T *trace, FLASHCAM_TRACE_STAGE_T stage, FLASHCAM_HISTOGRAM_T *hist) {
+        if ((stage < 0) || (stage >= FLASHCAM_TRACE_STAGES)) {
+            fprintf(stderr, "%s: Unknown stage (%d)\n", __func__, stage);
+            return -1;
+        }
+        
+        copy(&(trace->hist[stage]), hist);
+        return 0;
+    }
+    
+    void reset(FLASHCAM_TRACE_T *trace) {
+        for (unsigned int s=0; s<FLASHCAM_TRACE_STAGES; s++)
+            clear(&(trace->hist[s]));
+    }
+    
+    void copy(FLASHCAM_TRACE_HISTOGRAM_T *h, FLASHCAM_HISTOGRAM_T *hist) {
+        hist->count = h->count.load(std::memory_order_relaxed);
+        hist->sum   = h->sum.load(std::memory_order_relaxed);
+        hist->min   = hist->count ? h->min.load(std::memory_order_relaxed) : 0;
+        hist->max   = h->max.load(std::memory_order_relaxed);
+        for (unsigned int i=0; i<FLASHCAM_TRACE_BUCKETS; i++)
+            hist->buckets[i] = h->buckets[i].load(std::memory_order_relaxed);
+    }
+    
+    void clear(FLASHCAM_TRACE_HISTOGRAM_T *h) {
+        h->count = 0;
+        h->sum   = 0;
+        h->min   = UINT64_MAX;
+        h->max   = 0;
+        for (unsigned int i=0; i<FLASHCAM_TRACE_BUCKETS; i++)
+            h->buckets[i] = 0;
+    }
+    
+    uint64_t percentile(const FLASHCAM_HISTOGRAM_T *hist, float p) {
+        if (hist->count == 0)
+            return 0;
+        
+        uint64_t target = (uint64_t) (p * hist->count);
+        uint64_t n = 0;
+        for (unsigned int i=0; i<FLASHCAM_TRACE_BUCKETS; i++) {
+            n += hist->buckets[i];
+            if (n > target) {
+                uint64_t bound = (i == 0) ? 0 : ((((uint64_t) 1) << i) - 1);
+                return ((i == FLASHCAM_TRACE_BUCKETS - 1) || (bound > hist->max)) ? hist->max : bound;
+            }
+        }
+        return hist->max;
+    }
+}
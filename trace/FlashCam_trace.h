@@ -0,0 +1,68 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_trace_h
+#define FlashCam_trace_h
+
+
+#include "FlashCam_types.h"
+
+namespace FlashCamTrace {
+    
+    // Map CLOCK_MONOTONIC onto the GPU clock: `gpu_us` was sampled between `mono_before` and `mono_after` (us).
+    void calibrate(FLASHCAM_TRACE_T *trace, uint64_t gpu_us, uint64_t mono_before, uint64_t mono_after);
+    
+    // Current time in the GPU clock domain (us). Returns 0 when tracing is disabled.
+    uint64_t now(FLASHCAM_TRACE_T *trace);
+    
+    // Add the stage latencies of a frame to the histograms. Thread-safe.
+    void record(FLASHCAM_TRACE_T *trace, const FLASHCAM_TRACE_STAMPS_T *stamps);
+    
+    // Copy histogram of `stage`; clear all histograms.
+    int  get(FLASHCAM_TRACE_T *trace, FLASHCAM_TRACE_STAGE_T stage, FLASHCAM_HISTOGRAM_T *hist);
+    void reset(FLASHCAM_TRACE_T *trace);
+    
+    // Single histogram: add a sample (us, thread-safe), copy, clear.
+    void sample(FLASHCAM_TRACE_HISTOGRAM_T *hist, uint64_t us);
+    void copy(FLASHCAM_TRACE_HISTOGRAM_T *hist, FLASHCAM_HISTOGRAM_T *out);
+    void clear(FLASHCAM_TRACE_HISTOGRAM_T *hist);
+    
+    // Upper bound (us) of the bucket holding the `p`-th percentile (0.0f to 1.0f) of `hist`.
+    uint64_t percentile(const FLASHCAM_HISTOGRAM_T *hist, float p);
+}
+
+#endif /* FlashCam_trace_h */
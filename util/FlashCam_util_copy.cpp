@@ -0,0 +1,318 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#include "FlashCam_util_copy.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#if defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#endif
+
+#if defined(__arm__) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+
+namespace FlashCamUtilCopy {
+    
+    typedef void (*FLASHCAM_COPY_ROW_T) (uint8_t *, const uint8_t *, unsigned int);
+    typedef void (*FLASHCAM_SUBTRACT_ROW_T) (uint8_t *, const uint8_t *, const uint8_t *, unsigned int);
+    typedef void (*FLASHCAM_ACCUMULATE_ROW_T) (uint16_t *, const uint8_t *, const uint8_t *, unsigned int);
+    typedef void (*FLASHCAM_AVERAGE_ROW_T) (uint16_t *, const uint8_t *, unsigned int, unsigned int);
+    
+    static FLASHCAM_COPY_KERNEL_T    _kernel        = FLASHCAM_COPY_AUTO;
+    static FLASHCAM_COPY_ROW_T       _copyRow       = NULL;
+    static FLASHCAM_SUBTRACT_ROW_T   _subtractRow   = NULL;
+    static FLASHCAM_ACCUMULATE_ROW_T _accumulateRow = NULL;
+    static FLASHCAM_AVERAGE_ROW_T    _averageRow    = NULL;
+    
+    bool isSupported(FLASHCAM_COPY_KERNEL_T kernel) {
+        switch (kernel) {
+            case FLASHCAM_COPY_SCALAR:
+                return true;
+            case FLASHCAM_COPY_ARMV6:
+#if defined(__arm__)
+                return true;
+#else
+                return false;
+#endif
+            case FLASHCAM_COPY_NEON:
+                if (!builtNEON())
+                    return false;
+#if defined(__aarch64__)
+                return true;
+#elif defined(__arm__) && defined(__linux__)
+                return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+                return false;
+#endif
+            case FLASHCAM_COPY_SSE2:
+                if (!builtSSE2())
+                    return false;
+#if defined(__x86_64__)
+                return true;
+#elif defined(__i386__)
+                return __builtin_cpu_supports("sse2");
+#else
+                return false;
+#endif
+            default:
+                return false;
+        }
+    }
+    
+    int setKernel(FLASHCAM_COPY_KERNEL_T kernel) {
+        if (kernel == FLASHCAM_COPY_AUTO) {
+            if (isSupported(FLASHCAM_COPY_NEON))
+                kernel = FLASHCAM_COPY_NEON;
+            else if (isSupported(FLASHCAM_COPY_ARMV6))
+                kernel = FLASHCAM_COPY_ARMV6;
+            else if (isSupported(FLASHCAM_COPY_SSE2))
+                kernel = FLASHCAM_COPY_SSE2;
+            else
+                kernel = FLASHCAM_COPY_SCALAR;
+        }
+        
+        if (!isSupported(kernel)) {
+            fprintf(stderr, "%s: Kernel `%s` not supported on this system.\n", __func__, getKernelName(kernel));
+            return -1;
+        }
+        
+        // x86: memcpy of libc is vectorised already. ARMv6: the moving average needs signed 16-bit shifts, no gain over scalar.
+        switch (kernel) {
+            case FLASHCAM_COPY_NEON:
+                _copyRow = copyRowNEON;   _subtractRow = subtractRowNEON;   _accumulateRow = accumulateRowNEON;   _averageRow = averageRowNEON;   break;
+            case FLASHCAM_COPY_ARMV6:
+                _copyRow = copyRowARMv6;  _subtractRow = subtractRowARMv6;  _accumulateRow = accumulateRowARMv6;  _averageRow = averageRowScalar; break;
+            case FLASHCAM_COPY_SSE2:
+                _copyRow = copyRowScalar; _subtractRow = subtractRowSSE2;   _accumulateRow = accumulateRowSSE2;   _averageRow = averageRowSSE2;   break;
+            default:
+                _copyRow = copyRowScalar; _subtractRow = subtractRowScalar; _accumulateRow = accumulateRowScalar; _averageRow = averageRowScalar; break;
+        }
+        _kernel = kernel;
+        return 0;
+    }
+    
+    FLASHCAM_COPY_KERNEL_T getKernel() {
+        if (!_copyRow)
+            setKernel(FLASHCAM_COPY_AUTO);
+        return _kernel;
+    }
+    
+    const char *getKernelName(FLASHCAM_COPY_KERNEL_T kernel) {
+        switch (kernel) {
+            case FLASHCAM_COPY_AUTO:   return "auto";
+            case FLASHCAM_COPY_SCALAR: return "scalar";
+            case FLASHCAM_COPY_ARMV6:  return "armv6";
+            case FLASHCAM_COPY_NEON:   return "neon";
+            case FLASHCAM_COPY_SSE2:   return "sse2";
+            default:                   return "unknown";
+        }
+    }
+    
+    void copyPlane(uint8_t *dst, unsigned int dst_pitch, const uint8_t *src, unsigned int src_stride, unsigned int width, unsigned int rows) {
+        if (!_copyRow)
+            setKernel(FLASHCAM_COPY_AUTO);
+        
+        // Both planes without padding: a single copy
+        if ((dst_pitch == width) && (src_stride == width)) {
+            _copyRow(dst, src, width * rows);
+            return;
+        }
+        
+        for (unsigned int r=0; r<rows; r++, dst += dst_pitch, src += src_stride)
+            _copyRow(dst, src, width);
+    }
+    
+    void subtractPlane(uint8_t *dst, unsigned int dst_pitch, const uint8_t *lit, unsigned int lit_stride,
+                       const uint8_t *unlit, unsigned int unlit_stride, unsigned int width, unsigned int rows) {
+        if (!_subtractRow)
+            setKernel(FLASHCAM_COPY_AUTO);
+        
+        // All planes without padding: a single pass
+        if ((dst_pitch == width) && (lit_stride == width) && (unlit_stride == width)) {
+            _subtractRow(dst, lit, unlit, width * rows);
+            return;
+        }
+        
+        for (unsigned int r=0; r<rows; r++, dst += dst_pitch, lit += lit_stride, unlit += unlit_stride)
+            _subtractRow(dst, lit, unlit, width);
+    }
+    
+    void accumulate(uint16_t *acc, const uint8_t *add, const uint8_t *sub, unsigned int n) {
+        if (!_accumulateRow)
+            setKernel(FLASHCAM_COPY_AUTO);
+        _accumulateRow(acc, add, sub, n);
+    }
+    
+    void average(uint16_t *acc, const uint8_t *in, unsigned int shift, unsigned int n) {
+        if (!_averageRow)
+            setKernel(FLASHCAM_COPY_AUTO);
+        _averageRow(acc, in, shift, n);
+    }
+    
+    void copyRowScalar(uint8_t *dst, const uint8_t *src, unsigned int n) {
+        memcpy(dst, src, n);
+    }
+    
+    void subtractRowScalar(uint8_t *dst, const uint8_t *lit, const uint8_t *unlit, unsigned int n) {
+        for (unsigned int i=0; i<n; i++)
+            dst[i] = (lit[i] > unlit[i]) ? (lit[i] - unlit[i]) : 0;
+    }
+    
+    void accumulateRowScalar(uint16_t *acc, const uint8_t *add, const uint8_t *sub, unsigned int n) {
+        if (sub) {
+            for (unsigned int i=0; i<n; i++)
+                acc[i] = acc[i] + add[i] - sub[i];
+        } else {
+            for (unsigned int i=0; i<n; i++)
+                acc[i] += add[i];
+        }
+    }
+    
+    void averageRowScalar(uint16_t *acc, const uint8_t *in, unsigned int shift, unsigned int n) {
+        int round = shift ? (1 << (shift - 1)) : 0;
+        for (unsigned int i=0; i<n; i++) {
+            int d = (((int) in[i]) << FLASHCAM_COPY_AVERAGE_BITS) - acc[i];
+            acc[i] = (uint16_t) (acc[i] + ((d + round) >> shift));
+        }
+    }
+    
+    void copyRowARMv6(uint8_t *dst, const uint8_t *src, unsigned int n) {
+        // Unaligned word access is slow (or faults) on ARMv6
+        if ((((uintptr_t) dst) | ((uintptr_t) src)) & 3) {
+            memcpy(dst, src, n);
+            return;
+        }
+        
+        // 32 bytes per iteration: maps onto ldm/stm of 8 registers
+        uint32_t       *d = (uint32_t *) dst;
+        const uint32_t *s = (const uint32_t *) src;
+        unsigned int blocks = n >> 5;
+        for (unsigned int i=0; i<blocks; i++, d += 8, s += 8) {
+            uint32_t a0 = s[0], a1 = s[1], a2 = s[2], a3 = s[3];
+            uint32_t a4 = s[4], a5 = s[5], a6 = s[6], a7 = s[7];
+            d[0] = a0; d[1] = a1; d[2] = a2; d[3] = a3;
+            d[4] = a4; d[5] = a5; d[6] = a6; d[7] = a7;
+        }
+        
+        //remainder
+        unsigned int done = blocks << 5;
+        if (done < n)
+            memcpy(&dst[done], &src[done], n - done);
+    }
+    
+    // 4 saturating byte differences per word: uqsub8 (ARMv6 SIMD), or a borrow mask in plain C.
+    static inline uint32_t subtractWord(uint32_t a, uint32_t b) {
+#if defined(__ARM_FEATURE_SIMD32)
+        return __uqsub8(a, b);
+#else
+        const uint32_t H = 0x80808080u;
+        uint32_t diff   = ((a | H) - (b & ~H)) ^ ((a ^ ~b) & H);   // per byte: a - b (mod 256)
+        uint32_t borrow = ((~a & b) | (~(a ^ b) & diff)) & H;      // per byte: b > a
+        return diff & ~((borrow >> 7) * 0xFFu);
+#endif
+    }
+    
+    void subtractRowARMv6(uint8_t *dst, const uint8_t *lit, const uint8_t *unlit, unsigned int n) {
+        // Unaligned word access is slow (or faults) on ARMv6
+        if ((((uintptr_t) dst) | ((uintptr_t) lit) | ((uintptr_t) unlit)) & 3) {
+            subtractRowScalar(dst, lit, unlit, n);
+            return;
+        }
+        
+        // 16 bytes per iteration
+        uint32_t       *d = (uint32_t *) dst;
+        const uint32_t *a = (const uint32_t *) lit;
+        const uint32_t *b = (const uint32_t *) unlit;
+        unsigned int blocks = n >> 4;
+        for (unsigned int i=0; i<blocks; i++, d += 4, a += 4, b += 4) {
+            uint32_t a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+            uint32_t b0 = b[0], b1 = b[1], b2 = b[2], b3 = b[3];
+            d[0] = subtractWord(a0, b0);
+            d[1] = subtractWord(a1, b1);
+            d[2] = subtractWord(a2, b2);
+            d[3] = subtractWord(a3, b3);
+        }
+        
+        //remainder
+        unsigned int done = blocks << 4;
+        if (done < n)
+            subtractRowScalar(&dst[done], &lit[done], &unlit[done], n - done);
+    }
+    
+    // Bytes 0,1 and 2,3 of a word as two 16-bit lanes each (acc[i], acc[i+1] of a little-endian word)
+    static inline uint32_t lanesLow(uint32_t w)  { return (w & 0xFFu) | ((w << 8) & 0xFF0000u); }
+    static inline uint32_t lanesHigh(uint32_t w) { return ((w >> 16) & 0xFFu) | ((w >> 8) & 0xFF0000u); }
+    
+    void accumulateRowARMv6(uint16_t *acc, const uint8_t *add, const uint8_t *sub, unsigned int n) {
+        // Unaligned word access is slow (or faults) on ARMv6
+        if ((((uintptr_t) acc) | ((uintptr_t) add) | ((uintptr_t) sub)) & 3) {
+            accumulateRowScalar(acc, add, sub, n);
+            return;
+        }
+        
+        // 2 lanes per word: no lane leaves 0..65535 (see `accumulate`), so plain word adds never carry into the next lane.
+        //  4 bytes per iteration.
+        uint32_t       *a = (uint32_t *) acc;
+        const uint32_t *p = (const uint32_t *) add;
+        const uint32_t *m = (const uint32_t *) sub;
+        unsigned int blocks = n >> 2;
+        if (sub) {
+            for (unsigned int i=0; i<blocks; i++, a += 2) {
+                uint32_t x = p[i], y = m[i];
+                a[0] = a[0] + lanesLow(x)  - lanesLow(y);
+                a[1] = a[1] + lanesHigh(x) - lanesHigh(y);
+            }
+        } else {
+            for (unsigned int i=0; i<blocks; i++, a += 2) {
+                uint32_t x = p[i];
+                a[0] += lanesLow(x);
+                a[1] += lanesHigh(x);
+            }
+        }
+        
+        //remainder
+        unsigned int done = blocks << 2;
+        if (done < n)
+            accumulateRowScalar(&acc[done], &add[done], sub ? &sub[done] : NULL, n - done);
+    }
+}
@@ -0,0 +1,100 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+#ifndef FlashCam_util_copy_h
+#define FlashCam_util_copy_h
+
+
+#include <stdint.h>
+
+// Row kernels for plane copies, subtractions and stacking. AUTO selects the fastest kernel supported by the CPU at runtime.
+typedef enum {
+    FLASHCAM_COPY_AUTO = 0,
+    FLASHCAM_COPY_SCALAR,                       // memcpy per row, byte-wise subtraction & stacking
+    FLASHCAM_COPY_ARMV6,                        // 32-bit word copies, subtractions & sums (ARMv6 without NEON, e.g. Pi Zero / Pi 1)
+    FLASHCAM_COPY_NEON,                         // 128-bit NEON copies, subtractions & stacking (Pi 2 and later)
+    FLASHCAM_COPY_SSE2                          // 128-bit SSE2 subtractions & stacking, memcpy per row (x86: development hosts, replay)
+} FLASHCAM_COPY_KERNEL_T;
+
+// Fraction bits of the moving average of FlashCamUtilCopy::average (8.7 fixed point: fits signed 16-bit arithmetic)
+#define FLASHCAM_COPY_AVERAGE_BITS 7
+
+namespace FlashCamUtilCopy {
+    
+    // Select row kernel; `setKernel` returns -1 when `kernel` is not supported by this CPU/build.
+    bool isSupported(FLASHCAM_COPY_KERNEL_T kernel);
+    int setKernel(FLASHCAM_COPY_KERNEL_T kernel);
+    FLASHCAM_COPY_KERNEL_T getKernel();
+    const char *getKernelName(FLASHCAM_COPY_KERNEL_T kernel);
+    
+    // Copy `rows` rows of `width` bytes from a plane with `src_stride` bytes per row into a plane with
+    //  `dst_pitch` bytes per row. Padding of both planes is left untouched.
+    void copyPlane(uint8_t *dst, unsigned int dst_pitch, const uint8_t *src, unsigned int src_stride, unsigned int width, unsigned int rows);
+    
+    // Saturating difference of `rows` rows of `width` bytes: dst = max(lit - unlit, 0), e.g. to remove ambient light from
+    //  a frame lit by the PLL. `dst` may be `lit` or `unlit` (in place), planes are read and written in a single pass.
+    void subtractPlane(uint8_t *dst, unsigned int dst_pitch, const uint8_t *lit, unsigned int lit_stride,
+                       const uint8_t *unlit, unsigned int unlit_stride, unsigned int width, unsigned int rows);
+    
+    // Stacking of `n` bytes into 16-bit accumulators, acc[i] belongs to byte i:
+    //  - accumulate : acc += add - sub (`sub` may be NULL). Each acc[i] must stay within 0..65535: a running sum of up to
+    //                 256 frames, where `sub` is the frame leaving the window.
+    //  - average    : exponential moving average in FLASHCAM_COPY_AVERAGE_BITS fixed point, weight 1 / 2^shift (shift <= 8):
+    //                 acc += round(((in << FLASHCAM_COPY_AVERAGE_BITS) - acc) / 2^shift). With shift 0 `acc` is set to `in`.
+    void accumulate(uint16_t *acc, const uint8_t *add, const uint8_t *sub, unsigned int n);
+    void average(uint16_t *acc, const uint8_t *in, unsigned int shift, unsigned int n);
+    
+    // Row kernels. The NEON and SSE2 kernels live in their own units, as only these units are built with NEON / SSE2 enabled.
+    void copyRowScalar(uint8_t *dst, const uint8_t *src, unsigned int n);
+    void copyRowARMv6(uint8_t *dst, const uint8_t *src, unsigned int n);
+    void copyRowNEON(uint8_t *dst, const uint8_t *src, unsigned int n);
+    void subtractRowScalar(uint8_t *dst, const uint8_t *lit, const uint8_t *unlit, unsigned int n);
+    void subtractRowARMv6(uint8_t *dst, const uint8_t *lit, const uint8_t *unlit, unsigned int n);
+    void subtractRowNEON(uint8_t *dst, const uint8_t *lit, const uint8_t *unlit, unsigned int n);
+    void subtractRowSSE2(uint8_t *dst, const uint8_t *lit, const uint8_t *unlit, unsigned int n);
+    void accumulateRowScalar(uint16_t *acc, const uint8_t *add, const uint8_t *sub, unsigned int n);
+    void accumulateRowARMv6(uint16_t *acc, const uint8_t *add, const uint8_t *sub, unsigned int n);
+    void accumulateRowNEON(uint16_t *acc, const uint8_t *add, const uint8_t *sub, unsigned int n);
+    void accumulateRowSSE2(uint16_t *acc, const uint8_t *add, const uint8_t *sub, unsigned int n);
+    void averageRowScalar(uint16_t *acc, const uint8_t *in, unsigned int shift, unsigned int n);
+    void averageRowNEON(uint16_t *acc, const uint8_t *in, unsigned int shift, unsigned int n);
+    void averageRowSSE2(uint16_t *acc, const uint8_t *in, unsigned int shift, unsigned int n);
+    bool builtNEON();
+    bool builtSSE2();
+}
+
+#endif /* FlashCam_util_copy_h */
@@ -0,0 +1,162 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+// NEON row kernels. This unit is built with NEON enabled (see CMakeLists.txt); they are only
+//  called when the CPU reports NEON support, see FlashCamUtilCopy::setKernel().
+
+#include "FlashCam_util_copy.h"
+
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FLASHCAM_COPY_NEON_BUILT 1
+#endif
+
+namespace FlashCamUtilCopy {
+    
+    bool builtNEON() {
+#ifdef FLASHCAM_COPY_NEON_BUILT
+        return true;
+#else
+        return false;
+#endif
+    }
+    
+    void copyRowNEON(uint8_t *dst, const uint8_t *src, unsigned int n) {
+#ifdef FLASHCAM_COPY_NEON_BUILT
+        // 64 bytes per iteration
+        unsigned int blocks = n >> 6;
+        for (unsigned int i=0; i<blocks; i++, dst += 64, src += 64) {
+            __builtin_prefetch(src + 256);
+            uint8x16_t a = vld1q_u8(src);
+            uint8x16_t b = vld1q_u8(src + 16);
+            uint8x16_t c = vld1q_u8(src + 32);
+            uint8x16_t d = vld1q_u8(src + 48);
+            vst1q_u8(dst     , a);
+            vst1q_u8(dst + 16, b);
+            vst1q_u8(dst + 32, c);
+            vst1q_u8(dst + 48, d);
+        }
+        n &= 63;
+#endif
+        //remainder (or all, when NEON is not built)
+        if (n)
+            memcpy(dst, src, n);
+    }
+    
+    void subtractRowNEON(uint8_t *dst, const uint8_t *lit, const uint8_t *unlit, unsigned int n) {
+#ifdef FLASHCAM_COPY_NEON_BUILT
+        // 64 bytes per iteration, all loads before the stores: `dst` may be `lit` or `unlit`
+        unsigned int blocks = n >> 6;
+        for (unsigned int i=0; i<blocks; i++, dst += 64, lit += 64, unlit += 64) {
+            __builtin_prefetch(lit   + 256);
+            __builtin_prefetch(unlit + 256);
+            uint8x16_t a0 = vld1q_u8(lit);
+            uint8x16_t a1 = vld1q_u8(lit + 16);
+            uint8x16_t a2 = vld1q_u8(lit + 32);
+            uint8x16_t a3 = vld1q_u8(lit + 48);
+            uint8x16_t b0 = vld1q_u8(unlit);
+            uint8x16_t b1 = vld1q_u8(unlit + 16);
+            uint8x16_t b2 = vld1q_u8(unlit + 32);
+            uint8x16_t b3 = vld1q_u8(unlit + 48);
+            vst1q_u8(dst     , vqsubq_u8(a0, b0));
+            vst1q_u8(dst + 16, vqsubq_u8(a1, b1));
+            vst1q_u8(dst + 32, vqsubq_u8(a2, b2));
+            vst1q_u8(dst + 48, vqsubq_u8(a3, b3));
+        }
+        n &= 63;
+#endif
+        //remainder (or all, when NEON is not built)
+        if (n)
+            subtractRowScalar(dst, lit, unlit, n);
+    }
+    
+    void accumulateRowNEON(uint16_t *acc, const uint8_t *add, const uint8_t *sub, unsigned int n) {
+#ifdef FLASHCAM_COPY_NEON_BUILT
+        // 16 bytes (32 bytes of `acc`) per iteration: widening adds / subtractions
+        unsigned int blocks = n >> 4;
+        if (sub) {
+            for (unsigned int i=0; i<blocks; i++, acc += 16, add += 16, sub += 16) {
+                __builtin_prefetch(add + 256);
+                __builtin_prefetch(sub + 256);
+                uint8x16_t a  = vld1q_u8(add);
+                uint8x16_t s  = vld1q_u8(sub);
+                uint16x8_t lo = vld1q_u16(acc);
+                uint16x8_t hi = vld1q_u16(acc + 8);
+                vst1q_u16(acc    , vsubw_u8(vaddw_u8(lo, vget_low_u8(a)),  vget_low_u8(s)));
+                vst1q_u16(acc + 8, vsubw_u8(vaddw_u8(hi, vget_high_u8(a)), vget_high_u8(s)));
+            }
+        } else {
+            for (unsigned int i=0; i<blocks; i++, acc += 16, add += 16) {
+                __builtin_prefetch(add + 256);
+                uint8x16_t a  = vld1q_u8(add);
+                uint16x8_t lo = vld1q_u16(acc);
+                uint16x8_t hi = vld1q_u16(acc + 8);
+                vst1q_u16(acc    , vaddw_u8(lo, vget_low_u8(a)));
+                vst1q_u16(acc + 8, vaddw_u8(hi, vget_high_u8(a)));
+            }
+        }
+        n &= 15;
+#endif
+        //remainder (or all, when NEON is not built)
+        if (n)
+            accumulateRowScalar(acc, add, sub, n);
+    }
+    
+    void averageRowNEON(uint16_t *acc, const uint8_t *in, unsigned int shift, unsigned int n) {
+#ifdef FLASHCAM_COPY_NEON_BUILT
+        // 16 bytes per iteration: signed 16-bit difference, rounding shift (vrshl with a negative count)
+        int16x8_t    count  = vdupq_n_s16(-((int16_t) shift));
+        unsigned int blocks = n >> 4;
+        for (unsigned int i=0; i<blocks; i++, acc += 16, in += 16) {
+            __builtin_prefetch(in + 256);
+            uint8x16_t x  = vld1q_u8(in);
+            int16x8_t  lo = vreinterpretq_s16_u16(vld1q_u16(acc));
+            int16x8_t  hi = vreinterpretq_s16_u16(vld1q_u16(acc + 8));
+            int16x8_t  dl = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(vget_low_u8(x),  FLASHCAM_COPY_AVERAGE_BITS)), lo);
+            int16x8_t  dh = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(vget_high_u8(x), FLASHCAM_COPY_AVERAGE_BITS)), hi);
+            vst1q_u16(acc    , vreinterpretq_u16_s16(vaddq_s16(lo, vrshlq_s16(dl, count))));
+            vst1q_u16(acc + 8, vreinterpretq_u16_s16(vaddq_s16(hi, vrshlq_s16(dh, count))));
+        }
+        n &= 15;
+#endif
+        //remainder (or all, when NEON is not built)
+        if (n)
+            averageRowScalar(acc, in, shift, n);
+    }
+}
@@ -0,0 +1,141 @@
+/**********************************************************
+ Software developed by Hessel van der Molen
+ Main author Hessel van der Molen (hmolen.science at gmail dot com)
+ This software is released under BSD license as expressed below
+ -------------------------------------------------------------------
+ Copyright (c) 2017, Hessel van der Molen
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+ must display the following acknowledgement:
+ 
+ This product includes software developed by Hessel van der Molen
+ 
+ 4. None of the names of the author or irs contributors
+ may be used to endorse or promote products derived from this software
+ without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY Hessel van der Molen ''AS IS'' AND ANY
+ EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL AVA BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ****************************************************************/
+
+// SSE2 row kernels. This unit is built with SSE2 enabled (see CMakeLists.txt); they are only
+//  called when the CPU reports SSE2 support, see FlashCamUtilCopy::setKernel().
+
+#include "FlashCam_util_copy.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FLASHCAM_COPY_SSE2_BUILT 1
+#endif
+
+namespace FlashCamUtilCopy {
+    
+    bool builtSSE2() {
+#ifdef FLASHCAM_COPY_SSE2_BUILT
+        return true;
+#else
+        return false;
+#endif
+    }
+    
+    void subtractRowSSE2(uint8_t *dst, const uint8_t *lit, const uint8_t *unlit, unsigned int n) {
+#ifdef FLASHCAM_COPY_SSE2_BUILT
+        // 64 bytes per iteration, all loads before the stores: `dst` may be `lit` or `unlit`
+        unsigned int blocks = n >> 6;
+        for (unsigned int i=0; i<blocks; i++, dst += 64, lit += 64, unlit += 64) {
+            __m128i a0 = _mm_loadu_si128((const __m128i *) (lit));
+            __m128i a1 = _mm_loadu_si128((const __m128i *) (lit + 16));
+            __m128i a2 = _mm_loadu_si128((const __m128i *) (lit + 32));
+            __m128i a3 = _mm_loadu_si128((const __m128i *) (lit + 48));
+            __m128i b0 = _mm_loadu_si128((const __m128i *) (unlit));
+            __m128i b1 = _mm_loadu_si128((const __m128i *) (unlit + 16));
+            __m128i b2 = _mm_loadu_si128((const __m128i *) (unlit + 32));
+            __m128i b3 = _mm_loadu_si128((const __m128i *) (unlit + 48));
+            _mm_storeu_si128((__m128i *) (dst     ), _mm_subs_epu8(a0, b0));
+            _mm_storeu_si128((__m128i *) (dst + 16), _mm_subs_epu8(a1, b1));
+            _mm_storeu_si128((__m128i *) (dst + 32), _mm_subs_epu8(a2, b2));
+            _mm_storeu_si128((__m128i *) (dst + 48), _mm_subs_epu8(a3, b3));
+        }
+        n &= 63;
+#endif
+        //remainder (or all, when SSE2 is not built)
+        if (n)
+            subtractRowScalar(dst, lit, unlit, n);
+    }
+    
+    void accumulateRowSSE2(uint16_t *acc, const uint8_t *add, const uint8_t *sub, unsigned int n) {
+#ifdef FLASHCAM_COPY_SSE2_BUILT
+        // 16 bytes (32 bytes of `acc`) per iteration: bytes are widened by unpacking with zero
+        const __m128i zero   = _mm_setzero_si128();
+        unsigned int  blocks = n >> 4;
+        if (sub) {
+            for (unsigned int i=0; i<blocks; i++, acc += 16, add += 16, sub += 16) {
+                __m128i a  = _mm_loadu_si128((const __m128i *) (add));
+                __m128i s  = _mm_loadu_si128((const __m128i *) (sub));
+                __m128i lo = _mm_loadu_si128((const __m128i *) (acc));
+                __m128i hi = _mm_loadu_si128((const __m128i *) (acc + 8));
+                lo = _mm_sub_epi16(_mm_add_epi16(lo, _mm_unpacklo_epi8(a, zero)), _mm_unpacklo_epi8(s, zero));
+                hi = _mm_sub_epi16(_mm_add_epi16(hi, _mm_unpackhi_epi8(a, zero)), _mm_unpackhi_epi8(s, zero));
+                _mm_storeu_si128((__m128i *) (acc    ), lo);
+                _mm_storeu_si128((__m128i *) (acc + 8), hi);
+            }
+        } else {
+            for (unsigned int i=0; i<blocks; i++, acc += 16, add += 16) {
+                __m128i a  = _mm_loadu_si128((const __m128i *) (add));
+                __m128i lo = _mm_loadu_si128((const __m128i *) (acc));
+                __m128i hi = _mm_loadu_si128((const __m128i *) (acc + 8));
+                _mm_storeu_si128((__m128i *) (acc    ), _mm_add_epi16(lo, _mm_unpacklo_epi8(a, zero)));
+                _mm_storeu_si128((__m128i *) (acc + 8), _mm_add_epi16(hi, _mm_unpackhi_epi8(a, zero)));
+            }
+        }
+        n &= 15;
+#endif
+        //remainder (or all, when SSE2 is not built)
+        if (n)
+            accumulateRowScalar(acc, add, sub, n);
+    }
+    
+    void averageRowSSE2(uint16_t *acc, const uint8_t *in, unsigned int shift, unsigned int n) {
+#ifdef FLASHCAM_COPY_SSE2_BUILT
+        // 16 bytes per iteration. Rounding shift without overflow of d + 2^(shift-1): t = d >> (shift - 1), (t + 1) >> 1
+        if (shift) {
+            const __m128i zero   = _mm_setzero_si128();
+            const __m128i one    = _mm_set1_epi16(1);
+            const __m128i count  = _mm_cvtsi32_si128(shift - 1);
+            unsigned int  blocks = n >> 4;
+            for (unsigned int i=0; i<blocks; i++, acc += 16, in += 16) {
+                __m128i x  = _mm_loadu_si128((const __m128i *) (in));
+                __m128i lo = _mm_loadu_si128((const __m128i *) (acc));
+                __m128i hi = _mm_loadu_si128((const __m128i *) (acc + 8));
+                __m128i dl = _mm_sub_epi16(_mm_slli_epi16(_mm_unpacklo_epi8(x, zero), FLASHCAM_COPY_AVERAGE_BITS), lo);
+                __m128i dh = _mm_sub_epi16(_mm_slli_epi16(_mm_unpackhi_epi8(x, zero), FLASHCAM_COPY_AVERAGE_BITS), hi);
+                dl = _mm_srai_epi16(_mm_add_epi16(_mm_sra_epi16(dl, count), one), 1);
+                dh = _mm_srai_epi16(_mm_add_epi16(_mm_sra_epi16(dh, count), one), 1);
+                _mm_storeu_si128((__m128i *) (acc    ), _mm_add_epi16(lo, dl));
+                _mm_storeu_si128((__m128i *) (acc + 8), _mm_add_epi16(hi, dh));
+            }
+            n &= 15;
+        }
+#endif
+        //remainder (or all, when SSE2 is not built or `acc` is set)
+        if (n)
+            averageRowScalar(acc, in, shift, n);
+    }
+}
@@ -18,27 +18,29 @@
 
 namespace FlashCamUtilOpenGL {
         
-    static GLuint progid_oes2rgb        = 0;
-    static GLuint progid_oes2rgb_packed = 0;
-    static GLuint progid_rgbblur        = 0;
-    static GLuint progid_rgbsobel       = 0;
-    static GLuint vbufid                = 0;
-    static GLuint fbufid                = 0;
+    // EGL contexts are bound to a thread: every FlashCamOpenGL-worker (one per FlashCam instance)
+    //  initialises and uses its own display/context/programs, hence all state is thread-local.
+    static thread_local GLuint progid_oes2rgb        = 0;
+    static thread_local GLuint progid_oes2rgb_packed = 0;
+    static thread_local GLuint progid_rgbblur        = 0;
+    static thread_local GLuint progid_rgbsobel       = 0;
+    static thread_local GLuint vbufid                = 0;
+    static thread_local GLuint fbufid                = 0;
     
-    static std::vector<GLuint> textures;
+    static thread_local std::vector<GLuint> textures;
     
     //OpenGL settings
-    static EGLDisplay _display;                 /// The current EGL display
-    static EGLSurface _surface;                 /// The current EGL surface
-    static EGLContext _context;                 /// The current EGL context
+    static thread_local EGLDisplay _display;                 /// The current EGL display
+    static thread_local EGLSurface _surface;                 /// The current EGL surface
+    static thread_local EGLContext _context;                 /// The current EGL context
     //size
-    static unsigned int _width      = 0;
-    static unsigned int _height     = 0;
-    static bool _packed             = false;
+    static thread_local unsigned int _width      = 0;
+    static thread_local unsigned int _height     = 0;
+    static thread_local bool _packed             = false;
     
-    static bool initialised         = false;
+    static thread_local bool initialised         = false;
     
-    static FLASHCAM_CALLBACK_OPENGL_DESTROY_T _callback;
+    static thread_local FLASHCAM_CALLBACK_OPENGL_DESTROY_T _callback;
     
     // 2D vertex shader.    
 #define SRC_VSHADER_2D \